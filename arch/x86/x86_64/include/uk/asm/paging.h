@@ -186,6 +186,7 @@ static inline int ukarch_vaddr_range_isvalid(__vaddr_t start, __vaddr_t end)
 #define PAGE_ATTR_PROT_READ		0x01 /* Page is readable */
 #define PAGE_ATTR_PROT_WRITE		0x02 /* Page is writeable */
 #define PAGE_ATTR_PROT_EXEC		0x04 /* Page is executable */
+#define PAGE_ATTR_NOCACHE		0x08 /* Page is uncached (MMIO) */
 
 #ifndef CONFIG_PARAVIRT
 #ifndef __ASSEMBLY__
@@ -34,6 +34,7 @@
 
 #include <uk/config.h>
 #include <uk/essentials.h>
+#include <uk/arch/types.h>
 #include <uk/prio.h>
 
 #ifdef __cplusplus
@@ -42,6 +43,18 @@ extern "C" {
 
 typedef int (*uk_init_func_t)(void);
 
+/**
+ * Entry of the init table (uk_inittab)
+ */
+struct uk_inittab_entry {
+	/* Initialization function */
+	uk_init_func_t init;
+	/* Initialization class (UK_INIT_CLASS_*) */
+	__u8 initclass;
+	/* Priority level within the class */
+	__u8 initprio;
+};
+
 /**
  * Register a Unikraft init function that is
  * called during bootstrap (uk_inittab)
@@ -56,9 +69,13 @@ typedef int (*uk_init_func_t)(void);
  *   Note: Any other value for level will be ignored
  */
 #define __UK_INITTAB(fn, base, prio)					\
-	static const uk_init_func_t					\
+	static const struct uk_inittab_entry				\
 	__used __section(".uk_inittab" #base #prio)			\
-	__uk_inittab ## base ## prio ## _ ## fn = (fn)
+	__uk_inittab ## base ## prio ## _ ## fn = {			\
+		.init = (fn),						\
+		.initclass = (base),					\
+		.initprio = (prio),					\
+	}
 
 #define _UK_INITTAB(fn, base, prio)					\
 	__UK_INITTAB(fn, base, prio)
@@ -117,23 +134,22 @@ typedef int (*uk_init_func_t)(void);
 #define uk_sys_initcall(fn)       uk_sys_initcall_prio(fn, UK_PRIO_LATEST)
 #define uk_late_initcall(fn)      uk_late_initcall_prio(fn, UK_PRIO_LATEST)
 
-extern const uk_init_func_t uk_inittab_start[];
-extern const uk_init_func_t uk_inittab_end;
+extern const struct uk_inittab_entry uk_inittab_start[];
+extern const struct uk_inittab_entry uk_inittab_end;
 
 /**
- * Helper macro for iterating over init pointer tables
- * Please note that the table may contain NULL pointer entries
+ * Helper macro for iterating over init tables
  *
  * @param itr
- *   Iterator variable (uk_init_func_t *) which points to the individual
- *   table entries during iteration
+ *   Iterator variable (const struct uk_inittab_entry *) which points to the
+ *   individual table entries during iteration
  * @param inittab_start
- *   Start address of table (type: const uk_init_func_t[])
+ *   Start address of table (type: const struct uk_inittab_entry[])
  * @param inittab_end
- *   End address of table (type: const uk_init_func_t)
+ *   End address of table (type: const struct uk_inittab_entry)
  */
 #define uk_inittab_foreach(itr, inittab_start, inittab_end)	\
-	for ((itr) = DECONST(uk_init_func_t*, inittab_start);	\
+	for ((itr) = (inittab_start);				\
 	     (itr) < &(inittab_end);				\
 	     (itr)++)
 
@@ -34,6 +34,7 @@
 #ifndef __UKPLAT_TIME_H__
 #define __UKPLAT_TIME_H__
 
+#include <uk/config.h>
 #include <uk/arch/time.h>
 #include <stdint.h>
 
@@ -53,6 +54,17 @@ __nsec ukplat_wall_clock(void);
 #define UKPLAT_TIME_TICK_NSEC  (UKARCH_NSEC_PER_SEC / CONFIG_HZ)
 #define UKPLAT_TIME_TICK_MSEC  ukarch_time_nsec_to_msec(UKPLAT_TIME_TICK_NSEC)
 
+#if CONFIG_UKPLAT_VDSO
+/**
+ * Returns the ELF header of the vDSO image. The vDSO exports
+ * `__vdso_clock_gettime`, `__vdso_gettimeofday`, `__vdso_time`, and
+ * `__vdso_clock_getres`, which read the platform clock without a system
+ * call. Loaders of binary-compatible applications pass it as
+ * `AT_SYSINFO_EHDR` in the auxiliary vector.
+ */
+const void *ukplat_vdso_image(void);
+#endif /* CONFIG_UKPLAT_VDSO */
+
 #ifdef __cplusplus
 }
 #endif
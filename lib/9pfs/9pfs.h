@@ -34,16 +34,19 @@
 #define __UK_9PFS__
 
 #include <stdbool.h>
+#include <uk/config.h>
 #include <uk/9pdev.h>
 #include <uk/9pfid.h>
+#include <uk/9preq.h>
 
 #include <vfscore/prex.h>
 
 /*
- * Currently supports only the 9P2000.u variant of the protocol.
+ * Supported variants of the protocol.
  */
 enum uk_9pfs_proto {
 	UK_9P_PROTO_2000U,
+	UK_9P_PROTO_2000L,
 	UK_9P_PROTO_MAX
 };
 
@@ -75,6 +78,20 @@ struct uk_9pfs_file_data {
 	int                    readdir_off;
 	/* Total size of the data in the readdir buf. */
 	int                    readdir_sz;
+#if CONFIG_LIB9PFS_READAHEAD
+	/* Buffer holding data read ahead of the current file offset. */
+	char                   *ra_buf;
+	/* In-flight readahead request filling ra_buf, if any. */
+	struct uk_9preq        *ra_req;
+	/* File offset of the data in ra_buf. */
+	uint64_t               ra_off;
+	/* Amount of valid data in ra_buf. */
+	uint32_t               ra_len;
+	/* Node write generation at the time the readahead was issued. */
+	uint32_t               ra_gen;
+	/* Offset at which the next read is expected if access is sequential. */
+	uint64_t               ra_next;
+#endif
 };
 
 struct uk_9pfs_node_data {
@@ -84,6 +101,10 @@ struct uk_9pfs_node_data {
 	int                    nb_open_files;
 	/* Is a 9P remove call required when nb_open_files reaches 0? */
 	bool                   removed;
+	/* Fid opened for writing, shared by all writes to the node. */
+	struct uk_9pfid        *wfid;
+	/* Incremented on every write, invalidates readahead data. */
+	uint32_t               wgen;
 };
 
 int uk_9pfs_allocate_vnode_data(struct vnode *vp, struct uk_9pfid *fid);
@@ -96,5 +117,6 @@ void uk_9pfs_free_vnode_data(struct vnode *vp);
 #define UK_9PFS_ND(vnode) ((struct uk_9pfs_node_data *) (vnode)->v_data)
 #define UK_9PFS_VFID(vnode) (UK_9PFS_ND(vnode)->fid)
 #define UK_9PFS_MD(mount) ((struct uk_9pfs_mount_data *) (mount)->m_data)
+#define UK_9PFS_DOTL(mount) (UK_9PFS_MD(mount)->proto == UK_9P_PROTO_2000L)
 
 #endif /* __UK_9PFS__ */
@@ -37,6 +37,7 @@
 #include <vfscore/mount.h>
 #include <vfscore/dentry.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "9pfs.h"
 
@@ -69,36 +70,84 @@ static struct vfscore_fs_type uk_9pfs_fs = {
 UK_FS_REGISTER(uk_9pfs_fs);
 
 static const char *uk_9pfs_proto_str[UK_9P_PROTO_MAX] = {
-	[UK_9P_PROTO_2000U] = "9P2000.u"
+	[UK_9P_PROTO_2000U] = "9P2000.u",
+	[UK_9P_PROTO_2000L] = "9P2000.L"
 };
 
 static int uk_9pfs_parse_options(struct uk_9pfs_mount_data *md,
-		const void *data __unused)
+		const void *data)
 {
+	const char *opt = data;
+	const char *end;
+	size_t len;
 	int rc = 0;
 
 	md->trans = uk_9pdev_trans_get_default();
 	if (!md->trans)
 		goto out;
 
-	/* Currently, no options are supported. */
-
+#if CONFIG_LIB9PFS_PROTO_2000L
+	md->proto = UK_9P_PROTO_2000L;
+#else
 	md->proto = UK_9P_PROTO_2000U;
+#endif
 	md->uname = "";
 	md->aname = "";
 
+	/*
+	 * Only the protocol version can be selected, as in
+	 * "version=9p2000.L"; other options are ignored.
+	 */
+	while (opt && *opt) {
+		end = strchr(opt, ',');
+		len = end ? (size_t)(end - opt) : strlen(opt);
+
+		if (len == strlen("version=9p2000.L") &&
+		    !strncmp(opt, "version=9p2000.", 15)) {
+			if (opt[15] == 'L' || opt[15] == 'l')
+				md->proto = UK_9P_PROTO_2000L;
+			else if (opt[15] == 'u' || opt[15] == 'U')
+				md->proto = UK_9P_PROTO_2000U;
+			else
+				rc = EINVAL;
+		}
+
+		opt = end ? end + 1 : NULL;
+	}
+
 out:
 	return rc;
 }
 
+static int uk_9pfs_negotiate(struct uk_9pfs_mount_data *md)
+{
+	struct uk_9preq *version_req;
+	struct uk_9p_str rcvd_version;
+	int version_accepted;
+
+	version_req = uk_9p_version(md->dev, uk_9pfs_proto_str[md->proto],
+			&rcvd_version);
+	if (PTRISERR(version_req))
+		return -PTR2ERR(version_req);
+
+	version_accepted = uk_9p_str_equal(&rcvd_version,
+			uk_9pfs_proto_str[md->proto]);
+	uk_9pdev_req_remove(md->dev, version_req);
+
+	if (!version_accepted) {
+		uk_pr_warn("Could not negotiate protocol %s\n",
+				uk_9pfs_proto_str[md->proto]);
+		return EPROTONOSUPPORT;
+	}
+
+	return 0;
+}
+
 static int uk_9pfs_mount(struct mount *mp, const char *dev,
 			int flags __unused, const void *data)
 {
 	struct uk_9pfs_mount_data *md;
-	struct uk_9preq *version_req;
-	struct uk_9p_str rcvd_version;
 	struct uk_9pfid *rootfid;
-	int version_accepted;
 	int rc;
 
 	/* Set data as null, vnop_inactive() checks this for the root fid. */
@@ -122,22 +171,19 @@ static int uk_9pfs_mount(struct mount *mp, const char *dev,
 		goto out_free_mdata;
 	}
 
-	/* Create a new 9pfs session via a VERSION message. */
-	version_req = uk_9p_version(md->dev, uk_9pfs_proto_str[md->proto],
-			&rcvd_version);
-	if (PTRISERR(version_req)) {
-		rc = -PTR2ERR(version_req);
-		goto out_disconnect;
+	/*
+	 * Create a new 9pfs session via a VERSION message. Servers that do
+	 * not implement 9P2000.L still get a chance with 9P2000.u, a new
+	 * VERSION message resets the session.
+	 */
+	rc = uk_9pfs_negotiate(md);
+	if (rc == EPROTONOSUPPORT && md->proto == UK_9P_PROTO_2000L) {
+		md->proto = UK_9P_PROTO_2000U;
+		rc = uk_9pfs_negotiate(md);
 	}
-
-	version_accepted = uk_9p_str_equal(&rcvd_version,
-			uk_9pfs_proto_str[md->proto]);
-	uk_9pdev_req_remove(md->dev, version_req);
-
-	if (!version_accepted) {
-		rc = EIO;
-		uk_pr_warn("Could not negotiate protocol %s\n",
-				uk_9pfs_proto_str[md->proto]);
+	if (rc) {
+		if (rc == EPROTONOSUPPORT)
+			rc = EIO;
 		goto out_disconnect;
 	}
 
@@ -66,6 +66,26 @@ static uint32_t uk_9pfs_open_mode_from_posix_flags(int flags)
 	return mode;
 }
 
+static uint32_t uk_9pfs_dotl_flags_from_posix_flags(int flags)
+{
+	uint32_t dotl_flags = 0;
+	uint32_t flags_rw = flags & (UK_FREAD | UK_FWRITE);
+
+	if (flags_rw == UK_FREAD)
+		dotl_flags = UK_9P_DOTL_RDONLY;
+	else if (flags_rw == UK_FWRITE)
+		dotl_flags = UK_9P_DOTL_WRONLY;
+	else if (flags_rw == (UK_FREAD | UK_FWRITE))
+		dotl_flags = UK_9P_DOTL_RDWR;
+
+	if (flags & O_EXCL)
+		dotl_flags |= UK_9P_DOTL_EXCL;
+	if (flags & O_TRUNC)
+		dotl_flags |= UK_9P_DOTL_TRUNC;
+
+	return dotl_flags;
+}
+
 static int uk_9pfs_posix_perm_from_mode(int mode)
 {
 	int res;
@@ -125,6 +145,87 @@ static uint64_t uk_9pfs_ino(struct uk_9p_stat *stat)
 	return stat->qid.path;
 }
 
+/*
+ * 9P2000.L reports POSIX modes. Symbolic links and special files are shown
+ * as regular files, as with 9P2000.u.
+ */
+static int uk_9pfs_vtype_from_posix_mode(uint32_t mode)
+{
+	if (S_ISDIR(mode))
+		return VDIR;
+	return VREG;
+}
+
+static int uk_9pfs_getattr_fid(struct mount *mp, struct uk_9pfid *fid,
+		struct vattr *attr)
+{
+	struct uk_9pdev *dev = UK_9PFS_MD(mp)->dev;
+	struct uk_9p_attr lattr;
+	struct uk_9p_stat stat;
+	struct uk_9preq *stat_req;
+	int rc;
+
+	if (UK_9PFS_DOTL(mp)) {
+		rc = uk_9p_getattr(dev, fid, UK_9P_GETATTR_BASIC, &lattr);
+		if (rc)
+			return rc;
+
+		attr->va_type = uk_9pfs_vtype_from_posix_mode(lattr.mode);
+		attr->va_mode = lattr.mode & 07777;
+		if (attr->va_type == VDIR)
+			attr->va_mode |= S_IFDIR;
+		else
+			attr->va_mode |= S_IFREG;
+		attr->va_nodeid = lattr.qid.path;
+		attr->va_size = lattr.size;
+		attr->va_nlink = lattr.nlink;
+		attr->va_uid = lattr.uid;
+		attr->va_gid = lattr.gid;
+		attr->va_nblocks = lattr.blocks;
+
+		attr->va_atime.tv_sec = lattr.atime_sec;
+		attr->va_atime.tv_nsec = lattr.atime_nsec;
+		attr->va_mtime.tv_sec = lattr.mtime_sec;
+		attr->va_mtime.tv_nsec = lattr.mtime_nsec;
+		attr->va_ctime.tv_sec = lattr.ctime_sec;
+		attr->va_ctime.tv_nsec = lattr.ctime_nsec;
+
+		return 0;
+	}
+
+	stat_req = uk_9p_stat(dev, fid, &stat);
+	if (PTRISERR(stat_req))
+		return PTR2ERR(stat_req);
+
+	/* No stat string fields are used below. */
+	uk_9pdev_req_remove(dev, stat_req);
+
+	attr->va_type = uk_9pfs_vtype_from_mode(stat.mode);
+	attr->va_mode = uk_9pfs_posix_mode_from_mode(stat.mode);
+	attr->va_nodeid = uk_9pfs_ino(&stat);
+	attr->va_size = stat.length;
+
+	attr->va_atime.tv_sec = stat.atime;
+	attr->va_atime.tv_nsec = 0;
+	attr->va_mtime.tv_sec = stat.mtime;
+	attr->va_mtime.tv_nsec = 0;
+	attr->va_ctime.tv_sec = 0;
+	attr->va_ctime.tv_nsec = 0;
+
+	return 0;
+}
+
+static int uk_9pfs_open_fid(struct mount *mp, struct uk_9pfid *fid, int flags)
+{
+	struct uk_9pdev *dev = UK_9PFS_MD(mp)->dev;
+
+	if (UK_9PFS_DOTL(mp))
+		return uk_9p_lopen(dev, fid,
+				uk_9pfs_dotl_flags_from_posix_flags(flags));
+
+	return uk_9p_open(dev, fid, uk_9pfs_open_mode_from_posix_flags(flags));
+}
+
 int uk_9pfs_allocate_vnode_data(struct vnode *vp, struct uk_9pfid *fid)
 {
 	struct uk_9pfs_node_data *nd;
@@ -136,6 +237,8 @@ int uk_9pfs_allocate_vnode_data(struct vnode *vp, struct uk_9pfid *fid)
 	nd->fid = fid;
 	nd->nb_open_files = 0;
 	nd->removed = false;
+	nd->wfid = NULL;
+	nd->wgen = 0;
 	vp->v_data = nd;
 
 	return 0;
@@ -149,6 +252,9 @@ void uk_9pfs_free_vnode_data(struct vnode *vp)
 	if (!vp->v_data)
 		return;
 
+	if (nd->wfid)
+		uk_9pfid_put(nd->wfid);
+
 	if (nd->removed)
 		uk_9p_remove(dev, nd->fid);
 
@@ -178,8 +284,8 @@ static int uk_9pfs_open(struct vfscore_file *file)
 	}
 
 	/* Open cloned fid. */
-	rc = uk_9p_open(dev, openedfid,
-		uk_9pfs_open_mode_from_posix_flags(file->f_flags));
+	rc = uk_9pfs_open_fid(file->f_dentry->d_mount, openedfid,
+			file->f_flags);
 
 	if (rc)
 		goto out_err;
@@ -197,10 +303,20 @@ out:
 	return -rc;
 }
 
-static int uk_9pfs_close(struct vnode *vn __unused, struct vfscore_file *file)
+static int uk_9pfs_close(struct vnode *vn, struct vfscore_file *file)
 {
 	struct uk_9pfs_file_data *fd = UK_9PFS_FD(file);
 
+#if CONFIG_LIB9PFS_READAHEAD
+	/* The server may still be writing into the readahead buffer. */
+	if (fd->ra_req)
+		uk_9p_io_finish(UK_9PFS_MD(vn->v_mount)->dev, fd->ra_req);
+	if (fd->ra_buf)
+		free(fd->ra_buf);
+#else
+	(void)vn;
+#endif
+
 	if (fd->readdir_buf)
 		free(fd->readdir_buf);
 
@@ -216,8 +332,7 @@ static int uk_9pfs_lookup(struct vnode *dvp, char *name, struct vnode **vpp)
 	struct uk_9pdev *dev = UK_9PFS_MD(dvp->v_mount)->dev;
 	struct uk_9pfid *dfid = UK_9PFS_VFID(dvp);
 	struct uk_9pfid *fid;
-	struct uk_9p_stat stat;
-	struct uk_9preq *stat_req;
+	struct vattr attr;
 	struct vnode *vp;
 	int rc;
 
@@ -230,16 +345,11 @@ static int uk_9pfs_lookup(struct vnode *dvp, char *name, struct vnode **vpp)
 		goto out;
 	}
 
-	stat_req = uk_9p_stat(dev, fid, &stat);
-	if (PTRISERR(stat_req)) {
-		rc = PTR2ERR(stat_req);
+	rc = uk_9pfs_getattr_fid(dvp->v_mount, fid, &attr);
+	if (rc)
 		goto out_fid;
-	}
-
-	/* No stat string fields are used below. */
-	uk_9pdev_req_remove(dev, stat_req);
 
-	if (vfscore_vget(dvp->v_mount, uk_9pfs_ino(&stat), &vp)) {
+	if (vfscore_vget(dvp->v_mount, attr.va_nodeid, &vp)) {
 		/* Already in cache. */
 		rc = 0;
 		*vpp = vp;
@@ -254,9 +364,9 @@ static int uk_9pfs_lookup(struct vnode *dvp, char *name, struct vnode **vpp)
 	}
 
 	vp->v_flags = 0;
-	vp->v_mode = uk_9pfs_posix_mode_from_mode(stat.mode);
-	vp->v_type = uk_9pfs_vtype_from_mode(stat.mode);
-	vp->v_size = stat.length;
+	vp->v_mode = attr.va_mode;
+	vp->v_type = attr.va_type;
+	vp->v_size = attr.va_size;
 
 	rc = uk_9pfs_allocate_vnode_data(vp, fid);
 	if (rc != 0)
@@ -289,11 +399,24 @@ static int uk_9pfs_create_generic(struct vnode *dvp, char *name, mode_t mode)
 	if (strlen(name) > NAME_MAX)
 		return ENAMETOOLONG;
 
+	/* 9P2000.L creates directories without having to open them. */
+	if (UK_9PFS_DOTL(dvp->v_mount) && S_ISDIR(mode))
+		return -uk_9p_mkdir(dev, UK_9PFS_VFID(dvp), name, mode & 07777,
+				0);
+
 	/* Clone parent fid. */
 	fid = uk_9p_walk(dev, UK_9PFS_VFID(dvp), NULL);
+	if (PTRISERR(fid))
+		return -PTR2ERR(fid);
 
-	rc = uk_9p_create(dev, fid, name, uk_9pfs_perm_from_posix_mode(mode),
-			UK_9P_OTRUNC | UK_9P_OWRITE, NULL);
+	if (UK_9PFS_DOTL(dvp->v_mount))
+		rc = uk_9p_lcreate(dev, fid, name,
+				UK_9P_DOTL_WRONLY | UK_9P_DOTL_TRUNC,
+				mode & 07777, 0);
+	else
+		rc = uk_9p_create(dev, fid, name,
+				uk_9pfs_perm_from_posix_mode(mode),
+				UK_9P_OTRUNC | UK_9P_OWRITE, NULL);
 
 	uk_9pfid_put(fid);
 	return -rc;
@@ -348,8 +471,11 @@ static int uk_9pfs_readdir(struct vnode *vp, struct vfscore_file *fp,
 {
 	struct uk_9pdev *dev = UK_9PFS_MD(vp->v_mount)->dev;
 	struct uk_9pfs_file_data *fd = UK_9PFS_FD(fp);
+	bool dotl = UK_9PFS_DOTL(vp->v_mount);
 	int rc;
 	struct uk_9p_stat stat;
+	struct uk_9p_dirent dirent;
+	struct uk_9p_str *name;
 	struct uk_9preq fake_request;
 
 again:
@@ -365,8 +491,17 @@ again:
 
 	if (fd->readdir_off == fd->readdir_sz) {
 		fd->readdir_off = 0;
-		fd->readdir_sz = uk_9p_read(dev, fd->fid, fp->f_offset,
-				UK_9PFS_READDIR_BUFSZ, fd->readdir_buf);
+		/*
+		 * With 9P2000.L, the file offset is the offset of the last
+		 * consumed directory entry, as returned by the server.
+		 */
+		if (dotl)
+			fd->readdir_sz = uk_9p_readdir(dev, fd->fid,
+					fp->f_offset, UK_9PFS_READDIR_BUFSZ,
+					fd->readdir_buf);
+		else
+			fd->readdir_sz = uk_9p_read(dev, fd->fid, fp->f_offset,
+					UK_9PFS_READDIR_BUFSZ, fd->readdir_buf);
 		if (fd->readdir_sz < 0) {
 			rc = fd->readdir_sz;
 			goto out;
@@ -382,18 +517,22 @@ again:
 		 * Update offset for the next readdir() call which requires
 		 * the next chunk of data to be transferred.
 		 */
-		fp->f_offset += fd->readdir_sz;
+		if (!dotl)
+			fp->f_offset += fd->readdir_sz;
 	}
 
 	/*
 	 * Build a fake request to use the 9P request API to read from the
-	 * buffer the stat structure.
+	 * buffer the stat structure or the directory entry.
 	 */
 	fake_request.recv.buf = fd->readdir_buf;
 	fake_request.recv.size = fd->readdir_sz;
 	fake_request.recv.offset = fd->readdir_off;
 	fake_request.state = UK_9PREQ_RECEIVED;
-	rc = uk_9preq_readstat(&fake_request, &stat);
+	if (dotl)
+		rc = uk_9preq_readdirent(&fake_request, &dirent);
+	else
+		rc = uk_9preq_readstat(&fake_request, &stat);
 
 	if (rc == -ENOBUFS) {
 		/*
@@ -418,21 +557,227 @@ again:
 		goto out;
 	}
 
-	dir->d_type = uk_9pfs_dttype_from_mode(stat.mode);
-	dir->d_ino = uk_9pfs_ino(&stat);
-	strlcpy((char *) &dir->d_name, stat.name.data,
-			MIN(sizeof(dir->d_name), stat.name.size + 1U));
+	if (dotl) {
+		fp->f_offset = dirent.offset;
+		dir->d_type = dirent.type;
+		dir->d_ino = dirent.qid.path;
+		name = &dirent.name;
+	} else {
+		dir->d_type = uk_9pfs_dttype_from_mode(stat.mode);
+		dir->d_ino = uk_9pfs_ino(&stat);
+		name = &stat.name;
+	}
+	strlcpy((char *) &dir->d_name, name->data,
+			MIN(sizeof(dir->d_name), name->size + 1U));
 
 out:
 	return -rc;
 }
 
+/*
+ * Advances the uio past n bytes that were transferred in place.
+ */
+static void uk_9pfs_uio_advance(struct uio *uio, size_t n)
+{
+	struct iovec *iov;
+	size_t cnt;
+
+	uio->uio_resid -= n;
+	uio->uio_offset += n;
+
+	while (n) {
+		iov = uio->uio_iov;
+		cnt = MIN(iov->iov_len, n);
+		iov->iov_base = (char *)iov->iov_base + cnt;
+		iov->iov_len -= cnt;
+		n -= cnt;
+
+		if (!iov->iov_len) {
+			uio->uio_iov++;
+			uio->uio_iovcnt--;
+		}
+	}
+}
+
+struct uk_9pfs_io {
+	struct uk_9preq *req;
+	uint32_t len;
+};
+
+/*
+ * Transfers up to limit bytes between the file and the buffers of uio,
+ * starting at the uio offset. The transfer is split into chunks of at most
+ * one message. Reads keep up to CONFIG_LIB9PFS_MAX_INFLIGHT requests in
+ * flight, writes one. Replies are consumed in order; a short transfer ends
+ * the operation and the remaining replies are discarded.
+ */
+static int uk_9pfs_rw(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		struct uio *uio, size_t limit)
+{
+	struct uk_9pfs_io io[CONFIG_LIB9PFS_MAX_INFLIGHT];
+	bool write = uio->uio_rw == UIO_WRITE;
+	unsigned int depth;
+	struct iovec *iov = uio->uio_iov;
+	int iovcnt = uio->uio_iovcnt;
+	uint64_t offset = uio->uio_offset;
+	size_t transferred = 0;
+	unsigned int head = 0, nr = 0, slot;
+	char *pos = NULL;
+	size_t left = 0;
+	uint32_t chunk, len;
+	struct uk_9preq *req;
+	bool done = false;
+	int64_t res;
+	int rc = 0;
+
+	chunk = write ? uk_9p_write_iosize(dev, fid)
+		      : uk_9p_read_iosize(dev, fid);
+
+	/*
+	 * A write chunk must only be sent once all earlier chunks have been
+	 * written in full. Otherwise a short or failed reply could leave data
+	 * in the file beyond the byte count reported to the caller.
+	 */
+	depth = write ? 1 : ARRAY_SIZE(io);
+
+	for (;;) {
+		/* Keep the pipeline full. */
+		while (!done && limit && nr < depth) {
+			/*
+			 * The submission cursor is always ahead of completed
+			 * data, so iovecs it moves to are still untouched.
+			 */
+			while (!left && iovcnt) {
+				pos = iov->iov_base;
+				left = iov->iov_len;
+				iov++;
+				iovcnt--;
+			}
+			if (!left)
+				break;
+
+			len = MIN3(chunk, left, limit);
+			if (write)
+				req = uk_9p_write_start(dev, fid, offset, len,
+						pos);
+			else
+				req = uk_9p_read_start(dev, fid, offset, len,
+						pos);
+			if (PTRISERR(req)) {
+				rc = PTR2ERR(req);
+				done = true;
+				break;
+			}
+
+			slot = (head + nr) % ARRAY_SIZE(io);
+			io[slot].req = req;
+			io[slot].len = len;
+			nr++;
+
+			pos += len;
+			left -= len;
+			limit -= len;
+			offset += len;
+		}
+
+		if (!nr)
+			break;
+
+		res = uk_9p_io_finish(dev, io[head].req);
+		len = io[head].len;
+		head = (head + 1) % ARRAY_SIZE(io);
+		nr--;
+
+		if (done)
+			continue;
+		if (res < 0) {
+			rc = res;
+			done = true;
+			continue;
+		}
+
+		uk_9pfs_uio_advance(uio, res);
+		transferred += res;
+		if ((uint32_t)res < len)
+			done = true;
+	}
+
+	/* Report partial transfers, like POSIX read() and write(). */
+	return transferred ? 0 : rc;
+}
+
+#if CONFIG_LIB9PFS_READAHEAD
+/*
+ * Serves the beginning of a read from the readahead buffer, if it holds data
+ * at the current offset. Any readahead in flight is completed first.
+ */
+static void uk_9pfs_readahead_consume(struct uk_9pdev *dev,
+		struct uk_9pfs_node_data *nd, struct uk_9pfs_file_data *fd,
+		struct uio *uio)
+{
+	uint64_t skip;
+	int64_t res;
+	size_t len;
+
+	if (fd->ra_req) {
+		res = uk_9p_io_finish(dev, fd->ra_req);
+		fd->ra_req = NULL;
+		fd->ra_len = res > 0 ? res : 0;
+	}
+
+	/* Writes since the readahead was issued make its data stale. */
+	if (fd->ra_gen != nd->wgen)
+		fd->ra_len = 0;
+
+	if ((uint64_t)uio->uio_offset < fd->ra_off ||
+	    (uint64_t)uio->uio_offset >= fd->ra_off + fd->ra_len)
+		return;
+
+	skip = uio->uio_offset - fd->ra_off;
+	len = MIN(fd->ra_len - skip, (size_t)uio->uio_resid);
+	vfscore_uiomove(fd->ra_buf + skip, len, uio);
+}
+
+/*
+ * Requests the data following a sequential read in the background.
+ */
+static void uk_9pfs_readahead_start(struct uk_9pdev *dev, struct vnode *vp,
+		struct uk_9pfs_file_data *fd, uint64_t offset)
+{
+	struct uk_9preq *req;
+	uint32_t len;
+
+	if (offset >= (uint64_t)vp->v_size)
+		return;
+
+	len = MIN(CONFIG_LIB9PFS_READAHEAD_SIZE,
+		  uk_9p_read_iosize(dev, fd->fid));
+
+	if (!fd->ra_buf) {
+		fd->ra_buf = malloc(len);
+		if (!fd->ra_buf)
+			return;
+	}
+
+	req = uk_9p_read_start(dev, fd->fid, offset, len, fd->ra_buf);
+	if (PTRISERR(req))
+		return;
+
+	fd->ra_req = req;
+	fd->ra_off = offset;
+	fd->ra_len = 0;
+	fd->ra_gen = UK_9PFS_ND(vp)->wgen;
+}
+#endif /* CONFIG_LIB9PFS_READAHEAD */
+
 static int uk_9pfs_read(struct vnode *vp, struct vfscore_file *fp,
 			struct uio *uio, int ioflag __unused)
 {
 	struct uk_9pdev *dev = UK_9PFS_MD(vp->v_mount)->dev;
-	struct uk_9pfid *fid = UK_9PFS_FD(fp)->fid;
-	struct iovec *iov;
+	struct uk_9pfs_file_data *fd = UK_9PFS_FD(fp);
+#if CONFIG_LIB9PFS_READAHEAD
+	bool sequential;
+#endif
 	int rc;
 
 	if (vp->v_type == VDIR)
@@ -447,30 +792,33 @@ static int uk_9pfs_read(struct vnode *vp, struct vfscore_file *fp,
 	if (!uio->uio_resid)
 		return 0;
 
-	iov = uio->uio_iov;
-	while (!iov->iov_len) {
-		uio->uio_iov++;
-		uio->uio_iovcnt--;
-	}
-
-	rc = uk_9p_read(dev, fid, uio->uio_offset,
-			   iov->iov_len, iov->iov_base);
-	if (rc < 0)
-		return -rc;
+#if CONFIG_LIB9PFS_READAHEAD
+	sequential = (uint64_t)uio->uio_offset == fd->ra_next;
+	uk_9pfs_readahead_consume(dev, UK_9PFS_ND(vp), fd, uio);
+#endif
 
-	iov->iov_base = (char *)iov->iov_base + rc;
-	iov->iov_len -= rc;
-	uio->uio_resid -= rc;
-	uio->uio_offset += rc;
+	rc = 0;
+	if (uio->uio_resid && uio->uio_offset < (off_t) vp->v_size)
+		rc = uk_9pfs_rw(dev, fd->fid, uio,
+				MIN((size_t)uio->uio_resid,
+				    (size_t)(vp->v_size - uio->uio_offset)));
+
+#if CONFIG_LIB9PFS_READAHEAD
+	fd->ra_next = uio->uio_offset;
+	if (!rc && sequential && !fd->ra_req &&
+	    ((uint64_t)uio->uio_offset < fd->ra_off ||
+	     (uint64_t)uio->uio_offset >= fd->ra_off + fd->ra_len))
+		uk_9pfs_readahead_start(dev, vp, fd, uio->uio_offset);
+#endif
 
-	return 0;
+	return -rc;
 }
 
 static int uk_9pfs_write(struct vnode *vp, struct uio *uio, int ioflag)
 {
 	struct uk_9pdev *dev = UK_9PFS_MD(vp->v_mount)->dev;
+	struct uk_9pfs_node_data *nd = UK_9PFS_ND(vp);
 	struct uk_9pfid *fid;
-	struct iovec *iov;
 	int rc;
 
 	if (vp->v_type == VDIR)
@@ -487,38 +835,26 @@ static int uk_9pfs_write(struct vnode *vp, struct uio *uio, int ioflag)
 	if (ioflag & IO_APPEND)
 		uio->uio_offset = vp->v_size;
 
-	/* Clone vnode fid. */
-	fid = uk_9p_walk(dev, UK_9PFS_VFID(vp), NULL);
-	if (PTRISERR(fid))
-		return -PTR2ERR(fid);
-
-	rc = uk_9p_open(dev, fid, UK_9P_OWRITE);
-	if (rc < 0)
-		goto out;
-
-	if (!uio->uio_resid)
-		return 0;
+	/*
+	 * The write vnop has no access to the opened file, so the node keeps
+	 * its own fid opened for writing, created on the first write.
+	 */
+	if (!nd->wfid) {
+		fid = uk_9p_walk(dev, nd->fid, NULL);
+		if (PTRISERR(fid))
+			return -PTR2ERR(fid);
+
+		rc = uk_9pfs_open_fid(vp->v_mount, fid, UK_FWRITE);
+		if (rc) {
+			uk_9pfid_put(fid);
+			return -rc;
+		}
 
-	iov = uio->uio_iov;
-	while (!iov->iov_len) {
-		uio->uio_iov++;
-		uio->uio_iovcnt--;
+		nd->wfid = fid;
 	}
 
-	rc = uk_9p_write(dev, fid, uio->uio_offset,
-			    iov->iov_len, iov->iov_base);
-	if (rc < 0)
-		return -rc;
-
-	iov->iov_base = (char *)iov->iov_base + rc;
-	iov->iov_len -= rc;
-	uio->uio_resid -= rc;
-	uio->uio_offset += rc;
-
-	if (rc < 0)
-		goto out;
-
-	rc = 0;
+	nd->wgen++;
+	rc = uk_9pfs_rw(dev, nd->wfid, uio, uio->uio_resid);
 
 	/*
 	 * If the uio offset after completion of the write requests is bigger
@@ -528,42 +864,20 @@ static int uk_9pfs_write(struct vnode *vp, struct uio *uio, int ioflag)
 	if (uio->uio_offset > vp->v_size)
 		vp->v_size = uio->uio_offset;
 
-out:
-	uk_9pfid_put(fid);
 	return -rc;
 }
 
 static int uk_9pfs_getattr(struct vnode *vp, struct vattr *attr)
 {
-	struct uk_9pdev *dev = UK_9PFS_MD(vp->v_mount)->dev;
-	struct uk_9pfid *fid = UK_9PFS_VFID(vp);
-	struct uk_9p_stat stat;
-	struct uk_9preq *stat_req;
-	int rc = 0;
-
-	stat_req = uk_9p_stat(dev, fid, &stat);
-	if (PTRISERR(stat_req)) {
-		rc = PTR2ERR(stat_req);
-		goto out;
-	}
+	int rc;
 
-	/* No stat string fields are used below. */
-	uk_9pdev_req_remove(dev, stat_req);
+	rc = uk_9pfs_getattr_fid(vp->v_mount, UK_9PFS_VFID(vp), attr);
+	if (rc)
+		return -rc;
 
-	attr->va_type = uk_9pfs_vtype_from_mode(stat.mode);
-	attr->va_mode = uk_9pfs_posix_mode_from_mode(stat.mode);
 	attr->va_nodeid = vp->v_ino;
-	attr->va_size = stat.length;
 
-	attr->va_atime.tv_sec = stat.atime;
-	attr->va_atime.tv_nsec = 0;
-	attr->va_mtime.tv_sec = stat.mtime;
-	attr->va_mtime.tv_nsec = 0;
-	attr->va_ctime.tv_sec = 0;
-	attr->va_ctime.tv_nsec = 0;
-
-out:
-	return -rc;
+	return 0;
 }
 
 #define uk_9pfs_seek		((vnop_seek_t)vfscore_vop_nullop)
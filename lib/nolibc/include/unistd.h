@@ -89,7 +89,10 @@ int fsync(int fd);
 int dup(int oldfd);
 int dup2(int oldfd, int newfd);
 int dup3(int oldfd, int newfd, int flags);
+int pipe(int pipefd[2]);
+int pipe2(int pipefd[2], int flags);
 int unlink(const char *pathname);
+int symlink(const char *target, const char *linkpath);
 off_t lseek(int fd, off_t offset, int whence);
 #endif
 
@@ -44,20 +44,78 @@
 #include <errno.h>
 #include <limits.h>
 
+/*
+ * Poll all fds for pending events without registering them for event
+ * signaling. Sets revents and returns the number of ready fds.
+ */
+static int ppoll_probe(struct pollfd *fds, int num_fds)
+{
+	struct vfscore_file *fp;
+	int i, fd, n = 0;
+
+	for (i = 0; i < num_fds; i++) {
+		fds[i].revents = 0;
+		fd = fds[i].fd;
+
+		/* A negative fd means we should ignore it */
+		if (fd < 0)
+			continue;
+
+		fp = vfscore_get_file(fd);
+		if (unlikely(!fp))
+			return -EBADF;
+
+		fds[i].revents = (short)eventpoll_probe(fp,
+				(unsigned short)fds[i].events);
+		vfscore_put_file(fp);
+
+		if (fds[i].revents)
+			n++;
+	}
+
+	return n;
+}
+
 static int do_ppoll(struct pollfd *fds, nfds_t nfds, const __nsec *timeout,
 		    const sigset_t *sigmask, size_t sigsetsize __unused)
 {
 	struct epoll_event e;
 	struct epoll_event *events = NULL;
 	struct eventpoll ep;
-	struct eventpoll_fd *efd;
+	struct eventpoll_fd *efds = NULL;
 	struct vfscore_file *fp;
 	int ret, i, fd, num_fds = (int)nfds;
 
 	if (unlikely(nfds > INT_MAX))
 		return -EINVAL;
 
-	eventpoll_init(&ep, uk_alloc_get_default());
+	/* TODO: Implement atomic masking of signals */
+	if (sigmask)
+		uk_pr_warn_once("%s: signal masking not implemented.",
+				__func__);
+
+	/* Fast path: if events are already pending or we must not block,
+	 * there is no need to set up an eventpoll.
+	 */
+	ret = ppoll_probe(fds, num_fds);
+	if (ret != 0 || (timeout && *timeout == 0))
+		return ret;
+
+	/* The eventpoll file descriptions and the returned events share a
+	 * single allocation that we own, so the eventpoll gets no allocator.
+	 */
+	eventpoll_init(&ep, NULL);
+
+	/* We may call poll with no fds to just do a precise wait */
+	if (num_fds > 0) {
+		efds = uk_malloc(uk_alloc_get_default(),
+				 num_fds * (sizeof(*efds) + sizeof(*events)));
+		if (unlikely(!efds)) {
+			ret = -ENOMEM;
+			goto EXIT;
+		}
+		events = (struct epoll_event *)(efds + num_fds);
+	}
 
 	/* Register fds in eventpoll */
 	for (i = 0; i < num_fds; i++) {
@@ -73,50 +131,28 @@ static int do_ppoll(struct pollfd *fds, nfds_t nfds, const __nsec *timeout,
 			goto EXIT;
 		}
 
-		efd = uk_malloc(uk_alloc_get_default(), sizeof(*efd));
-		if (unlikely(!efd)) {
-			vfscore_put_file(fp);
-			ret = -ENOMEM;
-			goto EXIT;
-		}
-
 		/* We can use the unsafe method of adding the fd to the
 		 * eventpoll because we know that nobody except us may access
 		 * the eventpoll.
 		 */
 		e.data.ptr = &fds[i].revents;
 		e.events = fds[i].events;
-		eventpoll_fd_init(efd, fp, fd, &e);
-		eventpoll_add_unsafe(&ep, efd);
+		eventpoll_fd_init(&efds[i], fp, fd, &e);
+		eventpoll_add_unsafe(&ep, &efds[i]);
 
 		/* We must add the fd to triggered list so it is
 		 * checked in eventpoll_wait(). This is ok because the
 		 * method will ignore the fd if it has no events
 		 * pending.
 		 */
-		uk_list_add_tail(&efd->tr_link, &ep.tr_list);
+		uk_list_add_tail(&efds[i].tr_link, &ep.tr_list);
 
 		vfscore_put_file(fp);
 	}
 
-	/* We may call poll with no fds to just do a precise wait */
-	if (num_fds > 0) {
-		events = uk_calloc(uk_alloc_get_default(), num_fds,
-				   sizeof(struct epoll_event));
-		if (unlikely(!events)) {
-			ret = -ENOMEM;
-			goto EXIT;
-		}
-	}
-
-	/* TODO: Implement atomic masking of signals */
-	if (sigmask)
-		uk_pr_warn_once("%s: signal masking not implemented.",
-				__func__);
-
 	ret = eventpoll_wait(&ep, events, num_fds, timeout);
 	if (unlikely(ret < 0))
-		goto ERR_FREE_EVENTS;
+		goto EXIT;
 
 	for (i = 0; i < num_fds; i++)
 		fds[i].revents = 0;
@@ -128,14 +164,13 @@ static int do_ppoll(struct pollfd *fds, nfds_t nfds, const __nsec *timeout,
 		UK_ASSERT(events[i].data.ptr);
 
 		/* We have a pointer to revents of the corresponding pollfd */
-		*((int *)events[i].data.ptr) = events[i].events;
+		*((short *)events[i].data.ptr) = events[i].events;
 	}
 
-ERR_FREE_EVENTS:
-	if (events)
-		uk_free(uk_alloc_get_default(), events);
 EXIT:
 	eventpoll_fini(&ep);
+	if (efds)
+		uk_free(uk_alloc_get_default(), efds);
 	return ret;
 }
 
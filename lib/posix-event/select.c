@@ -51,6 +51,105 @@
 #define POLLOUT_SET (EPOLLWRNORM | EPOLLWRBAND | EPOLLOUT | EPOLLERR)
 #define POLLEX_SET  (EPOLLPRI)
 
+static inline unsigned int select_events(int fd, fd_set *readfds,
+					 fd_set *writefds, fd_set *exceptfds)
+{
+	unsigned int events = 0;
+
+	if (readfds && FD_ISSET(fd, readfds))
+		events |= POLLIN_SET;
+
+	if (writefds && FD_ISSET(fd, writefds))
+		events |= POLLOUT_SET;
+
+	if (exceptfds && FD_ISSET(fd, exceptfds))
+		events |= POLLEX_SET;
+
+	return events;
+}
+
+/* Updates the fd sets for fd and returns the number of set bits */
+static inline int select_report(int fd, unsigned int revents, fd_set *readfds,
+				fd_set *writefds, fd_set *exceptfds)
+{
+	int ret = 0;
+
+	if (readfds && (revents & POLLIN_SET)) {
+		FD_SET(fd, readfds);
+		ret++;
+	}
+	if (writefds && (revents & POLLOUT_SET)) {
+		FD_SET(fd, writefds);
+		ret++;
+	}
+	if (exceptfds && (revents & POLLEX_SET)) {
+		FD_SET(fd, exceptfds);
+		ret++;
+	}
+
+	return ret;
+}
+
+static inline void select_clear(int fd, fd_set *readfds, fd_set *writefds,
+				fd_set *exceptfds)
+{
+	if (readfds)
+		FD_CLR(fd, readfds);
+	if (writefds)
+		FD_CLR(fd, writefds);
+	if (exceptfds)
+		FD_CLR(fd, exceptfds);
+}
+
+/*
+ * Poll all requested fds for pending events without registering them for
+ * event signaling. The fd sets are only modified if at least one fd is
+ * ready or `update` is set, in which case they contain the result. Returns
+ * the number of set bits and the number of watched fds in `num_fds`.
+ */
+static int select_probe(int nfds, fd_set *readfds, fd_set *writefds,
+			fd_set *exceptfds, int update, int *num_fds)
+{
+	struct vfscore_file *fp;
+	unsigned int events, revents;
+	int i, j, ret = 0;
+
+	*num_fds = 0;
+	for (i = 0; i < nfds; i++) {
+		events = select_events(i, readfds, writefds, exceptfds);
+		if (!events)
+			continue;
+
+		fp = vfscore_get_file(i);
+		if (unlikely(!fp))
+			return -EBADF;
+
+		revents = eventpoll_probe(fp, events);
+		vfscore_put_file(fp);
+		(*num_fds)++;
+
+		/* Ignore events that are not reported in any of the sets */
+		if (!((readfds && (revents & POLLIN_SET)) ||
+		      (writefds && (revents & POLLOUT_SET)) ||
+		      (exceptfds && (revents & POLLEX_SET))))
+			revents = 0;
+
+		if (!revents && !ret && !update)
+			continue;
+
+		if (!ret && !update) {
+			/* First ready fd: none of the previous fds is ready */
+			for (j = 0; j < i; j++)
+				select_clear(j, readfds, writefds, exceptfds);
+		}
+
+		select_clear(i, readfds, writefds, exceptfds);
+		ret += select_report(i, revents, readfds, writefds, exceptfds);
+	}
+
+	return ret;
+}
+
 static int do_pselect(int nfds, fd_set *readfds, fd_set *writefds,
 		      fd_set *exceptfds, const __nsec *timeout,
 		      const sigset_t *sigmask, size_t sigsetsize __unused)
@@ -58,7 +157,7 @@ static int do_pselect(int nfds, fd_set *readfds, fd_set *writefds,
 	struct epoll_event e = {0};
 	struct epoll_event *events = NULL;
 	struct eventpoll ep;
-	struct eventpoll_fd *efd;
+	struct eventpoll_fd *efds = NULL;
 	struct vfscore_file *fp;
 	int num_fds = 0;
 	int ret, i;
@@ -66,73 +165,71 @@ static int do_pselect(int nfds, fd_set *readfds, fd_set *writefds,
 	if (unlikely(nfds < 0))
 		return -EINVAL;
 
-	eventpoll_init(&ep, uk_alloc_get_default());
+	/* TODO: Implement atomic masking of signals */
+	if (sigmask)
+		uk_pr_warn_once("%s: signal masking not implemented.",
+				__func__);
 
-	/* Register fds in eventpoll */
-	for (i = 0; i < nfds; i++) {
-		if (readfds && FD_ISSET(i, readfds))
-			e.events |= POLLIN_SET;
-
-		if (writefds && FD_ISSET(i, writefds))
-			e.events |= POLLOUT_SET;
-
-		if (exceptfds && FD_ISSET(i, exceptfds))
-			e.events |= POLLEX_SET;
-
-		if (e.events) {
-			fp = vfscore_get_file(i);
-			if (unlikely(!fp)) {
-				ret = -EBADF;
-				goto EXIT;
-			}
-
-			efd = uk_malloc(uk_alloc_get_default(), sizeof(*efd));
-			if (unlikely(!efd)) {
-				vfscore_put_file(fp);
-				ret = -ENOMEM;
-				goto EXIT;
-			}
-
-			/* We can use the unsafe method of adding the fd to the
-			 * eventpoll because we know that nobody except us
-			 * may access the eventpoll.
-			 */
-			e.data.fd = i;
-			eventpoll_fd_init(efd, fp, i, &e);
-			eventpoll_add_unsafe(&ep, efd);
-
-			/* We must add the fd to triggered list so it is
-			 * checked in eventpoll_wait(). This is ok because the
-			 * method will ignore the fd if it has no events
-			 * pending.
-			 */
-			uk_list_add_tail(&efd->tr_link, &ep.tr_list);
-
-			vfscore_put_file(fp);
-
-			num_fds++;
-			e.events = 0;
-		}
-	}
+	/* Fast path: if events are already pending or we must not block,
+	 * there is no need to set up an eventpoll.
+	 */
+	ret = select_probe(nfds, readfds, writefds, exceptfds,
+			   timeout && *timeout == 0, &num_fds);
+	if (ret != 0 || (timeout && *timeout == 0))
+		return ret;
+
+	/* The eventpoll file descriptions and the returned events share a
+	 * single allocation that we own, so the eventpoll gets no allocator.
+	 */
+	eventpoll_init(&ep, NULL);
 
 	/* We may call select with no fds to just do a precise wait */
 	if (num_fds > 0) {
-		events = uk_calloc(uk_alloc_get_default(), num_fds,
-				   sizeof(struct epoll_event));
-		if (unlikely(!events)) {
+		efds = uk_malloc(uk_alloc_get_default(),
+				 num_fds * (sizeof(*efds) + sizeof(*events)));
+		if (unlikely(!efds)) {
 			ret = -ENOMEM;
 			goto EXIT;
 		}
+		events = (struct epoll_event *)(efds + num_fds);
 	}
 
-	/* TODO: Implement atomic masking of signals */
-	if (sigmask)
-		uk_pr_warn_once("%s: signal masking not implemented.",
-				__func__);
+	/* Register fds in eventpoll */
+	num_fds = 0;
+	for (i = 0; i < nfds; i++) {
+		e.events = select_events(i, readfds, writefds, exceptfds);
+		if (!e.events)
+			continue;
+
+		fp = vfscore_get_file(i);
+		if (unlikely(!fp)) {
+			ret = -EBADF;
+			goto EXIT;
+		}
+
+		/* We can use the unsafe method of adding the fd to the
+		 * eventpoll because we know that nobody except us
+		 * may access the eventpoll.
+		 */
+		e.data.fd = i;
+		eventpoll_fd_init(&efds[num_fds], fp, i, &e);
+		eventpoll_add_unsafe(&ep, &efds[num_fds]);
+
+		/* We must add the fd to triggered list so it is
+		 * checked in eventpoll_wait(). This is ok because the
+		 * method will ignore the fd if it has no events
+		 * pending.
+		 */
+		uk_list_add_tail(&efds[num_fds].tr_link, &ep.tr_list);
+
+		vfscore_put_file(fp);
+
+		num_fds++;
+	}
 
 	ret = eventpoll_wait(&ep, events, num_fds, timeout);
 	if (ret < 0)
-		goto ERR_FREE_EVENTS;
+		goto EXIT;
 
 	if (readfds)
 		FD_ZERO(readfds);
@@ -143,7 +240,7 @@ static int do_pselect(int nfds, fd_set *readfds, fd_set *writefds,
 
 	/* Timeout */
 	if (ret == 0)
-		goto ERR_FREE_EVENTS;
+		goto EXIT;
 
 	UK_ASSERT(ret <= num_fds);
 	num_fds = ret;
@@ -153,25 +250,14 @@ static int do_pselect(int nfds, fd_set *readfds, fd_set *writefds,
 		UK_ASSERT(events[i].events);
 		UK_ASSERT(events[i].data.fd < nfds);
 
-		if (readfds && (events[i].events & POLLIN_SET)) {
-			FD_SET(events[i].data.fd, readfds);
-			ret++;
-		}
-		if (writefds && (events[i].events & POLLOUT_SET)) {
-			FD_SET(events[i].data.fd, writefds);
-			ret++;
-		}
-		if (exceptfds && (events[i].events & POLLEX_SET)) {
-			FD_SET(events[i].data.fd, exceptfds);
-			ret++;
-		}
+		ret += select_report(events[i].data.fd, events[i].events,
+				     readfds, writefds, exceptfds);
 	}
 
-ERR_FREE_EVENTS:
-	if (events)
-		uk_free(uk_alloc_get_default(), events);
 EXIT:
 	eventpoll_fini(&ep);
+	if (efds)
+		uk_free(uk_alloc_get_default(), efds);
 	return ret;
 }
 
@@ -0,0 +1,932 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <vfscore/file.h>
+#include <vfscore/fs.h>
+#include <vfscore/dentry.h>
+#include <vfscore/vnode.h>
+#include <vfscore/mount.h>
+#include <vfscore/eventpoll.h>
+#include <uk/syscall.h>
+#include <uk/essentials.h>
+#include <uk/print.h>
+#include <uk/alloc.h>
+#include <uk/wait.h>
+#include <uk/mutex.h>
+#include <uk/list.h>
+#include <uk/thread.h>
+#include <uk/arch/atomic.h>
+#include <uk/plat/time.h>
+#include <uk/config.h>
+
+#include <sys/socket.h>
+#include <poll.h>
+#include <errno.h>
+
+#include "iouring.h"
+
+/* Not every libc defines the Linux-specific ETIME. Applications compare
+ * completions against the Linux value, so it must not be aliased.
+ */
+#ifndef ETIME
+#define ETIME 62
+#endif
+
+/*
+ * Layout of the ring memory provided by the application. The SQ and CQ ring
+ * headers share the first cache line, followed by the CQEs and the SQ index
+ * array. This matches the size that liburing computes for
+ * io_uring_queue_init_mem().
+ */
+struct io_uring_rings {
+	__u32 sq_head;
+	__u32 sq_tail;
+	__u32 sq_ring_mask;
+	__u32 sq_ring_entries;
+	__u32 sq_flags;
+	__u32 sq_dropped;
+	__u32 cq_head;
+	__u32 cq_tail;
+	__u32 cq_ring_mask;
+	__u32 cq_ring_entries;
+	__u32 cq_overflow;
+	__u32 cq_flags;
+	__u32 resv[4];
+	struct io_uring_cqe cqes[];
+};
+
+UK_CTASSERT(__offsetof(struct io_uring_rings, cqes) == 64);
+
+#define IORING_SETUP_SUPPORTED						\
+	(IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP |			\
+	 IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN |		\
+	 IORING_SETUP_TASKRUN_FLAG | IORING_SETUP_SINGLE_ISSUER |	\
+	 IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_NO_MMAP)
+
+#define IORING_FEAT_SUPPORTED						\
+	(IORING_FEAT_SINGLE_MMAP | IORING_FEAT_SUBMIT_STABLE |		\
+	 IORING_FEAT_POLL_32BITS | IORING_FEAT_EXT_ARG |		\
+	 IORING_FEAT_NATIVE_WORKERS)
+
+#define IORING_ENTER_SUPPORTED						\
+	(IORING_ENTER_GETEVENTS | IORING_ENTER_SQ_WAKEUP |		\
+	 IORING_ENTER_SQ_WAIT | IORING_ENTER_EXT_ARG)
+
+struct io_uring_ctx {
+	/** Allocator used for the context and asynchronous requests */
+	struct uk_alloc *a;
+	/** Ring headers and CQEs (application memory) */
+	struct io_uring_rings *rings;
+	/** SQ index array (application memory) */
+	__u32 *sq_array;
+	/** SQEs (application memory) */
+	struct io_uring_sqe *sqes;
+	__u32 sq_entries;
+	__u32 cq_entries;
+
+	/** Serializes concurrent submitters */
+	struct uk_mutex sq_lock;
+	/** Serializes posting of completions */
+	struct uk_mutex cq_lock;
+	/** Number of completions posted so far, used by timeouts */
+	__u32 cq_seq;
+	/** Wait queue for threads waiting for completions */
+	struct uk_waitq cq_wq;
+	/** List of registered eventpolls */
+	struct uk_list_head ep_list;
+
+	/** Protects the fields below */
+	struct uk_mutex work_lock;
+	/** Wait queue for idle workers */
+	struct uk_waitq work_wq;
+	/** Requests waiting for a worker */
+	struct uk_list_head work_list;
+	unsigned int nr_workers;
+	unsigned int idle_workers;
+	/** References held by the ring file and each worker */
+	unsigned int refcount;
+	/** Set when the ring file is closed */
+	int closing;
+};
+
+struct io_uring_req {
+	struct uk_list_head link;
+	/** Private copy of the submission entry */
+	struct io_uring_sqe sqe;
+	/** IORING_OP_TIMEOUT: absolute deadline */
+	__nsec deadline;
+	/** IORING_OP_TIMEOUT: completion sequence number to wait for */
+	__u32 target;
+};
+
+static uint64_t io_uring_inode;
+static struct uk_mutex io_uring_global_lock =
+	UK_MUTEX_INITIALIZER(io_uring_global_lock);
+
+static inline __u32 io_uring_roundup_pow2(__u32 v)
+{
+	return (v <= 1) ? 1 : (__u32)1 << (ukarch_flsl(v - 1) + 1);
+}
+
+static inline __u32 io_uring_cq_ready(struct io_uring_ctx *ctx)
+{
+	return UK_READ_ONCE(ctx->rings->cq_tail) -
+		UK_READ_ONCE(ctx->rings->cq_head);
+}
+
+static void io_uring_ctx_put(struct io_uring_ctx *ctx)
+{
+	struct io_uring_req *req, *tmp;
+	unsigned int refcount;
+
+	uk_mutex_lock(&ctx->work_lock);
+	refcount = --ctx->refcount;
+	uk_mutex_unlock(&ctx->work_lock);
+
+	if (refcount)
+		return;
+
+	/* Requests that did not get a worker before the ring was closed */
+	uk_list_for_each_entry_safe(req, tmp, &ctx->work_list, link)
+		uk_free(ctx->a, req);
+
+	uk_free(ctx->a, ctx);
+}
+
+static void io_uring_complete(struct io_uring_ctx *ctx, __u64 user_data,
+			      __s32 res)
+{
+	struct io_uring_rings *rings = ctx->rings;
+	struct io_uring_cqe *cqe;
+	struct eventpoll_cb *ecb;
+	struct uk_list_head *itr;
+	__u32 head, tail;
+
+	uk_mutex_lock(&ctx->cq_lock);
+
+	/* The ring memory belongs to the application and may be gone as soon
+	 * as the ring file is closed.
+	 */
+	if (unlikely(UK_READ_ONCE(ctx->closing))) {
+		uk_mutex_unlock(&ctx->cq_lock);
+		return;
+	}
+
+	tail = rings->cq_tail;
+	head = __atomic_load_n(&rings->cq_head, __ATOMIC_ACQUIRE);
+	if (unlikely(tail - head >= ctx->cq_entries)) {
+		UK_WRITE_ONCE(rings->cq_overflow, rings->cq_overflow + 1);
+	} else {
+		cqe = &rings->cqes[tail & (ctx->cq_entries - 1)];
+		cqe->user_data = user_data;
+		cqe->res = res;
+		cqe->flags = 0;
+		__atomic_store_n(&rings->cq_tail, tail + 1, __ATOMIC_RELEASE);
+	}
+	UK_WRITE_ONCE(ctx->cq_seq, ctx->cq_seq + 1);
+
+	uk_mutex_lock(&io_uring_global_lock);
+	uk_list_for_each(itr, &ctx->ep_list) {
+		ecb = uk_list_entry(itr, struct eventpoll_cb, cb_link);
+
+		UK_ASSERT(ecb->unregister);
+
+		eventpoll_signal(ecb, EPOLLIN);
+	}
+	uk_mutex_unlock(&io_uring_global_lock);
+
+	uk_mutex_unlock(&ctx->cq_lock);
+
+	uk_waitq_wake_up(&ctx->cq_wq);
+}
+
+/*
+ * Executes a request. The operations are routed through the system call
+ * handlers of vfscore, posix-socket, and posix-event, so a request behaves
+ * exactly like the corresponding system call (including blocking).
+ */
+static long io_uring_issue(struct io_uring_ctx *ctx, struct io_uring_req *req)
+{
+	const struct io_uring_sqe *sqe = &req->sqe;
+	void *addr = (void *)(__uptr)sqe->addr;
+	struct pollfd pfd;
+	long ret;
+	int timedout;
+
+	switch (sqe->opcode) {
+	case IORING_OP_NOP:
+		return 0;
+	case IORING_OP_READV:
+		if (sqe->off == (__u64)-1)
+			return uk_syscall_r_static(SYS_readv, sqe->fd, addr,
+						   sqe->len);
+		return uk_syscall_r_static(SYS_preadv, sqe->fd, addr,
+					   sqe->len, sqe->off);
+	case IORING_OP_WRITEV:
+		if (sqe->off == (__u64)-1)
+			return uk_syscall_r_static(SYS_writev, sqe->fd, addr,
+						   sqe->len);
+		return uk_syscall_r_static(SYS_pwritev, sqe->fd, addr,
+					   sqe->len, sqe->off);
+	case IORING_OP_READ:
+		if (sqe->off == (__u64)-1)
+			return uk_syscall_r_static(SYS_read, sqe->fd, addr,
+						   sqe->len);
+		return uk_syscall_r_static(SYS_pread64, sqe->fd, addr,
+					   sqe->len, sqe->off);
+	case IORING_OP_WRITE:
+		if (sqe->off == (__u64)-1)
+			return uk_syscall_r_static(SYS_write, sqe->fd, addr,
+						   sqe->len);
+		return uk_syscall_r_static(SYS_pwrite64, sqe->fd, addr,
+					   sqe->len, sqe->off);
+	case IORING_OP_FSYNC:
+		if (sqe->fsync_flags & IORING_FSYNC_DATASYNC)
+			return uk_syscall_r_static(SYS_fdatasync, sqe->fd);
+		return uk_syscall_r_static(SYS_fsync, sqe->fd);
+	case IORING_OP_SENDMSG:
+		return uk_syscall_r_static(SYS_sendmsg, sqe->fd, addr,
+					   sqe->msg_flags);
+	case IORING_OP_RECVMSG:
+		return uk_syscall_r_static(SYS_recvmsg, sqe->fd, addr,
+					   sqe->msg_flags);
+	case IORING_OP_SEND:
+		return uk_syscall_r_static(SYS_sendto, sqe->fd, addr, sqe->len,
+					   sqe->msg_flags, NULL, 0);
+	case IORING_OP_RECV:
+		return uk_syscall_r_static(SYS_recvfrom, sqe->fd, addr,
+					   sqe->len, sqe->msg_flags, NULL,
+					   NULL);
+	case IORING_OP_ACCEPT:
+		return uk_syscall_r_static(SYS_accept4, sqe->fd, addr,
+					   (void *)(__uptr)sqe->addr2,
+					   sqe->accept_flags);
+	case IORING_OP_POLL_ADD:
+		pfd.fd = sqe->fd;
+		pfd.events = (short)sqe->poll32_events;
+		pfd.revents = 0;
+		ret = uk_syscall_r_static(SYS_poll, &pfd, 1, -1);
+		if (unlikely(ret < 0))
+			return ret;
+		return (unsigned short)pfd.revents;
+	case IORING_OP_TIMEOUT:
+		timedout = uk_waitq_wait_event_deadline(&ctx->cq_wq,
+			UK_READ_ONCE(ctx->closing) ||
+			(sqe->off &&
+			 (__s32)(UK_READ_ONCE(ctx->cq_seq) - req->target) >= 0),
+			req->deadline);
+		if (timedout)
+			return -ETIME;
+		return UK_READ_ONCE(ctx->closing) ? -ECANCELED : 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+/*
+ * Decides whether a request can be executed by the submitter without the
+ * risk of blocking it. Requests on pollable files are executed inline if the
+ * file is ready for the operation; requests on files without a notion of
+ * readiness (e.g., regular files) are executed inline unless they are known to
+ * take long.
+ */
+static int io_uring_can_inline(const struct io_uring_sqe *sqe)
+{
+	struct vfscore_file *fp;
+	struct vnode *vnode;
+	unsigned int events;
+	int ret;
+
+	if (sqe->flags & IOSQE_ASYNC)
+		return 0;
+
+	switch (sqe->opcode) {
+	case IORING_OP_READV:
+	case IORING_OP_READ:
+	case IORING_OP_RECVMSG:
+	case IORING_OP_RECV:
+	case IORING_OP_ACCEPT:
+		events = EPOLLIN;
+		break;
+	case IORING_OP_WRITEV:
+	case IORING_OP_WRITE:
+	case IORING_OP_SENDMSG:
+	case IORING_OP_SEND:
+		events = EPOLLOUT;
+		break;
+	case IORING_OP_POLL_ADD:
+		events = sqe->poll32_events;
+		break;
+	case IORING_OP_FSYNC:
+	case IORING_OP_TIMEOUT:
+		return 0;
+	default:
+		/* Completes immediately, also for invalid opcodes */
+		return 1;
+	}
+
+	fp = vfscore_get_file(sqe->fd);
+	if (unlikely(!fp))
+		return 1; /* Fails immediately with -EBADF */
+
+	vnode = fp->f_dentry->d_vnode;
+	switch (vnode->v_type) {
+	case VSOCK:
+	case VFIFO:
+	case VCHR:
+#ifdef CONFIG_LIBPOSIX_EVENT
+	case VEVENT:
+#endif /* CONFIG_LIBPOSIX_EVENT */
+		if (vnode->v_op->vop_poll)
+			ret = (eventpoll_probe(fp, events) != 0);
+		else
+			ret = 0;
+		break;
+	default:
+		ret = 1;
+		break;
+	}
+
+	vfscore_put_file(fp);
+	return ret;
+}
+
+static void io_uring_worker(void *arg)
+{
+	struct io_uring_ctx *ctx = (struct io_uring_ctx *)arg;
+	struct io_uring_req *req;
+	long res;
+
+	uk_mutex_lock(&ctx->work_lock);
+	for (;;) {
+		uk_waitq_wait_event_mutex(&ctx->work_wq,
+					  ctx->closing ||
+					  !uk_list_empty(&ctx->work_list),
+					  &ctx->work_lock);
+		if (ctx->closing)
+			break;
+
+		req = uk_list_first_entry(&ctx->work_list,
+					  struct io_uring_req, link);
+		uk_list_del(&req->link);
+		ctx->idle_workers--;
+		uk_mutex_unlock(&ctx->work_lock);
+
+		res = io_uring_issue(ctx, req);
+		io_uring_complete(ctx, req->sqe.user_data, (__s32)res);
+		uk_free(ctx->a, req);
+
+		uk_mutex_lock(&ctx->work_lock);
+		ctx->idle_workers++;
+	}
+	ctx->idle_workers--;
+	ctx->nr_workers--;
+	uk_mutex_unlock(&ctx->work_lock);
+
+	io_uring_ctx_put(ctx);
+}
+
+/* Hands a request over to the worker pool, which is grown on demand */
+static int io_uring_queue(struct io_uring_ctx *ctx, struct io_uring_req *req)
+{
+	uk_thread_attr_t attr;
+	struct uk_thread *t;
+
+	uk_mutex_lock(&ctx->work_lock);
+	uk_list_add_tail(&req->link, &ctx->work_list);
+
+	if (ctx->idle_workers == 0 &&
+	    ctx->nr_workers < CONFIG_LIBPOSIX_IOURING_WORKERS) {
+		uk_thread_attr_init(&attr);
+		uk_thread_attr_set_detachstate(&attr, UK_THREAD_ATTR_DETACHED);
+
+		t = uk_thread_create_attr("io_uring-worker", &attr,
+					  io_uring_worker, ctx);
+		uk_thread_attr_fini(&attr);
+		if (t) {
+			ctx->nr_workers++;
+			ctx->idle_workers++;
+			ctx->refcount++;
+		} else if (ctx->nr_workers == 0) {
+			uk_list_del(&req->link);
+			uk_mutex_unlock(&ctx->work_lock);
+			return -EAGAIN;
+		}
+	}
+	uk_mutex_unlock(&ctx->work_lock);
+
+	uk_waitq_wake_up(&ctx->work_wq);
+	return 0;
+}
+
+static int io_uring_prep_timeout(struct io_uring_ctx *ctx,
+				 struct io_uring_req *req)
+{
+	const struct __kernel_timespec *ts;
+	__nsec ns;
+
+	if (unlikely(req->sqe.len != 1 ||
+		     (req->sqe.timeout_flags & ~IORING_TIMEOUT_ABS)))
+		return -EINVAL;
+
+	ts = (const struct __kernel_timespec *)(__uptr)req->sqe.addr;
+	if (unlikely(!ts))
+		return -EFAULT;
+	if (unlikely(ts->tv_sec < 0 || ts->tv_nsec < 0 ||
+		     ts->tv_nsec >= (__s64)UKARCH_NSEC_PER_SEC))
+		return -EINVAL;
+
+	ns = ukarch_time_sec_to_nsec((__nsec)ts->tv_sec) + ts->tv_nsec;
+	if (req->sqe.timeout_flags & IORING_TIMEOUT_ABS)
+		req->deadline = (ns) ? ns : 1;
+	else
+		req->deadline = ukplat_monotonic_clock() + ns;
+
+	/* The timeout completes after `off` further completions */
+	req->target = UK_READ_ONCE(ctx->cq_seq) + (__u32)req->sqe.off;
+
+	return 0;
+}
+
+static void io_uring_dispatch(struct io_uring_ctx *ctx,
+			      const struct io_uring_sqe *sqe)
+{
+	struct io_uring_req inline_req;
+	struct io_uring_req *req;
+	long res;
+
+	/* Linked and drained requests are not supported */
+	if (unlikely(sqe->flags & ~IOSQE_ASYNC)) {
+		io_uring_complete(ctx, sqe->user_data, -EINVAL);
+		return;
+	}
+
+	if (io_uring_can_inline(sqe)) {
+		inline_req.sqe = *sqe;
+		res = io_uring_issue(ctx, &inline_req);
+		io_uring_complete(ctx, sqe->user_data, (__s32)res);
+		return;
+	}
+
+	req = uk_malloc(ctx->a, sizeof(*req));
+	if (unlikely(!req)) {
+		io_uring_complete(ctx, sqe->user_data, -ENOMEM);
+		return;
+	}
+	req->sqe = *sqe;
+
+	if (sqe->opcode == IORING_OP_TIMEOUT) {
+		res = io_uring_prep_timeout(ctx, req);
+		if (unlikely(res))
+			goto err_free;
+	}
+
+	res = io_uring_queue(ctx, req);
+	if (unlikely(res))
+		goto err_free;
+
+	return;
+
+err_free:
+	uk_free(ctx->a, req);
+	io_uring_complete(ctx, sqe->user_data, (__s32)res);
+}
+
+static unsigned int io_uring_submit(struct io_uring_ctx *ctx,
+				    unsigned int to_submit)
+{
+	struct io_uring_rings *rings = ctx->rings;
+	struct io_uring_sqe sqe;
+	unsigned int submitted = 0;
+	__u32 head, tail, idx;
+
+	uk_mutex_lock(&ctx->sq_lock);
+
+	head = rings->sq_head;
+	tail = __atomic_load_n(&rings->sq_tail, __ATOMIC_ACQUIRE);
+	while (submitted < to_submit && head != tail) {
+		idx = UK_READ_ONCE(ctx->sq_array[head & (ctx->sq_entries - 1)]);
+		head++;
+
+		if (unlikely(idx >= ctx->sq_entries)) {
+			UK_WRITE_ONCE(rings->sq_dropped, rings->sq_dropped + 1);
+			continue;
+		}
+
+		/* Take a private copy and release the entry right away, so
+		 * the application can reuse it while the request is running.
+		 */
+		sqe = ctx->sqes[idx];
+		__atomic_store_n(&rings->sq_head, head, __ATOMIC_RELEASE);
+		submitted++;
+
+		io_uring_dispatch(ctx, &sqe);
+	}
+	__atomic_store_n(&rings->sq_head, head, __ATOMIC_RELEASE);
+
+	uk_mutex_unlock(&ctx->sq_lock);
+
+	return submitted;
+}
+
+static int io_uring_vfscore_close(struct vnode *vnode,
+				  struct vfscore_file *fp __unused)
+{
+	struct io_uring_ctx *ctx;
+
+	UK_ASSERT(vnode->v_data);
+	UK_ASSERT(vnode->v_type == VURING);
+
+	ctx = (struct io_uring_ctx *)vnode->v_data;
+
+	/* Workers that are currently blocked in a request keep the context
+	 * alive until the request returns; its completion is discarded.
+	 */
+	uk_mutex_lock(&ctx->cq_lock);
+	uk_mutex_lock(&ctx->work_lock);
+	ctx->closing = 1;
+	uk_mutex_unlock(&ctx->work_lock);
+	uk_mutex_unlock(&ctx->cq_lock);
+
+	uk_waitq_wake_up(&ctx->work_wq);
+	uk_waitq_wake_up(&ctx->cq_wq);
+
+	io_uring_ctx_put(ctx);
+
+	vnode->v_data = NULL;
+	return 0;
+}
+
+static void io_uring_unregister_eventpoll(struct eventpoll_cb *ecb)
+{
+	UK_ASSERT(ecb);
+
+	uk_mutex_lock(&io_uring_global_lock);
+	UK_ASSERT(!uk_list_empty(&ecb->cb_link));
+	uk_list_del(&ecb->cb_link);
+
+	ecb->data = NULL;
+	ecb->unregister = NULL;
+	uk_mutex_unlock(&io_uring_global_lock);
+}
+
+static int io_uring_vfscore_poll(struct vnode *vnode, unsigned int *revents,
+				 struct eventpoll_cb *ecb)
+{
+	struct io_uring_ctx *ctx = (struct io_uring_ctx *)vnode->v_data;
+
+	UK_ASSERT(vnode->v_data);
+	UK_ASSERT(vnode->v_type == VURING);
+
+	uk_mutex_lock(&io_uring_global_lock);
+	if (!ecb->unregister) {
+		UK_ASSERT(uk_list_empty(&ecb->cb_link));
+		UK_ASSERT(!ecb->data);
+
+		uk_list_add_tail(&ecb->cb_link, &ctx->ep_list);
+
+		ecb->data = ctx;
+		ecb->unregister = io_uring_unregister_eventpoll;
+	}
+	uk_mutex_unlock(&io_uring_global_lock);
+
+	*revents = (io_uring_cq_ready(ctx)) ? EPOLLIN : 0;
+
+	return 0;
+}
+
+/* vnode operations */
+#define io_uring_vfscore_inactive ((vnop_inactive_t) vfscore_vop_einval)
+
+static struct vnops io_uring_vnops = {
+	.vop_close = io_uring_vfscore_close,
+	.vop_inactive = io_uring_vfscore_inactive,
+	.vop_poll = io_uring_vfscore_poll
+};
+
+/* file system operations */
+#define io_uring_vget ((vfsop_vget_t) vfscore_nullop)
+
+static struct vfsops io_uring_vfsops = {
+	.vfs_vget = io_uring_vget,
+	.vfs_vnops = &io_uring_vnops
+};
+
+/* bogus mount point used by all io_uring fds */
+static struct mount io_uring_mount = {
+	.m_op = &io_uring_vfsops
+};
+
+static int io_uring_create_fd(struct uk_alloc *a, struct io_uring_ctx *ctx)
+{
+	int vfs_fd, ret;
+	struct vfscore_file *vfs_file;
+	struct dentry *vfs_dentry;
+	struct vnode *vfs_vnode;
+
+	/* Reserve a file descriptor number */
+	vfs_fd = vfscore_alloc_fd();
+	if (unlikely(vfs_fd < 0)) {
+		ret = -ENFILE;
+		goto ERR_EXIT;
+	}
+
+	vfs_file = uk_malloc(a, sizeof(struct vfscore_file));
+	if (unlikely(!vfs_file)) {
+		ret = -ENOMEM;
+		goto ERR_MALLOC_VFS_FILE;
+	}
+
+	uk_mutex_lock(&io_uring_global_lock);
+	ret = vfscore_vget(&io_uring_mount, io_uring_inode++, &vfs_vnode);
+	uk_mutex_unlock(&io_uring_global_lock);
+	UK_ASSERT(ret == 0); /* we should not find it in the cache */
+	if (unlikely(!vfs_vnode)) {
+		ret = -ENOMEM;
+		goto ERR_ALLOC_VNODE;
+	}
+
+	vfs_dentry = dentry_alloc(NULL, vfs_vnode, "/");
+	if (unlikely(!vfs_dentry)) {
+		ret = -ENOMEM;
+		goto ERR_ALLOC_DENTRY;
+	}
+
+	/* Initialize data structures */
+	vfs_file->fd = vfs_fd;
+	vfs_file->f_flags = UK_FREAD | UK_FWRITE;
+	vfs_file->f_count = 1;
+	vfs_file->f_data = ctx;
+	vfs_file->f_dentry = vfs_dentry;
+	vfs_file->f_vfs_flags = UK_VFSCORE_NOPOS;
+	vfs_file->f_offset = 0;
+
+	uk_mutex_init(&vfs_file->f_lock);
+	UK_INIT_LIST_HEAD(&vfs_file->f_ep);
+
+	vfs_vnode->v_data = ctx;
+	vfs_vnode->v_type = VURING;
+
+	/* Store within the vfs structure */
+	ret = vfscore_install_fd(vfs_fd, vfs_file);
+	if (unlikely(ret))
+		goto ERR_VFS_INSTALL;
+
+	/* Only the dentry should hold a reference; release ours */
+	vput(vfs_vnode);
+
+	return vfs_fd;
+
+ERR_VFS_INSTALL:
+	drele(vfs_dentry);
+ERR_ALLOC_DENTRY:
+	vput(vfs_vnode);
+ERR_ALLOC_VNODE:
+	uk_free(a, vfs_file);
+ERR_MALLOC_VFS_FILE:
+	vfscore_put_fd(vfs_fd);
+ERR_EXIT:
+	UK_ASSERT(ret < 0);
+	return ret;
+}
+
+UK_SYSCALL_R_DEFINE(int, io_uring_setup, __u32, entries,
+		    struct io_uring_params *, p)
+{
+	struct uk_alloc *a = uk_alloc_get_default();
+	struct io_uring_ctx *ctx;
+	struct io_uring_rings *rings;
+	__u32 sq_entries, cq_entries;
+	unsigned int i;
+	int ret;
+
+	if (unlikely(!p))
+		return -EFAULT;
+
+	if (unlikely(p->flags & ~IORING_SETUP_SUPPORTED))
+		return -EINVAL;
+
+	for (i = 0; i < ARRAY_SIZE(p->resv); i++)
+		if (unlikely(p->resv[i]))
+			return -EINVAL;
+
+	/* There is no mmap() support for files, so the application has to
+	 * provide the memory for the rings (see io_uring_queue_init_mem()).
+	 */
+	if (unlikely(!(p->flags & IORING_SETUP_NO_MMAP))) {
+		uk_pr_warn_once("io_uring: only IORING_SETUP_NO_MMAP rings are supported\n");
+		return -EINVAL;
+	}
+
+	if (unlikely(!p->sq_off.user_addr || !p->cq_off.user_addr))
+		return -EFAULT;
+	if (unlikely(!IS_ALIGNED(p->cq_off.user_addr, sizeof(__u64))))
+		return -EINVAL;
+
+	if (unlikely(!entries))
+		return -EINVAL;
+	if (entries > IORING_MAX_ENTRIES) {
+		if (!(p->flags & IORING_SETUP_CLAMP))
+			return -EINVAL;
+		entries = IORING_MAX_ENTRIES;
+	}
+	sq_entries = io_uring_roundup_pow2(entries);
+
+	if (p->flags & IORING_SETUP_CQSIZE) {
+		if (unlikely(!p->cq_entries))
+			return -EINVAL;
+		cq_entries = p->cq_entries;
+		if (cq_entries > IORING_MAX_CQ_ENTRIES) {
+			if (!(p->flags & IORING_SETUP_CLAMP))
+				return -EINVAL;
+			cq_entries = IORING_MAX_CQ_ENTRIES;
+		}
+		cq_entries = io_uring_roundup_pow2(cq_entries);
+		if (unlikely(cq_entries < sq_entries))
+			return -EINVAL;
+	} else {
+		cq_entries = 2 * sq_entries;
+	}
+
+	ctx = uk_calloc(a, 1, sizeof(*ctx));
+	if (unlikely(!ctx))
+		return -ENOMEM;
+
+	rings = (struct io_uring_rings *)(__uptr)p->cq_off.user_addr;
+	ctx->a = a;
+	ctx->rings = rings;
+	ctx->sq_array = (__u32 *)&rings->cqes[cq_entries];
+	ctx->sqes = (struct io_uring_sqe *)(__uptr)p->sq_off.user_addr;
+	ctx->sq_entries = sq_entries;
+	ctx->cq_entries = cq_entries;
+	ctx->refcount = 1;
+	uk_mutex_init(&ctx->sq_lock);
+	uk_mutex_init(&ctx->cq_lock);
+	uk_waitq_init(&ctx->cq_wq);
+	UK_INIT_LIST_HEAD(&ctx->ep_list);
+	uk_mutex_init(&ctx->work_lock);
+	uk_waitq_init(&ctx->work_wq);
+	UK_INIT_LIST_HEAD(&ctx->work_list);
+
+	rings->sq_head = 0;
+	rings->sq_tail = 0;
+	rings->sq_ring_mask = sq_entries - 1;
+	rings->sq_ring_entries = sq_entries;
+	rings->sq_flags = 0;
+	rings->sq_dropped = 0;
+	rings->cq_head = 0;
+	rings->cq_tail = 0;
+	rings->cq_ring_mask = cq_entries - 1;
+	rings->cq_ring_entries = cq_entries;
+	rings->cq_overflow = 0;
+	rings->cq_flags = 0;
+
+	ret = io_uring_create_fd(a, ctx);
+	if (unlikely(ret < 0)) {
+		uk_free(a, ctx);
+		return ret;
+	}
+
+	p->sq_entries = sq_entries;
+	p->cq_entries = cq_entries;
+	p->features = IORING_FEAT_SUPPORTED;
+
+	p->sq_off.head = __offsetof(struct io_uring_rings, sq_head);
+	p->sq_off.tail = __offsetof(struct io_uring_rings, sq_tail);
+	p->sq_off.ring_mask = __offsetof(struct io_uring_rings, sq_ring_mask);
+	p->sq_off.ring_entries = __offsetof(struct io_uring_rings,
+					    sq_ring_entries);
+	p->sq_off.flags = __offsetof(struct io_uring_rings, sq_flags);
+	p->sq_off.dropped = __offsetof(struct io_uring_rings, sq_dropped);
+	p->sq_off.array = (__u32)((__uptr)ctx->sq_array - (__uptr)rings);
+	p->sq_off.resv1 = 0;
+
+	p->cq_off.head = __offsetof(struct io_uring_rings, cq_head);
+	p->cq_off.tail = __offsetof(struct io_uring_rings, cq_tail);
+	p->cq_off.ring_mask = __offsetof(struct io_uring_rings, cq_ring_mask);
+	p->cq_off.ring_entries = __offsetof(struct io_uring_rings,
+					    cq_ring_entries);
+	p->cq_off.overflow = __offsetof(struct io_uring_rings, cq_overflow);
+	p->cq_off.cqes = __offsetof(struct io_uring_rings, cqes);
+	p->cq_off.flags = __offsetof(struct io_uring_rings, cq_flags);
+	p->cq_off.resv1 = 0;
+
+	return ret;
+}
+
+UK_SYSCALL_R_DEFINE(int, io_uring_enter, unsigned int, fd,
+		    unsigned int, to_submit, unsigned int, min_complete,
+		    unsigned int, flags, const void *, argp, size_t, argsz)
+{
+	const struct io_uring_getevents_arg *arg;
+	const struct __kernel_timespec *ts;
+	struct io_uring_ctx *ctx;
+	struct vfscore_file *fp;
+	struct vnode *vnode;
+	__nsec deadline = 0;
+	int ret = 0;
+
+	if (unlikely(flags & ~IORING_ENTER_SUPPORTED))
+		return -EINVAL;
+
+	fp = vfscore_get_file(fd);
+	if (unlikely(!fp))
+		return -EBADF;
+
+	vnode = fp->f_dentry->d_vnode;
+	if (unlikely(vnode->v_op != &io_uring_vnops)) {
+		ret = -EOPNOTSUPP;
+		goto out;
+	}
+
+	ctx = (struct io_uring_ctx *)vnode->v_data;
+	UK_ASSERT(ctx);
+
+	if (flags & IORING_ENTER_EXT_ARG) {
+		if (unlikely(argsz != sizeof(*arg))) {
+			ret = -EINVAL;
+			goto out;
+		}
+		arg = (const struct io_uring_getevents_arg *)argp;
+		if (unlikely(!arg)) {
+			ret = -EFAULT;
+			goto out;
+		}
+
+		/* TODO: Implement atomic masking of signals */
+		if (arg->sigmask)
+			uk_pr_warn_once("%s: signal masking not implemented.",
+					__func__);
+
+		ts = (const struct __kernel_timespec *)(__uptr)arg->ts;
+		if (ts)
+			deadline = ukplat_monotonic_clock() +
+				ukarch_time_sec_to_nsec((__nsec)ts->tv_sec) +
+				ts->tv_nsec;
+	} else if (argp) {
+		uk_pr_warn_once("%s: signal masking not implemented.",
+				__func__);
+	}
+
+	if (to_submit)
+		ret = io_uring_submit(ctx, to_submit);
+
+	if ((flags & IORING_ENTER_GETEVENTS) && min_complete) {
+		min_complete = MIN(min_complete, ctx->cq_entries);
+		if (uk_waitq_wait_event_deadline(&ctx->cq_wq,
+				io_uring_cq_ready(ctx) >= min_complete,
+				deadline) && ret == 0)
+			ret = -ETIME;
+	}
+
+out:
+	vfscore_put_file(fp);
+	return ret;
+}
+
+UK_SYSCALL_R_DEFINE(int, io_uring_register, unsigned int, fd,
+		    unsigned int, opcode, void *, arg, unsigned int, nr_args)
+{
+	struct vfscore_file *fp;
+	int ret;
+
+	fp = vfscore_get_file(fd);
+	if (unlikely(!fp))
+		return -EBADF;
+
+	/* Registered buffers, files, and eventfds are not supported */
+	if (fp->f_dentry->d_vnode->v_op != &io_uring_vnops)
+		ret = -EOPNOTSUPP;
+	else
+		ret = -EINVAL;
+
+	vfscore_put_file(fp);
+	return ret;
+}
@@ -0,0 +1,194 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __POSIX_IOURING_H__
+#define __POSIX_IOURING_H__
+
+#include <uk/arch/types.h>
+#include <uk/essentials.h>
+
+/*
+ * io_uring application binary interface as defined by Linux
+ * (include/uapi/linux/io_uring.h). Only the subset that is implemented by
+ * this library is defined here.
+ */
+
+struct io_uring_sqe {
+	__u8	opcode;		/* type of operation for this sqe */
+	__u8	flags;		/* IOSQE_ flags */
+	__u16	ioprio;		/* ioprio for the request */
+	__s32	fd;		/* file descriptor to do IO on */
+	union {
+		__u64	off;	/* offset into file */
+		__u64	addr2;
+	};
+	__u64	addr;		/* pointer to buffer or iovecs */
+	__u32	len;		/* buffer size or number of iovecs */
+	union {
+		__u32	rw_flags;
+		__u32	fsync_flags;
+		__u16	poll_events;
+		__u32	poll32_events;
+		__u32	msg_flags;
+		__u32	timeout_flags;
+		__u32	accept_flags;
+	};
+	__u64	user_data;	/* data to be passed back at completion time */
+	__u16	buf_index;
+	__u16	personality;
+	__s32	splice_fd_in;
+	__u64	__pad2[2];
+};
+
+struct io_uring_cqe {
+	__u64	user_data;	/* sqe->user_data */
+	__s32	res;		/* result code for this event */
+	__u32	flags;
+};
+
+struct io_sqring_offsets {
+	__u32 head;
+	__u32 tail;
+	__u32 ring_mask;
+	__u32 ring_entries;
+	__u32 flags;
+	__u32 dropped;
+	__u32 array;
+	__u32 resv1;
+	__u64 user_addr;
+};
+
+struct io_cqring_offsets {
+	__u32 head;
+	__u32 tail;
+	__u32 ring_mask;
+	__u32 ring_entries;
+	__u32 overflow;
+	__u32 cqes;
+	__u32 flags;
+	__u32 resv1;
+	__u64 user_addr;
+};
+
+struct io_uring_params {
+	__u32 sq_entries;
+	__u32 cq_entries;
+	__u32 flags;
+	__u32 sq_thread_cpu;
+	__u32 sq_thread_idle;
+	__u32 features;
+	__u32 wq_fd;
+	__u32 resv[3];
+	struct io_sqring_offsets sq_off;
+	struct io_cqring_offsets cq_off;
+};
+
+struct io_uring_getevents_arg {
+	__u64	sigmask;
+	__u32	sigmask_sz;
+	__u32	pad;
+	__u64	ts;
+};
+
+struct __kernel_timespec {
+	__s64	tv_sec;
+	__s64	tv_nsec;
+};
+
+UK_CTASSERT(sizeof(struct io_uring_sqe) == 64);
+UK_CTASSERT(sizeof(struct io_uring_cqe) == 16);
+UK_CTASSERT(sizeof(struct io_uring_params) == 120);
+
+/* sqe->flags */
+#define IOSQE_FIXED_FILE		(1U << 0)
+#define IOSQE_IO_DRAIN			(1U << 1)
+#define IOSQE_IO_LINK			(1U << 2)
+#define IOSQE_IO_HARDLINK		(1U << 3)
+#define IOSQE_ASYNC			(1U << 4)
+#define IOSQE_BUFFER_SELECT		(1U << 5)
+#define IOSQE_CQE_SKIP_SUCCESS		(1U << 6)
+
+/* io_uring_setup() flags */
+#define IORING_SETUP_IOPOLL		(1U << 0)
+#define IORING_SETUP_SQPOLL		(1U << 1)
+#define IORING_SETUP_SQ_AFF		(1U << 2)
+#define IORING_SETUP_CQSIZE		(1U << 3)
+#define IORING_SETUP_CLAMP		(1U << 4)
+#define IORING_SETUP_ATTACH_WQ		(1U << 5)
+#define IORING_SETUP_R_DISABLED		(1U << 6)
+#define IORING_SETUP_SUBMIT_ALL		(1U << 7)
+#define IORING_SETUP_COOP_TASKRUN	(1U << 8)
+#define IORING_SETUP_TASKRUN_FLAG	(1U << 9)
+#define IORING_SETUP_SQE128		(1U << 10)
+#define IORING_SETUP_CQE32		(1U << 11)
+#define IORING_SETUP_SINGLE_ISSUER	(1U << 12)
+#define IORING_SETUP_DEFER_TASKRUN	(1U << 13)
+#define IORING_SETUP_NO_MMAP		(1U << 14)
+
+/* io_uring_params->features */
+#define IORING_FEAT_SINGLE_MMAP		(1U << 0)
+#define IORING_FEAT_NODROP		(1U << 1)
+#define IORING_FEAT_SUBMIT_STABLE	(1U << 2)
+#define IORING_FEAT_POLL_32BITS		(1U << 6)
+#define IORING_FEAT_EXT_ARG		(1U << 8)
+#define IORING_FEAT_NATIVE_WORKERS	(1U << 9)
+
+/* io_uring_enter() flags */
+#define IORING_ENTER_GETEVENTS		(1U << 0)
+#define IORING_ENTER_SQ_WAKEUP		(1U << 1)
+#define IORING_ENTER_SQ_WAIT		(1U << 2)
+#define IORING_ENTER_EXT_ARG		(1U << 3)
+
+/* sqe->fsync_flags */
+#define IORING_FSYNC_DATASYNC		(1U << 0)
+
+/* sqe->timeout_flags */
+#define IORING_TIMEOUT_ABS		(1U << 0)
+
+#define IORING_MAX_ENTRIES		32768
+#define IORING_MAX_CQ_ENTRIES		(2 * IORING_MAX_ENTRIES)
+
+enum io_uring_op {
+	IORING_OP_NOP = 0,
+	IORING_OP_READV = 1,
+	IORING_OP_WRITEV = 2,
+	IORING_OP_FSYNC = 3,
+	IORING_OP_POLL_ADD = 6,
+	IORING_OP_SENDMSG = 9,
+	IORING_OP_RECVMSG = 10,
+	IORING_OP_TIMEOUT = 11,
+	IORING_OP_ACCEPT = 13,
+	IORING_OP_READ = 22,
+	IORING_OP_WRITE = 23,
+	IORING_OP_SEND = 26,
+	IORING_OP_RECV = 27,
+};
+
+#endif /* __POSIX_IOURING_H__ */
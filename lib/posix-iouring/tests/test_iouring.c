@@ -0,0 +1,180 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/test.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <uk/syscall.h>
+#include <uk/plat/time.h>
+
+#include "../iouring.h"
+
+#define RING_ENTRIES	4
+/* Ring headers, CQEs (twice the SQ entries) and the SQ index array */
+#define RING_SIZE	(64 + 2 * RING_ENTRIES * sizeof(struct io_uring_cqe) \
+			 + RING_ENTRIES * sizeof(__u32))
+
+struct test_ring {
+	int fd;
+	struct io_uring_params p;
+	__u32 *sq_tail;
+	__u32 *sq_array;
+	__u32 *cq_head;
+	__u32 *cq_tail;
+	struct io_uring_cqe *cqes;
+};
+
+static char ring_mem[RING_SIZE] __align(64);
+static struct io_uring_sqe sqes[RING_ENTRIES];
+
+static int test_ring_init(struct test_ring *r)
+{
+	char *base = ring_mem;
+
+	memset(&r->p, 0, sizeof(r->p));
+	r->p.flags = IORING_SETUP_NO_MMAP;
+	r->p.sq_off.user_addr = (__u64)(__uptr)sqes;
+	r->p.cq_off.user_addr = (__u64)(__uptr)ring_mem;
+
+	r->fd = uk_syscall_r_static(SYS_io_uring_setup, RING_ENTRIES, &r->p);
+	if (r->fd < 0)
+		return r->fd;
+
+	r->sq_tail = (__u32 *)(base + r->p.sq_off.tail);
+	r->sq_array = (__u32 *)(base + r->p.sq_off.array);
+	r->cq_head = (__u32 *)(base + r->p.cq_off.head);
+	r->cq_tail = (__u32 *)(base + r->p.cq_off.tail);
+	r->cqes = (struct io_uring_cqe *)(base + r->p.cq_off.cqes);
+	return 0;
+}
+
+static void test_ring_push(struct test_ring *r, const struct io_uring_sqe *sqe)
+{
+	__u32 tail = *r->sq_tail;
+	__u32 idx = tail & (RING_ENTRIES - 1);
+
+	sqes[idx] = *sqe;
+	r->sq_array[idx] = idx;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/* Returns the CQE of the given request and consumes all CQEs before it */
+static struct io_uring_cqe *test_ring_find(struct test_ring *r,
+					   __u64 user_data)
+{
+	__u32 head, tail;
+	struct io_uring_cqe *cqe;
+
+	tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+	for (head = *r->cq_head; head != tail; head++) {
+		cqe = &r->cqes[head & (2 * RING_ENTRIES - 1)];
+		if (cqe->user_data == user_data) {
+			__atomic_store_n(r->cq_head, head + 1,
+					 __ATOMIC_RELEASE);
+			return cqe;
+		}
+	}
+	return NULL;
+}
+
+UK_TESTCASE(posix_iouring, timeout_expires)
+{
+	struct __kernel_timespec ts = { .tv_sec = 0, .tv_nsec = 10000000 };
+	struct io_uring_sqe sqe = {
+		.opcode = IORING_OP_TIMEOUT,
+		.addr = (__u64)(__uptr)&ts,
+		.len = 1,
+		.user_data = 1,
+	};
+	struct io_uring_cqe *cqe;
+	struct test_ring r;
+	__nsec start;
+
+	UK_TEST_EXPECT_ZERO(test_ring_init(&r));
+
+	start = ukplat_monotonic_clock();
+	test_ring_push(&r, &sqe);
+	UK_TEST_EXPECT_SNUM_EQ(uk_syscall_r_static(SYS_io_uring_enter, r.fd,
+						   1, 1,
+						   IORING_ENTER_GETEVENTS,
+						   NULL, 0), 1);
+	UK_TEST_EXPECT(ukplat_monotonic_clock() - start >= 10000000);
+
+	/* Expired timeouts complete with the Linux value of -ETIME */
+	cqe = test_ring_find(&r, 1);
+	UK_TEST_EXPECT_NOT_NULL(cqe);
+	if (cqe)
+		UK_TEST_EXPECT_SNUM_EQ(cqe->res, -62);
+
+	close(r.fd);
+}
+
+UK_TESTCASE(posix_iouring, timeout_completion_count)
+{
+	struct __kernel_timespec ts = { .tv_sec = 10, .tv_nsec = 0 };
+	struct io_uring_sqe timeout = {
+		.opcode = IORING_OP_TIMEOUT,
+		.addr = (__u64)(__uptr)&ts,
+		.len = 1,
+		.off = 1,
+		.user_data = 1,
+	};
+	struct io_uring_sqe nop = {
+		.opcode = IORING_OP_NOP,
+		.user_data = 2,
+	};
+	struct io_uring_cqe *cqe;
+	struct test_ring r;
+
+	UK_TEST_EXPECT_ZERO(test_ring_init(&r));
+
+	/* The timeout is satisfied by the completion of the NOP */
+	test_ring_push(&r, &timeout);
+	test_ring_push(&r, &nop);
+	UK_TEST_EXPECT_SNUM_EQ(uk_syscall_r_static(SYS_io_uring_enter, r.fd,
+						   2, 2,
+						   IORING_ENTER_GETEVENTS,
+						   NULL, 0), 2);
+
+	cqe = test_ring_find(&r, 2);
+	UK_TEST_EXPECT_NOT_NULL(cqe);
+	if (cqe)
+		UK_TEST_EXPECT_ZERO(cqe->res);
+	cqe = test_ring_find(&r, 1);
+	UK_TEST_EXPECT_NOT_NULL(cqe);
+	if (cqe)
+		UK_TEST_EXPECT_ZERO(cqe->res);
+
+	close(r.fd);
+}
+
+uk_testsuite_register(posix_iouring, NULL);
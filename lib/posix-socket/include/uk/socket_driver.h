@@ -55,6 +55,7 @@ struct posix_socket_ops;
 struct posix_socket_file;
 
 struct eventpoll_cb;
+struct mmsghdr;
 
 /**
  * The POSIX socket driver defines the operations to be used for the
@@ -279,6 +280,41 @@ typedef ssize_t (*posix_socket_sendto_func_t)(struct posix_socket_file *sock,
 		const void *buf, size_t len, int flags,
 		const struct sockaddr *dest_addr, socklen_t addrlen);
 
+/**
+ * Receive multiple messages from a socket. This operation is optional. If a
+ * driver does not provide it, the messages are received one by one with
+ * recvmsg.
+ *
+ * @param sock Reference to the socket
+ * @param msgvec Array of message structures. The number of bytes received
+ *    for each message is returned in its msg_len field
+ * @param vlen The number of elements in msgvec
+ * @param flags Bitwise OR of zero or more flags for the socket
+ *
+ * @return The number of messages received on success, -errno otherwise. An
+ *    error that occurs after at least one message was received must not be
+ *    reported; the number of messages received so far is returned instead
+ */
+typedef int (*posix_socket_recvmmsg_func_t)(struct posix_socket_file *sock,
+		struct mmsghdr *msgvec, unsigned int vlen, int flags);
+
+/**
+ * Send multiple messages on a socket. This operation is optional. If a
+ * driver does not provide it, the messages are sent one by one with sendmsg.
+ *
+ * @param sock Reference to the socket
+ * @param msgvec Array of message structures. The number of bytes sent for
+ *    each message is returned in its msg_len field
+ * @param vlen The number of elements in msgvec
+ * @param flags Bitwise OR of zero or more flags for the socket
+ *
+ * @return The number of messages sent on success, -errno otherwise. An error
+ *    that occurs after at least one message was sent must not be reported;
+ *    the number of messages sent so far is returned instead
+ */
+typedef int (*posix_socket_sendmmsg_func_t)(struct posix_socket_file *sock,
+		struct mmsghdr *msgvec, unsigned int vlen, int flags);
+
 /**
  * Create a pair of connected sockets.
  *
@@ -380,6 +416,9 @@ struct posix_socket_ops {
 	posix_socket_sendmsg_func_t	sendmsg;
 	posix_socket_sendto_func_t	sendto;
 	posix_socket_socketpair_func_t	socketpair;
+	/* Optional batched POSIX interface */
+	posix_socket_recvmmsg_func_t	recvmmsg;
+	posix_socket_sendmmsg_func_t	sendmmsg;
 	/* vfscore ops */
 	posix_socket_write_func_t	write;
 	posix_socket_read_func_t	read;
@@ -535,6 +574,26 @@ posix_socket_sendto(struct posix_socket_file *sock, const void *buf,
 					 dest_addr, addrlen);
 }
 
+static inline int
+posix_socket_recvmmsg(struct posix_socket_file *sock, struct mmsghdr *msgvec,
+		      unsigned int vlen, int flags)
+{
+	UK_ASSERT(sock);
+	UK_ASSERT(sock->driver->ops->recvmmsg);
+
+	return sock->driver->ops->recvmmsg(sock, msgvec, vlen, flags);
+}
+
+static inline int
+posix_socket_sendmmsg(struct posix_socket_file *sock, struct mmsghdr *msgvec,
+		      unsigned int vlen, int flags)
+{
+	UK_ASSERT(sock);
+	UK_ASSERT(sock->driver->ops->sendmmsg);
+
+	return sock->driver->ops->sendmmsg(sock, msgvec, vlen, flags);
+}
+
 static inline int
 posix_socket_socketpair(struct posix_socket_driver *d, int family, int type,
 			int protocol, void *usockvec[2])
@@ -34,12 +34,15 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define _GNU_SOURCE
 #include <sys/types.h>
 #include <uk/socket.h>
 #include <uk/errptr.h>
 #include <uk/print.h>
 #include <uk/trace.h>
 #include <uk/syscall.h>
+#include <uk/plat/time.h>
+#include <limits.h>
 #include <errno.h>
 
 UK_TRACEPOINT(trace_posix_socket_create, "%d %d %d", int, int, int);
@@ -582,6 +585,158 @@ ssize_t send(int sock, const void *buf, size_t len, int flags)
 	return sendto(sock, buf, len, flags, NULL, 0);
 }
 
+#if CONFIG_LIBPOSIX_SOCKET_MMSG
+/* Like Linux, we silently limit the number of messages per call */
+#define PSOCKET_MMSG_MAX IOV_MAX
+
+static int posix_socket_recvmmsg_loop(struct posix_socket_file *file,
+				      struct mmsghdr *msgvec,
+				      unsigned int vlen, int flags,
+				      const struct timespec *timeout)
+{
+	int waitforone = flags & MSG_WAITFORONE;
+	__nsec deadline = 0;
+	unsigned int i;
+	ssize_t ret;
+
+	if (timeout)
+		deadline = ukplat_monotonic_clock() +
+			ukarch_time_sec_to_nsec(timeout->tv_sec) +
+			timeout->tv_nsec;
+
+	/* MSG_WAITFORONE is not a recvmsg() flag, drivers may reject it */
+	flags &= ~MSG_WAITFORONE;
+
+	for (i = 0; i < vlen; i++) {
+		ret = posix_socket_recvmsg(file, &msgvec[i].msg_hdr, flags);
+		if (unlikely(ret < 0))
+			return (i > 0) ? (int)i : (int)ret;
+
+		msgvec[i].msg_len = (unsigned int)ret;
+
+		/* Do not block after the first message */
+		if (waitforone)
+			flags |= MSG_DONTWAIT;
+
+		/* The timeout is only checked after each message */
+		if (timeout && ukplat_monotonic_clock() >= deadline)
+			return i + 1;
+	}
+
+	return i;
+}
+
+static int posix_socket_sendmmsg_loop(struct posix_socket_file *file,
+				      struct mmsghdr *msgvec,
+				      unsigned int vlen, int flags)
+{
+	unsigned int i;
+	ssize_t ret;
+
+	for (i = 0; i < vlen; i++) {
+		ret = posix_socket_sendmsg(file, &msgvec[i].msg_hdr, flags);
+		if (unlikely(ret < 0))
+			return (i > 0) ? (int)i : (int)ret;
+
+		msgvec[i].msg_len = (unsigned int)ret;
+	}
+
+	return i;
+}
+
+UK_TRACEPOINT(trace_posix_socket_recvmmsg, "%d %p %u %d %p", int,
+	      struct mmsghdr *, unsigned int, int, struct timespec *);
+UK_TRACEPOINT(trace_posix_socket_recvmmsg_ret, "%d", int);
+UK_TRACEPOINT(trace_posix_socket_recvmmsg_err, "%d", int);
+
+UK_SYSCALL_R_DEFINE(int, recvmmsg, int, sock, struct mmsghdr *, msgvec,
+		    unsigned int, vlen, int, flags, struct timespec *, timeout)
+{
+	struct posix_socket_file *file;
+	int ret;
+
+	trace_posix_socket_recvmmsg(sock, msgvec, vlen, flags, timeout);
+
+	if (unlikely(timeout && (timeout->tv_sec < 0 || timeout->tv_nsec < 0 ||
+				 timeout->tv_nsec >= UKARCH_NSEC_PER_SEC))) {
+		ret = -EINVAL;
+		goto EXIT_ERR;
+	}
+
+	if (vlen > PSOCKET_MMSG_MAX)
+		vlen = PSOCKET_MMSG_MAX;
+
+	file = posix_socket_file_get(sock);
+	if (unlikely(PTRISERR(file))) {
+		ret = PTR2ERR(file);
+		goto EXIT_ERR;
+	}
+
+	/* Receive a batch of messages from a socket. The driver operation
+	 * has no notion of a timeout, so we fall back to receiving messages
+	 * one by one if a timeout is given.
+	 */
+	if (file->driver->ops->recvmmsg && !timeout)
+		ret = posix_socket_recvmmsg(file, msgvec, vlen, flags);
+	else
+		ret = posix_socket_recvmmsg_loop(file, msgvec, vlen, flags,
+						 timeout);
+
+	vfscore_put_file(file->vfs_file);
+
+	if (unlikely((ret < 0) && (ret != -EAGAIN)))
+		goto EXIT_ERR;
+
+	trace_posix_socket_recvmmsg_ret(ret);
+	return ret;
+EXIT_ERR:
+	PSOCKET_ERR("recvmmsg on socket %d failed: %d\n", sock, ret);
+	trace_posix_socket_recvmmsg_err(ret);
+	return ret;
+}
+
+UK_TRACEPOINT(trace_posix_socket_sendmmsg, "%d %p %u %d", int,
+	      struct mmsghdr *, unsigned int, int);
+UK_TRACEPOINT(trace_posix_socket_sendmmsg_ret, "%d", int);
+UK_TRACEPOINT(trace_posix_socket_sendmmsg_err, "%d", int);
+
+UK_SYSCALL_R_DEFINE(int, sendmmsg, int, sock, struct mmsghdr *, msgvec,
+		    unsigned int, vlen, int, flags)
+{
+	struct posix_socket_file *file;
+	int ret;
+
+	trace_posix_socket_sendmmsg(sock, msgvec, vlen, flags);
+
+	if (vlen > PSOCKET_MMSG_MAX)
+		vlen = PSOCKET_MMSG_MAX;
+
+	file = posix_socket_file_get(sock);
+	if (unlikely(PTRISERR(file))) {
+		ret = PTR2ERR(file);
+		goto EXIT_ERR;
+	}
+
+	/* Send a batch of messages to a socket */
+	if (file->driver->ops->sendmmsg)
+		ret = posix_socket_sendmmsg(file, msgvec, vlen, flags);
+	else
+		ret = posix_socket_sendmmsg_loop(file, msgvec, vlen, flags);
+
+	vfscore_put_file(file->vfs_file);
+
+	if (unlikely((ret < 0) && (ret != -EAGAIN)))
+		goto EXIT_ERR;
+
+	trace_posix_socket_sendmmsg_ret(ret);
+	return ret;
+EXIT_ERR:
+	PSOCKET_ERR("sendmmsg on socket %d failed: %d\n", sock, ret);
+	trace_posix_socket_sendmmsg_err(ret);
+	return ret;
+}
+#endif /* CONFIG_LIBPOSIX_SOCKET_MMSG */
+
 UK_TRACEPOINT(trace_posix_socket_socketpair, "%d %d %d %p", int, int, int,
 	      int *);
 UK_TRACEPOINT(trace_posix_socket_socketpair_ret, "%d", int);
@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __RAMFS_RAMFS_H__
+#define __RAMFS_RAMFS_H__
+
+#include <stddef.h>
+#include <vfscore/vnode.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Backs an empty ramfs regular file with externally owned memory, without
+ * copying it. The memory must stay valid for the lifetime of the file; it
+ * is never freed by ramfs. A write that grows the file moves it to a ramfs
+ * allocated buffer, other writes modify the memory in place.
+ *
+ * @param vp
+ *   Vnode of the file, must belong to a ramfs mount.
+ * @param data
+ *   File contents.
+ * @param size
+ *   Size of the file contents.
+ * @return
+ *   0 on success, EINVAL if the vnode is not an empty ramfs regular file,
+ *   EISDIR if it is a directory.
+ */
+int ramfs_set_file_data(struct vnode *vp, const void *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RAMFS_RAMFS_H__ */
@@ -51,10 +51,13 @@
 #include <vfscore/file.h>
 
 #include "ramfs.h"
+#include <ramfs/ramfs.h>
 #include <dirent.h>
 #include <fcntl.h>
 #include <vfscore/fs.h>
 
+extern struct vnops ramfs_vnops;
+
 static struct uk_mutex ramfs_lock = UK_MUTEX_INITIALIZER(ramfs_lock);
 static uint64_t inode_count = 1; /* inode 0 is reserved to root */
 
@@ -428,6 +431,8 @@ ramfs_set_file_data(struct vnode *vp, const void *data, size_t size)
 {
 	struct ramfs_node *np =  vp->v_data;
 
+	if (vp->v_op != &ramfs_vnops)
+		return EINVAL;
 	if (vp->v_type == VDIR)
 		return EISDIR;
 	if (vp->v_type != VREG)
@@ -523,6 +528,7 @@ ramfs_rename(struct vnode *dvp1, struct vnode *vp1, char *name1 __unused,
 			np->rn_buf = old_np->rn_buf;
 			np->rn_size = old_np->rn_size;
 			np->rn_bufsize = old_np->rn_bufsize;
+			np->rn_owns_buf = old_np->rn_owns_buf;
 			old_np->rn_buf = NULL;
 		}
 		/* Remove source file */
@@ -0,0 +1,128 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/test.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <vfscore/file.h>
+#include <vfscore/dentry.h>
+#include <ramfs/ramfs.h>
+
+#define TEST_ROOT	"/ramfs_test"
+
+/* Not heap memory: freeing it from ramfs corrupts the heap */
+static char zerocopy_data[] = "archive-backed file contents";
+
+/* Creates a file whose contents reference zerocopy_data */
+static int create_zerocopy(const char *path)
+{
+	struct vfscore_file *fp;
+	int fd, rc;
+
+	fd = open(path, O_CREAT | O_RDWR, 0644);
+	if (fd < 0)
+		return -1;
+
+	fp = vfscore_get_file(fd);
+	if (!fp) {
+		close(fd);
+		return -1;
+	}
+
+	rc = ramfs_set_file_data(fp->f_dentry->d_vnode, zerocopy_data,
+				 sizeof(zerocopy_data));
+	vfscore_put_file(fp);
+	close(fd);
+
+	return rc ? -1 : 0;
+}
+
+UK_TESTCASE(ramfs, zerocopy_rename_across_directories)
+{
+	char buf[sizeof(zerocopy_data)];
+	struct stat st;
+	int fd;
+
+	UK_TEST_EXPECT_ZERO(mkdir(TEST_ROOT "/src", 0755));
+	UK_TEST_EXPECT_ZERO(mkdir(TEST_ROOT "/dst", 0755));
+	UK_TEST_EXPECT_ZERO(create_zerocopy(TEST_ROOT "/src/file"));
+
+	UK_TEST_EXPECT_ZERO(rename(TEST_ROOT "/src/file",
+				   TEST_ROOT "/dst/file"));
+	UK_TEST_EXPECT_ZERO(stat(TEST_ROOT "/dst/file", &st));
+	UK_TEST_EXPECT_SNUM_EQ(st.st_size, sizeof(zerocopy_data));
+
+	fd = open(TEST_ROOT "/dst/file", O_RDONLY);
+	UK_TEST_EXPECT(fd >= 0);
+	UK_TEST_EXPECT_SNUM_EQ(read(fd, buf, sizeof(buf)), sizeof(buf));
+	UK_TEST_EXPECT_ZERO(memcmp(buf, zerocopy_data, sizeof(buf)));
+	UK_TEST_EXPECT_ZERO(close(fd));
+
+	/* The moved file must still not own its buffer */
+	UK_TEST_EXPECT_ZERO(unlink(TEST_ROOT "/dst/file"));
+	UK_TEST_EXPECT_SNUM_EQ(stat(TEST_ROOT "/dst/file", &st), -1);
+	UK_TEST_EXPECT_SNUM_EQ(errno, ENOENT);
+}
+
+UK_TESTCASE(ramfs, zerocopy_truncate_after_rename)
+{
+	struct stat st;
+	int fd;
+
+	UK_TEST_EXPECT_ZERO(mkdir(TEST_ROOT "/tsrc", 0755));
+	UK_TEST_EXPECT_ZERO(mkdir(TEST_ROOT "/tdst", 0755));
+	UK_TEST_EXPECT_ZERO(create_zerocopy(TEST_ROOT "/tsrc/file"));
+	UK_TEST_EXPECT_ZERO(rename(TEST_ROOT "/tsrc/file",
+				   TEST_ROOT "/tdst/file"));
+
+	fd = open(TEST_ROOT "/tdst/file", O_WRONLY | O_TRUNC);
+	UK_TEST_EXPECT(fd >= 0);
+	UK_TEST_EXPECT_ZERO(close(fd));
+	UK_TEST_EXPECT_ZERO(stat(TEST_ROOT "/tdst/file", &st));
+	UK_TEST_EXPECT_ZERO(st.st_size);
+	UK_TEST_EXPECT_ZERO(unlink(TEST_ROOT "/tdst/file"));
+}
+
+static int ramfs_test_init(struct uk_testsuite *suite __unused)
+{
+	int rc;
+
+	rc = mkdir(TEST_ROOT, 0755);
+	if (rc)
+		return rc;
+	return mount("", TEST_ROOT, "ramfs", 0, NULL);
+}
+
+uk_testsuite_register(ramfs, ramfs_test_init);
@@ -0,0 +1,211 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Load-time rewriting of system call sites (x86_64)
+ *
+ * A site `mov $nr, %eax; syscall` (or `mov $nr, %rax; syscall`) is rewritten
+ * by replacing the `mov` with a jump to a per-site trampoline. The
+ * trampoline calls the raw handler of `nr` through a common entry that
+ * preserves all registers that the `syscall` instruction preserves, and
+ * jumps back behind the `syscall` instruction. The `syscall` instruction
+ * itself is left untouched so that code jumping directly to it still takes
+ * the trap path.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <uk/assert.h>
+#include <uk/essentials.h>
+#include <uk/print.h>
+#include <uk/syscall.h>
+
+/* Common entry of all trampolines, see rewrite_entry.S */
+extern void _uk_syscall_rewrite_entry(void);
+
+#define X86_MOV_EAX_IMM32_LEN	5
+#define X86_MOV_RAX_IMM32_LEN	7
+#define X86_SYSCALL_LEN		2
+#define X86_JMP_REL32_LEN	5
+
+static const __u8 x86_mov_eax_imm32[] = { 0xb8 };
+static const __u8 x86_mov_rax_imm32[] = { 0x48, 0xc7, 0xc0 };
+static const __u8 x86_syscall[] = { 0x0f, 0x05 };
+
+/*
+ * Trampoline layout, skips the red zone of the interrupted function before
+ * anything is pushed to the stack:
+ *
+ *   lea    -0x80(%rsp), %rsp
+ *   movabs $<handler>, %r11
+ *   movabs $_uk_syscall_rewrite_entry, %rax
+ *   call   *%rax
+ *   lea    0x80(%rsp), %rsp
+ *   jmp    <behind syscall instruction>
+ */
+static const __u8 tramp_lea_sub[] = { 0x48, 0x8d, 0x64, 0x24, 0x80 };
+static const __u8 tramp_movabs_r11[] = { 0x49, 0xbb };
+static const __u8 tramp_movabs_rax[] = { 0x48, 0xb8 };
+static const __u8 tramp_call_rax[] = { 0xff, 0xd0 };
+static const __u8 tramp_lea_add[] = { 0x48, 0x8d, 0xa4, 0x24,
+				      0x80, 0x00, 0x00, 0x00 };
+
+#define TRAMP_LEN (sizeof(tramp_lea_sub) + sizeof(tramp_movabs_r11) + 8 + \
+		   sizeof(tramp_movabs_rax) + 8 + sizeof(tramp_call_rax) + \
+		   sizeof(tramp_lea_add) + X86_JMP_REL32_LEN)
+
+UK_CTASSERT(TRAMP_LEN <= UK_SYSCALL_REWRITE_TRAMP_SIZE);
+
+static inline __u8 *emit(__u8 *p, const void *bytes, __sz len)
+{
+	memcpy(p, bytes, len);
+	return p + len;
+}
+
+static inline __u8 *emit64(__u8 *p, __u64 val)
+{
+	return emit(p, &val, sizeof(val));
+}
+
+/* Emits `jmp rel32` at `p`, returns NULL if `to` is out of range */
+static __u8 *emit_jmp(__u8 *p, const __u8 *to)
+{
+	__s64 rel = (__s64) (to - (p + X86_JMP_REL32_LEN));
+	__s32 rel32 = (__s32) rel;
+
+	if (rel != rel32)
+		return NULL;
+
+	*p++ = 0xe9;
+	return emit(p, &rel32, sizeof(rel32));
+}
+
+/*
+ * Returns the length of the `mov` instruction of a system call site at
+ * `p`, or 0 if there is none. The system call number is returned in `nr`.
+ */
+static __sz site_match(const __u8 *p, const __u8 *end, long *nr)
+{
+	__s32 imm;
+	__sz len;
+
+	if (end - p >= (long) (X86_MOV_EAX_IMM32_LEN + X86_SYSCALL_LEN) &&
+	    !memcmp(p, x86_mov_eax_imm32, sizeof(x86_mov_eax_imm32)))
+		len = X86_MOV_EAX_IMM32_LEN;
+	else if (end - p >= (long) (X86_MOV_RAX_IMM32_LEN + X86_SYSCALL_LEN) &&
+		 !memcmp(p, x86_mov_rax_imm32, sizeof(x86_mov_rax_imm32)))
+		len = X86_MOV_RAX_IMM32_LEN;
+	else
+		return 0;
+
+	if (memcmp(p + len, x86_syscall, sizeof(x86_syscall)))
+		return 0;
+
+	memcpy(&imm, p + len - sizeof(imm), sizeof(imm));
+	if (imm < 0)
+		return 0;
+
+	*nr = imm;
+	return len;
+}
+
+int uk_syscall_rewrite(void *code, __sz len, void *tramp, __sz tramp_len)
+{
+	__u8 *p = code, *end = p + len;
+	__u8 *t = tramp, *tend = t + tramp_len;
+	__u8 *tp, *sp;
+	long (*fn)(void);
+	unsigned int sites = 0, skipped = 0;
+	__sz mlen;
+	long nr;
+
+	if (unlikely(!code || (tramp_len && !tramp)))
+		return -EINVAL;
+
+	while (p < end) {
+		mlen = site_match(p, end, &nr);
+		if (!mlen) {
+			p++;
+			continue;
+		}
+
+		/* Unknown system calls keep failing through the trap path */
+		fn = uk_syscall_r_fn(nr);
+		if (!fn)
+			goto next;
+
+		if (!tramp) {
+			/* Only count sites */
+			sites++;
+			goto next;
+		}
+
+		if ((__sz) (tend - t) < UK_SYSCALL_REWRITE_TRAMP_SIZE) {
+			skipped++;
+			goto next;
+		}
+
+		tp = t;
+		tp = emit(tp, tramp_lea_sub, sizeof(tramp_lea_sub));
+		tp = emit(tp, tramp_movabs_r11, sizeof(tramp_movabs_r11));
+		tp = emit64(tp, (__u64) fn);
+		tp = emit(tp, tramp_movabs_rax, sizeof(tramp_movabs_rax));
+		tp = emit64(tp, (__u64) _uk_syscall_rewrite_entry);
+		tp = emit(tp, tramp_call_rax, sizeof(tramp_call_rax));
+		tp = emit(tp, tramp_lea_add, sizeof(tramp_lea_add));
+		tp = emit_jmp(tp, p + mlen + X86_SYSCALL_LEN);
+		if (!tp) {
+			skipped++;
+			goto next;
+		}
+
+		/* Replace the `mov` with a jump to the trampoline */
+		sp = emit_jmp(p, t);
+		if (!sp) {
+			skipped++;
+			goto next;
+		}
+		/* 2-byte nop (`xchg %ax, %ax`) in place of the rest */
+		UK_ASSERT(p + mlen - sp == 0 || p + mlen - sp == 2);
+		if (sp < p + mlen) {
+			sp[0] = 0x66;
+			sp[1] = 0x90;
+		}
+
+		t += UK_SYSCALL_REWRITE_TRAMP_SIZE;
+		sites++;
+next:
+		p += mlen + X86_SYSCALL_LEN;
+	}
+
+	uk_pr_debug("Rewrote %u system call sites in %p-%p (%u skipped)\n",
+		    sites, code, end, skipped);
+	return sites;
+}
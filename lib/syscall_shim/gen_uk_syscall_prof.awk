@@ -0,0 +1,29 @@
+BEGIN {
+	print "/* Auto generated file. DO NOT EDIT */\n\n"
+
+	print "#include <stddef.h>"
+	print "#include <uk/store.h>"
+	print "#include <uk/syscall.h>\n"
+	nr_syscalls = 0
+}
+
+
+/[a-zA-Z0-9]+-[0-9]+/{
+	name = $1
+	if (name in seen)
+		next
+	seen[name] = 1
+	syscalls[nr_syscalls++] = name
+	printf "struct uk_syscall_prof uk_syscall_prof_%s = { .name = \"%s\" };\n", name, name
+	printf "UK_STORE_STATIC_ENTRY(syscall_%s_calls, u64, _uk_syscall_prof_get_calls, NULL, &uk_syscall_prof_%s);\n", name, name
+	printf "UK_STORE_STATIC_ENTRY(syscall_%s_errors, u64, _uk_syscall_prof_get_errors, NULL, &uk_syscall_prof_%s);\n", name, name
+	printf "UK_STORE_STATIC_ENTRY(syscall_%s_time, u64, _uk_syscall_prof_get_time, NULL, &uk_syscall_prof_%s);\n", name, name
+	printf "UK_STORE_STATIC_ENTRY(syscall_%s_hist, charp, _uk_syscall_prof_get_hist, NULL, &uk_syscall_prof_%s);\n", name, name
+}
+
+END {
+	printf "\nstruct uk_syscall_prof *const uk_syscall_prof_tab[] = {\n"
+	for (i = 0; i < nr_syscalls; i++)
+		printf "\t&uk_syscall_prof_%s,\n", syscalls[i]
+	printf "\tNULL\n};\n"
+}
@@ -147,6 +147,76 @@ typedef long uk_syscall_arg_t;
 #define __UK_SYSCALL_PRINTD(...) do {} while(0)
 #endif /* CONFIG_LIBSYSCALL_SHIM_DEBUG || CONFIG_LIBUKDEBUG_PRINTD */
 
+#if CONFIG_LIBSYSCALL_SHIM_PROFILE
+#include <uk/plat/time.h>
+
+/*
+ * Syscall profiler
+ * Each provided system call has a profile (see generated uk_syscall_prof.c)
+ * that is updated by the UK_*SYSCALL*_DEFINE() wrappers, so native calls and
+ * binary system call requests are both accounted. Histogram bucket `i`
+ * counts calls that took [2^i, 2^(i+1)) nanoseconds; the last bucket also
+ * collects all longer calls.
+ */
+#define UK_SYSCALL_PROF_BUCKETS 24
+
+struct uk_syscall_prof {
+	const char *name;
+	/* Number of calls */
+	__u64 calls;
+	/* Number of calls that returned an error */
+	__u64 errors;
+	/* Total time spent in the call, in nanoseconds */
+	__u64 time;
+	/* Latency histogram */
+	__u64 hist[UK_SYSCALL_PROF_BUCKETS];
+};
+
+/* NULL-terminated table of all system call profiles */
+extern struct uk_syscall_prof *const uk_syscall_prof_tab[];
+
+#define uk_syscall_prof_foreach(itr)					\
+	for ((itr) = uk_syscall_prof_tab; *(itr); (itr)++)
+
+/**
+ * Returns the profile of the system call `name`, or NULL if the system call
+ * is not provided.
+ */
+struct uk_syscall_prof *uk_syscall_prof_get(const char *name);
+
+/**
+ * Resets all system call profiles.
+ */
+void uk_syscall_prof_reset(void);
+
+/**
+ * Prints a report of all system calls that were called at least once.
+ */
+void uk_syscall_prof_dump(void);
+
+void _uk_syscall_prof_record(struct uk_syscall_prof *prof, __nsec start,
+			     int failed);
+
+/* ukstore getters of the per-syscall entries, the cookie is the profile */
+int _uk_syscall_prof_get_calls(void *cookie, __u64 *out);
+int _uk_syscall_prof_get_errors(void *cookie, __u64 *out);
+int _uk_syscall_prof_get_time(void *cookie, __u64 *out);
+int _uk_syscall_prof_get_hist(void *cookie, char **out);
+
+/* Profiles are weak so that unlisted system calls are not accounted */
+#define __UK_SYSCALL_PROF_DECLARE(name)					\
+	extern struct uk_syscall_prof UK_CONCAT(uk_syscall_prof_, name) __weak;
+#define __UK_SYSCALL_PROF_START(start)					\
+	__nsec start = ukplat_monotonic_clock()
+#define __UK_SYSCALL_PROF_END(name, start, failed)			\
+	_uk_syscall_prof_record(&UK_CONCAT(uk_syscall_prof_, name),	\
+				(start), (failed))
+#else
+#define __UK_SYSCALL_PROF_DECLARE(name)
+#define __UK_SYSCALL_PROF_START(start) do {} while (0)
+#define __UK_SYSCALL_PROF_END(name, start, failed) do {} while (0)
+#endif /* CONFIG_LIBSYSCALL_SHIM_PROFILE */
+
 /* System call implementation that uses errno and returns -1 on errors */
 /* TODO: `void` as return type is currently not supported.
  * NOTE: Workaround is to use `int` instead.
@@ -156,6 +226,7 @@ typedef long uk_syscall_arg_t;
  * Low-level variant, does not provide a libc-style wrapper
  */
 #define __UK_LLSYSCALL_DEFINE(x, rtype, name, ename, rname, ...)	\
+	__UK_SYSCALL_PROF_DECLARE(name)					\
 	long ename(UK_ARG_MAPx(x, UK_S_ARG_LONG, __VA_ARGS__));		\
 	long rname(UK_ARG_MAPx(x, UK_S_ARG_LONG, __VA_ARGS__))		\
 	{								\
@@ -174,9 +245,14 @@ typedef long uk_syscall_arg_t;
 					UK_S_ARG_ACTUAL, __VA_ARGS__)); \
 	long ename(UK_ARG_MAPx(x, UK_S_ARG_LONG, __VA_ARGS__))		\
 	{								\
+		long ret;						\
+									\
 		__UK_SYSCALL_PRINTD(x, rtype, ename, __VA_ARGS__);	\
-		return (long) __##ename(				\
+		__UK_SYSCALL_PROF_START(_prof_start);			\
+		ret = (long) __##ename(					\
 			UK_ARG_MAPx(x, UK_S_ARG_CAST_ACTUAL, __VA_ARGS__)); \
+		__UK_SYSCALL_PROF_END(name, _prof_start, ret == -1);	\
+		return ret;						\
 	}								\
 	static inline rtype __##ename(UK_ARG_MAPx(x,			\
 						  UK_S_ARG_ACTUAL_MAYBE_UNUSED,\
@@ -231,6 +307,7 @@ typedef long uk_syscall_arg_t;
  * Low-level variant, does not provide a libc-style wrapper
  */
 #define __UK_LLSYSCALL_R_DEFINE(x, rtype, name, ename, rname, ...)	\
+	__UK_SYSCALL_PROF_DECLARE(name)					\
 	long rname(UK_ARG_MAPx(x, UK_S_ARG_LONG, __VA_ARGS__));		\
 	long ename(UK_ARG_MAPx(x, UK_S_ARG_LONG, __VA_ARGS__))		\
 	{								\
@@ -246,9 +323,15 @@ typedef long uk_syscall_arg_t;
 						 __VA_ARGS__));		\
 	long rname(UK_ARG_MAPx(x, UK_S_ARG_LONG, __VA_ARGS__))		\
 	{								\
+		long ret;						\
+									\
 		__UK_SYSCALL_PRINTD(x, rtype, rname, __VA_ARGS__);	\
-		return (long) __##rname(				\
+		__UK_SYSCALL_PROF_START(_prof_start);			\
+		ret = (long) __##rname(					\
 			UK_ARG_MAPx(x, UK_S_ARG_CAST_ACTUAL, __VA_ARGS__)); \
+		__UK_SYSCALL_PROF_END(name, _prof_start,		\
+				      ret < 0 && PTRISERR(ret));	\
+		return ret;						\
 	}								\
 	static inline rtype __##rname(UK_ARG_MAPx(x,			\
 						  UK_S_ARG_ACTUAL_MAYBE_UNUSED,\
@@ -358,8 +441,8 @@ long uk_syscall6_r(long nr, long arg1, long arg2, long arg3,
  * handler instead of doing a look-up at runtime
  */
 #define uk_syscall_r_static(...)					\
-	UK_CONCAT(__uk_syscall,						\
-		  UK_CONCAT(__UK_SYSCALL_NARGS(__VA_ARGS__)), _r)(__VA_ARGS__)
+	UK_CONCAT(UK_CONCAT(__uk_syscall,				\
+			    __UK_SYSCALL_NARGS(__VA_ARGS__)), _r)(__VA_ARGS__)
 
 /**
  * Returns a string with the name of the system call number `nr`.
@@ -398,6 +481,35 @@ const char *uk_syscall_name_p(long nr);
  */
 long (*uk_syscall_r_fn(long nr))(void);
 
+#if CONFIG_LIBSYSCALL_SHIM_REWRITE
+/* Size of the trampoline that is needed for each rewritten site */
+#define UK_SYSCALL_REWRITE_TRAMP_SIZE 40
+
+/**
+ * Rewrites system call sites in the code of a binary-compatible application
+ * so that they call the raw system call handler directly instead of
+ * trapping. Sites are `mov $nr, %eax; syscall` sequences with a constant
+ * system call number `nr` that is provided. Other sites keep using the
+ * trap path. The sequences are found by a byte-pattern scan, not by
+ * disassembling the code.
+ *
+ * @param code
+ *  Start of an executable segment; must be writable during the call
+ * @param len
+ *  Length of the segment
+ * @param tramp
+ *  Executable memory for the trampolines (UK_SYSCALL_REWRITE_TRAMP_SIZE
+ *  bytes per site), within +/-2GiB of `code`. If NULL, only the number
+ *  of sites that could be rewritten is returned.
+ * @param tramp_len
+ *  Length of `tramp`
+ * @return
+ *  - (>=0): number of rewritten sites
+ *  - (<0): negative error code
+ */
+int uk_syscall_rewrite(void *code, __sz len, void *tramp, __sz tramp_len);
+#endif /* CONFIG_LIBSYSCALL_SHIM_REWRITE */
+
 #endif /* CONFIG_LIBSYSCALL_SHIM */
 
 #ifdef __cplusplus
@@ -0,0 +1,202 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <uk/arch/atomic.h>
+#include <uk/store.h>
+#include <uk/syscall.h>
+
+void _uk_syscall_prof_record(struct uk_syscall_prof *prof, __nsec start,
+			     int failed)
+{
+	__nsec duration;
+	unsigned int bucket;
+
+	if (!prof)
+		return;
+
+	duration = ukplat_monotonic_clock() - start;
+	bucket = duration ? ukarch_flsl(duration) : 0;
+	if (bucket >= UK_SYSCALL_PROF_BUCKETS)
+		bucket = UK_SYSCALL_PROF_BUCKETS - 1;
+
+	/* Calls can be made concurrently from multiple CPUs */
+	__atomic_fetch_add(&prof->calls, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&prof->time, duration, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&prof->hist[bucket], 1, __ATOMIC_RELAXED);
+	if (failed)
+		__atomic_fetch_add(&prof->errors, 1, __ATOMIC_RELAXED);
+}
+
+struct uk_syscall_prof *uk_syscall_prof_get(const char *name)
+{
+	struct uk_syscall_prof *const *itr;
+
+	uk_syscall_prof_foreach(itr) {
+		if (strcmp((*itr)->name, name) == 0)
+			return *itr;
+	}
+	return NULL;
+}
+
+void uk_syscall_prof_reset(void)
+{
+	struct uk_syscall_prof *const *itr;
+	struct uk_syscall_prof *prof;
+	unsigned int i;
+
+	uk_syscall_prof_foreach(itr) {
+		prof = *itr;
+		UK_WRITE_ONCE(prof->calls, 0);
+		UK_WRITE_ONCE(prof->errors, 0);
+		UK_WRITE_ONCE(prof->time, 0);
+		for (i = 0; i < UK_SYSCALL_PROF_BUCKETS; i++)
+			UK_WRITE_ONCE(prof->hist[i], 0);
+	}
+}
+
+void uk_syscall_prof_dump(void)
+{
+	struct uk_syscall_prof *const *itr;
+	struct uk_syscall_prof *prof;
+	unsigned int i;
+
+	printf("%-20s %12s %12s %14s %10s  %s\n", "syscall", "calls",
+	       "errors", "total [ns]", "avg [ns]",
+	       "latency histogram (log2 ns: calls)");
+
+	uk_syscall_prof_foreach(itr) {
+		prof = *itr;
+		if (!prof->calls)
+			continue;
+
+		printf("%-20s %12llu %12llu %14llu %10llu ", prof->name,
+		       (unsigned long long) prof->calls,
+		       (unsigned long long) prof->errors,
+		       (unsigned long long) prof->time,
+		       (unsigned long long) (prof->time / prof->calls));
+		for (i = 0; i < UK_SYSCALL_PROF_BUCKETS; i++) {
+			if (prof->hist[i])
+				printf(" %u:%llu", i,
+				       (unsigned long long) prof->hist[i]);
+		}
+		printf("\n");
+	}
+}
+
+int _uk_syscall_prof_get_calls(void *cookie, __u64 *out)
+{
+	*out = UK_READ_ONCE(((struct uk_syscall_prof *) cookie)->calls);
+	return 0;
+}
+
+int _uk_syscall_prof_get_errors(void *cookie, __u64 *out)
+{
+	*out = UK_READ_ONCE(((struct uk_syscall_prof *) cookie)->errors);
+	return 0;
+}
+
+int _uk_syscall_prof_get_time(void *cookie, __u64 *out)
+{
+	*out = UK_READ_ONCE(((struct uk_syscall_prof *) cookie)->time);
+	return 0;
+}
+
+/* Formats the histogram like uk_syscall_prof_dump(): "bucket:calls ..." */
+int _uk_syscall_prof_get_hist(void *cookie, char **out)
+{
+	struct uk_syscall_prof *prof = cookie;
+	/* Space for " bucket:calls" with 2 and 20 digits per bucket */
+	size_t len = UK_SYSCALL_PROF_BUCKETS * 24 + 1;
+	size_t off = 0;
+	unsigned int i;
+	__u64 calls;
+	char *str;
+
+	str = malloc(len);
+	if (!str)
+		return -ENOMEM;
+
+	str[0] = '\0';
+	for (i = 0; i < UK_SYSCALL_PROF_BUCKETS; i++) {
+		calls = UK_READ_ONCE(prof->hist[i]);
+		if (calls)
+			off += snprintf(str + off, len - off, "%s%u:%llu",
+					off ? " " : "", i,
+					(unsigned long long) calls);
+	}
+
+	*out = str;
+	return 0;
+}
+
+static int get_calls(void *cookie __unused, __u64 *out)
+{
+	struct uk_syscall_prof *const *itr;
+
+	*out = 0;
+	uk_syscall_prof_foreach(itr)
+		*out += (*itr)->calls;
+	return 0;
+}
+UK_STORE_STATIC_ENTRY(syscall_calls, u64, get_calls, NULL, NULL);
+
+static int get_errors(void *cookie __unused, __u64 *out)
+{
+	struct uk_syscall_prof *const *itr;
+
+	*out = 0;
+	uk_syscall_prof_foreach(itr)
+		*out += (*itr)->errors;
+	return 0;
+}
+UK_STORE_STATIC_ENTRY(syscall_errors, u64, get_errors, NULL, NULL);
+
+static int get_time(void *cookie __unused, __u64 *out)
+{
+	struct uk_syscall_prof *const *itr;
+
+	*out = 0;
+	uk_syscall_prof_foreach(itr)
+		*out += (*itr)->time;
+	return 0;
+}
+UK_STORE_STATIC_ENTRY(syscall_time, u64, get_time, NULL, NULL);
+
+static int set_reset(void *cookie __unused, __u8 val)
+{
+	if (val)
+		uk_syscall_prof_reset();
+	return 0;
+}
+UK_STORE_STATIC_ENTRY(syscall_prof_reset, u8, NULL, set_reset, NULL);
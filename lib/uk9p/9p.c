@@ -45,7 +45,7 @@ UK_TRACEPOINT(uk_9p_trace_ready, "tag %u", uint16_t);
 UK_TRACEPOINT(uk_9p_trace_sent, "tag %u", uint16_t);
 UK_TRACEPOINT(uk_9p_trace_received, "tag %u", uint16_t);
 
-static inline int send_and_wait_zc(struct uk_9pdev *dev, struct uk_9preq *req,
+static inline int send_zc(struct uk_9pdev *dev, struct uk_9preq *req,
 		enum uk_9preq_zcdir zc_dir, void *zc_buf, uint32_t zc_size,
 		uint32_t zc_offset)
 {
@@ -59,6 +59,13 @@ static inline int send_and_wait_zc(struct uk_9pdev *dev, struct uk_9preq *req,
 		return rc;
 	uk_9p_trace_sent(req->tag);
 
+	return 0;
+}
+
+static inline int wait_reply(struct uk_9preq *req)
+{
+	int rc;
+
 	if ((rc = uk_9preq_waitreply(req)))
 		return rc;
 	uk_9p_trace_received(req->tag);
@@ -66,6 +73,18 @@ static inline int send_and_wait_zc(struct uk_9pdev *dev, struct uk_9preq *req,
 	return 0;
 }
 
+static inline int send_and_wait_zc(struct uk_9pdev *dev, struct uk_9preq *req,
+		enum uk_9preq_zcdir zc_dir, void *zc_buf, uint32_t zc_size,
+		uint32_t zc_offset)
+{
+	int rc;
+
+	if ((rc = send_zc(dev, req, zc_dir, zc_buf, zc_size, zc_offset)))
+		return rc;
+
+	return wait_reply(req);
+}
+
 static inline int send_and_wait_no_zc(struct uk_9pdev *dev,
 		struct uk_9preq *req)
 {
@@ -374,64 +393,75 @@ out:
 	return rc;
 }
 
-int64_t uk_9p_read(struct uk_9pdev *dev, struct uk_9pfid *fid,
+struct uk_9preq *uk_9p_read_start(struct uk_9pdev *dev, struct uk_9pfid *fid,
 		uint64_t offset, uint32_t count, char *buf)
 {
 	struct uk_9preq *req;
-	int64_t rc;
+	int rc;
 
-	if (fid->iounit != 0)
-		count = MIN(count, fid->iounit);
-	count = MIN(count, dev->msize - 11);
+	count = MIN(count, uk_9p_read_iosize(dev, fid));
 
 	uk_pr_debug("TREAD fid %u offset %lu count %u\n", fid->fid,
 			offset, count);
 
 	req = request_create(dev, UK_9P_TREAD);
 	if (PTRISERR(req))
-		return PTR2ERR(req);
+		return req;
 
 	if ((rc = uk_9preq_write32(req, fid->fid)) ||
 		(rc = uk_9preq_write64(req, offset)) ||
 		(rc = uk_9preq_write32(req, count)) ||
-		(rc = send_and_wait_zc(dev, req, UK_9PREQ_ZCDIR_READ, buf,
-				       count, 11)) ||
-		(rc = uk_9preq_read32(req, &count)))
+		(rc = send_zc(dev, req, UK_9PREQ_ZCDIR_READ, buf,
+			      count, UK_9P_RREAD_HEADER_SIZE)))
 		goto out;
 
-	uk_pr_debug("RREAD count %u\n", count);
-
-	rc = count;
+	return req;
 
 out:
 	uk_9pdev_req_remove(dev, req);
-	return rc;
+	return ERR2PTR(rc);
 }
 
-int64_t uk_9p_write(struct uk_9pdev *dev, struct uk_9pfid *fid,
+struct uk_9preq *uk_9p_write_start(struct uk_9pdev *dev, struct uk_9pfid *fid,
 		uint64_t offset, uint32_t count, const char *buf)
 {
 	struct uk_9preq *req;
-	int64_t rc;
+	int rc;
 
-	count = MIN(count, fid->iounit);
-	count = MIN(count, dev->msize - 23);
+	count = MIN(count, uk_9p_write_iosize(dev, fid));
 
 	uk_pr_debug("TWRITE fid %u offset %lu count %u\n", fid->fid,
 			offset, count);
+
 	req = request_create(dev, UK_9P_TWRITE);
 	if (PTRISERR(req))
-		return PTR2ERR(req);
+		return req;
 
 	if ((rc = uk_9preq_write32(req, fid->fid)) ||
 		(rc = uk_9preq_write64(req, offset)) ||
 		(rc = uk_9preq_write32(req, count)) ||
-		(rc = send_and_wait_zc(dev, req, UK_9PREQ_ZCDIR_WRITE,
-				(void *)buf, count, 23)) ||
+		(rc = send_zc(dev, req, UK_9PREQ_ZCDIR_WRITE, (void *)buf,
+			      count, UK_9P_TWRITE_HEADER_SIZE)))
+		goto out;
+
+	return req;
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return ERR2PTR(rc);
+}
+
+int64_t uk_9p_io_finish(struct uk_9pdev *dev, struct uk_9preq *req)
+{
+	uint32_t count;
+	int64_t rc;
+
+	if ((rc = wait_reply(req)) ||
 		(rc = uk_9preq_read32(req, &count)))
 		goto out;
 
-	uk_pr_debug("RWRITE count %u\n", count);
+	uk_pr_debug("R%s count %u\n",
+		    req->xmit.type == UK_9P_TWRITE ? "WRITE" : "READ", count);
 
 	rc = count;
 
@@ -440,6 +470,30 @@ out:
 	return rc;
 }
 
+int64_t uk_9p_read(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t offset, uint32_t count, char *buf)
+{
+	struct uk_9preq *req;
+
+	req = uk_9p_read_start(dev, fid, offset, count, buf);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	return uk_9p_io_finish(dev, req);
+}
+
+int64_t uk_9p_write(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t offset, uint32_t count, const char *buf)
+{
+	struct uk_9preq *req;
+
+	req = uk_9p_write_start(dev, fid, offset, count, buf);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	return uk_9p_io_finish(dev, req);
+}
+
 struct uk_9preq *uk_9p_stat(struct uk_9pdev *dev, struct uk_9pfid *fid,
 		struct uk_9p_stat *stat)
 {
@@ -499,3 +553,157 @@ out:
 	uk_9pdev_req_remove(dev, req);
 	return rc;
 }
+
+int uk_9p_lopen(struct uk_9pdev *dev, struct uk_9pfid *fid, uint32_t flags)
+{
+	struct uk_9preq *req;
+	int rc = 0;
+
+	req = request_create(dev, UK_9P_TLOPEN);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	uk_pr_debug("TLOPEN fid %u flags %o\n", fid->fid, flags);
+
+	if ((rc = uk_9preq_write32(req, fid->fid)) ||
+		(rc = uk_9preq_write32(req, flags)) ||
+		(rc = send_and_wait_no_zc(dev, req)) ||
+		(rc = uk_9preq_readqid(req, &fid->qid)) ||
+		(rc = uk_9preq_read32(req, &fid->iounit)))
+		goto out;
+
+	uk_pr_debug("RLOPEN qid type %u version %u path %lu iounit %u\n",
+			fid->qid.type, fid->qid.version, fid->qid.path,
+			fid->iounit);
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
+
+int uk_9p_lcreate(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		const char *name, uint32_t flags, uint32_t mode, uint32_t gid)
+{
+	struct uk_9preq *req;
+	struct uk_9p_str name_str;
+	int rc = 0;
+
+	uk_9p_str_init(&name_str, name);
+
+	req = request_create(dev, UK_9P_TLCREATE);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	uk_pr_debug("TLCREATE fid %u name %s flags %o mode %o gid %u\n",
+			fid->fid, name, flags, mode, gid);
+
+	if ((rc = uk_9preq_write32(req, fid->fid)) ||
+		(rc = uk_9preq_writestr(req, &name_str)) ||
+		(rc = uk_9preq_write32(req, flags)) ||
+		(rc = uk_9preq_write32(req, mode)) ||
+		(rc = uk_9preq_write32(req, gid)) ||
+		(rc = send_and_wait_no_zc(dev, req)) ||
+		(rc = uk_9preq_readqid(req, &fid->qid)) ||
+		(rc = uk_9preq_read32(req, &fid->iounit)))
+		goto out;
+
+	uk_pr_debug("RLCREATE qid type %u version %u path %lu iounit %u\n",
+			fid->qid.type, fid->qid.version, fid->qid.path,
+			fid->iounit);
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
+
+int uk_9p_mkdir(struct uk_9pdev *dev, struct uk_9pfid *dfid,
+		const char *name, uint32_t mode, uint32_t gid)
+{
+	struct uk_9preq *req;
+	struct uk_9p_str name_str;
+	struct uk_9p_qid qid;
+	int rc = 0;
+
+	uk_9p_str_init(&name_str, name);
+
+	req = request_create(dev, UK_9P_TMKDIR);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	uk_pr_debug("TMKDIR dfid %u name %s mode %o gid %u\n",
+			dfid->fid, name, mode, gid);
+
+	if ((rc = uk_9preq_write32(req, dfid->fid)) ||
+		(rc = uk_9preq_writestr(req, &name_str)) ||
+		(rc = uk_9preq_write32(req, mode)) ||
+		(rc = uk_9preq_write32(req, gid)) ||
+		(rc = send_and_wait_no_zc(dev, req)) ||
+		(rc = uk_9preq_readqid(req, &qid)))
+		goto out;
+
+	uk_pr_debug("RMKDIR qid type %u version %u path %lu\n",
+			qid.type, qid.version, qid.path);
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
+
+int uk_9p_getattr(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t request_mask, struct uk_9p_attr *attr)
+{
+	struct uk_9preq *req;
+	int rc = 0;
+
+	req = request_create(dev, UK_9P_TGETATTR);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	uk_pr_debug("TGETATTR fid %u request_mask %lx\n", fid->fid,
+			request_mask);
+
+	if ((rc = uk_9preq_write32(req, fid->fid)) ||
+		(rc = uk_9preq_write64(req, request_mask)) ||
+		(rc = send_and_wait_no_zc(dev, req)) ||
+		(rc = uk_9preq_readattr(req, attr)))
+		goto out;
+
+	uk_pr_debug("RGETATTR valid %lx mode %o size %lu\n", attr->valid,
+			attr->mode, attr->size);
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
+
+int64_t uk_9p_readdir(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t offset, uint32_t count, char *buf)
+{
+	struct uk_9preq *req;
+	int64_t rc;
+
+	count = MIN(count, uk_9p_read_iosize(dev, fid));
+
+	uk_pr_debug("TREADDIR fid %u offset %lu count %u\n", fid->fid,
+			offset, count);
+
+	req = request_create(dev, UK_9P_TREADDIR);
+	if (PTRISERR(req))
+		return PTR2ERR(req);
+
+	if ((rc = uk_9preq_write32(req, fid->fid)) ||
+		(rc = uk_9preq_write64(req, offset)) ||
+		(rc = uk_9preq_write32(req, count)) ||
+		(rc = send_and_wait_zc(dev, req, UK_9PREQ_ZCDIR_READ, buf,
+				       count, UK_9P_RREAD_HEADER_SIZE)) ||
+		(rc = uk_9preq_read32(req, &count)))
+		goto out;
+
+	uk_pr_debug("RREADDIR count %u\n", count);
+
+	rc = count;
+
+out:
+	uk_9pdev_req_remove(dev, req);
+	return rc;
+}
@@ -165,7 +165,8 @@ int uk_9preq_receive_cb(struct uk_9preq *req, uint32_t recv_size)
 		return -EIO;
 
 	/* Fix the receive size for zero-copy requests. */
-	if (req->recv.zc_buf && req->recv.type != UK_9P_RERROR)
+	if (req->recv.zc_buf && req->recv.type != UK_9P_RERROR &&
+			req->recv.type != UK_9P_RLERROR)
 		req->recv.size = req->recv.zc_offset;
 	else
 		req->recv.size = size;
@@ -206,7 +207,7 @@ int uk_9preq_error(struct uk_9preq *req)
 
 	if (UK_READ_ONCE(req->state) != UK_9PREQ_RECEIVED)
 		return -EIO;
-	if (req->recv.type != UK_9P_RERROR)
+	if (req->recv.type != UK_9P_RERROR && req->recv.type != UK_9P_RLERROR)
 		return 0;
 
 	/*
@@ -215,6 +216,18 @@ int uk_9preq_error(struct uk_9preq *req)
 	 */
 	UK_BUGON(req->recv.offset != UK_9P_HEADER_SIZE);
 
+	/* 9P2000.L errors carry only the numeric error code. */
+	if (req->recv.type == UK_9P_RLERROR) {
+		if ((rc = uk_9preq_read32(req, &errcode)) < 0)
+			return rc;
+
+		uk_pr_debug("RLERROR %d\n", errcode);
+		if (errcode == 0 || errcode >= 512)
+			return -EIO;
+
+		return -errcode;
+	}
+
 	if ((rc = uk_9preq_readstr(req, &error)) < 0 ||
 		(rc = uk_9preq_read32(req, &errcode)) < 0)
 		return rc;
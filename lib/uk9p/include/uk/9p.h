@@ -45,6 +45,62 @@
 extern "C" {
 #endif
 
+/*
+ * Size of the fixed part of an Rread (and Rreaddir) reply: header (7) and
+ * count (4).
+ */
+#define UK_9P_RREAD_HEADER_SIZE         11U
+
+/*
+ * Size of the fixed part of a Twrite request: header (7), fid (4), offset (8)
+ * and count (4).
+ */
+#define UK_9P_TWRITE_HEADER_SIZE        23U
+
+/**
+ * Returns the maximum amount of data a single read on the given fid can
+ * transfer, as limited by the negotiated message size and the fid iounit.
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   Opened 9P fid.
+ * @return
+ *   Maximum number of bytes per read request.
+ */
+static inline uint32_t uk_9p_read_iosize(struct uk_9pdev *dev,
+		struct uk_9pfid *fid)
+{
+	uint32_t size = dev->msize - UK_9P_RREAD_HEADER_SIZE;
+
+	if (fid->iounit != 0)
+		size = MIN(size, fid->iounit);
+
+	return size;
+}
+
+/**
+ * Returns the maximum amount of data a single write on the given fid can
+ * transfer, as limited by the negotiated message size and the fid iounit.
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   Opened 9P fid.
+ * @return
+ *   Maximum number of bytes per write request.
+ */
+static inline uint32_t uk_9p_write_iosize(struct uk_9pdev *dev,
+		struct uk_9pfid *fid)
+{
+	uint32_t size = dev->msize - UK_9P_TWRITE_HEADER_SIZE;
+
+	if (fid->iounit != 0)
+		size = MIN(size, fid->iounit);
+
+	return size;
+}
+
 /**
  * Negotiates the version and is the first message in a 9P session.
  *
@@ -225,6 +281,66 @@ int64_t uk_9p_read(struct uk_9pdev *dev, struct uk_9pfid *fid,
 int64_t uk_9p_write(struct uk_9pdev *dev, struct uk_9pfid *fid,
 		uint64_t offset, uint32_t count, const char *buf);
 
+/**
+ * Sends a read request without waiting for the reply, allowing several
+ * requests to be in flight on the same device. The count is limited to
+ * uk_9p_read_iosize(). The buffer must stay valid until the request is
+ * completed with uk_9p_io_finish().
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid to read from.
+ * @param offset
+ *   Offset at which to start reading.
+ * @param count
+ *   Maximum number of bytes to read.
+ * @param buf
+ *   Buffer to read into.
+ * @return
+ *   - (!ERRPTR): The sent request, to be passed to uk_9p_io_finish().
+ *   - ERRPTR: The error returned by the API.
+ */
+struct uk_9preq *uk_9p_read_start(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t offset, uint32_t count, char *buf);
+
+/**
+ * Sends a write request without waiting for the reply, allowing several
+ * requests to be in flight on the same device. The count is limited to
+ * uk_9p_write_iosize(). The buffer must stay valid until the request is
+ * completed with uk_9p_io_finish().
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid to write to.
+ * @param offset
+ *   Offset at which to start writing.
+ * @param count
+ *   Maximum number of bytes to write.
+ * @param buf
+ *   Data to be written.
+ * @return
+ *   - (!ERRPTR): The sent request, to be passed to uk_9p_io_finish().
+ *   - ERRPTR: The error returned by the API.
+ */
+struct uk_9preq *uk_9p_write_start(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t offset, uint32_t count, const char *buf);
+
+/**
+ * Waits for the reply of a request sent with uk_9p_read_start() or
+ * uk_9p_write_start() and removes the request.
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param req
+ *   The in-flight request.
+ * @return
+ *   - (>= 0): Amount of bytes transferred.
+ *   - (< 0): An error occurred.
+ */
+int64_t uk_9p_io_finish(struct uk_9pdev *dev, struct uk_9preq *req);
+
 /**
  * Stats the given fid and places the data into the given stat structure.
  *
@@ -256,6 +372,108 @@ struct uk_9preq *uk_9p_stat(struct uk_9pdev *dev, struct uk_9pfid *fid,
 int uk_9p_wstat(struct uk_9pdev *dev, struct uk_9pfid *fid,
 		struct uk_9p_stat *stat);
 
+/**
+ * Opens the fid with the given Linux open flags (9P2000.L).
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid.
+ * @param flags
+ *   9P2000.L open flags (UK_9P_DOTL_*).
+ * @return
+ *   - 0: Successful.
+ *   - (< 0): An error occurred.
+ */
+int uk_9p_lopen(struct uk_9pdev *dev, struct uk_9pfid *fid, uint32_t flags);
+
+/**
+ * Creates a regular file with the given name in the directory associated
+ * with fid, and associates fid with the newly created file, opening it with
+ * the given flags (9P2000.L).
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P directory fid.
+ * @param name
+ *   Name of the created file.
+ * @param flags
+ *   9P2000.L open flags (UK_9P_DOTL_*).
+ * @param mode
+ *   POSIX mode of the created file.
+ * @param gid
+ *   Group id of the created file.
+ * @return
+ *   - 0: Successful.
+ *   - (< 0): An error occurred.
+ */
+int uk_9p_lcreate(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		const char *name, uint32_t flags, uint32_t mode, uint32_t gid);
+
+/**
+ * Creates a directory with the given name in the directory associated with
+ * dfid (9P2000.L).
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param dfid
+ *   9P directory fid.
+ * @param name
+ *   Name of the created directory.
+ * @param mode
+ *   POSIX mode of the created directory.
+ * @param gid
+ *   Group id of the created directory.
+ * @return
+ *   - 0: Successful.
+ *   - (< 0): An error occurred.
+ */
+int uk_9p_mkdir(struct uk_9pdev *dev, struct uk_9pfid *dfid,
+		const char *name, uint32_t mode, uint32_t gid);
+
+/**
+ * Gets the attributes of the given fid (9P2000.L). Unlike uk_9p_stat(), no
+ * strings are returned, so the request is not kept around.
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   9P fid.
+ * @param request_mask
+ *   Requested attributes (UK_9P_GETATTR_*).
+ * @param attr
+ *   Where to store the attributes.
+ * @return
+ *   - 0: Successful.
+ *   - (< 0): An error occurred.
+ */
+int uk_9p_getattr(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t request_mask, struct uk_9p_attr *attr);
+
+/**
+ * Reads directory entries from the opened directory fid (9P2000.L). The
+ * buffer is filled with whole entries that can be deserialized with
+ * uk_9preq_readdirent(); the offset of the last entry consumed must be
+ * passed to continue reading.
+ *
+ * @param dev
+ *   The Unikraft 9P Device.
+ * @param fid
+ *   Opened 9P directory fid.
+ * @param offset
+ *   0, or the offset field of the last consumed directory entry.
+ * @param count
+ *   Maximum number of bytes to read.
+ * @param buf
+ *   Buffer to read into.
+ * @return
+ *   - (>= 0): Amount of bytes read, 0 at the end of the directory.
+ *   - (< 0): An error occurred.
+ */
+int64_t uk_9p_readdir(struct uk_9pdev *dev, struct uk_9pfid *fid,
+		uint64_t offset, uint32_t count, char *buf);
+
 #ifdef __cplusplus
 }
 #endif
@@ -53,6 +53,20 @@ extern "C" {
  * Source: https://github.com/9fans/plan9port/blob/master/include/fcall.h
  */
 enum uk_9p_type {
+	/* 9P2000.L extensions. */
+	UK_9P_TLERROR           = 6,
+	UK_9P_RLERROR,
+	UK_9P_TLOPEN            = 12,
+	UK_9P_RLOPEN,
+	UK_9P_TLCREATE          = 14,
+	UK_9P_RLCREATE,
+	UK_9P_TGETATTR          = 24,
+	UK_9P_RGETATTR,
+	UK_9P_TREADDIR          = 40,
+	UK_9P_RREADDIR,
+	UK_9P_TMKDIR            = 72,
+	UK_9P_RMKDIR,
+	/* 9P2000 and 9P2000.u. */
 	UK_9P_TVERSION          = 100,
 	UK_9P_RVERSION,
 	UK_9P_TAUTH             = 102,
@@ -135,6 +149,42 @@ enum uk_9p_type {
 #define UK_9P_OAPPEND             0x80
 #define UK_9P_OEXCL               0x1000
 
+/**
+ * 9P2000.L open and create flags, using the Linux generic values.
+ *
+ * Source: https://github.com/chaos/diod/blob/master/protocol.md.
+ */
+#define UK_9P_DOTL_RDONLY         00000000
+#define UK_9P_DOTL_WRONLY         00000001
+#define UK_9P_DOTL_RDWR           00000002
+#define UK_9P_DOTL_CREATE         00000100
+#define UK_9P_DOTL_EXCL           00000200
+#define UK_9P_DOTL_NOCTTY         00000400
+#define UK_9P_DOTL_TRUNC          00001000
+#define UK_9P_DOTL_APPEND         00002000
+#define UK_9P_DOTL_NONBLOCK       00004000
+#define UK_9P_DOTL_DIRECTORY      00200000
+#define UK_9P_DOTL_NOFOLLOW       00400000
+#define UK_9P_DOTL_SYNC           04000000
+
+/**
+ * 9P2000.L getattr request mask bits.
+ *
+ * Source: https://github.com/chaos/diod/blob/master/protocol.md.
+ */
+#define UK_9P_GETATTR_MODE        0x00000001ULL
+#define UK_9P_GETATTR_NLINK       0x00000002ULL
+#define UK_9P_GETATTR_UID         0x00000004ULL
+#define UK_9P_GETATTR_GID         0x00000008ULL
+#define UK_9P_GETATTR_RDEV        0x00000010ULL
+#define UK_9P_GETATTR_ATIME       0x00000020ULL
+#define UK_9P_GETATTR_MTIME       0x00000040ULL
+#define UK_9P_GETATTR_CTIME       0x00000080ULL
+#define UK_9P_GETATTR_INO         0x00000100ULL
+#define UK_9P_GETATTR_SIZE        0x00000200ULL
+#define UK_9P_GETATTR_BLOCKS      0x00000400ULL
+#define UK_9P_GETATTR_BASIC       0x000007ffULL
+
 /**
  * 9P qid.
  *
@@ -212,6 +262,42 @@ struct uk_9p_stat {
 	uint32_t                n_muid;
 };
 
+/**
+ * 9P2000.L attribute structure, as returned by Rgetattr.
+ */
+struct uk_9p_attr {
+	uint64_t                valid;
+	struct uk_9p_qid        qid;
+	uint32_t                mode;
+	uint32_t                uid;
+	uint32_t                gid;
+	uint64_t                nlink;
+	uint64_t                rdev;
+	uint64_t                size;
+	uint64_t                blksize;
+	uint64_t                blocks;
+	uint64_t                atime_sec;
+	uint64_t                atime_nsec;
+	uint64_t                mtime_sec;
+	uint64_t                mtime_nsec;
+	uint64_t                ctime_sec;
+	uint64_t                ctime_nsec;
+	uint64_t                btime_sec;
+	uint64_t                btime_nsec;
+	uint64_t                gen;
+	uint64_t                data_version;
+};
+
+/**
+ * 9P2000.L directory entry, as found in the data of an Rreaddir reply.
+ */
+struct uk_9p_dirent {
+	struct uk_9p_qid        qid;
+	uint64_t                offset;
+	uint8_t                 type;
+	struct uk_9p_str        name;
+};
+
 /*
  * TODO: The wire format is always little-endian. Add little-endian types and
  * cpu_to_le*() data to the required format.
@@ -137,7 +137,7 @@ void *uk_malloc_ifpages(struct uk_alloc *a, __sz size)
 		return __NULL;
 
 	num_pages = size_to_num_pages(realsize);
-	intptr = (__uptr)uk_palloc(a, num_pages);
+	intptr = (__uptr)uk_do_palloc(a, num_pages);
 
 	if (!intptr)
 		return __NULL;
@@ -161,7 +161,7 @@ void uk_free_ifpages(struct uk_alloc *a, void *ptr)
 
 	UK_ASSERT(metadata->base != __NULL);
 	UK_ASSERT(metadata->num_pages != 0);
-	uk_pfree(a, metadata->base, metadata->num_pages);
+	uk_do_pfree(a, metadata->base, metadata->num_pages);
 }
 
 void *uk_realloc_ifpages(struct uk_alloc *a, void *ptr, __sz size)
@@ -252,7 +252,7 @@ int uk_posix_memalign_ifpages(struct uk_alloc *a,
 		return EINVAL;
 
 	num_pages = size_to_num_pages(realsize);
-	intptr = (__uptr) uk_palloc(a, num_pages);
+	intptr = (__uptr) uk_do_palloc(a, num_pages);
 
 	if (!intptr)
 		return ENOMEM;
@@ -455,7 +455,7 @@ void uk_pfree_compat(struct uk_alloc *a, void *ptr,
 	/* if the object is not page aligned it was clearly not from us */
 	UK_ASSERT(page_off(ptr) == 0);
 
-	uk_free(a, ptr);
+	uk_do_free(a, ptr);
 }
 
 void *uk_palloc_compat(struct uk_alloc *a, unsigned long num_pages)
@@ -468,7 +468,8 @@ void *uk_palloc_compat(struct uk_alloc *a, unsigned long num_pages)
 	if (num_pages > (~(__sz)0)/__PAGE_SIZE)
 		return __NULL;
 
-	if (uk_posix_memalign(a, &ptr, __PAGE_SIZE, num_pages * __PAGE_SIZE))
+	if (uk_do_posix_memalign(a, &ptr, __PAGE_SIZE,
+				 num_pages * __PAGE_SIZE))
 		return __NULL;
 
 	return ptr;
@@ -480,20 +481,20 @@ void *uk_realloc_compat(struct uk_alloc *a, void *ptr, __sz size)
 
 	UK_ASSERT(a);
 	if (!ptr)
-		return uk_malloc(a, size);
+		return uk_do_malloc(a, size);
 
 	if (ptr && !size) {
-		uk_free(a, ptr);
+		uk_do_free(a, ptr);
 		return __NULL;
 	}
 
-	retptr = uk_malloc(a, size);
+	retptr = uk_do_malloc(a, size);
 	if (!retptr)
 		return __NULL;
 
 	memcpy(retptr, ptr, size);
 
-	uk_free(a, ptr);
+	uk_do_free(a, ptr);
 	return retptr;
 }
 
@@ -507,7 +508,7 @@ void *uk_calloc_compat(struct uk_alloc *a, __sz nmemb, __sz size)
 		return __NULL;
 
 	UK_ASSERT(a);
-	ptr = uk_malloc(a, tlen);
+	ptr = uk_do_malloc(a, tlen);
 	if (!ptr)
 		return __NULL;
 
@@ -520,7 +521,7 @@ void *uk_memalign_compat(struct uk_alloc *a, __sz align, __sz size)
 	void *ptr;
 
 	UK_ASSERT(a);
-	if (uk_posix_memalign(a, &ptr, align, size) != 0)
+	if (uk_do_posix_memalign(a, &ptr, align, size) != 0)
 		return __NULL;
 
 	return ptr;
@@ -35,6 +35,7 @@
 #define __UK_ALLOC_H__
 
 #include <uk/arch/types.h>
+#include <uk/arch/limits.h>
 #include <uk/config.h>
 #include <uk/assert.h>
 #include <uk/essentials.h>
@@ -138,6 +139,35 @@ static inline struct uk_alloc *uk_alloc_get_default(void)
 }
 #endif /* !CONFIG_LIBUKALLOC_IFSTATS_PERLIB */
 
+#if CONFIG_LIBUKALLOC_IFPROF
+/* NOTE: Please do not use these directly */
+extern __ssz _uk_alloc_prof_countdown;
+extern __sz _uk_alloc_prof_nb_live;
+
+void _uk_alloc_prof_sample(void *ptr, __sz size);
+void _uk_alloc_prof_release(void *ptr);
+
+/* Counts down the bytes to the next sample; called after allocations */
+static inline void _uk_alloc_prof_count_alloc(void *ptr, __sz size)
+{
+	if (likely(ptr)) {
+		_uk_alloc_prof_countdown -= (__ssz) size;
+		if (unlikely(_uk_alloc_prof_countdown < 0))
+			_uk_alloc_prof_sample(ptr, size);
+	}
+}
+
+/* Drops a sample if ptr was sampled; called before releasing memory */
+static inline void _uk_alloc_prof_count_free(void *ptr)
+{
+	if (unlikely(_uk_alloc_prof_nb_live) && ptr)
+		_uk_alloc_prof_release(ptr);
+}
+#else /* !CONFIG_LIBUKALLOC_IFPROF */
+#define _uk_alloc_prof_count_alloc(ptr, size) do {} while (0)
+#define _uk_alloc_prof_count_free(ptr) do {} while (0)
+#endif /* !CONFIG_LIBUKALLOC_IFPROF */
+
 /* wrapper functions */
 static inline void *uk_do_malloc(struct uk_alloc *a, __sz size)
 {
@@ -147,11 +177,15 @@ static inline void *uk_do_malloc(struct uk_alloc *a, __sz size)
 
 static inline void *uk_malloc(struct uk_alloc *a, __sz size)
 {
+	void *ptr;
+
 	if (unlikely(!a)) {
 		errno = ENOMEM;
 		return __NULL;
 	}
-	return uk_do_malloc(a, size);
+	ptr = uk_do_malloc(a, size);
+	_uk_alloc_prof_count_alloc(ptr, size);
+	return ptr;
 }
 
 static inline void *uk_do_calloc(struct uk_alloc *a,
@@ -164,11 +198,15 @@ static inline void *uk_do_calloc(struct uk_alloc *a,
 static inline void *uk_calloc(struct uk_alloc *a,
 			      __sz nmemb, __sz size)
 {
+	void *ptr;
+
 	if (unlikely(!a)) {
 		errno = ENOMEM;
 		return __NULL;
 	}
-	return uk_do_calloc(a, nmemb, size);
+	ptr = uk_do_calloc(a, nmemb, size);
+	_uk_alloc_prof_count_alloc(ptr, nmemb * size);
+	return ptr;
 }
 
 #define uk_do_zalloc(a, size) uk_do_calloc((a), 1, (size))
@@ -183,11 +221,18 @@ static inline void *uk_do_realloc(struct uk_alloc *a,
 
 static inline void *uk_realloc(struct uk_alloc *a, void *ptr, __sz size)
 {
+	void *retptr;
+
 	if (unlikely(!a)) {
 		errno = ENOMEM;
 		return __NULL;
 	}
-	return uk_do_realloc(a, ptr, size);
+	retptr = uk_do_realloc(a, ptr, size);
+	/* The old object is only gone if realloc succeeded or freed it */
+	if (retptr || !size)
+		_uk_alloc_prof_count_free(ptr);
+	_uk_alloc_prof_count_alloc(retptr, size);
+	return retptr;
 }
 
 static inline int uk_do_posix_memalign(struct uk_alloc *a, void **memptr,
@@ -200,11 +245,16 @@ static inline int uk_do_posix_memalign(struct uk_alloc *a, void **memptr,
 static inline int uk_posix_memalign(struct uk_alloc *a, void **memptr,
 				    __sz align, __sz size)
 {
+	int ret;
+
 	if (unlikely(!a)) {
 		*memptr = __NULL;
 		return ENOMEM;
 	}
-	return uk_do_posix_memalign(a, memptr, align, size);
+	ret = uk_do_posix_memalign(a, memptr, align, size);
+	if (ret == 0)
+		_uk_alloc_prof_count_alloc(*memptr, size);
+	return ret;
 }
 
 static inline void *uk_do_memalign(struct uk_alloc *a,
@@ -217,9 +267,13 @@ static inline void *uk_do_memalign(struct uk_alloc *a,
 static inline void *uk_memalign(struct uk_alloc *a,
 				__sz align, __sz size)
 {
+	void *ptr;
+
 	if (unlikely(!a))
 		return __NULL;
-	return uk_do_memalign(a, align, size);
+	ptr = uk_do_memalign(a, align, size);
+	_uk_alloc_prof_count_alloc(ptr, size);
+	return ptr;
 }
 
 static inline void uk_do_free(struct uk_alloc *a, void *ptr)
@@ -230,6 +284,7 @@ static inline void uk_do_free(struct uk_alloc *a, void *ptr)
 
 static inline void uk_free(struct uk_alloc *a, void *ptr)
 {
+	_uk_alloc_prof_count_free(ptr);
 	uk_do_free(a, ptr);
 }
 
@@ -241,9 +296,13 @@ static inline void *uk_do_palloc(struct uk_alloc *a, unsigned long num_pages)
 
 static inline void *uk_palloc(struct uk_alloc *a, unsigned long num_pages)
 {
+	void *ptr;
+
 	if (unlikely(!a || !a->palloc))
 		return __NULL;
-	return uk_do_palloc(a, num_pages);
+	ptr = uk_do_palloc(a, num_pages);
+	_uk_alloc_prof_count_alloc(ptr, ((__sz) num_pages) << __PAGE_SHIFT);
+	return ptr;
 }
 
 static inline void uk_do_pfree(struct uk_alloc *a, void *ptr,
@@ -256,6 +315,7 @@ static inline void uk_do_pfree(struct uk_alloc *a, void *ptr,
 static inline void uk_pfree(struct uk_alloc *a, void *ptr,
 			    unsigned long num_pages)
 {
+	_uk_alloc_prof_count_free(ptr);
 	uk_do_pfree(a, ptr, num_pages);
 }
 
@@ -335,6 +395,42 @@ extern struct uk_alloc_libstats_entry _uk_alloc_libstats_end;
 #endif /* CONFIG_LIBUKALLOC_IFSTATS_PERLIB */
 #endif /* CONFIG_LIBUKALLOC_IFSTATS */
 
+#if CONFIG_LIBUKALLOC_IFPROF
+/*
+ * Sampling heap profiler
+ */
+typedef int (*uk_alloc_prof_write_func_t)(void *cookie, const char *buf,
+					  __sz len);
+
+/**
+ * Sets the average number of allocated bytes between two samples.
+ * A rate of 0 stops sampling; already recorded samples are kept.
+ */
+void uk_alloc_prof_set_rate(__sz rate);
+__sz uk_alloc_prof_get_rate(void);
+
+/**
+ * Writes the sampled heap profile in the legacy text format understood by
+ * pprof (`heap profile: ... @ heap_v2/<rate>`). Stacks are raw return
+ * addresses; symbolize them with the debug image, e.g.,
+ * `pprof <image>.dbg heap.prof`.
+ *
+ * @param write callback receiving the profile in chunks
+ * @param cookie passed to `write`
+ * @return 0 on success, the first negative value returned by `write`
+ *         otherwise
+ */
+int uk_alloc_prof_dump(uk_alloc_prof_write_func_t write, void *cookie);
+
+/* Writes the heap profile to the kernel console */
+int uk_alloc_prof_dump_console(void);
+
+#if CONFIG_LIBVFSCORE
+/* Writes the heap profile to a file, e.g., on a ramfs mount */
+int uk_alloc_prof_dump_file(const char *path);
+#endif /* CONFIG_LIBVFSCORE */
+#endif /* CONFIG_LIBUKALLOC_IFPROF */
+
 #ifdef __cplusplus
 }
 #endif
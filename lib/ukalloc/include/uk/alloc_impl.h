@@ -202,12 +202,13 @@ static inline void _uk_alloc_stats_count_free(struct uk_alloc_stats *stats,
 #define uk_alloc_stats_reset(a) do {} while (0)
 #endif /* !CONFIG_LIBUKALLOC_IFSTATS */
 
-/* Shortcut for doing a registration of an allocator that does not implement
- * palloc() or pfree()
+/* Fills out the callbacks of an allocator that does not implement palloc()
+ * or pfree() without registering it. This is meant for short-lived allocators
+ * that are used explicitly, e.g., arenas.
  */
-#define uk_alloc_init_malloc(a, malloc_f, calloc_f, realloc_f, free_f,	\
-			     posix_memalign_f, memalign_f, maxalloc_f,	\
-			     availmem_f, addmem_f)			\
+#define uk_alloc_set_ops_malloc(a, malloc_f, calloc_f, realloc_f, free_f, \
+				posix_memalign_f, memalign_f, maxalloc_f, \
+				availmem_f, addmem_f)			\
 	do {								\
 		(a)->malloc         = (malloc_f);			\
 		(a)->calloc         = (calloc_f);			\
@@ -224,8 +225,23 @@ static inline void _uk_alloc_stats_count_free(struct uk_alloc_stats *stats,
 		(a)->pmaxalloc      = (maxalloc_f != NULL)		\
 				      ? uk_alloc_pmaxalloc_compat : NULL; \
 		(a)->addmem         = (addmem_f);			\
+		(a)->next           = __NULL;				\
 									\
 		uk_alloc_stats_reset((a));				\
+	} while (0)
+
+/* Shortcut for doing a registration of an allocator that does not implement
+ * palloc() or pfree()
+ */
+#define uk_alloc_init_malloc(a, malloc_f, calloc_f, realloc_f, free_f,	\
+			     posix_memalign_f, memalign_f, maxalloc_f,	\
+			     availmem_f, addmem_f)			\
+	do {								\
+		uk_alloc_set_ops_malloc((a), (malloc_f), (calloc_f),	\
+					(realloc_f), (free_f),		\
+					(posix_memalign_f),		\
+					(memalign_f), (maxalloc_f),	\
+					(availmem_f), (addmem_f));	\
 		uk_alloc_register((a));					\
 	} while (0)
 
@@ -0,0 +1,436 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Sampling heap profiler
+ * ----------------------
+ * The public allocation wrappers (`uk_malloc()`, `uk_palloc()`, ...) count
+ * down the number of allocated bytes to the next sample. Sampling intervals
+ * are drawn from an exponential distribution so that samples are a Poisson
+ * process over the allocated bytes, which is what pprof assumes when it
+ * scales a `heap_v2` profile back to the full heap. For every sampled
+ * allocation, the call stack is taken by walking the frame pointers and the
+ * allocation is accounted to its site. Frees of sampled objects are matched
+ * via a table of live samples, so each site knows its live bytes as well as
+ * the total bytes it ever allocated.
+ *
+ * All tables are statically sized because the profiler must not allocate.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <uk/config.h>
+#include <uk/alloc.h>
+#include <uk/arch/limits.h>
+#include <uk/essentials.h>
+#include <uk/preempt.h>
+#include <uk/print.h>
+#include <uk/store.h>
+#include <uk/plat/console.h>
+#if CONFIG_LIBVFSCORE
+#include <fcntl.h>
+#include <unistd.h>
+#endif /* CONFIG_LIBVFSCORE */
+
+#if !CONFIG_OPTIMIZE_NOOMITFP
+#error "The heap profiler walks frame pointers, enable OPTIMIZE_NOOMITFP"
+#endif
+
+#define PROF_DEPTH	CONFIG_LIBUKALLOC_IFPROF_DEPTH
+#define PROF_NSITES	CONFIG_LIBUKALLOC_IFPROF_SITES
+#define PROF_NLIVE	CONFIG_LIBUKALLOC_IFPROF_LIVE
+/* Keep probe sequences short by never filling the tables completely */
+#define PROF_MAXSITES	(PROF_NSITES - PROF_NSITES / 4)
+#define PROF_MAXLIVE	(PROF_NLIVE - PROF_NLIVE / 4)
+
+/* Used to bound the rate so that interval computations cannot overflow */
+#define PROF_RATE_MAX	((__sz) __U32_MAX)
+
+struct prof_site {
+	__uptr pc[PROF_DEPTH];
+	unsigned int depth; /* 0 if the slot is unused */
+	__u64 inuse_objs;
+	__u64 inuse_bytes;
+	__u64 alloc_objs;
+	__u64 alloc_bytes;
+};
+
+struct prof_live {
+	void *ptr; /* NULL if the slot is unused */
+	__sz size;
+	struct prof_site *site;
+};
+
+static struct prof_site prof_sites[PROF_NSITES];
+static struct prof_live prof_live[PROF_NLIVE];
+static unsigned int prof_nb_sites;
+static __u64 prof_nb_dropped;
+static __sz prof_rate = CONFIG_LIBUKALLOC_IFPROF_RATE;
+static __u64 prof_rnd = 0x853c49e6748fea9bULL;
+
+__ssz _uk_alloc_prof_countdown = CONFIG_LIBUKALLOC_IFPROF_RATE ?
+				 CONFIG_LIBUKALLOC_IFPROF_RATE : __SSZ_MAX;
+__sz _uk_alloc_prof_nb_live;
+
+/* Weak so that platforms without these linker symbols still link */
+extern char _text[] __weak;
+extern char _etext[] __weak;
+
+static inline __u64 prof_hash(__u64 x)
+{
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	return x;
+}
+
+/* Returns the number of bytes to allocate until the next sample */
+static __ssz prof_next_interval(void)
+{
+	__u32 u, msb, log2u;
+	__u64 nlog;
+
+	if (!prof_rate)
+		return __SSZ_MAX;
+
+	/* xorshift64* */
+	prof_rnd ^= prof_rnd >> 12;
+	prof_rnd ^= prof_rnd << 25;
+	prof_rnd ^= prof_rnd >> 27;
+	u = (__u32) ((prof_rnd * 0x2545f4914f6cdd1dULL) >> 32) | 1;
+
+	/* Exponentially distributed with mean prof_rate:
+	 * -ln(u / 2^32) * rate. log2(u) is approximated in 16.16 fixed point
+	 * from the position of the most significant bit and the mantissa,
+	 * which is precise enough for sampling.
+	 */
+	msb = 31 - __builtin_clz(u);
+	log2u = (msb << 16) | (((u << (31 - msb)) >> 15) & 0xffff);
+	nlog = ((((__u64) 32 << 16) - log2u) * 45426) >> 16; /* * ln(2) */
+
+	return (__ssz) ((prof_rate * nlog) >> 16);
+}
+
+static struct prof_site *prof_site_get(const __uptr *pc, unsigned int depth)
+{
+	struct prof_site *site;
+	__u64 h = depth;
+	unsigned int i;
+
+	for (i = 0; i < depth; i++)
+		h = prof_hash(h ^ pc[i]);
+
+	for (i = h % PROF_NSITES; ; i = (i + 1) % PROF_NSITES) {
+		site = &prof_sites[i];
+		if (!site->depth)
+			break;
+		if (site->depth == depth &&
+		    !memcmp(site->pc, pc, depth * sizeof(*pc)))
+			return site;
+	}
+
+	if (prof_nb_sites >= PROF_MAXSITES)
+		return NULL;
+
+	memcpy(site->pc, pc, depth * sizeof(*pc));
+	site->depth = depth;
+	prof_nb_sites++;
+	return site;
+}
+
+static inline unsigned int prof_live_slot(const void *ptr)
+{
+	return prof_hash((__uptr) ptr) % PROF_NLIVE;
+}
+
+static struct prof_live *prof_live_find(const void *ptr)
+{
+	unsigned int i;
+
+	for (i = prof_live_slot(ptr); prof_live[i].ptr;
+	     i = (i + 1) % PROF_NLIVE)
+		if (prof_live[i].ptr == ptr)
+			return &prof_live[i];
+	return NULL;
+}
+
+/* Removes an entry with backward shifting, which avoids tombstones */
+static void prof_live_remove(struct prof_live *l)
+{
+	unsigned int i = l - prof_live;
+	unsigned int j = i;
+	unsigned int k;
+
+	for (;;) {
+		j = (j + 1) % PROF_NLIVE;
+		if (!prof_live[j].ptr)
+			break;
+
+		/* Entry j may move into the hole at i only if its home slot
+		 * k does not lie cyclically within (i, j]
+		 */
+		k = prof_live_slot(prof_live[j].ptr);
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+
+		prof_live[i] = prof_live[j];
+		i = j;
+	}
+	prof_live[i].ptr = NULL;
+}
+
+/*
+ * Called from the inlined allocation wrappers, so our return address is the
+ * allocation site. Frame records are laid out as {previous fp, return
+ * address} on all supported architectures.
+ */
+__noinline void _uk_alloc_prof_sample(void *ptr, __sz size)
+{
+	__uptr pc[PROF_DEPTH];
+	__uptr *fp, *next;
+	unsigned int depth = 0;
+	struct prof_site *site;
+	unsigned int i;
+
+	fp = (__uptr *) __builtin_frame_address(0);
+	while (depth < PROF_DEPTH) {
+		pc[depth++] = fp[1];
+
+		/* Callers live further up on the same stack */
+		next = (__uptr *) fp[0];
+		if (next <= fp || (__uptr) next - (__uptr) fp > __STACK_SIZE ||
+		    ((__uptr) next & (sizeof(*next) - 1)) || !next[1])
+			break;
+		fp = next;
+	}
+
+	uk_preempt_disable();
+	_uk_alloc_prof_countdown = prof_next_interval();
+	if (unlikely(!prof_rate))
+		goto out;
+
+	if (unlikely(_uk_alloc_prof_nb_live >= PROF_MAXLIVE)) {
+		prof_nb_dropped++;
+		goto out;
+	}
+	site = prof_site_get(pc, depth);
+	if (unlikely(!site)) {
+		prof_nb_dropped++;
+		goto out;
+	}
+
+	for (i = prof_live_slot(ptr); prof_live[i].ptr;
+	     i = (i + 1) % PROF_NLIVE)
+		;
+	prof_live[i].ptr = ptr;
+	prof_live[i].size = size;
+	prof_live[i].site = site;
+	_uk_alloc_prof_nb_live++;
+
+	site->inuse_objs++;
+	site->inuse_bytes += size;
+	site->alloc_objs++;
+	site->alloc_bytes += size;
+out:
+	uk_preempt_enable();
+}
+
+void _uk_alloc_prof_release(void *ptr)
+{
+	struct prof_live *l;
+
+	uk_preempt_disable();
+	l = prof_live_find(ptr);
+	if (l) {
+		l->site->inuse_objs--;
+		l->site->inuse_bytes -= l->size;
+		prof_live_remove(l);
+		_uk_alloc_prof_nb_live--;
+	}
+	uk_preempt_enable();
+}
+
+void uk_alloc_prof_set_rate(__sz rate)
+{
+	uk_preempt_disable();
+	prof_rate = MIN(rate, PROF_RATE_MAX);
+	_uk_alloc_prof_countdown = prof_next_interval();
+	uk_preempt_enable();
+}
+
+__sz uk_alloc_prof_get_rate(void)
+{
+	return prof_rate;
+}
+
+int uk_alloc_prof_dump(uk_alloc_prof_write_func_t write, void *cookie)
+{
+	__u64 inuse_objs = 0, inuse_bytes = 0;
+	__u64 alloc_objs = 0, alloc_bytes = 0;
+	struct prof_site *site;
+	char buf[128 + PROF_DEPTH * 19]; /* " 0x" + 16 digits per frame */
+	unsigned int i, j;
+	int len, ret;
+
+	UK_ASSERT(write);
+
+	uk_preempt_disable();
+	for (i = 0; i < PROF_NSITES; i++) {
+		site = &prof_sites[i];
+		inuse_objs += site->inuse_objs;
+		inuse_bytes += site->inuse_bytes;
+		alloc_objs += site->alloc_objs;
+		alloc_bytes += site->alloc_bytes;
+	}
+	uk_preempt_enable();
+
+	if (prof_nb_dropped)
+		uk_pr_warn("Heap profile misses %"__PRIu64" samples\n",
+			   prof_nb_dropped);
+
+	len = snprintf(buf, sizeof(buf),
+		       "heap profile: %"__PRIu64": %"__PRIu64
+		       " [%"__PRIu64": %"__PRIu64"] @ heap_v2/%"__PRIsz"\n",
+		       inuse_objs, inuse_bytes, alloc_objs, alloc_bytes,
+		       prof_rate);
+	ret = write(cookie, buf, len);
+	if (unlikely(ret < 0))
+		return ret;
+
+	for (i = 0; i < PROF_NSITES; i++) {
+		/* Formatting happens on a snapshot of the site; writing may
+		 * allocate and thus change the tables
+		 */
+		uk_preempt_disable();
+		site = &prof_sites[i];
+		if (!site->depth || !site->alloc_objs) {
+			uk_preempt_enable();
+			continue;
+		}
+		len = snprintf(buf, sizeof(buf),
+			       "%"__PRIu64": %"__PRIu64
+			       " [%"__PRIu64": %"__PRIu64"] @",
+			       site->inuse_objs, site->inuse_bytes,
+			       site->alloc_objs, site->alloc_bytes);
+		for (j = 0; j < site->depth; j++)
+			len += snprintf(buf + len, sizeof(buf) - len,
+					" 0x%"__PRIx64, (__u64) site->pc[j]);
+		uk_preempt_enable();
+
+		buf[len++] = '\n';
+		ret = write(cookie, buf, len);
+		if (unlikely(ret < 0))
+			return ret;
+	}
+
+	if (!_text || !_etext)
+		return 0;
+
+	/* Tells pprof which addresses belong to the image */
+	len = snprintf(buf, sizeof(buf),
+		       "\nMAPPED_LIBRARIES:\n"
+		       "%lx-%lx r-xp 00000000 00:00 0 %s\n",
+		       (unsigned long) _text, (unsigned long) _etext,
+		       CONFIG_UK_NAME);
+	ret = write(cookie, buf, MIN((__sz) len, sizeof(buf) - 1));
+	return (ret < 0) ? ret : 0;
+}
+
+static int prof_write_console(void *cookie __unused, const char *buf,
+			      __sz len)
+{
+	return ukplat_coutk(buf, len);
+}
+
+int uk_alloc_prof_dump_console(void)
+{
+	return uk_alloc_prof_dump(prof_write_console, NULL);
+}
+
+#if CONFIG_LIBVFSCORE
+static int prof_write_file(void *cookie, const char *buf, __sz len)
+{
+	int fd = *((int *) cookie);
+	ssize_t ret;
+
+	while (len) {
+		ret = write(fd, buf, len);
+		if (unlikely(ret < 0))
+			return -errno;
+		buf += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+int uk_alloc_prof_dump_file(const char *path)
+{
+	int fd, ret;
+
+	UK_ASSERT(path);
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (unlikely(fd < 0))
+		return -errno;
+
+	ret = uk_alloc_prof_dump(prof_write_file, &fd);
+	close(fd);
+	return ret;
+}
+#endif /* CONFIG_LIBVFSCORE */
+
+static int get_prof_rate(void *cookie __unused, __u64 *out)
+{
+	*out = (__u64) uk_alloc_prof_get_rate();
+	return 0;
+}
+
+static int set_prof_rate(void *cookie __unused, __u64 val)
+{
+	uk_alloc_prof_set_rate((__sz) val);
+	return 0;
+}
+UK_STORE_STATIC_ENTRY(prof_rate, u64, get_prof_rate, set_prof_rate, NULL);
+
+/* Writing "-" dumps the profile to the console, anything else is taken as a
+ * file path
+ */
+static int set_prof_dump(void *cookie __unused, const char *val)
+{
+	if (!val || !strcmp(val, "-"))
+		return uk_alloc_prof_dump_console();
+#if CONFIG_LIBVFSCORE
+	return uk_alloc_prof_dump_file(val);
+#else /* !CONFIG_LIBVFSCORE */
+	return -ENOTSUP;
+#endif /* !CONFIG_LIBVFSCORE */
+}
+UK_STORE_STATIC_ENTRY(prof_dump, charp, NULL, set_prof_dump, NULL);
@@ -43,6 +43,44 @@ extern "C" {
 /* allocator initialization */
 struct uk_alloc *uk_allocregion_init(void *base, size_t len);
 
+/*
+ * Arenas
+ */
+struct uk_allocregion_mark {
+	void *chunk;
+	void *pos;
+};
+
+/**
+ * Creates an arena that grows in chunks taken from `parent`. The arena is a
+ * regular `struct uk_alloc` but it is not registered with ukalloc. free() is
+ * a no-op; memory is released with reset, rewind, or destroy.
+ * maxalloc() and availmem() report the space left in the current chunk.
+ *
+ * @param parent allocator that provides the chunks
+ * @param chunk_size size of the chunks requested from `parent`, including
+ *        bookkeeping. Larger allocations get a chunk of their own.
+ * @return the arena, or NULL if the first chunk could not be allocated
+ */
+struct uk_alloc *uk_allocregion_arena_create(struct uk_alloc *parent,
+					     size_t chunk_size);
+
+/* Records the current fill level of an arena */
+void uk_allocregion_arena_mark(struct uk_alloc *a,
+			       struct uk_allocregion_mark *m);
+
+/* Releases everything that was allocated after the mark was taken. Marks
+ * taken after `m` become invalid.
+ */
+void uk_allocregion_arena_rewind(struct uk_alloc *a,
+				 const struct uk_allocregion_mark *m);
+
+/* Releases all allocations but keeps the first chunk for reuse */
+void uk_allocregion_arena_reset(struct uk_alloc *a);
+
+/* Releases all memory of the arena, including the arena itself */
+void uk_allocregion_arena_destroy(struct uk_alloc *a);
+
 #ifdef __cplusplus
 }
 #endif
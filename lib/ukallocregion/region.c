@@ -45,24 +45,100 @@
  *
  * Refer to Gay & Aiken, `Memory management with explicit regions' (PLDI'98) for
  * an introduction to region-based memory management.
+ *
+ * Arenas are regions that grow in chunks that are taken from a parent
+ * allocator. They are not registered with ukalloc; instead, they are created
+ * and destroyed for a specific lifetime, e.g., a request or a connection.
+ * Memory is released all at once with `uk_allocregion_arena_reset()`, or
+ * back to a previously taken mark with `uk_allocregion_arena_rewind()`.
+ * Allocations from arenas are not counted in the statistics: the chunks are
+ * already accounted for by the parent allocator.
  */
 
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include <sys/types.h>
 #include <uk/allocregion.h>
 #include <uk/alloc_impl.h>
 #include <uk/page.h>	/* round_pgup() */
 
+/* Header of each chunk of an arena */
+struct uk_allocregion_chunk {
+	struct uk_allocregion_chunk *prev; /* NULL for the first chunk */
+	size_t len; /* including this header */
+};
+
 struct uk_allocregion {
 	void *heap_top;
 	void *heap_base;
+
+	/* Arenas only */
+	struct uk_alloc *parent;
+	struct uk_allocregion_chunk *chunk; /* current chunk */
+	void *origin; /* heap_base of the empty arena */
+	size_t chunk_size;
 };
 
+static inline void *chunk_top(struct uk_allocregion_chunk *c)
+{
+	return (void *) ((uintptr_t) c + c->len);
+}
+
+/* Returns the aligned start of size bytes at the heap base or 0 on OOM */
+static uintptr_t uk_allocregion_bump(struct uk_allocregion *b, size_t size,
+				     size_t align)
+{
+	uintptr_t intptr, newbase;
+
+	intptr = ALIGN_UP((uintptr_t) b->heap_base, (uintptr_t) align);
+
+	newbase  = intptr + size;
+	if (newbase > (uintptr_t) b->heap_top)
+		return 0; /* OOM */
+
+	/* Check for overflow, handle malloc(0) */
+	if (newbase <= (uintptr_t) b->heap_base)
+		return 0;
+
+	b->heap_base = (void *)(newbase);
+	return intptr;
+}
+
+/* Continues an arena in a new chunk that fits at least size bytes with the
+ * given alignment. Requests larger than the chunk size get a chunk of their
+ * own; the rest of the current chunk is abandoned.
+ */
+static int uk_allocregion_grow(struct uk_allocregion *b, size_t size,
+			       size_t align)
+{
+	struct uk_allocregion_chunk *c;
+	size_t len;
+
+	if (!b->parent || !size)
+		return -ENOMEM;
+
+	len = sizeof(*c) + align + size;
+	if (len < size)
+		return -ENOMEM; /* overflow */
+	len = MAX(len, b->chunk_size);
+
+	c = uk_malloc(b->parent, len);
+	if (!c)
+		return -ENOMEM;
+
+	c->prev = b->chunk;
+	c->len = len;
+	b->chunk = c;
+	b->heap_base = (void *) ((uintptr_t) c + sizeof(*c));
+	b->heap_top = chunk_top(c);
+	return 0;
+}
+
 static void *uk_allocregion_malloc(struct uk_alloc *a, size_t size)
 {
 	struct uk_allocregion *b;
-	uintptr_t intptr, newbase;
+	uintptr_t intptr;
 
 	UK_ASSERT(a != NULL);
 
@@ -73,20 +149,16 @@ static void *uk_allocregion_malloc(struct uk_alloc *a, size_t size)
 	/* return aligned pointers: this is a requirement for some
 	 * embedded systems archs, and more generally good for performance
 	 */
-	intptr = ALIGN_UP(((uintptr_t) b->heap_base),
-			     (uintptr_t) sizeof(void *));
-
-	newbase  = intptr + size;
-	if (newbase > (uintptr_t) b->heap_top)
-		goto enomem; /* OOM */
-
-	/* Check for overflow, handle malloc(0) */
-	if (newbase <= (uintptr_t) b->heap_base)
-		goto enomem;
-
-	b->heap_base = (void *)(newbase);
+	intptr = uk_allocregion_bump(b, size, sizeof(void *));
+	if (!intptr) {
+		if (uk_allocregion_grow(b, size, sizeof(void *)))
+			goto enomem; /* OOM */
+		intptr = uk_allocregion_bump(b, size, sizeof(void *));
+		UK_ASSERT(intptr);
+	}
 
-	uk_alloc_stats_count_alloc(a, (void *) intptr, size);
+	if (!b->parent)
+		uk_alloc_stats_count_alloc(a, (void *) intptr, size);
 	return (void *) intptr;
 
 enomem:
@@ -98,7 +170,7 @@ static int uk_allocregion_posix_memalign(struct uk_alloc *a, void **memptr,
 					 size_t align, size_t size)
 {
 	struct uk_allocregion *b;
-	uintptr_t intptr, newbase;
+	uintptr_t intptr;
 
 	UK_ASSERT(a != NULL);
 
@@ -117,20 +189,18 @@ static int uk_allocregion_posix_memalign(struct uk_alloc *a, void **memptr,
 		return EINVAL;
 	}
 
-	intptr = ALIGN_UP((uintptr_t) b->heap_base, (uintptr_t) align);
-
-	newbase  = intptr + size;
-	if (newbase > (uintptr_t) b->heap_top)
-		goto enomem; /* out-of-memory */
-
-	/* Check for overflow */
-	if (newbase <= (uintptr_t) b->heap_base)
-		goto enomem;
+	intptr = uk_allocregion_bump(b, size, align);
+	if (!intptr) {
+		if (uk_allocregion_grow(b, size, align))
+			goto enomem; /* out-of-memory */
+		intptr = uk_allocregion_bump(b, size, align);
+		UK_ASSERT(intptr);
+	}
 
 	*memptr = (void *)intptr;
-	b->heap_base = (void *)(newbase);
 
-	uk_alloc_stats_count_alloc(a, (void *) intptr, size);
+	if (!b->parent)
+		uk_alloc_stats_count_alloc(a, (void *) intptr, size);
 	return 0;
 
 enomem:
@@ -142,11 +212,71 @@ enomem:
 static void uk_allocregion_free(struct uk_alloc *a __maybe_unused,
 				void *ptr __maybe_unused)
 {
+	struct uk_allocregion *b __maybe_unused;
+
 	uk_pr_debug("%p: Releasing of memory is not supported by "
 			"ukallocregion\n", a);
 
 	/* Count a free operation but do not release memory from stats */
-	uk_alloc_stats_count_free(a, ptr, 0);
+	b = (struct uk_allocregion *)&a->priv;
+	if (!b->parent)
+		uk_alloc_stats_count_free(a, ptr, 0);
+}
+
+/* Returns how many bytes can be read from ptr without leaving the memory
+ * that has been handed out. The size of objects is not recorded, so this is
+ * an upper bound that may include subsequent objects.
+ */
+static size_t uk_allocregion_span(struct uk_allocregion *b, void *ptr)
+{
+	struct uk_allocregion_chunk *c;
+
+	if (!b->parent || (ptr >= (void *) b->chunk
+			   && ptr < chunk_top(b->chunk))) {
+		UK_ASSERT(ptr < b->heap_base);
+		return (uintptr_t) b->heap_base - (uintptr_t) ptr;
+	}
+
+	for (c = b->chunk->prev; c; c = c->prev) {
+		if (ptr >= (void *) c && ptr < chunk_top(c))
+			return (uintptr_t) chunk_top(c) - (uintptr_t) ptr;
+	}
+
+	UK_ASSERT(0); /* ptr is not from this arena */
+	return 0;
+}
+
+/* Like uk_realloc_compat() but copies at most up to the end of the memory
+ * that is in use, which may be in another chunk of an arena
+ */
+static void *uk_allocregion_realloc(struct uk_alloc *a, void *ptr,
+				    size_t size)
+{
+	struct uk_allocregion *b;
+	void *retptr;
+	size_t span;
+
+	UK_ASSERT(a != NULL);
+
+	if (!ptr)
+		return uk_allocregion_malloc(a, size);
+
+	if (!size) {
+		uk_allocregion_free(a, ptr);
+		return NULL;
+	}
+
+	b = (struct uk_allocregion *)&a->priv;
+	span = uk_allocregion_span(b, ptr);
+
+	retptr = uk_allocregion_malloc(a, size);
+	if (!retptr)
+		return NULL;
+
+	memcpy(retptr, ptr, MIN(size, span));
+
+	uk_allocregion_free(a, ptr);
+	return retptr;
 }
 
 /* NOTE: We use `uk_allocregion_leftspace()` for `maxalloc` and `availmem`
@@ -204,12 +334,16 @@ struct uk_alloc *uk_allocregion_init(void *base, size_t len)
 
 	b->heap_top  = (void *)((uintptr_t) base + len);
 	b->heap_base = (void *)((uintptr_t) base + metalen);
+	b->parent    = NULL;
+	b->chunk     = NULL;
+	b->origin    = b->heap_base;
+	b->chunk_size = 0;
 
 	/* use exclusively "compat" wrappers for calloc, realloc, memalign,
 	 * palloc and pfree as those do not add additional metadata.
 	 */
 	uk_alloc_init_malloc(a, uk_allocregion_malloc, uk_calloc_compat,
-				uk_realloc_compat, uk_allocregion_free,
+				uk_allocregion_realloc, uk_allocregion_free,
 				uk_allocregion_posix_memalign,
 				uk_memalign_compat, uk_allocregion_leftspace,
 				uk_allocregion_leftspace,
@@ -217,3 +351,117 @@ struct uk_alloc *uk_allocregion_init(void *base, size_t len)
 
 	return a;
 }
+
+struct uk_alloc *uk_allocregion_arena_create(struct uk_alloc *parent,
+					     size_t chunk_size)
+{
+	struct uk_allocregion_chunk *c;
+	struct uk_alloc *a;
+	struct uk_allocregion *b;
+	size_t metalen = sizeof(*c) + sizeof(*a) + sizeof(*b);
+
+	UK_ASSERT(parent != NULL);
+
+	/* The first chunk also holds the allocator itself */
+	chunk_size = MAX(chunk_size, metalen);
+	c = uk_malloc(parent, chunk_size);
+	if (!c)
+		return NULL;
+
+	c->prev = NULL;
+	c->len  = chunk_size;
+	a = (struct uk_alloc *)((uintptr_t) c + sizeof(*c));
+	b = (struct uk_allocregion *)&a->priv;
+
+	b->heap_top   = chunk_top(c);
+	b->heap_base  = (void *)((uintptr_t) c + metalen);
+	b->parent     = parent;
+	b->chunk      = c;
+	b->origin     = b->heap_base;
+	b->chunk_size = chunk_size;
+
+	uk_alloc_set_ops_malloc(a, uk_allocregion_malloc, uk_calloc_compat,
+				uk_allocregion_realloc, uk_allocregion_free,
+				uk_allocregion_posix_memalign,
+				uk_memalign_compat, uk_allocregion_leftspace,
+				uk_allocregion_leftspace,
+				uk_allocregion_addmem);
+
+	return a;
+}
+
+void uk_allocregion_arena_mark(struct uk_alloc *a,
+			       struct uk_allocregion_mark *m)
+{
+	struct uk_allocregion *b;
+
+	UK_ASSERT(a != NULL);
+	UK_ASSERT(m != NULL);
+
+	b = (struct uk_allocregion *)&a->priv;
+	UK_ASSERT(b->parent != NULL);
+
+	m->chunk = b->chunk;
+	m->pos   = b->heap_base;
+}
+
+void uk_allocregion_arena_rewind(struct uk_alloc *a,
+				 const struct uk_allocregion_mark *m)
+{
+	struct uk_allocregion *b;
+	struct uk_allocregion_chunk *c;
+
+	UK_ASSERT(a != NULL);
+	UK_ASSERT(m != NULL);
+
+	b = (struct uk_allocregion *)&a->priv;
+	UK_ASSERT(b->parent != NULL);
+
+	/* Release all chunks that were added after the mark was taken */
+	while (b->chunk != m->chunk) {
+		c = b->chunk;
+		UK_ASSERT(c->prev != NULL); /* mark is not from this arena */
+		b->chunk = c->prev;
+		uk_free(b->parent, c);
+	}
+
+	b->heap_base = m->pos;
+	b->heap_top  = chunk_top(b->chunk);
+	UK_ASSERT(b->heap_base <= b->heap_top);
+}
+
+void uk_allocregion_arena_reset(struct uk_alloc *a)
+{
+	struct uk_allocregion *b;
+	struct uk_allocregion_chunk *c;
+
+	UK_ASSERT(a != NULL);
+
+	b = (struct uk_allocregion *)&a->priv;
+	UK_ASSERT(b->parent != NULL);
+
+	/* Keep the first chunk, it holds the allocator */
+	while (b->chunk->prev) {
+		c = b->chunk;
+		b->chunk = c->prev;
+		uk_free(b->parent, c);
+	}
+
+	b->heap_base = b->origin;
+	b->heap_top  = chunk_top(b->chunk);
+}
+
+void uk_allocregion_arena_destroy(struct uk_alloc *a)
+{
+	struct uk_allocregion *b;
+	struct uk_alloc *parent;
+
+	UK_ASSERT(a != NULL);
+
+	b = (struct uk_allocregion *)&a->priv;
+	parent = b->parent;
+	UK_ASSERT(parent != NULL);
+
+	uk_allocregion_arena_reset(a);
+	uk_free(parent, b->chunk);
+}
@@ -0,0 +1,173 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/test.h>
+
+#include <string.h>
+#include <uk/alloc_impl.h>
+#include <uk/allocregion.h>
+
+#define CHUNK_SIZE	4096
+
+/* Parent allocator that counts the chunks that an arena holds */
+static struct uk_alloc parent;
+static int parent_chunks;
+
+static void *parent_malloc(struct uk_alloc *a __unused, __sz size)
+{
+	void *ptr;
+
+	ptr = uk_malloc(uk_alloc_get_default(), size);
+	if (ptr)
+		parent_chunks++;
+	return ptr;
+}
+
+static void parent_free(struct uk_alloc *a __unused, void *ptr)
+{
+	if (ptr)
+		parent_chunks--;
+	uk_free(uk_alloc_get_default(), ptr);
+}
+
+static int parent_posix_memalign(struct uk_alloc *a __unused, void **memptr,
+				 __sz align, __sz size)
+{
+	int rc;
+
+	rc = uk_posix_memalign(uk_alloc_get_default(), memptr, align, size);
+	if (!rc)
+		parent_chunks++;
+	return rc;
+}
+
+UK_TESTCASE(ukallocregion_arena, rewind_to_mark)
+{
+	struct uk_allocregion_mark m;
+	struct uk_alloc *a;
+	void *p, *q;
+
+	a = uk_allocregion_arena_create(&parent, CHUNK_SIZE);
+	UK_TEST_EXPECT_NOT_NULL(a);
+	UK_TEST_EXPECT_NOT_NULL(uk_malloc(a, 64));
+
+	uk_allocregion_arena_mark(a, &m);
+	p = uk_malloc(a, 64);
+	UK_TEST_EXPECT_NOT_NULL(p);
+
+	/* Allocations after a rewind reuse the memory after the mark */
+	uk_allocregion_arena_rewind(a, &m);
+	q = uk_malloc(a, 64);
+	UK_TEST_EXPECT_PTR_EQ(q, p);
+
+	uk_allocregion_arena_destroy(a);
+	UK_TEST_EXPECT_SNUM_EQ(parent_chunks, 0);
+}
+
+UK_TESTCASE(ukallocregion_arena, rewind_releases_chunks)
+{
+	struct uk_allocregion_mark m;
+	struct uk_alloc *a;
+	int i;
+
+	a = uk_allocregion_arena_create(&parent, CHUNK_SIZE);
+	UK_TEST_EXPECT_NOT_NULL(a);
+	uk_allocregion_arena_mark(a, &m);
+
+	/* Fill more than one chunk, plus one oversized allocation */
+	for (i = 0; i < 16; i++)
+		UK_TEST_EXPECT_NOT_NULL(uk_malloc(a, CHUNK_SIZE / 4));
+	UK_TEST_EXPECT_NOT_NULL(uk_malloc(a, 4 * CHUNK_SIZE));
+	UK_TEST_EXPECT(parent_chunks > 1);
+
+	uk_allocregion_arena_rewind(a, &m);
+	UK_TEST_EXPECT_SNUM_EQ(parent_chunks, 1);
+
+	uk_allocregion_arena_destroy(a);
+	UK_TEST_EXPECT_SNUM_EQ(parent_chunks, 0);
+}
+
+UK_TESTCASE(ukallocregion_arena, reset_keeps_first_chunk)
+{
+	struct uk_alloc *a;
+	void *first;
+	int i;
+
+	a = uk_allocregion_arena_create(&parent, CHUNK_SIZE);
+	UK_TEST_EXPECT_NOT_NULL(a);
+	first = uk_malloc(a, 64);
+	UK_TEST_EXPECT_NOT_NULL(first);
+	for (i = 0; i < 16; i++)
+		UK_TEST_EXPECT_NOT_NULL(uk_malloc(a, CHUNK_SIZE / 4));
+
+	uk_allocregion_arena_reset(a);
+	UK_TEST_EXPECT_SNUM_EQ(parent_chunks, 1);
+	UK_TEST_EXPECT_PTR_EQ(uk_malloc(a, 64), first);
+
+	uk_allocregion_arena_destroy(a);
+	UK_TEST_EXPECT_SNUM_EQ(parent_chunks, 0);
+}
+
+UK_TESTCASE(ukallocregion_arena, realloc_across_chunks)
+{
+	struct uk_alloc *a;
+	char *p;
+	int i;
+
+	a = uk_allocregion_arena_create(&parent, CHUNK_SIZE);
+	UK_TEST_EXPECT_NOT_NULL(a);
+
+	/* Place a small object at the end of the first chunk */
+	while (uk_alloc_availmem(a) > 64)
+		UK_TEST_EXPECT_NOT_NULL(uk_malloc(a, 32));
+	p = uk_malloc(a, 16);
+	UK_TEST_EXPECT_NOT_NULL(p);
+	memset(p, 0xa5, 16);
+
+	/* Growing it must not read past the end of the first chunk */
+	p = uk_realloc(a, p, 2 * CHUNK_SIZE);
+	UK_TEST_EXPECT_NOT_NULL(p);
+	for (i = 0; i < 16; i++)
+		UK_TEST_EXPECT_SNUM_EQ((unsigned char) p[i], 0xa5);
+
+	uk_allocregion_arena_destroy(a);
+	UK_TEST_EXPECT_SNUM_EQ(parent_chunks, 0);
+}
+
+static int ukallocregion_arena_init(struct uk_testsuite *suite __unused)
+{
+	uk_alloc_set_ops_malloc(&parent, parent_malloc, uk_calloc_compat,
+				uk_realloc_compat, parent_free,
+				parent_posix_memalign, uk_memalign_compat,
+				NULL, NULL, NULL);
+	return 0;
+}
+
+uk_testsuite_register(ukallocregion_arena, ukallocregion_arena_init);
@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/test.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <uk/alloc.h>
+#include <uk/alloctlsf.h>
+
+#define HEAP_SIZE	(64 * 1024)
+
+/* Allocators are registered and never removed, so every test uses a heap
+ * of its own
+ */
+static char heap_split[HEAP_SIZE] __align(16);
+/* Page-aligned, so that the metadata leaves a gap before the next page */
+static char heap_align[HEAP_SIZE] __align(4096);
+static char heap_realloc[HEAP_SIZE] __align(16);
+static char heap_multi[2][HEAP_SIZE] __align(16);
+
+static int in_heap(const void *ptr, const char *heap)
+{
+	return (const char *) ptr >= heap &&
+	       (const char *) ptr < heap + HEAP_SIZE;
+}
+
+UK_TESTCASE(ukalloctlsf, split_and_coalesce)
+{
+	struct uk_alloc *a;
+	__ssz avail, max;
+	void *p[4];
+	int i;
+
+	a = uk_alloctlsf_init(heap_split, sizeof(heap_split));
+	UK_TEST_EXPECT_NOT_NULL(a);
+	avail = uk_alloc_availmem(a);
+	max = uk_alloc_maxalloc(a);
+
+	/* Each allocation is split off the single free block */
+	for (i = 0; i < 4; i++) {
+		p[i] = uk_malloc(a, 1000);
+		UK_TEST_EXPECT_NOT_NULL(p[i]);
+	}
+	UK_TEST_EXPECT(uk_alloc_availmem(a) < avail - 4 * 1000);
+
+	/* Freeing out of order must merge all neighbours again */
+	uk_free(a, p[1]);
+	uk_free(a, p[3]);
+	uk_free(a, p[0]);
+	uk_free(a, p[2]);
+	UK_TEST_EXPECT_SNUM_EQ(uk_alloc_availmem(a), avail);
+	UK_TEST_EXPECT_SNUM_EQ(uk_alloc_maxalloc(a), max);
+	p[0] = uk_malloc(a, max);
+	UK_TEST_EXPECT_NOT_NULL(p[0]);
+	uk_free(a, p[0]);
+}
+
+UK_TESTCASE(ukalloctlsf, memalign_returns_gap)
+{
+	struct uk_alloc *a;
+	__ssz avail;
+	void *p, *q;
+
+	a = uk_alloctlsf_init(heap_align, sizeof(heap_align));
+	UK_TEST_EXPECT_NOT_NULL(a);
+	avail = uk_alloc_availmem(a);
+
+	UK_TEST_EXPECT_ZERO(uk_posix_memalign(a, &p, 4096, 100));
+	UK_TEST_EXPECT_ZERO((uintptr_t) p & 4095);
+
+	/* The leading gap is a free block that small requests can use */
+	q = uk_malloc(a, 64);
+	UK_TEST_EXPECT_NOT_NULL(q);
+	UK_TEST_EXPECT((uintptr_t) q < (uintptr_t) p);
+
+	uk_free(a, q);
+	uk_free(a, p);
+	UK_TEST_EXPECT_SNUM_EQ(uk_alloc_availmem(a), avail);
+}
+
+UK_TESTCASE(ukalloctlsf, realloc_grow_and_shrink)
+{
+	struct uk_alloc *a;
+	char *p, *q, *r;
+	int i;
+
+	a = uk_alloctlsf_init(heap_realloc, sizeof(heap_realloc));
+	UK_TEST_EXPECT_NOT_NULL(a);
+
+	p = uk_malloc(a, 256);
+	UK_TEST_EXPECT_NOT_NULL(p);
+	for (i = 0; i < 256; i++)
+		p[i] = (char) i;
+
+	/* Shrinking and growing into the free successor stay in place */
+	UK_TEST_EXPECT_PTR_EQ(uk_realloc(a, p, 64), p);
+	UK_TEST_EXPECT_PTR_EQ(uk_realloc(a, p, 4096), p);
+	for (i = 0; i < 64; i++)
+		UK_TEST_EXPECT_SNUM_EQ(p[i], (char) i);
+
+	/* With a used successor, growing moves the data */
+	q = uk_malloc(a, 64);
+	UK_TEST_EXPECT_NOT_NULL(q);
+	r = uk_realloc(a, p, 8192);
+	UK_TEST_EXPECT_NOT_NULL(r);
+	UK_TEST_EXPECT(r != p);
+	for (i = 0; i < 64; i++)
+		UK_TEST_EXPECT_SNUM_EQ(r[i], (char) i);
+
+	uk_free(a, q);
+	uk_free(a, r);
+}
+
+UK_TESTCASE(ukalloctlsf, addmem_second_region)
+{
+	struct uk_alloc *a;
+	__ssz avail;
+	void *p, *q;
+
+	a = uk_alloctlsf_init(heap_multi[0], HEAP_SIZE);
+	UK_TEST_EXPECT_NOT_NULL(a);
+	avail = uk_alloc_availmem(a);
+
+	UK_TEST_EXPECT_ZERO(uk_alloc_addmem(a, heap_multi[1], HEAP_SIZE));
+	UK_TEST_EXPECT(uk_alloc_availmem(a) > avail + HEAP_SIZE / 2);
+
+	/* Neither request fits next to the other in one region */
+	p = uk_malloc(a, HEAP_SIZE / 2 + HEAP_SIZE / 4);
+	q = uk_malloc(a, HEAP_SIZE / 2 + HEAP_SIZE / 4);
+	UK_TEST_EXPECT_NOT_NULL(p);
+	UK_TEST_EXPECT_NOT_NULL(q);
+	UK_TEST_EXPECT(in_heap(p, heap_multi[0]) != in_heap(q, heap_multi[0]));
+	UK_TEST_EXPECT(in_heap(p, heap_multi[1]) != in_heap(q, heap_multi[1]));
+
+	/* Regions are never coalesced with each other */
+	uk_free(a, p);
+	uk_free(a, q);
+	UK_TEST_EXPECT_NULL(uk_malloc(a, HEAP_SIZE + HEAP_SIZE / 2));
+}
+
+uk_testsuite_register(ukalloctlsf, NULL);
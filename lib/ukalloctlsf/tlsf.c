@@ -0,0 +1,612 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* ukalloctlsf is a two-level segregated fit (TLSF) allocator.
+ *
+ * Free blocks are kept in segregated lists. The first level splits sizes
+ * into powers of two, the second level linearly subdivides each power of two
+ * into TLSF_SL_COUNT ranges. A bitmap per level records which lists are
+ * non-empty, so that a suitable list is found with two find-first-set
+ * operations. Together with immediate coalescing of physically adjacent free
+ * blocks, malloc() and free() run in constant time, independent of the number
+ * of free blocks.
+ *
+ * Allocations are served from the first block of the smallest list whose
+ * blocks are all large enough ("good fit"); the remainder of the block is
+ * split off and returned to the free lists.
+ *
+ * Refer to Masmano et al., `TLSF: a New Dynamic Memory Allocator for
+ * Real-Time Systems' (ECRTS'04) for a description of the algorithm.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/types.h>
+#include <uk/alloctlsf.h>
+#include <uk/alloc_impl.h>
+#include <uk/essentials.h>
+#include <uk/print.h>
+
+#define TLSF_ALIGN_LOG2		4
+#define TLSF_ALIGN		(1UL << TLSF_ALIGN_LOG2)
+/* Number of second-level lists per first-level range */
+#define TLSF_SL_LOG2		5
+#define TLSF_SL_COUNT		(1U << TLSF_SL_LOG2)
+/* Sizes below TLSF_SMALL_SIZE share the first first-level range */
+#define TLSF_FL_SHIFT		(TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_SMALL_SIZE		(1UL << TLSF_FL_SHIFT)
+/* Blocks are smaller than 2^TLSF_FL_MAX bytes */
+#define TLSF_FL_MAX		((sizeof(long) == 8) ? 40 : 30)
+#define TLSF_FL_COUNT		(TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+#define TLSF_BLOCK_MAX		((1UL << TLSF_FL_MAX) - TLSF_ALIGN)
+
+/* Flags stored in the low bits of the block size */
+#define TLSF_BLOCK_FREE		0x1UL
+#define TLSF_BLOCK_PREV_FREE	0x2UL
+#define TLSF_BLOCK_FLAGS	(TLSF_BLOCK_FREE | TLSF_BLOCK_PREV_FREE)
+
+struct tlsf_block {
+	/* Physically previous block, only valid if that block is free */
+	struct tlsf_block *prev_phys;
+	/* Size of the payload including the flags above */
+	size_t size;
+
+	/* The payload starts here. Free blocks link themselves into their
+	 * free list with it.
+	 */
+	struct tlsf_block *next_free;
+	struct tlsf_block *prev_free;
+};
+
+#define TLSF_BLOCK_HDR		offsetof(struct tlsf_block, next_free)
+#define TLSF_BLOCK_MIN		(sizeof(struct tlsf_block) - TLSF_BLOCK_HDR)
+
+UK_CTASSERT(TLSF_BLOCK_HDR % TLSF_ALIGN == 0);
+UK_CTASSERT(TLSF_BLOCK_MIN % TLSF_ALIGN == 0);
+UK_CTASSERT(TLSF_SL_COUNT <= 32);
+
+struct uk_alloctlsf {
+	__u32 fl_bitmap;
+	__u32 sl_bitmap[TLSF_FL_COUNT];
+	struct tlsf_block *blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];
+
+	size_t free_mem; /* sum of the payloads of all free blocks */
+};
+
+UK_CTASSERT(TLSF_FL_COUNT <= 32);
+
+static inline struct uk_alloctlsf *tlsf_get(struct uk_alloc *a)
+{
+	return (struct uk_alloctlsf *) &a->priv;
+}
+
+/* Index of the most significant set bit; x must not be 0 */
+static inline unsigned int tlsf_fls(size_t x)
+{
+	return (sizeof(unsigned long) * 8 - 1) - __builtin_clzl(x);
+}
+
+static inline unsigned int tlsf_ffs(__u32 x)
+{
+	return __builtin_ctz(x);
+}
+
+static inline size_t block_size(const struct tlsf_block *b)
+{
+	return b->size & ~TLSF_BLOCK_FLAGS;
+}
+
+static inline void block_set_size(struct tlsf_block *b, size_t size)
+{
+	b->size = size | (b->size & TLSF_BLOCK_FLAGS);
+}
+
+static inline int block_is_free(const struct tlsf_block *b)
+{
+	return b->size & TLSF_BLOCK_FREE;
+}
+
+static inline int block_is_prev_free(const struct tlsf_block *b)
+{
+	return b->size & TLSF_BLOCK_PREV_FREE;
+}
+
+static inline void *block_to_ptr(struct tlsf_block *b)
+{
+	return (void *) ((uintptr_t) b + TLSF_BLOCK_HDR);
+}
+
+static inline struct tlsf_block *block_from_ptr(const void *ptr)
+{
+	return (struct tlsf_block *) ((uintptr_t) ptr - TLSF_BLOCK_HDR);
+}
+
+static inline struct tlsf_block *block_next(struct tlsf_block *b)
+{
+	return (struct tlsf_block *) ((uintptr_t) block_to_ptr(b)
+				      + block_size(b));
+}
+
+/* Updates the free flag of b and the view of its physical successor */
+static inline void block_mark_free(struct tlsf_block *b)
+{
+	struct tlsf_block *next = block_next(b);
+
+	b->size |= TLSF_BLOCK_FREE;
+	next->prev_phys = b;
+	next->size |= TLSF_BLOCK_PREV_FREE;
+}
+
+static inline void block_mark_used(struct tlsf_block *b)
+{
+	struct tlsf_block *next = block_next(b);
+
+	b->size &= ~TLSF_BLOCK_FREE;
+	next->size &= ~TLSF_BLOCK_PREV_FREE;
+}
+
+/* Returns the lists that hold blocks of the given size */
+static inline void mapping_insert(size_t size, unsigned int *fl,
+				  unsigned int *sl)
+{
+	unsigned int f;
+
+	if (size < TLSF_SMALL_SIZE) {
+		*fl = 0;
+		*sl = size / (TLSF_SMALL_SIZE / TLSF_SL_COUNT);
+	} else {
+		f = tlsf_fls(size);
+		*sl = (size >> (f - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+		*fl = f - (TLSF_FL_SHIFT - 1);
+	}
+}
+
+/* Returns the first lists whose blocks are all at least size bytes large */
+static inline void mapping_search(size_t size, unsigned int *fl,
+				  unsigned int *sl)
+{
+	if (size >= TLSF_SMALL_SIZE)
+		size += (1UL << (tlsf_fls(size) - TLSF_SL_LOG2)) - 1;
+	mapping_insert(size, fl, sl);
+}
+
+static void tlsf_insert(struct uk_alloctlsf *t, struct tlsf_block *b)
+{
+	struct tlsf_block *head;
+	unsigned int fl, sl;
+
+	mapping_insert(block_size(b), &fl, &sl);
+	head = t->blocks[fl][sl];
+
+	b->next_free = head;
+	b->prev_free = NULL;
+	if (head)
+		head->prev_free = b;
+	t->blocks[fl][sl] = b;
+
+	t->fl_bitmap |= 1U << fl;
+	t->sl_bitmap[fl] |= 1U << sl;
+	t->free_mem += block_size(b);
+}
+
+static void tlsf_remove(struct uk_alloctlsf *t, struct tlsf_block *b)
+{
+	unsigned int fl, sl;
+
+	mapping_insert(block_size(b), &fl, &sl);
+
+	if (b->prev_free)
+		b->prev_free->next_free = b->next_free;
+	else
+		t->blocks[fl][sl] = b->next_free;
+	if (b->next_free)
+		b->next_free->prev_free = b->prev_free;
+
+	if (!t->blocks[fl][sl]) {
+		t->sl_bitmap[fl] &= ~(1U << sl);
+		if (!t->sl_bitmap[fl])
+			t->fl_bitmap &= ~(1U << fl);
+	}
+	t->free_mem -= block_size(b);
+}
+
+/* Finds and removes a free block with at least size bytes of payload */
+static struct tlsf_block *tlsf_locate(struct uk_alloctlsf *t, size_t size)
+{
+	struct tlsf_block *b;
+	unsigned int fl, sl;
+	__u32 map;
+
+	mapping_search(size, &fl, &sl);
+	if (unlikely(fl >= TLSF_FL_COUNT))
+		return NULL;
+
+	map = t->sl_bitmap[fl] & (~0U << sl);
+	if (!map) {
+		/* Take the smallest list of the next non-empty range */
+		if (fl + 1 >= TLSF_FL_COUNT)
+			return NULL;
+		map = t->fl_bitmap & (~0U << (fl + 1));
+		if (!map)
+			return NULL;
+		fl = tlsf_ffs(map);
+		map = t->sl_bitmap[fl];
+		UK_ASSERT(map);
+	}
+	sl = tlsf_ffs(map);
+
+	b = t->blocks[fl][sl];
+	UK_ASSERT(b && block_size(b) >= size);
+	tlsf_remove(t, b);
+	return b;
+}
+
+/* Splits b after size bytes of payload if the rest can form a block on its
+ * own, and returns the rest. Otherwise NULL is returned.
+ */
+static struct tlsf_block *block_split(struct tlsf_block *b, size_t size)
+{
+	struct tlsf_block *rest;
+	size_t rest_size;
+
+	if (block_size(b) < size + sizeof(struct tlsf_block))
+		return NULL;
+
+	rest = (struct tlsf_block *) ((uintptr_t) block_to_ptr(b) + size);
+	rest_size = block_size(b) - size - TLSF_BLOCK_HDR;
+	rest->size = rest_size;
+	block_set_size(b, size);
+	return rest;
+}
+
+/* Merges b with its free physical neighbors, which are removed from their
+ * free lists, and returns the resulting block
+ */
+static struct tlsf_block *block_coalesce(struct uk_alloctlsf *t,
+					 struct tlsf_block *b)
+{
+	struct tlsf_block *prev, *next;
+
+	if (block_is_prev_free(b)) {
+		prev = b->prev_phys;
+		UK_ASSERT(block_is_free(prev));
+		tlsf_remove(t, prev);
+		block_set_size(prev, block_size(prev) + TLSF_BLOCK_HDR
+			       + block_size(b));
+		b = prev;
+	}
+
+	next = block_next(b);
+	if (block_is_free(next)) {
+		tlsf_remove(t, next);
+		block_set_size(b, block_size(b) + TLSF_BLOCK_HDR
+			       + block_size(next));
+	}
+	return b;
+}
+
+/* Returns the tail of a used block after size bytes to the free lists */
+static void block_trim_used(struct uk_alloctlsf *t, struct tlsf_block *b,
+			    size_t size)
+{
+	struct tlsf_block *rest;
+
+	rest = block_split(b, size);
+	if (!rest)
+		return;
+
+	/* The rest is followed by what used to follow b */
+	rest->size &= ~TLSF_BLOCK_PREV_FREE;
+	rest = block_coalesce(t, rest);
+	block_mark_free(rest);
+	tlsf_insert(t, rest);
+}
+
+/* Returns the payload size for a request, or 0 if it cannot be served */
+static inline size_t tlsf_adjust_size(size_t size)
+{
+	if (unlikely(!size || size > TLSF_BLOCK_MAX))
+		return 0;
+	size = ALIGN_UP(size, TLSF_ALIGN);
+	return MAX(size, TLSF_BLOCK_MIN);
+}
+
+static void *tlsf_malloc(struct uk_alloc *a, size_t size)
+{
+	struct uk_alloctlsf *t;
+	struct tlsf_block *b;
+	size_t asize;
+
+	UK_ASSERT(a != NULL);
+	t = tlsf_get(a);
+
+	asize = tlsf_adjust_size(size);
+	if (unlikely(!asize))
+		goto enomem;
+
+	b = tlsf_locate(t, asize);
+	if (unlikely(!b))
+		goto enomem;
+
+	block_mark_used(b);
+	block_trim_used(t, b, asize);
+
+	uk_alloc_stats_count_alloc(a, block_to_ptr(b), block_size(b));
+	return block_to_ptr(b);
+
+enomem:
+	uk_alloc_stats_count_enomem(a, size);
+	return NULL;
+}
+
+static void tlsf_free(struct uk_alloc *a, void *ptr)
+{
+	struct uk_alloctlsf *t;
+	struct tlsf_block *b;
+
+	UK_ASSERT(a != NULL);
+	if (!ptr)
+		return;
+
+	t = tlsf_get(a);
+	b = block_from_ptr(ptr);
+	UK_ASSERT(!block_is_free(b));
+
+	uk_alloc_stats_count_free(a, ptr, block_size(b));
+
+	b = block_coalesce(t, b);
+	block_mark_free(b);
+	tlsf_insert(t, b);
+}
+
+static int tlsf_posix_memalign(struct uk_alloc *a, void **memptr,
+			       size_t align, size_t size)
+{
+	struct uk_alloctlsf *t;
+	struct tlsf_block *b, *aligned;
+	uintptr_t ptr, aptr;
+	size_t asize;
+
+	UK_ASSERT(a != NULL);
+	t = tlsf_get(a);
+
+	/* align must be a power of two and a multiple of the pointer size */
+	if (unlikely((align & (align - 1)) || (align % sizeof(void *)))) {
+		*memptr = NULL;
+		return EINVAL;
+	}
+
+	if (!size) {
+		*memptr = NULL;
+		return EINVAL;
+	}
+
+	if (align <= TLSF_ALIGN) {
+		*memptr = tlsf_malloc(a, size);
+		return (*memptr) ? 0 : ENOMEM;
+	}
+
+	/* Over-allocate so that an aligned payload fits behind a leading
+	 * gap that is large enough to become a free block on its own
+	 */
+	asize = tlsf_adjust_size(size);
+	if (unlikely(!asize ||
+		     asize + align + sizeof(struct tlsf_block) > TLSF_BLOCK_MAX))
+		goto enomem;
+
+	b = tlsf_locate(t, asize + align + sizeof(struct tlsf_block));
+	if (unlikely(!b))
+		goto enomem;
+
+	ptr = (uintptr_t) block_to_ptr(b);
+	aptr = ALIGN_UP(ptr, align);
+	if (aptr != ptr && aptr - ptr < sizeof(struct tlsf_block))
+		aptr = ALIGN_UP(ptr + sizeof(struct tlsf_block), align);
+
+	if (aptr != ptr) {
+		/* Give the leading gap back to the free lists */
+		aligned = block_split(b, aptr - ptr - TLSF_BLOCK_HDR);
+		UK_ASSERT(aligned);
+		aligned->size |= TLSF_BLOCK_PREV_FREE;
+		aligned->prev_phys = b;
+		b->size |= TLSF_BLOCK_FREE;
+		tlsf_insert(t, b);
+		b = aligned;
+	}
+
+	block_mark_used(b);
+	block_trim_used(t, b, asize);
+
+	*memptr = block_to_ptr(b);
+	UK_ASSERT(((uintptr_t) *memptr & (align - 1)) == 0);
+	uk_alloc_stats_count_alloc(a, *memptr, block_size(b));
+	return 0;
+
+enomem:
+	uk_alloc_stats_count_enomem(a, size);
+	*memptr = NULL;
+	return ENOMEM;
+}
+
+static void *tlsf_realloc(struct uk_alloc *a, void *ptr, size_t size)
+{
+	struct uk_alloctlsf *t;
+	struct tlsf_block *b, *next;
+	size_t asize, cur;
+	void *retptr;
+
+	UK_ASSERT(a != NULL);
+	if (!ptr)
+		return tlsf_malloc(a, size);
+
+	if (!size) {
+		tlsf_free(a, ptr);
+		return NULL;
+	}
+
+	t = tlsf_get(a);
+	b = block_from_ptr(ptr);
+	UK_ASSERT(!block_is_free(b));
+	cur = block_size(b);
+
+	asize = tlsf_adjust_size(size);
+	if (unlikely(!asize)) {
+		uk_alloc_stats_count_enomem(a, size);
+		return NULL;
+	}
+
+	next = block_next(b);
+	if (asize > cur &&
+	    (!block_is_free(next) ||
+	     asize > cur + TLSF_BLOCK_HDR + block_size(next))) {
+		/* Cannot grow in place */
+		retptr = tlsf_malloc(a, size);
+		if (!retptr)
+			return NULL;
+
+		memcpy(retptr, ptr, MIN(cur, size));
+		tlsf_free(a, ptr);
+		return retptr;
+	}
+
+	uk_alloc_stats_count_free(a, ptr, cur);
+	if (asize > cur) {
+		/* Absorb the free successor */
+		tlsf_remove(t, next);
+		block_set_size(b, cur + TLSF_BLOCK_HDR + block_size(next));
+		block_mark_used(b);
+	}
+	block_trim_used(t, b, asize);
+	uk_alloc_stats_count_alloc(a, ptr, block_size(b));
+
+	return ptr;
+}
+
+/* Biggest request that is guaranteed to succeed: the smallest size that
+ * maps to the highest non-empty list
+ */
+static ssize_t tlsf_maxalloc(struct uk_alloc *a)
+{
+	struct uk_alloctlsf *t;
+	unsigned int fl, sl;
+
+	UK_ASSERT(a != NULL);
+	t = tlsf_get(a);
+
+	if (!t->fl_bitmap)
+		return 0;
+
+	fl = tlsf_fls(t->fl_bitmap);
+	sl = tlsf_fls(t->sl_bitmap[fl]);
+	if (fl == 0)
+		return sl * (TLSF_SMALL_SIZE / TLSF_SL_COUNT);
+	return (ssize_t) ((1UL << (fl + TLSF_FL_SHIFT - 1))
+			  + ((size_t) sl << (fl + TLSF_ALIGN_LOG2 - 1)));
+}
+
+static ssize_t tlsf_availmem(struct uk_alloc *a)
+{
+	UK_ASSERT(a != NULL);
+
+	return (ssize_t) tlsf_get(a)->free_mem;
+}
+
+static int tlsf_addmem(struct uk_alloc *a, void *base, size_t len)
+{
+	struct uk_alloctlsf *t;
+	struct tlsf_block *b, *last;
+	uintptr_t start, end;
+	size_t size;
+
+	UK_ASSERT(a != NULL);
+	t = tlsf_get(a);
+
+	start = ALIGN_UP((uintptr_t) base, TLSF_ALIGN);
+	end = ALIGN_DOWN((uintptr_t) base + len, TLSF_ALIGN);
+
+	/* Every region starts with a free block and ends with a zero-sized
+	 * used block. Both are never coalesced with memory outside of the
+	 * region. Huge regions are split into several maximum-sized blocks.
+	 */
+	while (start < end &&
+	       end - start >= 2 * TLSF_BLOCK_HDR + TLSF_BLOCK_MIN) {
+		size = MIN(end - start - 2 * TLSF_BLOCK_HDR, TLSF_BLOCK_MAX);
+
+		b = (struct tlsf_block *) start;
+		b->size = size;
+		last = block_next(b);
+		last->size = 0;
+		block_mark_free(b);
+		tlsf_insert(t, b);
+
+		uk_pr_debug("%p: Add memory region %p - %p\n", a, (void *) start,
+			    (void *) ((uintptr_t) last + TLSF_BLOCK_HDR));
+		start = (uintptr_t) last + TLSF_BLOCK_HDR;
+	}
+
+	return 0;
+}
+
+struct uk_alloc *uk_alloctlsf_init(void *base, size_t len)
+{
+	struct uk_alloc *a;
+	struct uk_alloctlsf *t;
+	size_t metalen;
+
+	a = (struct uk_alloc *) ALIGN_UP((uintptr_t) base, sizeof(void *));
+	metalen = ((uintptr_t) a - (uintptr_t) base) + sizeof(*a) + sizeof(*t);
+
+	/* enough space for allocator available? */
+	if (metalen + 2 * TLSF_BLOCK_HDR + TLSF_BLOCK_MIN > len) {
+		uk_pr_err("Not enough space for allocator: %"__PRIsz
+			  " B required but only %"__PRIuptr" B usable\n",
+			  metalen, len);
+		return NULL;
+	}
+
+	/* store allocator metadata on the heap, just before the memory pool */
+	t = tlsf_get(a);
+	memset(t, 0, sizeof(*t));
+
+	uk_pr_info("Initialize tlsf allocator @ 0x%"
+		   __PRIuptr ", len %"__PRIsz"\n", (uintptr_t) a, len);
+
+	/* use the "compat" wrappers for calloc, memalign, palloc and pfree as
+	 * those do not add additional metadata.
+	 */
+	uk_alloc_init_malloc(a, tlsf_malloc, uk_calloc_compat,
+			     tlsf_realloc, tlsf_free, tlsf_posix_memalign,
+			     uk_memalign_compat, tlsf_maxalloc,
+			     tlsf_availmem, tlsf_addmem);
+
+	tlsf_addmem(a, (void *) ((uintptr_t) base + metalen), len - metalen);
+	return a;
+}
@@ -0,0 +1,203 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <uk/bench.h>
+#include <uk/init.h>
+#include <uk/assert.h>
+#include <uk/print.h>
+#include <uk/essentials.h>
+#include <uk/plat/time.h>
+
+#define BENCH_SAMPLES		CONFIG_LIBUKBENCH_SAMPLES
+#define BENCH_WARMUP		CONFIG_LIBUKBENCH_WARMUP
+#define BENCH_SAMPLE_NSEC	((__nsec) CONFIG_LIBUKBENCH_SAMPLE_NSEC)
+#define BENCH_MAX_ITERS		(1ULL << 32)
+
+/* Values are reported per operation with two decimal places */
+#define FIX_FMT			"%"__PRIu64".%02u"
+#define FIX_ARG(v)		(v) / 100, (unsigned int) ((v) % 100)
+
+struct bench_result {
+	__u64 iters;
+	/* Minimum, median, 99th percentile and maximum per operation,
+	 * times 100
+	 */
+	__u64 cycles[4];
+	__u64 nsec[4];
+};
+
+static __u64 samples[BENCH_SAMPLES];
+
+static __u64 bench_sample(const struct uk_bench *bench, __u64 iters)
+{
+	struct uk_bench_state b = { .iters = iters };
+
+	uk_bench_timer_start(&b);
+	bench->func(&b);
+	uk_bench_timer_stop(&b);
+
+	return b.elapsed;
+}
+
+/* Doubles the iterations until a sample takes the configured time */
+static __u64 bench_calibrate(const struct uk_bench *bench)
+{
+	__u64 iters = 1;
+	__nsec t;
+
+	for (;;) {
+		t = ukplat_monotonic_clock();
+		bench_sample(bench, iters);
+		t = ukplat_monotonic_clock() - t;
+
+		if (t >= BENCH_SAMPLE_NSEC || iters >= BENCH_MAX_ITERS)
+			return iters;
+		iters <<= 1;
+	}
+}
+
+static void bench_sort(__u64 *v, unsigned int n)
+{
+	unsigned int i, j;
+	__u64 x;
+
+	for (i = 1; i < n; i++) {
+		x = v[i];
+		for (j = i; j > 0 && v[j - 1] > x; j--)
+			v[j] = v[j - 1];
+		v[j] = x;
+	}
+}
+
+static void bench_print(const struct uk_bench *bench,
+			const struct bench_result *r)
+{
+#if CONFIG_LIBUKBENCH_OUTPUT_CSV
+	printf("%s,%s,%"__PRIu64",%u,"
+	       FIX_FMT","FIX_FMT","FIX_FMT","FIX_FMT","
+	       FIX_FMT","FIX_FMT","FIX_FMT","FIX_FMT"\n",
+	       bench->suite, bench->name, r->iters, BENCH_SAMPLES,
+	       FIX_ARG(r->cycles[0]), FIX_ARG(r->cycles[1]),
+	       FIX_ARG(r->cycles[2]), FIX_ARG(r->cycles[3]),
+	       FIX_ARG(r->nsec[0]), FIX_ARG(r->nsec[1]),
+	       FIX_ARG(r->nsec[2]), FIX_ARG(r->nsec[3]));
+#elif CONFIG_LIBUKBENCH_OUTPUT_JSON
+	printf("{\"suite\":\"%s\",\"benchmark\":\"%s\","
+	       "\"iterations\":%"__PRIu64",\"samples\":%u,"
+	       "\"cycles\":{\"min\":"FIX_FMT",\"median\":"FIX_FMT
+	       ",\"p99\":"FIX_FMT",\"max\":"FIX_FMT"},"
+	       "\"ns\":{\"min\":"FIX_FMT",\"median\":"FIX_FMT
+	       ",\"p99\":"FIX_FMT",\"max\":"FIX_FMT"}}\n",
+	       bench->suite, bench->name, r->iters, BENCH_SAMPLES,
+	       FIX_ARG(r->cycles[0]), FIX_ARG(r->cycles[1]),
+	       FIX_ARG(r->cycles[2]), FIX_ARG(r->cycles[3]),
+	       FIX_ARG(r->nsec[0]), FIX_ARG(r->nsec[1]),
+	       FIX_ARG(r->nsec[2]), FIX_ARG(r->nsec[3]));
+#else /* CONFIG_LIBUKBENCH_OUTPUT_TEXT */
+	printf("bench: %s->%s (%"__PRIu64" iterations)\n"
+	       "    cycles/op: min "FIX_FMT"  median "FIX_FMT
+	       "  p99 "FIX_FMT"  max "FIX_FMT"\n"
+	       "    ns/op:     min "FIX_FMT"  median "FIX_FMT
+	       "  p99 "FIX_FMT"  max "FIX_FMT"\n",
+	       bench->suite, bench->name, r->iters,
+	       FIX_ARG(r->cycles[0]), FIX_ARG(r->cycles[1]),
+	       FIX_ARG(r->cycles[2]), FIX_ARG(r->cycles[3]),
+	       FIX_ARG(r->nsec[0]), FIX_ARG(r->nsec[1]),
+	       FIX_ARG(r->nsec[2]), FIX_ARG(r->nsec[3]));
+#endif /* CONFIG_LIBUKBENCH_OUTPUT_TEXT */
+}
+
+int uk_bench_run(const struct uk_bench *bench)
+{
+	struct bench_result r;
+	__u64 c, ns_per_cycle;
+	__nsec t;
+	unsigned int i, idx[4];
+
+	UK_ASSERT(bench);
+	UK_ASSERT(bench->func);
+
+	r.iters = bench->iters ? bench->iters : bench_calibrate(bench);
+
+	for (i = 0; i < BENCH_WARMUP; i++)
+		bench_sample(bench, r.iters);
+
+	/* Relate the cycle counter to the monotonic clock over the whole
+	 * measurement, in 16.16 fixed point
+	 */
+	t = ukplat_monotonic_clock();
+	c = uk_bench_cycles();
+	for (i = 0; i < BENCH_SAMPLES; i++)
+		samples[i] = bench_sample(bench, r.iters);
+	c = uk_bench_cycles() - c;
+	t = ukplat_monotonic_clock() - t;
+	if (unlikely(c == 0))
+		return -EINVAL;
+	ns_per_cycle = (t << 16) / c;
+
+	bench_sort(samples, BENCH_SAMPLES);
+	idx[0] = 0;
+	idx[1] = BENCH_SAMPLES / 2;
+	idx[2] = (BENCH_SAMPLES * 99 + 99) / 100 - 1;
+	idx[3] = BENCH_SAMPLES - 1;
+	for (i = 0; i < 4; i++) {
+		r.cycles[i] = samples[idx[i]] * 100 / r.iters;
+		r.nsec[i] = ((samples[idx[i]] * ns_per_cycle) >> 16)
+			    * 100 / r.iters;
+	}
+
+	bench_print(bench, &r);
+	return 0;
+}
+
+static int uk_bench_run_all(void)
+{
+	const struct uk_bench *bench;
+	int rc;
+
+#if CONFIG_LIBUKBENCH_OUTPUT_CSV
+	printf("suite,benchmark,iterations,samples,"
+	       "min_cycles,median_cycles,p99_cycles,max_cycles,"
+	       "min_ns,median_ns,p99_ns,max_ns\n");
+#endif /* CONFIG_LIBUKBENCH_OUTPUT_CSV */
+
+	uk_bench_foreach(bench) {
+		rc = uk_bench_run(bench);
+		if (unlikely(rc < 0))
+			uk_pr_err("Could not run benchmark %s->%s: %d\n",
+				  bench->suite, bench->name, rc);
+	}
+
+	return 0;
+}
+
+uk_late_initcall(uk_bench_run_all);
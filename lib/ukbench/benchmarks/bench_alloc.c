@@ -0,0 +1,292 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/bench.h>
+#include <uk/alloc.h>
+#include <uk/assert.h>
+#include <uk/config.h>
+#if CONFIG_LIBUKALLOCBBUDDY
+#include <uk/allocbbuddy.h>
+#endif
+#if CONFIG_LIBUKALLOCPOOL
+#include <uk/allocpool.h>
+#endif
+#if CONFIG_LIBUKALLOCREGION
+#include <uk/allocregion.h>
+#endif
+#if CONFIG_LIBUKALLOCTLSF
+#include <uk/alloctlsf.h>
+#endif
+
+#define BATCH 32
+#define LAT_LIVE 64
+
+struct bench_lat {
+	struct uk_alloc *a;
+	void *live[LAT_LIVE];
+	unsigned int next;
+	__u32 rnd;
+};
+
+static void bench_malloc_free(struct uk_bench_state *b, struct uk_alloc *a,
+			      __sz size)
+{
+	void *p;
+	__u64 i;
+
+	for (i = 0; i < b->iters; i++) {
+		p = uk_malloc(a, size);
+		uk_bench_keep(p);
+		uk_free(a, p);
+	}
+}
+
+/* Allocates BATCH objects before freeing them, one iteration is one object */
+static void bench_malloc_batch(struct uk_bench_state *b, struct uk_alloc *a,
+			       __sz size)
+{
+	void *p[BATCH];
+	__u64 i;
+	int j;
+
+	for (i = 0; i < b->iters; i += BATCH) {
+		for (j = 0; j < BATCH; j++)
+			p[j] = uk_malloc(a, size);
+		uk_bench_clobber();
+		for (j = 0; j < BATCH; j++)
+			uk_free(a, p[j]);
+	}
+}
+
+static void bench_palloc_pfree(struct uk_bench_state *b, struct uk_alloc *a)
+{
+	void *p;
+	__u64 i;
+
+	for (i = 0; i < b->iters; i++) {
+		p = uk_palloc(a, 1);
+		uk_bench_keep(p);
+		uk_pfree(a, p, 1);
+	}
+}
+
+/* Replaces the oldest of LAT_LIVE objects with one of pseudo-random size
+ * between 16 B and 4 KiB, so that the heap stays fragmented. Registered with
+ * one iteration per sample, so that the maximum is the worst-case latency
+ * of a free() followed by a malloc().
+ */
+static void bench_latency(struct uk_bench_state *b, struct bench_lat *l)
+{
+	__sz size;
+	__u64 i;
+
+	for (i = 0; i < b->iters; i++) {
+		l->rnd = l->rnd * 1103515245 + 12345;
+		size = 16 + (l->rnd >> 16) % 4081;
+		uk_free(l->a, l->live[l->next]);
+		l->live[l->next] = uk_malloc(l->a, size);
+		l->next = (l->next + 1) % LAT_LIVE;
+	}
+}
+
+UK_BENCHMARK(ukalloc, default_malloc_free_64)
+{
+	bench_malloc_free(b, uk_alloc_get_default(), 64);
+}
+
+UK_BENCHMARK(ukalloc, default_malloc_free_4k)
+{
+	bench_malloc_free(b, uk_alloc_get_default(), 4096);
+}
+
+UK_BENCHMARK(ukalloc, default_malloc_batch_64)
+{
+	bench_malloc_batch(b, uk_alloc_get_default(), 64);
+}
+
+UK_BENCHMARK(ukalloc, default_palloc_pfree_1)
+{
+	bench_palloc_pfree(b, uk_alloc_get_default());
+}
+
+UK_BENCHMARK_ITERS(ukalloc, default_latency_mixed, 1)
+{
+	static struct bench_lat l;
+
+	if (!l.a)
+		l.a = uk_alloc_get_default();
+	bench_latency(b, &l);
+}
+
+#if CONFIG_LIBUKALLOCBBUDDY
+#define BBUDDY_PAGES 256
+
+/* A private instance on memory of the default allocator. It is kept for
+ * the lifetime of the system because allocators cannot be unregistered.
+ */
+static struct uk_alloc *bench_bbuddy(void)
+{
+	static struct uk_alloc *a;
+	void *base;
+
+	if (!a) {
+		base = uk_palloc(uk_alloc_get_default(), BBUDDY_PAGES);
+		UK_ASSERT(base);
+		a = uk_allocbbuddy_init(base, BBUDDY_PAGES * __PAGE_SIZE);
+		UK_ASSERT(a);
+	}
+	return a;
+}
+
+UK_BENCHMARK(ukalloc, bbuddy_malloc_free_64)
+{
+	bench_malloc_free(b, bench_bbuddy(), 64);
+}
+
+UK_BENCHMARK(ukalloc, bbuddy_malloc_batch_64)
+{
+	bench_malloc_batch(b, bench_bbuddy(), 64);
+}
+
+UK_BENCHMARK(ukalloc, bbuddy_palloc_pfree_1)
+{
+	bench_palloc_pfree(b, bench_bbuddy());
+}
+
+UK_BENCHMARK_ITERS(ukalloc, bbuddy_latency_mixed, 1)
+{
+	static struct bench_lat l;
+
+	if (!l.a)
+		l.a = bench_bbuddy();
+	bench_latency(b, &l);
+}
+#endif /* CONFIG_LIBUKALLOCBBUDDY */
+
+#if CONFIG_LIBUKALLOCREGION
+/* Allocates BATCH objects and releases them at once with an arena reset,
+ * one iteration is one object. Compare with *_malloc_batch_64.
+ */
+UK_BENCHMARK(ukalloc, arena_malloc_batch_64)
+{
+	static struct uk_alloc *a;
+	void *p;
+	__u64 i;
+	int j;
+
+	if (!a) {
+		a = uk_allocregion_arena_create(uk_alloc_get_default(),
+						4 * __PAGE_SIZE);
+		UK_ASSERT(a);
+	}
+
+	for (i = 0; i < b->iters; i += BATCH) {
+		for (j = 0; j < BATCH; j++) {
+			p = uk_malloc(a, 64);
+			uk_bench_keep(p);
+		}
+		uk_allocregion_arena_reset(a);
+	}
+}
+#endif /* CONFIG_LIBUKALLOCREGION */
+
+#if CONFIG_LIBUKALLOCTLSF
+#define TLSF_PAGES 256
+
+/* A private instance, see bench_bbuddy() */
+static struct uk_alloc *bench_tlsf(void)
+{
+	static struct uk_alloc *a;
+	void *base;
+
+	if (!a) {
+		base = uk_palloc(uk_alloc_get_default(), TLSF_PAGES);
+		UK_ASSERT(base);
+		a = uk_alloctlsf_init(base, TLSF_PAGES * __PAGE_SIZE);
+		UK_ASSERT(a);
+	}
+	return a;
+}
+
+UK_BENCHMARK(ukalloc, tlsf_malloc_free_64)
+{
+	bench_malloc_free(b, bench_tlsf(), 64);
+}
+
+UK_BENCHMARK(ukalloc, tlsf_malloc_batch_64)
+{
+	bench_malloc_batch(b, bench_tlsf(), 64);
+}
+
+UK_BENCHMARK(ukalloc, tlsf_palloc_pfree_1)
+{
+	bench_palloc_pfree(b, bench_tlsf());
+}
+
+UK_BENCHMARK_ITERS(ukalloc, tlsf_latency_mixed, 1)
+{
+	static struct bench_lat l;
+
+	if (!l.a)
+		l.a = bench_tlsf();
+	bench_latency(b, &l);
+}
+#endif /* CONFIG_LIBUKALLOCTLSF */
+
+#if CONFIG_LIBUKALLOCPOOL
+static struct uk_allocpool *bench_pool(void)
+{
+	static struct uk_allocpool *p;
+
+	if (!p) {
+		p = uk_allocpool_alloc(uk_alloc_get_default(), BATCH, 64, 8);
+		UK_ASSERT(p);
+	}
+	return p;
+}
+
+UK_BENCHMARK(ukalloc, pool_take_return)
+{
+	struct uk_allocpool *p = bench_pool();
+	void *obj;
+	__u64 i;
+
+	for (i = 0; i < b->iters; i++) {
+		obj = uk_allocpool_take(p);
+		uk_bench_keep(obj);
+		uk_allocpool_return(p, obj);
+	}
+}
+
+UK_BENCHMARK(ukalloc, pool_malloc_batch_64)
+{
+	bench_malloc_batch(b, uk_allocpool2ukalloc(bench_pool()), 64);
+}
+#endif /* CONFIG_LIBUKALLOCPOOL */
@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/bench.h>
+#include <uk/mbox.h>
+#include <uk/alloc.h>
+#include <uk/assert.h>
+
+#define MBOX_SIZE 256
+#define BATCH     32
+
+static struct uk_mbox *bench_mbox_get(void)
+{
+	static struct uk_mbox *m;
+
+	if (!m) {
+		m = uk_mbox_create(uk_alloc_get_default(), MBOX_SIZE);
+		UK_ASSERT(m);
+	}
+	return m;
+}
+
+/* Uncontended post and receive, nobody ever waits on the mailbox */
+UK_BENCHMARK(ukmpi, mbox_post_recv)
+{
+	struct uk_mbox *m = bench_mbox_get();
+	void *msg;
+	__u64 i;
+
+	for (i = 0; i < b->iters; i++) {
+		uk_mbox_post(m, (void *) b);
+		uk_mbox_recv(m, &msg);
+		uk_bench_keep(msg);
+	}
+}
+
+/* Posts a batch and drains it with one call, one iteration is one message */
+UK_BENCHMARK(ukmpi, mbox_recv_batch_32)
+{
+	struct uk_mbox *m = bench_mbox_get();
+	void *msgs[BATCH];
+	unsigned int n;
+	__u64 i;
+	int j;
+
+	for (i = 0; i < b->iters; i += BATCH) {
+		for (j = 0; j < BATCH; j++)
+			uk_mbox_post(m, (void *) b);
+		for (n = 0; n < BATCH; )
+			n += uk_mbox_recv_batch(m, msgs, BATCH - n);
+		uk_bench_keep(msgs[0]);
+	}
+}
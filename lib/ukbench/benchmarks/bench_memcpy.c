@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <uk/bench.h>
+
+#define BUF_SIZE 65536
+
+static char src[BUF_SIZE] __align(64);
+static char dst[BUF_SIZE] __align(64);
+
+static void bench_memcpy(struct uk_bench_state *b, __sz len)
+{
+	__u64 i;
+
+	for (i = 0; i < b->iters; i++) {
+		memcpy(dst, src, len);
+		uk_bench_clobber();
+	}
+}
+
+UK_BENCHMARK(memcpy, copy_64)
+{
+	bench_memcpy(b, 64);
+}
+
+UK_BENCHMARK(memcpy, copy_4k)
+{
+	bench_memcpy(b, 4096);
+}
+
+UK_BENCHMARK(memcpy, copy_64k)
+{
+	bench_memcpy(b, BUF_SIZE);
+}
+
+UK_BENCHMARK(memcpy, copy_unaligned_1500)
+{
+	__u64 i;
+
+	for (i = 0; i < b->iters; i++) {
+		memcpy(dst + 1, src + 3, 1500);
+		uk_bench_clobber();
+	}
+}
@@ -0,0 +1,144 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/bench.h>
+#include <uk/ring.h>
+#include <uk/alloc.h>
+#include <uk/assert.h>
+
+#define RING_SIZE 256
+#define BATCH     32
+
+static struct uk_ring *bench_ring_get(void)
+{
+	static struct uk_ring *r;
+
+	if (!r) {
+		r = uk_ring_alloc(RING_SIZE, uk_alloc_get_default()
+#ifdef DEBUG_BUFRING
+				  , NULL
+#endif
+			);
+		UK_ASSERT(r);
+	}
+	return r;
+}
+
+UK_BENCHMARK(ukring, enqueue_dequeue_sc)
+{
+	struct uk_ring *r = bench_ring_get();
+	__u64 i;
+
+	for (i = 0; i < b->iters; i++) {
+		uk_ring_enqueue(r, (void *) b);
+		uk_bench_keep(uk_ring_dequeue_sc(r));
+	}
+}
+
+UK_BENCHMARK(ukring, enqueue_dequeue_mc)
+{
+	struct uk_ring *r = bench_ring_get();
+	__u64 i;
+
+	for (i = 0; i < b->iters; i++) {
+		uk_ring_enqueue(r, (void *) b);
+		uk_bench_keep(uk_ring_dequeue_mc(r));
+	}
+}
+
+UK_BENCHMARK(ukring, enqueue_dequeue_spsc)
+{
+	struct uk_ring *r = bench_ring_get();
+	__u64 i;
+
+	for (i = 0; i < b->iters; i++) {
+		uk_ring_enqueue_sp(r, (void *) b);
+		uk_bench_keep(uk_ring_dequeue_sc(r));
+	}
+}
+
+/* Fills and drains the ring in bursts, one iteration is one object */
+UK_BENCHMARK(ukring, burst_32)
+{
+	struct uk_ring *r = bench_ring_get();
+	__u64 i;
+	int j;
+
+	for (i = 0; i < b->iters; i += BATCH) {
+		for (j = 0; j < BATCH; j++)
+			uk_ring_enqueue(r, (void *) b);
+		for (j = 0; j < BATCH; j++)
+			uk_bench_keep(uk_ring_dequeue_sc(r));
+	}
+}
+
+/*
+ * Moves `n` objects per operation with the bulk interface, one iteration is
+ * one object. Comparing sizes shows how well the per-operation cost of the
+ * index updates is amortized; comparing mpmc with spsc shows the cost of the
+ * CAS and the wait for preceding operations.
+ */
+static void bench_ring_bulk(struct uk_bench_state *b, unsigned int n, int sp)
+{
+	struct uk_ring *r = bench_ring_get();
+	void *objs[RING_SIZE];
+	unsigned int j;
+	__u64 i;
+
+	UK_ASSERT(n <= RING_SIZE);
+	for (j = 0; j < n; j++)
+		objs[j] = (void *) b;
+
+	for (i = 0; i < b->iters; i += n) {
+		if (sp) {
+			uk_ring_enqueue_bulk_sp(r, objs, n);
+			uk_ring_dequeue_bulk_sc(r, objs, n);
+		} else {
+			uk_ring_enqueue_bulk(r, objs, n);
+			uk_ring_dequeue_bulk_mc(r, objs, n);
+		}
+		uk_bench_keep(objs[0]);
+	}
+}
+
+#define BENCH_RING_BULK(n)						\
+	UK_BENCHMARK(ukring, bulk_mpmc_##n)				\
+	{								\
+		bench_ring_bulk(b, n, 0);				\
+	}								\
+	UK_BENCHMARK(ukring, bulk_spsc_##n)				\
+	{								\
+		bench_ring_bulk(b, n, 1);				\
+	}
+
+BENCH_RING_BULK(1)
+BENCH_RING_BULK(8)
+BENCH_RING_BULK(32)
+BENCH_RING_BULK(128)
@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/bench.h>
+#include <uk/sched.h>
+#include <uk/thread.h>
+#include <uk/print.h>
+
+static volatile int partner_stop;
+
+static void partner(void *arg __unused)
+{
+	while (!partner_stop)
+		uk_sched_yield();
+}
+
+/* One iteration is a round trip to a second thread, two context switches */
+UK_BENCHMARK(uksched, yield_roundtrip)
+{
+	struct uk_thread *t;
+	__u64 i;
+
+	uk_bench_timer_stop(b);
+	partner_stop = 0;
+	t = uk_thread_create("bench-partner", partner, NULL);
+	if (unlikely(!t)) {
+		uk_pr_err("Failed to create partner thread\n");
+		return;
+	}
+	uk_sched_yield();
+	uk_bench_timer_start(b);
+
+	for (i = 0; i < b->iters; i++)
+		uk_sched_yield();
+
+	uk_bench_timer_stop(b);
+	partner_stop = 1;
+	uk_thread_wait(t);
+}
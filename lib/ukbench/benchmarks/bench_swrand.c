@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <uk/bench.h>
+#include <uk/swrand.h>
+
+#define BUF_SIZE 65536
+
+static char buf[BUF_SIZE] __align(64);
+
+/* Word by word, the way uk_swrand_fill_buffer() used to fill buffers */
+static void bench_swrand_randr(struct uk_bench_state *b, __sz len)
+{
+	__u32 rd;
+	__sz off;
+	__u64 i;
+
+	for (i = 0; i < b->iters; i++) {
+		for (off = 0; off < len; off += sizeof(rd)) {
+			rd = uk_swrand_randr();
+			memcpy(buf + off, &rd, sizeof(rd));
+		}
+		uk_bench_clobber();
+	}
+}
+
+static void bench_swrand_fill(struct uk_bench_state *b, __sz len)
+{
+	__u64 i;
+
+	for (i = 0; i < b->iters; i++) {
+		uk_swrand_fill_buffer(buf, len);
+		uk_bench_clobber();
+	}
+}
+
+UK_BENCHMARK(swrand, randr_16)
+{
+	bench_swrand_randr(b, 16);
+}
+
+UK_BENCHMARK(swrand, randr_4k)
+{
+	bench_swrand_randr(b, 4096);
+}
+
+UK_BENCHMARK(swrand, fill_16)
+{
+	bench_swrand_fill(b, 16);
+}
+
+UK_BENCHMARK(swrand, fill_4k)
+{
+	bench_swrand_fill(b, 4096);
+}
+
+UK_BENCHMARK(swrand, fill_64k)
+{
+	bench_swrand_fill(b, BUF_SIZE);
+}
@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <uk/bench.h>
+#include <uk/print.h>
+
+#define BENCH_ROOT	"/vfscore_bench"
+#define BENCH_DEEP	BENCH_ROOT "/a/b/c/d"
+
+static const char *const bench_dirs[] = {
+	BENCH_ROOT,
+	BENCH_ROOT "/a",
+	BENCH_ROOT "/a/b",
+	BENCH_ROOT "/a/b/c",
+	BENCH_DEEP,
+};
+
+/* Benchmarks are run repeatedly, so the tree may already exist */
+static int bench_tree_create(void)
+{
+	unsigned int i;
+	int fd;
+
+	for (i = 0; i < ARRAY_SIZE(bench_dirs); i++) {
+		if (mkdir(bench_dirs[i], 0755) && errno != EEXIST)
+			goto err;
+	}
+
+	fd = open(BENCH_DEEP "/file", O_CREAT | O_WRONLY, 0644);
+	if (fd < 0)
+		goto err;
+	close(fd);
+	return 0;
+
+err:
+	uk_pr_err("Failed to create %s: %d\n", BENCH_ROOT, errno);
+	return -1;
+}
+
+static void bench_stat(struct uk_bench_state *b, const char *path)
+{
+	struct stat st;
+	__u64 i;
+
+	uk_bench_timer_stop(b);
+	if (bench_tree_create())
+		return;
+	/* Populate the dentry cache */
+	stat(path, &st);
+	uk_bench_timer_start(b);
+
+	for (i = 0; i < b->iters; i++) {
+		stat(path, &st);
+		uk_bench_clobber();
+	}
+}
+
+UK_BENCHMARK(vfscore, stat_deep_path)
+{
+	bench_stat(b, BENCH_DEEP "/file");
+}
+
+UK_BENCHMARK(vfscore, stat_deep_path_missing)
+{
+	bench_stat(b, BENCH_DEEP "/missing");
+}
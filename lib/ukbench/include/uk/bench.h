@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __UK_BENCH_H__
+#define __UK_BENCH_H__
+
+#include <uk/arch/types.h>
+#include <uk/essentials.h>
+#include <uk/config.h>
+#include <uk/plat/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Timing state of a running benchmark. A benchmark function executes the
+ * operation under test `iters` times. The time spent in the function is
+ * measured, except for parts enclosed in uk_bench_timer_stop() and
+ * uk_bench_timer_start(), e.g., setup and teardown.
+ */
+struct uk_bench_state {
+	/* The number of iterations to run. */
+	__u64 iters;
+	/* Cycle counter value at the last start of the timer. */
+	__u64 start;
+	/* Cycles accumulated while the timer was running. */
+	__u64 elapsed;
+	/* Whether the timer is running. */
+	int running;
+};
+
+struct uk_bench {
+	/* The name of the suite the benchmark belongs to. */
+	const char *suite;
+	/* The name of the benchmark. */
+	const char *name;
+	/* Pointer to the benchmark method. */
+	void (*func)(struct uk_bench_state *b);
+	/* Fixed number of iterations per sample, 0 for calibration. */
+	__u64 iters;
+} __packed;
+
+extern const struct uk_bench uk_benchtab_start[];
+extern const struct uk_bench uk_benchtab_end[];
+
+#define uk_bench_foreach(bench)						\
+	for ((bench) = uk_benchtab_start;				\
+	     (bench) < uk_benchtab_end;					\
+	     (bench)++)
+
+/**
+ * Reads the cycle counter. Earlier instructions complete before the counter
+ * is read. Falls back to the monotonic clock on architectures without a
+ * user-readable counter.
+ */
+static inline __u64 uk_bench_cycles(void)
+{
+#if defined(__X86_64__)
+	__u32 lo, hi;
+
+	__asm__ __volatile__("lfence\n\trdtsc" : "=a"(lo), "=d"(hi));
+	return ((__u64) hi << 32) | lo;
+#elif defined(__ARM_64__)
+	__u64 v;
+
+	__asm__ __volatile__("isb\n\tmrs %0, cntvct_el0" : "=r"(v));
+	return v;
+#else
+	return ukplat_monotonic_clock();
+#endif
+}
+
+static inline void uk_bench_timer_start(struct uk_bench_state *b)
+{
+	if (!b->running) {
+		b->running = 1;
+		b->start = uk_bench_cycles();
+	}
+}
+
+static inline void uk_bench_timer_stop(struct uk_bench_state *b)
+{
+	if (b->running) {
+		b->elapsed += uk_bench_cycles() - b->start;
+		b->running = 0;
+	}
+}
+
+/**
+ * Keeps the compiler from optimizing away the computation of `v`.
+ */
+#define uk_bench_keep(v)						\
+	__asm__ __volatile__("" : : "g"(v) : "memory")
+
+/**
+ * Keeps the compiler from caching memory contents across this point.
+ */
+#define uk_bench_clobber()						\
+	__asm__ __volatile__("" : : : "memory")
+
+#define _UK_BENCH_FUNC(bsuite, bname)					\
+	_uk_bench_ ## bsuite ## _ ## bname
+#define _UK_BENCH_LABEL(bsuite, bname)					\
+	_uk_benchtab_ ## bsuite ## _ ## bname
+
+/**
+ * Registers a benchmark that runs a fixed number of iterations per sample.
+ * The body follows the macro and has access to the timing state `b`:
+ *
+ *	UK_BENCHMARK_ITERS(mysuite, myop, 1000)
+ *	{
+ *		for (__u64 i = 0; i < b->iters; i++)
+ *			myop();
+ *	}
+ *
+ * Benchmarks are run in the order of their suite and benchmark names.
+ *
+ * @param bsuite
+ *   Name of the suite
+ * @param bname
+ *   Name of the benchmark
+ * @param niters
+ *   Iterations per sample, 0 to calibrate to LIBUKBENCH_SAMPLE_NSEC
+ */
+#define UK_BENCHMARK_ITERS(bsuite, bname, niters)			\
+	static void _UK_BENCH_FUNC(bsuite, bname)(			\
+		struct uk_bench_state *b __maybe_unused);		\
+	static const struct uk_bench					\
+	__used __section(".uk_benchtab_" #bsuite "~" #bname) __align(1)	\
+	_UK_BENCH_LABEL(bsuite, bname) = {				\
+		.suite = #bsuite,					\
+		.name = #bname,						\
+		.func = _UK_BENCH_FUNC(bsuite, bname),			\
+		.iters = niters						\
+	};								\
+	static void _UK_BENCH_FUNC(bsuite, bname)(			\
+		struct uk_bench_state *b __maybe_unused)
+
+/**
+ * Registers a benchmark with a calibrated iteration count.
+ */
+#define UK_BENCHMARK(bsuite, bname)					\
+	UK_BENCHMARK_ITERS(bsuite, bname, 0)
+
+/**
+ * Runs a single benchmark and prints its result.
+ *
+ * @return
+ *   0 on success, < 0 if the benchmark could not be run
+ */
+int uk_bench_run(const struct uk_bench *bench);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UK_BENCH_H__ */
@@ -43,6 +43,8 @@
 #include <uk/allocbbuddy.h>
 #elif CONFIG_LIBUKBOOT_INITREGION
 #include <uk/allocregion.h>
+#elif CONFIG_LIBUKBOOT_INITUKALLOCTLSF
+#include <uk/alloctlsf.h>
 #elif CONFIG_LIBUKBOOT_INITMIMALLOC
 #include <uk/mimalloc.h>
 #elif CONFIG_LIBUKBOOT_INITTLSF
@@ -53,6 +55,9 @@
 #if CONFIG_LIBUKSCHED
 #include <uk/sched.h>
 #endif
+#if CONFIG_LIBUKBOOT_INITTAB_TIMING || CONFIG_LIBUKBOOT_INITTAB_PARALLEL
+#include <uk/alloc.h>
+#endif
 #include <uk/arch/lcpu.h>
 #include <uk/plat/bootstrap.h>
 #include <uk/plat/memory.h>
@@ -70,6 +75,9 @@
 #ifdef CONFIG_LIBUKSP
 #include <uk/sp.h>
 #endif
+#if CONFIG_LIBSYSCALL_SHIM_PROFILE_DUMP
+#include <uk/syscall.h>
+#endif
 #include "banner.h"
 
 int main(int argc, char *argv[]) __weak;
@@ -81,29 +89,175 @@ struct thread_main_arg {
 	char **argv;
 };
 
+struct inittab_call {
+	const struct uk_inittab_entry *entry;
+	int ret;
+#if CONFIG_LIBUKBOOT_INITTAB_TIMING
+	__nsec start;
+	__nsec end;
+#endif
+#if CONFIG_LIBUKBOOT_INITTAB_PARALLEL
+	struct uk_thread *thread;
+#endif
+};
+
+static void inittab_call(struct inittab_call *call)
+{
+	UK_ASSERT(call->entry->init);
+
+	uk_pr_debug("Call init function: %p()...\n", call->entry->init);
+#if CONFIG_LIBUKBOOT_INITTAB_TIMING
+	call->start = ukplat_monotonic_clock();
+#endif
+	call->ret = call->entry->init();
+#if CONFIG_LIBUKBOOT_INITTAB_TIMING
+	call->end = ukplat_monotonic_clock();
+#endif
+	if (unlikely(call->ret < 0))
+		uk_pr_err("Init function at %p returned error %d\n",
+			  call->entry->init, call->ret);
+}
+
+#if CONFIG_LIBUKBOOT_INITTAB_PARALLEL
+static void inittab_thread_func(void *arg)
+{
+	inittab_call((struct inittab_call *)arg);
+}
+
+/*
+ * Runs a batch of init functions with the same class and priority. These do
+ * not depend on each other, so all but the first one get their own thread.
+ * The threads make progress whenever an init function blocks.
+ */
+static void inittab_call_batch(struct inittab_call *calls, unsigned int num)
+{
+	unsigned int i;
+
+	for (i = 1; i < num; i++)
+		calls[i].thread = uk_thread_create("inittab",
+						   inittab_thread_func,
+						   &calls[i]);
+
+	inittab_call(&calls[0]);
+
+	for (i = 1; i < num; i++) {
+		if (calls[i].thread)
+			uk_thread_wait(calls[i].thread);
+		else
+			inittab_call(&calls[i]);
+	}
+}
+#endif /* CONFIG_LIBUKBOOT_INITTAB_PARALLEL */
+
+#if CONFIG_LIBUKBOOT_INITTAB_TIMING
+static void inittab_print_timeline(const struct inittab_call *calls,
+				   unsigned int num, __nsec start, __nsec end)
+{
+	unsigned int i;
+
+	printf("Init table timeline (us):\n");
+	printf("%10s %10s %5s %4s  %s\n",
+	       "start", "duration", "class", "prio", "function");
+	for (i = 0; i < num; i++)
+		printf("%10"__PRInsec" %10"__PRInsec" %5u %4u  %p\n",
+		       (calls[i].start - start) / 1000,
+		       (calls[i].end - calls[i].start) / 1000,
+		       calls[i].entry->initclass, calls[i].entry->initprio,
+		       calls[i].entry->init);
+	printf("Init table completed in %"__PRInsec" us\n",
+	       (end - start) / 1000);
+	fflush(stdout);
+}
+#endif /* CONFIG_LIBUKBOOT_INITTAB_TIMING */
+
+#if CONFIG_LIBUKBOOT_INITTAB_TIMING || CONFIG_LIBUKBOOT_INITTAB_PARALLEL
+/* Runs the init table and keeps a record of every call */
+static int inittab_run_recorded(struct inittab_call *calls, unsigned int num)
+{
+	unsigned int i, j, k;
+#if CONFIG_LIBUKBOOT_INITTAB_TIMING
+	__nsec start = ukplat_monotonic_clock();
+#endif
+
+	for (i = 0; i < num; i++)
+		calls[i].entry = &uk_inittab_start[i];
+
+	for (i = 0; i < num; i = j) {
+		j = i + 1;
+#if CONFIG_LIBUKBOOT_INITTAB_PARALLEL
+		while (j < num &&
+		       calls[j].entry->initclass == calls[i].entry->initclass &&
+		       calls[j].entry->initprio == calls[i].entry->initprio)
+			j++;
+
+		inittab_call_batch(&calls[i], j - i);
+#else /* !CONFIG_LIBUKBOOT_INITTAB_PARALLEL */
+		inittab_call(&calls[i]);
+#endif /* !CONFIG_LIBUKBOOT_INITTAB_PARALLEL */
+
+		for (k = i; k < j; k++)
+			if (calls[k].ret < 0)
+				return calls[k].ret;
+	}
+
+#if CONFIG_LIBUKBOOT_INITTAB_TIMING
+	inittab_print_timeline(calls, num, start, ukplat_monotonic_clock());
+#endif
+	return 0;
+}
+#endif /* CONFIG_LIBUKBOOT_INITTAB_TIMING || CONFIG_LIBUKBOOT_INITTAB_PARALLEL */
+
+static int inittab_run(void)
+{
+	const struct uk_inittab_entry *itr;
+	struct inittab_call call;
+#if CONFIG_LIBUKBOOT_INITTAB_TIMING || CONFIG_LIBUKBOOT_INITTAB_PARALLEL
+	struct uk_alloc *a = uk_alloc_get_default();
+	struct inittab_call *calls = NULL;
+	unsigned int num;
+	int ret;
+
+	num = &uk_inittab_end - uk_inittab_start;
+	if (unlikely(num == 0))
+		return 0;
+
+	if (a)
+		calls = uk_calloc(a, num, sizeof(*calls));
+	if (likely(calls)) {
+		ret = inittab_run_recorded(calls, num);
+		uk_free(a, calls);
+		return ret;
+	}
+
+	uk_pr_warn("Could not allocate init table records, running init functions sequentially\n");
+#endif /* CONFIG_LIBUKBOOT_INITTAB_TIMING || CONFIG_LIBUKBOOT_INITTAB_PARALLEL */
+
+	uk_inittab_foreach(itr, uk_inittab_start, uk_inittab_end) {
+		call.entry = itr;
+		inittab_call(&call);
+		if (call.ret < 0)
+			return call.ret;
+	}
+
+	return 0;
+}
+
 static void main_thread_func(void *arg)
 {
 	int i;
 	int ret;
 	struct thread_main_arg *tma = arg;
 	uk_ctor_func_t *ctorfn;
-	uk_init_func_t *initfn;
 
 	/**
 	 * Run init table
 	 */
 	uk_pr_info("Init Table @ %p - %p\n",
 		   &uk_inittab_start[0], &uk_inittab_end);
-	uk_inittab_foreach(initfn, uk_inittab_start, uk_inittab_end) {
-		UK_ASSERT(*initfn);
-		uk_pr_debug("Call init function: %p()...\n", *initfn);
-		ret = (*initfn)();
-		if (ret < 0) {
-			uk_pr_err("Init function at %p returned error %d\n",
-				  *initfn, ret);
-			ret = UKPLAT_CRASH;
-			goto exit;
-		}
+	ret = inittab_run();
+	if (ret < 0) {
+		ret = UKPLAT_CRASH;
+		goto exit;
 	}
 
 #ifdef CONFIG_LIBUKSP
@@ -155,6 +309,10 @@ static void main_thread_func(void *arg)
 	uk_pr_info("main returned %d, halting system\n", ret);
 	ret = (ret != 0) ? UKPLAT_CRASH : UKPLAT_HALT;
 
+#if CONFIG_LIBSYSCALL_SHIM_PROFILE_DUMP
+	uk_syscall_prof_dump();
+#endif
+
 exit:
 	ukplat_terminate(ret); /* does not return */
 }
@@ -240,6 +398,8 @@ void ukplat_entry(int argc, char *argv[])
 			a = uk_allocbbuddy_init(md.base, md.len);
 #elif CONFIG_LIBUKBOOT_INITREGION
 			a = uk_allocregion_init(md.base, md.len);
+#elif CONFIG_LIBUKBOOT_INITUKALLOCTLSF
+			a = uk_alloctlsf_init(md.base, md.len);
 #elif CONFIG_LIBUKBOOT_INITMIMALLOC
 			a = uk_mimalloc_init(md.base, md.len);
 #elif CONFIG_LIBUKBOOT_INITTLSF
@@ -39,6 +39,7 @@
 #include <inttypes.h>
 #include <errno.h>
 
+#include <uk/config.h>
 #include <uk/assert.h>
 #include <uk/print.h>
 #include <uk/cpio.h>
@@ -47,6 +48,11 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#if CONFIG_LIBUKCPIO_ZEROCOPY
+#include <ramfs/ramfs.h>
+#include <vfscore/file.h>
+#include <vfscore/vnode.h>
+#endif
 
 /*
  * Currently only supports BSD new-style cpio archive format.
@@ -167,6 +173,41 @@ absolute_path(const char *prefix, const char *path)
 	return abs_path;
 }
 
+#if CONFIG_LIBUKCPIO_ZEROCOPY
+/**
+ * Makes the file behind fd reference its contents inside the archive.
+ *
+ * @param fd
+ *  File descriptor of the newly created, empty file.
+ * @param data
+ *  Location of the file contents in the archive.
+ * @param size
+ *  Size of the file contents.
+ * @return
+ *  Returns 0 on success, or an errno value if the file is not backed by
+ *  ramfs and the contents must be copied instead.
+ */
+static int
+reference_data(int fd, const char *data, uint32_t size)
+{
+	struct vfscore_file *fp;
+	struct vnode *vp;
+	int rc;
+
+	fp = vfscore_get_file(fd);
+	if (!fp)
+		return EBADF;
+
+	vp = fp->f_dentry->d_vnode;
+	vn_lock(vp);
+	rc = ramfs_set_file_data(vp, data, size);
+	vn_unlock(vp);
+
+	vfscore_put_file(fp);
+	return rc;
+}
+#endif /* CONFIG_LIBUKCPIO_ZEROCOPY */
+
 /**
  * Reads the section to the dest from a given a CPIO header.
  *
@@ -257,6 +298,11 @@ read_section(struct cpio_header **header_ptr,
 		bytes_to_write = header_filesize;
 		bytes_written = 0;
 
+#if CONFIG_LIBUKCPIO_ZEROCOPY
+		if (reference_data(fd, data_location, header_filesize) == 0)
+			bytes_to_write = 0;
+#endif
+
 		while (bytes_to_write > 0) {
 			bytes_written = write(fd, data_location + bytes_written,
 					      bytes_to_write);
@@ -59,6 +59,10 @@ enum ukcpio_error {
 /**
  * Extracts the given CPIO buffer to the path destination.
  *
+ * With CONFIG_LIBUKCPIO_ZEROCOPY, regular files created on ramfs reference
+ * their contents inside the buffer instead of copying them, in which case the
+ * buffer must not be released or reused afterwards.
+ *
  * @param dest
  *  The path location where the buffer will be extracted to.
  * @param buf
@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __UKARCH_TICKETLOCK_H__
+#define __UKARCH_TICKETLOCK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <uk/arch/lcpu.h>
+
+#ifdef CONFIG_HAVE_SMP
+#include <uk/arch/atomic.h>
+
+/* Unless you know what you are doing, use struct uk_spinlock instead. */
+typedef struct __ticketlock __ticketlock;
+
+/*
+ * Fair FIFO spinlock: each locker draws a ticket from `next` and waits
+ * until `current` reaches it. Unlike the test-and-set ukarch_spin_lock(),
+ * waiters are served in arrival order and only the owner writes `current`,
+ * so the lock word does not bounce between waiting CPUs on release.
+ */
+struct __align(4) __ticketlock {
+	__u16	current; /* currently served */
+	__u16	next;	 /* next available ticket */
+};
+
+/* Initialize a ticketlock to unlocked state */
+#define UKARCH_TICKETLOCK_INITIALIZER() { 0, 0 }
+
+static inline void ukarch_ticket_init(struct __ticketlock *lock)
+{
+	lock->next = 0;
+	lock->current = 0;
+}
+
+static inline void ukarch_ticket_lock(struct __ticketlock *lock)
+{
+	__u16 ticket;
+
+	ticket = __atomic_fetch_add(&lock->next, 1, __ATOMIC_RELAXED);
+	while (__atomic_load_n(&lock->current, __ATOMIC_ACQUIRE) != ticket)
+		ukarch_spinwait();
+}
+
+static inline void ukarch_ticket_unlock(struct __ticketlock *lock)
+{
+	__atomic_store_n(&lock->current, (__u16)(lock->current + 1),
+			 __ATOMIC_RELEASE);
+}
+
+static inline int ukarch_ticket_trylock(struct __ticketlock *lock)
+{
+	__u16 current;
+	__u16 next;
+
+	/* The lock is free only if the next ticket is the one being served */
+	current = __atomic_load_n(&lock->current, __ATOMIC_RELAXED);
+	next = current;
+	return __atomic_compare_exchange_n(&lock->next, &next,
+					   (__u16)(current + 1), 0,
+					   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline int ukarch_ticket_is_locked(struct __ticketlock *lock)
+{
+	return __atomic_load_n(&lock->next, __ATOMIC_RELAXED) !=
+	       __atomic_load_n(&lock->current, __ATOMIC_RELAXED);
+}
+
+#else /* CONFIG_HAVE_SMP */
+
+typedef struct __ticketlock {
+	/* empty */
+} __ticketlock;
+
+#define UKARCH_TICKETLOCK_INITIALIZER()	{}
+#define ukarch_ticket_init(lock)		(void)(lock)
+#define ukarch_ticket_lock(lock)		\
+	do { barrier(); (void)(lock); } while (0)
+#define ukarch_ticket_unlock(lock)	\
+	do { barrier(); (void)(lock); } while (0)
+#define ukarch_ticket_trylock(lock)	({ barrier(); (void)(lock); 1; })
+#define ukarch_ticket_is_locked(lock)	({ barrier(); (void)(lock); 0; })
+
+#endif /* CONFIG_HAVE_SMP */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UKARCH_TICKETLOCK_H__ */
@@ -0,0 +1,148 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __UK_MCSLOCK_H__
+#define __UK_MCSLOCK_H__
+
+#include <stddef.h>
+#include <uk/config.h>
+#include <uk/essentials.h>
+#include <uk/arch/lcpu.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * MCS queued spinlock
+ *
+ * Every locker brings its own queue node (usually on its stack) and spins
+ * only on that node, so a contended lock does not make all waiting CPUs
+ * hammer the same cache line. Waiters are served in FIFO order. The node
+ * passed to uk_mcslock_unlock() must be the one used to acquire the lock.
+ */
+struct uk_mcslock_node {
+	struct uk_mcslock_node *next;
+	int locked;
+};
+
+#ifdef CONFIG_HAVE_SMP
+#include <uk/arch/atomic.h>
+
+struct uk_mcslock {
+	struct uk_mcslock_node *tail;
+};
+
+#define UK_MCSLOCK_INITIALIZER() { NULL }
+
+static inline void uk_mcslock_init(struct uk_mcslock *lock)
+{
+	lock->tail = NULL;
+}
+
+static inline void uk_mcslock_lock(struct uk_mcslock *lock,
+				   struct uk_mcslock_node *node)
+{
+	struct uk_mcslock_node *prev;
+
+	node->next = NULL;
+	node->locked = 1;
+
+	prev = __atomic_exchange_n(&lock->tail, node, __ATOMIC_ACQ_REL);
+	if (!prev)
+		return;
+
+	/* Queue behind the previous tail and wait for it to hand over */
+	__atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+	while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE))
+		ukarch_spinwait();
+}
+
+static inline int uk_mcslock_trylock(struct uk_mcslock *lock,
+				     struct uk_mcslock_node *node)
+{
+	struct uk_mcslock_node *unlocked = NULL;
+
+	node->next = NULL;
+	node->locked = 0;
+
+	return __atomic_compare_exchange_n(&lock->tail, &unlocked, node, 0,
+					   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline void uk_mcslock_unlock(struct uk_mcslock *lock,
+				     struct uk_mcslock_node *node)
+{
+	struct uk_mcslock_node *next;
+	struct uk_mcslock_node *self = node;
+
+	next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+	if (!next) {
+		/* No known successor: try to mark the lock as free */
+		if (__atomic_compare_exchange_n(&lock->tail, &self, NULL, 0,
+						__ATOMIC_RELEASE,
+						__ATOMIC_RELAXED))
+			return;
+
+		/* A successor swapped the tail but did not link itself yet */
+		while (!(next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)))
+			ukarch_spinwait();
+	}
+
+	__atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+}
+
+static inline int uk_mcslock_is_locked(struct uk_mcslock *lock)
+{
+	return __atomic_load_n(&lock->tail, __ATOMIC_RELAXED) != NULL;
+}
+
+#else /* CONFIG_HAVE_SMP */
+
+struct uk_mcslock {
+	/* empty */
+};
+
+#define UK_MCSLOCK_INITIALIZER()	{}
+#define uk_mcslock_init(lock)		(void)(lock)
+#define uk_mcslock_lock(lock, node)	\
+	do { barrier(); (void)(lock); (void)(node); } while (0)
+#define uk_mcslock_unlock(lock, node)	\
+	do { barrier(); (void)(lock); (void)(node); } while (0)
+#define uk_mcslock_trylock(lock, node)	\
+	({ barrier(); (void)(lock); (void)(node); 1; })
+#define uk_mcslock_is_locked(lock)	({ barrier(); (void)(lock); 0; })
+
+#endif /* CONFIG_HAVE_SMP */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UK_MCSLOCK_H__ */
@@ -37,7 +37,11 @@
 
 #if CONFIG_LIBUKLOCK_MUTEX
 #include <uk/assert.h>
+#include <uk/essentials.h>
+#include <uk/arch/atomic.h>
+#include <uk/arch/lcpu.h>
 #include <uk/plat/lcpu.h>
+#include <uk/spinlock.h>
 #include <uk/thread.h>
 #include <uk/wait.h>
 #include <uk/wait_types.h>
@@ -55,13 +59,36 @@ extern "C" {
 /*
  * Mutex that relies on a scheduler
  * uses wait queues for threads
+ *
+ * Ownership is taken with an atomic compare-and-swap on `owner`, so the
+ * mutex can be shared between threads running on different CPUs. A
+ * contended lock first spins for CONFIG_LIBUKLOCK_MUTEX_SPIN iterations
+ * (the owner is likely to release it soon if it runs on another CPU) and
+ * then blocks on the wait queue. `wait_lock` serializes sleeping waiters
+ * against the wakeup done by unlock so that no wakeup can get lost.
  */
 struct uk_mutex {
 	int lock_count;
 	struct uk_thread *owner;
 	struct uk_waitq wait;
+	uk_spinlock wait_lock;
+#ifdef CONFIG_LIBUKLOCK_MUTEX_METRICS
+	__nsec locked_at;
+#endif /* CONFIG_LIBUKLOCK_MUTEX_METRICS */
 };
 
+/*
+ * The contention and hold-time histograms use logarithmic buckets:
+ * bucket 0 counts durations below 2^UK_MUTEX_METRICS_HIST_SHIFT ns,
+ * bucket i counts durations in [2^(SHIFT + i - 1), 2^(SHIFT + i)) ns, and
+ * the last bucket additionally collects everything above its lower bound.
+ * With 16 buckets and a shift of 10, the buckets go from below 1.024 us up
+ * to [16.8 ms, 33.6 ms). Durations of 33.6 ms and more also land in the
+ * last bucket.
+ */
+#define UK_MUTEX_METRICS_HIST_SHIFT	10
+#define UK_MUTEX_METRICS_HIST_BUCKETS	16
+
 /*
  * Mutex statistics for ukstore.
  */
@@ -79,6 +106,15 @@ struct uk_mutex_metrics {
 	size_t total_failed_trylocks;
 	/** Successful unlock operations since startup */
 	size_t total_unlocks;
+
+	/** Blocking lock operations that found the mutex owned by
+	 *  another thread since startup
+	 */
+	size_t total_contended;
+	/** Time spent waiting by contended lock operations */
+	size_t wait_hist[UK_MUTEX_METRICS_HIST_BUCKETS];
+	/** Time between acquiring a mutex and finally releasing it */
+	size_t hold_hist[UK_MUTEX_METRICS_HIST_BUCKETS];
 };
 
 #ifdef CONFIG_LIBUKLOCK_MUTEX_METRICS
@@ -87,108 +123,181 @@ struct uk_mutex_metrics {
  */
 extern struct uk_mutex_metrics _uk_mutex_metrics;
 extern __spinlock              _uk_mutex_metrics_lock;
+
+static inline unsigned int _uk_mutex_metrics_bucket(__nsec duration)
+{
+	unsigned int b;
+
+	if (duration < (1UL << UK_MUTEX_METRICS_HIST_SHIFT))
+		return 0;
+
+	b = ukarch_flsl(duration) - UK_MUTEX_METRICS_HIST_SHIFT + 1;
+	return MIN(b, UK_MUTEX_METRICS_HIST_BUCKETS - 1);
+}
 #endif /* CONFIG_LIBUKLOCK_MUTEX_METRICS */
 
 #define	UK_MUTEX_INITIALIZER(name)				\
-	{ 0, NULL, __WAIT_QUEUE_INITIALIZER((name).wait) }
+	{							\
+		.lock_count = 0,				\
+		.owner = NULL,					\
+		.wait = __WAIT_QUEUE_INITIALIZER((name).wait),	\
+		.wait_lock = UK_SPINLOCK_INITIALIZER(),		\
+	}
 
 void uk_mutex_init(struct uk_mutex *m);
 void uk_mutex_get_metrics(struct uk_mutex_metrics *dst);
 
+static inline int _uk_mutex_tryacquire(struct uk_mutex *m,
+				       struct uk_thread *current)
+{
+	struct uk_thread *unowned = NULL;
+
+	return __atomic_compare_exchange_n(&m->owner, &unowned, current, 0,
+					   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/* Slow path of uk_mutex_lock(): spin for a while, then sleep */
+static inline void _uk_mutex_wait(struct uk_mutex *m,
+				  struct uk_thread *current)
+{
+	uk_spinlock *wait_lock = &m->wait_lock;
+#if CONFIG_LIBUKLOCK_MUTEX_SPIN > 0
+	unsigned int spin;
+
+	for (spin = 0; spin < CONFIG_LIBUKLOCK_MUTEX_SPIN; spin++) {
+		ukarch_spinwait();
+		if (!__atomic_load_n(&m->owner, __ATOMIC_RELAXED) &&
+		    _uk_mutex_tryacquire(m, current))
+			return;
+	}
+#endif /* CONFIG_LIBUKLOCK_MUTEX_SPIN > 0 */
+
+	/* The wait condition takes ownership as soon as it becomes free */
+	uk_spin_lock(wait_lock);
+	uk_waitq_wait_event_locked(&m->wait,
+				   _uk_mutex_tryacquire(m, current),
+				   uk_spin_lock, uk_spin_unlock, wait_lock);
+	uk_spin_unlock(wait_lock);
+}
+
 static inline void uk_mutex_lock(struct uk_mutex *m)
 {
 	struct uk_thread *current;
-	unsigned long irqf;
+#ifdef CONFIG_LIBUKLOCK_MUTEX_METRICS
+	__nsec wait_start = 0;
+	int contended = 0;
+#endif /* CONFIG_LIBUKLOCK_MUTEX_METRICS */
 
 	UK_ASSERT(m);
 
 	current = uk_thread_current();
 
-	for (;;) {
-		uk_waitq_wait_event(&m->wait,
-			m->lock_count == 0 || m->owner == current);
-		irqf = ukplat_lcpu_save_irqf();
-		if (m->lock_count == 0 || m->owner == current)
-			break;
-		ukplat_lcpu_restore_irqf(irqf);
-	}
+	/* Only this thread can have stored itself as the owner */
+	if (__atomic_load_n(&m->owner, __ATOMIC_RELAXED) != current) {
+		if (unlikely(!_uk_mutex_tryacquire(m, current))) {
 #ifdef CONFIG_LIBUKLOCK_MUTEX_METRICS
-	ukarch_spin_lock(&_uk_mutex_metrics_lock);
+			contended = 1;
+			wait_start = ukplat_monotonic_clock();
 #endif /* CONFIG_LIBUKLOCK_MUTEX_METRICS */
+			_uk_mutex_wait(m, current);
+		}
+		UK_ASSERT(m->lock_count == 0);
+	}
 
 	m->lock_count++;
-	m->owner = current;
 
 #ifdef CONFIG_LIBUKLOCK_MUTEX_METRICS
+	if (m->lock_count == 1)
+		m->locked_at = ukplat_monotonic_clock();
+
+	ukarch_spin_lock(&_uk_mutex_metrics_lock);
+
 	_uk_mutex_metrics.active_locked   += (m->lock_count == 1);
 	_uk_mutex_metrics.active_unlocked -= (m->lock_count == 1);
 	_uk_mutex_metrics.total_locks++;
+	if (contended) {
+		_uk_mutex_metrics.total_contended++;
+		_uk_mutex_metrics.wait_hist[_uk_mutex_metrics_bucket(
+			m->locked_at - wait_start)]++;
+	}
 
 	ukarch_spin_unlock(&_uk_mutex_metrics_lock);
 #endif /* CONFIG_LIBUKLOCK_MUTEX_METRICS */
-	ukplat_lcpu_restore_irqf(irqf);
 }
 
 static inline int uk_mutex_trylock(struct uk_mutex *m)
 {
 	struct uk_thread *current;
-	unsigned long irqf;
 	int ret = 0;
 
 	UK_ASSERT(m);
 
 	current = uk_thread_current();
 
-	irqf = ukplat_lcpu_save_irqf();
-	if (m->lock_count == 0 || m->owner == current) {
+	if (__atomic_load_n(&m->owner, __ATOMIC_RELAXED) == current ||
+	    _uk_mutex_tryacquire(m, current)) {
 		ret = 1;
 		m->lock_count++;
-		m->owner = current;
 	}
 
 #ifdef CONFIG_LIBUKLOCK_MUTEX_METRICS
+	if (ret && m->lock_count == 1)
+		m->locked_at = ukplat_monotonic_clock();
+
+	ukarch_spin_lock(&_uk_mutex_metrics_lock);
+
 	_uk_mutex_metrics.active_locked += (ret == 1) && (m->lock_count == 1);
-	_uk_mutex_metrics.active_unlocked += (ret == 1) && (m->lock_count == 1);
+	_uk_mutex_metrics.active_unlocked -= (ret == 1) && (m->lock_count == 1);
 	_uk_mutex_metrics.total_ok_trylocks += ret;
 	_uk_mutex_metrics.total_failed_trylocks += !ret;
+
+	ukarch_spin_unlock(&_uk_mutex_metrics_lock);
 #endif /* CONFIG_LIBUKLOCK_MUTEX_METRICS */
 
-	ukplat_lcpu_restore_irqf(irqf);
 	return ret;
 }
 
 static inline int uk_mutex_is_locked(struct uk_mutex *m)
 {
-	return m->lock_count > 0;
+	return __atomic_load_n(&m->owner, __ATOMIC_RELAXED) != NULL;
 }
 
 static inline void uk_mutex_unlock(struct uk_mutex *m)
 {
-	unsigned long irqf;
+	uk_spinlock *wait_lock;
+#ifdef CONFIG_LIBUKLOCK_MUTEX_METRICS
+	int released = 0;
+	__nsec held = 0;
+#endif /* CONFIG_LIBUKLOCK_MUTEX_METRICS */
 
 	UK_ASSERT(m);
+	UK_ASSERT(m->lock_count > 0);
 
-	irqf = ukplat_lcpu_save_irqf();
-
+	if (--m->lock_count == 0) {
 #ifdef CONFIG_LIBUKLOCK_MUTEX_METRICS
-	ukarch_spin_lock(&_uk_mutex_metrics_lock);
+		held = ukplat_monotonic_clock() - m->locked_at;
+		released = 1;
 #endif /* CONFIG_LIBUKLOCK_MUTEX_METRICS */
+		wait_lock = &m->wait_lock;
 
-	UK_ASSERT(m->lock_count > 0);
-	if (--m->lock_count == 0) {
-		m->owner = NULL;
+		uk_spin_lock(wait_lock);
+		__atomic_store_n(&m->owner, NULL, __ATOMIC_RELEASE);
 		uk_waitq_wake_up(&m->wait);
+		uk_spin_unlock(wait_lock);
 	}
 
 #ifdef CONFIG_LIBUKLOCK_MUTEX_METRICS
-	_uk_mutex_metrics.active_locked   -= (m->lock_count == 0);
-	_uk_mutex_metrics.active_unlocked += (m->lock_count == 0);
+	ukarch_spin_lock(&_uk_mutex_metrics_lock);
+
+	/* `m` may already be owned by another thread: use `released` */
+	_uk_mutex_metrics.active_locked   -= released;
+	_uk_mutex_metrics.active_unlocked += released;
 	_uk_mutex_metrics.total_unlocks++;
+	if (released)
+		_uk_mutex_metrics.hold_hist[_uk_mutex_metrics_bucket(held)]++;
 
 	ukarch_spin_unlock(&_uk_mutex_metrics_lock);
 #endif /* CONFIG_LIBUKLOCK_MUTEX_METRICS */
-
-	ukplat_lcpu_restore_irqf(irqf);
 }
 
 #define uk_waitq_wait_event_mutex(wq, condition, mutex) \
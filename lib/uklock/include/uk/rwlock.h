@@ -0,0 +1,184 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __UK_RWLOCK_H__
+#define __UK_RWLOCK_H__
+
+#include <uk/config.h>
+
+#if CONFIG_LIBUKLOCK_RWLOCK
+#include <uk/assert.h>
+#include <uk/essentials.h>
+#include <uk/arch/atomic.h>
+#include <uk/spinlock.h>
+#include <uk/thread.h>
+#include <uk/wait.h>
+#include <uk/wait_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Reader-writer lock that relies on a scheduler
+ * uses wait queues for threads
+ *
+ * `state` holds the number of readers, or UK_RWLOCK_WRITER while a writer
+ * owns the lock; both sides acquire it with an atomic compare-and-swap.
+ * Writers are preferred: new readers back off while a writer waits, so a
+ * steady stream of readers cannot starve it. Consequently, the lock is not
+ * recursive, not even for readers.
+ */
+struct uk_rwlock {
+	int state;
+	unsigned int write_waiters;
+	struct uk_waitq wait;
+	uk_spinlock wait_lock;
+};
+
+#define UK_RWLOCK_WRITER	(-1)
+
+#define UK_RWLOCK_INITIALIZER(name)				\
+	{ 0, 0, __WAIT_QUEUE_INITIALIZER((name).wait),		\
+	  UK_SPINLOCK_INITIALIZER() }
+
+void uk_rwlock_init(struct uk_rwlock *rw);
+
+static inline int uk_rwlock_tryrlock(struct uk_rwlock *rw)
+{
+	int state;
+
+	UK_ASSERT(rw);
+
+	state = __atomic_load_n(&rw->state, __ATOMIC_RELAXED);
+	while (state >= 0 &&
+	       !__atomic_load_n(&rw->write_waiters, __ATOMIC_RELAXED)) {
+		if (__atomic_compare_exchange_n(&rw->state, &state, state + 1,
+						0, __ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			return 1;
+	}
+	return 0;
+}
+
+static inline int uk_rwlock_trywlock(struct uk_rwlock *rw)
+{
+	int unlocked = 0;
+
+	UK_ASSERT(rw);
+
+	return __atomic_compare_exchange_n(&rw->state, &unlocked,
+					   UK_RWLOCK_WRITER, 0,
+					   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline void uk_rwlock_rlock(struct uk_rwlock *rw)
+{
+	uk_spinlock *wait_lock;
+
+	if (likely(uk_rwlock_tryrlock(rw)))
+		return;
+
+	wait_lock = &rw->wait_lock;
+	uk_spin_lock(wait_lock);
+	uk_waitq_wait_event_locked(&rw->wait, uk_rwlock_tryrlock(rw),
+				   uk_spin_lock, uk_spin_unlock, wait_lock);
+	uk_spin_unlock(wait_lock);
+}
+
+static inline void uk_rwlock_wlock(struct uk_rwlock *rw)
+{
+	uk_spinlock *wait_lock;
+
+	if (likely(uk_rwlock_trywlock(rw)))
+		return;
+
+	wait_lock = &rw->wait_lock;
+	uk_spin_lock(wait_lock);
+	__atomic_fetch_add(&rw->write_waiters, 1, __ATOMIC_RELAXED);
+	uk_waitq_wait_event_locked(&rw->wait, uk_rwlock_trywlock(rw),
+				   uk_spin_lock, uk_spin_unlock, wait_lock);
+	__atomic_fetch_sub(&rw->write_waiters, 1, __ATOMIC_RELAXED);
+	uk_spin_unlock(wait_lock);
+}
+
+static inline void _uk_rwlock_wake(struct uk_rwlock *rw)
+{
+	uk_spin_lock(&rw->wait_lock);
+	uk_waitq_wake_up(&rw->wait);
+	uk_spin_unlock(&rw->wait_lock);
+}
+
+static inline void uk_rwlock_runlock(struct uk_rwlock *rw)
+{
+	UK_ASSERT(rw);
+	UK_ASSERT(rw->state > 0);
+
+	/* Only the last reader can let a writer in */
+	if (__atomic_sub_fetch(&rw->state, 1, __ATOMIC_RELEASE) == 0)
+		_uk_rwlock_wake(rw);
+}
+
+static inline void uk_rwlock_wunlock(struct uk_rwlock *rw)
+{
+	UK_ASSERT(rw);
+	UK_ASSERT(rw->state == UK_RWLOCK_WRITER);
+
+	__atomic_store_n(&rw->state, 0, __ATOMIC_RELEASE);
+	_uk_rwlock_wake(rw);
+}
+
+/* Turns a write lock into a read lock without letting another writer in */
+static inline void uk_rwlock_downgrade(struct uk_rwlock *rw)
+{
+	UK_ASSERT(rw);
+	UK_ASSERT(rw->state == UK_RWLOCK_WRITER);
+
+	__atomic_store_n(&rw->state, 1, __ATOMIC_RELEASE);
+	_uk_rwlock_wake(rw);
+}
+
+static inline int uk_rwlock_is_locked(struct uk_rwlock *rw)
+{
+	return __atomic_load_n(&rw->state, __ATOMIC_RELAXED) != 0;
+}
+
+static inline int uk_rwlock_is_wlocked(struct uk_rwlock *rw)
+{
+	return __atomic_load_n(&rw->state, __ATOMIC_RELAXED) ==
+	       UK_RWLOCK_WRITER;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_LIBUKLOCK_RWLOCK */
+
+#endif /* __UK_RWLOCK_H__ */
@@ -58,8 +58,10 @@ extern "C" {
 
 #ifndef uk_spinlock
 
-#ifdef CONFIG_ARCH_ARM_64
+#if defined CONFIG_ARCH_ARM_64
 #include <uk/arch/arm64/ticketlock.h>
+#elif defined CONFIG_ARCH_X86_64
+#include <uk/arch/x86_64/ticketlock.h>
 #endif
 
 #define uk_spinlock __ticketlock
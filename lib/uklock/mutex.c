@@ -13,6 +13,7 @@ void uk_mutex_init(struct uk_mutex *m)
 	m->lock_count = 0;
 	m->owner = NULL;
 	uk_waitq_init(&m->wait);
+	uk_spin_init(&m->wait_lock);
 
 #ifdef CONFIG_LIBUKLOCK_MUTEX_METRICS
 	ukarch_spin_lock(&_uk_mutex_metrics_lock);
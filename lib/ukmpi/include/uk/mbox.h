@@ -56,6 +56,11 @@ int uk_mbox_post_try(struct uk_mbox *m, void *msg);
 __nsec uk_mbox_post_to(struct uk_mbox *m, void *msg, __nsec timeout);
 
 void uk_mbox_recv(struct uk_mbox *m, void **msg);
+/* Blocks until at least one message arrives, then fetches up to `count`
+ * messages into `msgs`. Returns the number of fetched messages.
+ */
+unsigned int uk_mbox_recv_batch(struct uk_mbox *m, void **msgs,
+				unsigned int count);
 int uk_mbox_recv_try(struct uk_mbox *m, void **msg);
 __nsec uk_mbox_recv_to(struct uk_mbox *m, void **msg, __nsec timeout);
 
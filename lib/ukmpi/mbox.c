@@ -91,6 +91,22 @@ void uk_mbox_recv(struct uk_mbox *m, void **msg)
 }
 
 
+unsigned int uk_mbox_recv_batch(struct uk_mbox *m, void **msgs,
+				unsigned int count)
+{
+	unsigned int n;
+
+	UK_ASSERT(m);
+	UK_ASSERT(msgs);
+	UK_ASSERT(count > 0);
+
+	uk_semaphore_down(&m->readsem);
+	msgs[0] = _do_mbox_recv(m);
+	for (n = 1; n < count && uk_semaphore_down_try(&m->readsem); n++)
+		msgs[n] = _do_mbox_recv(m);
+	return n;
+}
+
 /* This is similar to uk_mbox_fetch, however if a message is not
  * present in the mailbox, it immediately returns with the code
  * SYS_MBOX_EMPTY. On success 0 is returned.
@@ -0,0 +1,182 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/mbox.h>
+#include <uk/assert.h>
+#include <uk/plat/time.h>
+#include "mbox_ring_defs.h"
+
+struct uk_mbox *uk_mbox_create(struct uk_alloc *a, size_t size)
+{
+	struct uk_mbox *m;
+	int count = 1;
+
+	UK_ASSERT(size <= (1UL << 30));
+
+	/* uk_ring needs a power-of-two number of slots, so the mailbox may
+	 * hold slightly more messages than requested
+	 */
+	while ((size_t) count < size)
+		count <<= 1;
+
+	m = uk_malloc(a, sizeof(*m));
+	if (!m)
+		return NULL;
+
+	m->ring = uk_ring_alloc(count, a
+#ifdef DEBUG_BUFRING
+				, NULL
+#endif
+		);
+	if (!m->ring) {
+		uk_free(a, m);
+		return NULL;
+	}
+
+	uk_waitq_init(&m->readq);
+	uk_waitq_init(&m->writeq);
+
+	uk_pr_debug("Created mailbox %p\n", m);
+	return m;
+}
+
+/* Deallocates a mailbox. If there are messages still present in the
+ * mailbox when the mailbox is deallocated, it is an indication of a
+ * programming error in lwIP and the developer should be notified.
+ */
+void uk_mbox_free(struct uk_alloc *a, struct uk_mbox *m)
+{
+	uk_pr_debug("Release mailbox %p\n", m);
+
+	UK_ASSERT(a);
+	UK_ASSERT(m);
+	UK_ASSERT(uk_ring_empty(m->ring));
+	UK_ASSERT(uk_waitq_empty(&m->readq));
+	UK_ASSERT(uk_waitq_empty(&m->writeq));
+
+	uk_ring_free(m->ring, a);
+	uk_free(a, m);
+}
+
+void uk_mbox_post(struct uk_mbox *m, void *msg)
+{
+	UK_ASSERT(m);
+
+	while (_do_mbox_post_try(m, msg) < 0)
+		uk_waitq_wait_event(&m->writeq, !uk_ring_full(m->ring));
+}
+
+int uk_mbox_post_try(struct uk_mbox *m, void *msg)
+{
+	UK_ASSERT(m);
+
+	return _do_mbox_post_try(m, msg);
+}
+
+__nsec uk_mbox_post_to(struct uk_mbox *m, void *msg, __nsec timeout)
+{
+	__nsec then = ukplat_monotonic_clock();
+	__nsec deadline = then + timeout;
+
+	UK_ASSERT(m);
+
+	while (_do_mbox_post_try(m, msg) < 0) {
+		if (uk_waitq_wait_event_deadline(&m->writeq,
+						 !uk_ring_full(m->ring),
+						 deadline))
+			return __NSEC_MAX;
+	}
+	return ukplat_monotonic_clock() - then;
+}
+
+void uk_mbox_recv(struct uk_mbox *m, void **msg)
+{
+	void *rmsg;
+
+	UK_ASSERT(m);
+
+	while (!_do_mbox_recv_try(m, &rmsg, 1))
+		uk_waitq_wait_event(&m->readq, !uk_ring_empty(m->ring));
+	if (msg)
+		*msg = rmsg;
+}
+
+unsigned int uk_mbox_recv_batch(struct uk_mbox *m, void **msgs,
+				unsigned int count)
+{
+	unsigned int n;
+
+	UK_ASSERT(m);
+	UK_ASSERT(msgs);
+	UK_ASSERT(count > 0);
+
+	while (!(n = _do_mbox_recv_try(m, msgs, count)))
+		uk_waitq_wait_event(&m->readq, !uk_ring_empty(m->ring));
+	return n;
+}
+
+int uk_mbox_recv_try(struct uk_mbox *m, void **msg)
+{
+	void *rmsg;
+
+	UK_ASSERT(m);
+
+	if (!_do_mbox_recv_try(m, &rmsg, 1))
+		return -ENOMSG;
+	if (msg)
+		*msg = rmsg;
+	return 0;
+}
+
+__nsec uk_mbox_recv_to(struct uk_mbox *m, void **msg, __nsec timeout)
+{
+	__nsec then = ukplat_monotonic_clock();
+	__nsec deadline = then + timeout;
+	void *rmsg = NULL;
+	__nsec ret;
+
+	UK_ASSERT(m);
+
+	ret = 0;
+	while (!_do_mbox_recv_try(m, &rmsg, 1)) {
+		if (uk_waitq_wait_event_deadline(&m->readq,
+						 !uk_ring_empty(m->ring),
+						 deadline)) {
+			ret = __NSEC_MAX;
+			break;
+		}
+	}
+	if (ret != __NSEC_MAX)
+		ret = ukplat_monotonic_clock() - then;
+
+	if (msg)
+		*msg = rmsg;
+	return ret;
+}
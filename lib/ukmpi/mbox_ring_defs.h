@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __MBOX_RING_DEFS_H__
+#define __MBOX_RING_DEFS_H__
+
+#include <uk/ring.h>
+#include <uk/wait.h>
+#include <uk/print.h>
+#include <uk/plat/lcpu.h>
+
+/*
+ * NOTE: The definitions below are included by both isr-safe and normal
+ * compilation units. Moving one of the inline functions from this file
+ * requires special care.
+ */
+
+/*
+ * Messages are kept in a lock-free ring. The wait queues are only used by
+ * threads that found the mailbox empty (readq) or full (writeq), so posting
+ * and receiving do not need to touch them as long as nobody is waiting.
+ */
+struct uk_mbox {
+	struct uk_ring *ring;
+	struct uk_waitq readq;
+	struct uk_waitq writeq;
+};
+
+static inline void _do_mbox_wake(struct uk_waitq *wq)
+{
+	/* Make the ring update visible before looking for waiters. A waiter
+	 * rechecks the ring after it queued itself.
+	 */
+	mb();
+	if (!uk_waitq_empty(wq))
+		uk_waitq_wake_up(wq);
+}
+
+/*
+ * The ring operations run with interrupts disabled so that an interrupt
+ * handler using the same mailbox never spins on a slot reservation of the
+ * thread that it interrupted.
+ */
+static inline int _do_mbox_post_try(struct uk_mbox *m, void *msg)
+{
+	unsigned long irqf;
+	int ret;
+
+	irqf = ukplat_lcpu_save_irqf();
+	ret = uk_ring_enqueue(m->ring, msg);
+	ukplat_lcpu_restore_irqf(irqf);
+	if (unlikely(ret < 0))
+		return ret;
+
+	uk_pr_debug("Posted message %p to mailbox %p\n", msg, m);
+	_do_mbox_wake(&m->readq);
+	return 0;
+}
+
+/*
+ * Fetch up to `count` messages from a mailbox without blocking. Returns the
+ * number of fetched messages.
+ */
+static inline unsigned int _do_mbox_recv_try(struct uk_mbox *m, void **msgs,
+					     unsigned int count)
+{
+	unsigned long irqf;
+	unsigned int n;
+
+	irqf = ukplat_lcpu_save_irqf();
+	n = uk_ring_dequeue_burst_mc(m->ring, msgs, count);
+	ukplat_lcpu_restore_irqf(irqf);
+	if (!n)
+		return 0;
+
+	uk_pr_debug("Received %u message(s) from mailbox %p\n", n, m);
+	_do_mbox_wake(&m->writeq);
+	return n;
+}
+
+#endif /* __MBOX_RING_DEFS_H__ */
@@ -0,0 +1,171 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __UK_NETBUFPOOL_H__
+#define __UK_NETBUFPOOL_H__
+
+#include <stdint.h>
+#include <uk/alloc.h>
+#include <uk/netbuf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct uk_netbufpool;
+
+/**
+ * Pool occupancy counters
+ */
+struct uk_netbufpool_stats {
+	unsigned int total;     /**< Number of netbufs in the pool */
+	unsigned int inuse;     /**< Number of netbufs currently taken */
+	unsigned int peak;      /**< Highest `inuse` value seen so far */
+	__u64 exhausted;        /**< Number of requested but unserved netbufs */
+};
+
+/**
+ * Allocates a pool of netbufs on a parent allocator.
+ * The whole pool is allocated at once, so taking and recycling
+ * netbufs later never reaches the parent allocator.
+ * Each pool object contains the buffer area followed by
+ * `struct uk_netbuf` and the private data area (see
+ * uk_netbuf_prepare_buf()). On the last uk_netbuf_free(), the netbuf is
+ * given back to the pool.
+ * Note: The pool does not do any locking, callers have to make sure that
+ *       it is not accessed concurrently.
+ *
+ * @param a
+ *   Parent allocator for the pool.
+ * @param count
+ *   Number of netbufs in the pool.
+ * @param buflen
+ *   Size of the buffer area of each netbuf (including headroom).
+ * @param bufalign
+ *   Alignment for the buffer area. The buffer area is always at least
+ *   aligned to a cache line.
+ * @param headroom
+ *   Number of bytes reserved as headroom from the buffer area.
+ *   `headroom` has to be smaller or equal to `buflen`.
+ * @param privlen
+ *   Length for reserved memory to store private data for each netbuf.
+ * @returns
+ *   - (NULL): Allocation failed
+ *   - pointer to the netbuf pool
+ */
+struct uk_netbufpool *uk_netbufpool_alloc(struct uk_alloc *a,
+					  unsigned int count,
+					  size_t buflen, size_t bufalign,
+					  uint16_t headroom, size_t privlen);
+
+/**
+ * Frees a netbuf pool that was allocated with uk_netbufpool_alloc().
+ * All netbufs have to be returned to the pool before.
+ *
+ * @param p
+ *   Pointer to the netbuf pool.
+ */
+void uk_netbufpool_free(struct uk_netbufpool *p);
+
+/**
+ * Takes a netbuf from the pool. The netbuf is initialized
+ * like one returned by uk_netbuf_alloc_buf().
+ *
+ * @param p
+ *   Pointer to the netbuf pool.
+ * @returns
+ *   - (NULL): Pool exhausted
+ *   - initialized uk_netbuf
+ */
+struct uk_netbuf *uk_netbufpool_take(struct uk_netbufpool *p);
+
+/**
+ * Takes multiple netbufs from the pool.
+ *
+ * @param p
+ *   Pointer to the netbuf pool.
+ * @param nb
+ *   Array that is filled with the taken netbufs.
+ * @param count
+ *   Maximum number of netbufs to take.
+ * @returns
+ *   Number of netbufs placed on `nb`.
+ */
+unsigned int uk_netbufpool_take_batch(struct uk_netbufpool *p,
+				      struct uk_netbuf *nb[],
+				      unsigned int count);
+
+/**
+ * Releases a reference of multiple netbufs of the same pool. Netbufs that
+ * lose their last reference are returned to the pool in a single batch.
+ * Unlike uk_netbuf_free(), only single netbufs (no chains) are accepted.
+ *
+ * @param p
+ *   Pointer to the netbuf pool that the netbufs were taken from.
+ * @param nb
+ *   Array of netbufs.
+ * @param count
+ *   Number of netbufs on `nb`.
+ */
+void uk_netbufpool_free_batch(struct uk_netbufpool *p,
+			      struct uk_netbuf *nb[], unsigned int count);
+
+/**
+ * Receive buffer allocator for uknetdev that can be used as
+ * `rx_conf->alloc_rxpkts` callback. `argp` has to point to the
+ * netbuf pool (`rx_conf->alloc_rxpkts_argp`).
+ */
+uint16_t uk_netbufpool_alloc_rxpkts(void *argp, struct uk_netbuf *pkts[],
+				    uint16_t count);
+
+/**
+ * Returns the number of netbufs that are currently available.
+ *
+ * @param p
+ *   Pointer to the netbuf pool.
+ */
+unsigned int uk_netbufpool_availcount(struct uk_netbufpool *p);
+
+/**
+ * Retrieves the occupancy counters of a pool.
+ *
+ * @param p
+ *   Pointer to the netbuf pool.
+ * @param stats
+ *   Structure that is filled with the current counter values.
+ */
+void uk_netbufpool_stats(struct uk_netbufpool *p,
+			 struct uk_netbufpool_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UK_NETBUFPOOL_H__ */
@@ -0,0 +1,256 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <uk/config.h>
+#include <uk/netbufpool.h>
+#include <uk/allocpool.h>
+#include <uk/refcount.h>
+#include <uk/arch/lcpu.h>
+#include <uk/essentials.h>
+#include <uk/assert.h>
+#include <uk/print.h>
+
+/* Same alignment that is applied by lib/uknetdev to netbuf areas */
+#define NBPOOL_ALIGN		(sizeof(long long))
+
+/* Number of netbufs that uk_netbufpool_free_batch() returns at once */
+#define NBPOOL_RETURN_BATCH	32
+
+struct uk_netbufpool {
+	struct uk_allocpool *ap;
+	struct uk_alloc *a;
+
+	__sz objlen;
+	__sz privlen;
+	uint16_t headroom;
+
+	unsigned int total;
+	unsigned int peak;
+	__u64 exhausted;
+};
+
+/* Hidden per-netbuf metadata, placed in front of the user's private data */
+struct nbpool_meta {
+	struct uk_netbufpool *p;
+	void *obj;
+};
+
+#define NBPOOL_META_LEN ALIGN_UP(sizeof(struct nbpool_meta), NBPOOL_ALIGN)
+
+static inline struct nbpool_meta *nbpool_meta(struct uk_netbuf *m)
+{
+	/* uk_netbuf_prepare_buf() places the private area right after `m` */
+	return (struct nbpool_meta *) ((__uptr) m + sizeof(*m));
+}
+
+static void nbpool_dtor(struct uk_netbuf *m)
+{
+	struct nbpool_meta *meta = nbpool_meta(m);
+
+	uk_allocpool_return(meta->p->ap, meta->obj);
+}
+
+static inline struct uk_netbuf *nbpool_prepare(struct uk_netbufpool *p,
+					       void *obj)
+{
+	struct nbpool_meta *meta;
+	struct uk_netbuf *m;
+
+	m = uk_netbuf_prepare_buf(obj, p->objlen, p->headroom,
+				  NBPOOL_META_LEN + p->privlen, nbpool_dtor);
+	UK_ASSERT(m);
+
+	meta = nbpool_meta(m);
+	meta->p = p;
+	meta->obj = obj;
+	m->priv = (p->privlen > 0)
+		  ? (void *) ((__uptr) meta + NBPOOL_META_LEN) : NULL;
+	return m;
+}
+
+static inline void nbpool_account(struct uk_netbufpool *p,
+				  unsigned int requested, unsigned int taken)
+{
+	unsigned int inuse;
+
+	if (unlikely(taken < requested))
+		p->exhausted += requested - taken;
+
+	inuse = p->total - uk_allocpool_availcount(p->ap);
+	if (inuse > p->peak)
+		p->peak = inuse;
+}
+
+struct uk_netbufpool *uk_netbufpool_alloc(struct uk_alloc *a,
+					  unsigned int count,
+					  size_t buflen, size_t bufalign,
+					  uint16_t headroom, size_t privlen)
+{
+	struct uk_netbufpool *p;
+
+	UK_ASSERT(a);
+	UK_ASSERT(count > 0);
+	UK_ASSERT(buflen > 0);
+	UK_ASSERT(headroom <= buflen);
+	UK_ASSERT(!bufalign || POWER_OF_2(bufalign));
+
+	p = uk_malloc(a, sizeof(*p));
+	if (!p)
+		return NULL;
+
+	p->a = a;
+	p->headroom = headroom;
+	p->privlen = privlen;
+	p->objlen = ALIGN_UP(buflen, NBPOOL_ALIGN)
+		    + ALIGN_UP(sizeof(struct uk_netbuf) + NBPOOL_META_LEN
+			       + privlen, NBPOOL_ALIGN);
+	p->peak = 0;
+	p->exhausted = 0;
+
+	/* Buffers start on a cache line so that DMA and the header parsing
+	 * of one packet never share a line with a neighbouring netbuf.
+	 */
+	p->ap = uk_allocpool_alloc(a, count, p->objlen,
+				   MAX(bufalign, (size_t) CACHE_LINE_SIZE));
+	if (!p->ap) {
+		uk_free(a, p);
+		return NULL;
+	}
+	p->total = uk_allocpool_availcount(p->ap);
+	UK_ASSERT(p->total >= count);
+
+	uk_pr_debug("%p: Pool of %u netbufs (%"__PRIsz" bytes each)\n",
+		    p, p->total, p->objlen);
+	return p;
+}
+
+void uk_netbufpool_free(struct uk_netbufpool *p)
+{
+	UK_ASSERT(p);
+
+	/* Make sure we got all netbufs back */
+	UK_ASSERT(uk_allocpool_availcount(p->ap) == p->total);
+
+	uk_allocpool_free(p->ap);
+	uk_free(p->a, p);
+}
+
+struct uk_netbuf *uk_netbufpool_take(struct uk_netbufpool *p)
+{
+	void *obj;
+
+	UK_ASSERT(p);
+
+	obj = uk_allocpool_take(p->ap);
+	nbpool_account(p, 1, obj ? 1 : 0);
+	if (unlikely(!obj))
+		return NULL;
+
+	return nbpool_prepare(p, obj);
+}
+
+unsigned int uk_netbufpool_take_batch(struct uk_netbufpool *p,
+				      struct uk_netbuf *nb[],
+				      unsigned int count)
+{
+	unsigned int i, taken;
+
+	UK_ASSERT(p);
+	UK_ASSERT(nb || count == 0);
+
+	/* The array is first filled with the raw pool objects, each slot is
+	 * then replaced by the netbuf prepared on that object.
+	 */
+	taken = uk_allocpool_take_batch(p->ap, (void **) nb, count);
+	for (i = 0; i < taken; ++i)
+		nb[i] = nbpool_prepare(p, (void *) nb[i]);
+
+	nbpool_account(p, count, taken);
+	return taken;
+}
+
+void uk_netbufpool_free_batch(struct uk_netbufpool *p,
+			      struct uk_netbuf *nb[], unsigned int count)
+{
+	void *obj[NBPOOL_RETURN_BATCH];
+	struct nbpool_meta *meta;
+	unsigned int i, n = 0;
+
+	UK_ASSERT(p);
+	UK_ASSERT(nb || count == 0);
+
+	for (i = 0; i < count; ++i) {
+		UK_ASSERT(nb[i]);
+		UK_ASSERT(!nb[i]->next && !nb[i]->prev);
+		UK_ASSERT(nb[i]->dtor == nbpool_dtor);
+
+		if (uk_refcount_release(&nb[i]->refcount) != 1)
+			continue;
+
+		meta = nbpool_meta(nb[i]);
+		UK_ASSERT(meta->p == p);
+
+		obj[n++] = meta->obj;
+		if (n == NBPOOL_RETURN_BATCH) {
+			uk_allocpool_return_batch(p->ap, obj, n);
+			n = 0;
+		}
+	}
+
+	if (n)
+		uk_allocpool_return_batch(p->ap, obj, n);
+}
+
+uint16_t uk_netbufpool_alloc_rxpkts(void *argp, struct uk_netbuf *pkts[],
+				    uint16_t count)
+{
+	return (uint16_t) uk_netbufpool_take_batch(
+				(struct uk_netbufpool *) argp, pkts, count);
+}
+
+unsigned int uk_netbufpool_availcount(struct uk_netbufpool *p)
+{
+	UK_ASSERT(p);
+
+	return uk_allocpool_availcount(p->ap);
+}
+
+void uk_netbufpool_stats(struct uk_netbufpool *p,
+			 struct uk_netbufpool_stats *stats)
+{
+	UK_ASSERT(p);
+	UK_ASSERT(stats);
+
+	stats->total     = p->total;
+	stats->inuse     = p->total - uk_allocpool_availcount(p->ap);
+	stats->peak      = p->peak;
+	stats->exhausted = p->exhausted;
+}
@@ -45,15 +45,32 @@
 #define critical_enter()  uk_preempt_disable()
 #define critical_exit()   uk_preempt_enable()
 
-
+/*
+ * Producer and consumer each own a head and a tail index. Heads are moved
+ * to reserve slots, tails are moved to publish them to the other side once
+ * the slots are written (producer) or read (consumer). Indexes are
+ * free-running and only masked to access the slots, so all `size` slots can
+ * be used and distances are computed with unsigned wrap-around.
+ *
+ * Memory ordering follows the C11 model: a tail is stored with release
+ * semantics after the slots were accessed, and the other side loads it with
+ * acquire semantics before accessing the slots. This is sufficient on
+ * weakly-ordered architectures like arm64 without further barriers.
+ *
+ * Multi-producer (multi-consumer) operations reserve slots with a CAS on the
+ * head and then wait for preceding operations of the same side to publish.
+ * Single-producer (single-consumer) operations must be serialized by the
+ * caller, e.g., by a lock or by having exactly one producer thread. They get
+ * along without atomic read-modify-write operations.
+ */
 struct uk_ring {
-	volatile uint32_t br_prod_head;
-	volatile uint32_t br_prod_tail;
+	uint32_t          br_prod_head;
+	uint32_t          br_prod_tail;
 	int               br_prod_size;
 	int               br_prod_mask;
 	uint64_t          br_drops;
-	volatile uint32_t br_cons_head __aligned(CACHE_LINE_SIZE);
-	volatile uint32_t br_cons_tail;
+	uint32_t          br_cons_head __aligned(CACHE_LINE_SIZE);
+	uint32_t          br_cons_tail;
 	int               br_cons_size;
 	int               br_cons_mask;
 #ifdef DEBUG_BUFRING
@@ -62,178 +79,256 @@ struct uk_ring {
 	void             *br_ring[0] __aligned(CACHE_LINE_SIZE);
 };
 
-/*
- * multi-producer safe lock-free ring buffer enqueue
- *
- */
-static __inline int
-uk_ring_enqueue(struct uk_ring *br, void *buf)
+/* NOTE: Please do not use this function directly */
+static __inline unsigned int
+_uk_ring_enqueue(struct uk_ring *br, void *const *bufs, unsigned int n,
+		 int fixed, int sp)
 {
-	uint32_t prod_head, prod_next, cons_tail;
+	uint32_t prod_head, prod_next, cons_tail, free;
+	unsigned int i;
 #ifdef DEBUG_BUFRING
-	int i;
+	uint32_t j;
 
 	/*
 	 * Note: It is possible to encounter an mbuf that was removed
 	 * via drbr_peek(), and then re-added via drbr_putback() and
 	 * trigger a spurious panic.
 	 */
-	for (i = br->br_cons_head; i != br->br_prod_head;
-			 i = ((i + 1) & br->br_cons_mask))
-		if (br->br_ring[i] == buf)
-			UK_CRASH("buf=%p already enqueue at %d prod=%d cons=%d",
-					buf, i, br->br_prod_tail, br->br_cons_tail);
+	for (i = 0; i < n; i++)
+		for (j = br->br_cons_head; j != br->br_prod_head; j++)
+			if (br->br_ring[j & br->br_prod_mask] == bufs[i])
+				UK_CRASH("buf=%p already enqueue at %d "
+					 "prod=%d cons=%d", bufs[i], j,
+					 br->br_prod_tail,
+					 br->br_cons_tail);
 #endif
 	critical_enter();
+	prod_head = __atomic_load_n(&br->br_prod_head, __ATOMIC_RELAXED);
 	do {
-		prod_head = br->br_prod_head;
-		prod_next = (prod_head + 1) & br->br_prod_mask;
-		cons_tail = br->br_cons_tail;
-
-		if (prod_next == cons_tail) {
-			rmb();
-			if (prod_head == br->br_prod_head && cons_tail == br->br_cons_tail) {
-				br->br_drops++;
+		/* Pairs with the release store of br_cons_tail: slots are not
+		 * overwritten before the consumer has read them
+		 */
+		cons_tail = __atomic_load_n(&br->br_cons_tail,
+					    __ATOMIC_ACQUIRE);
+		free = br->br_prod_size - (prod_head - cons_tail);
+		if (unlikely(n > free)) {
+			if (fixed || free == 0) {
+				__atomic_fetch_add(&br->br_drops, n,
+						   __ATOMIC_RELAXED);
 				critical_exit();
-				return -ENOBUFS;
+				return 0;
 			}
-			continue;
+			__atomic_fetch_add(&br->br_drops, n - free,
+					   __ATOMIC_RELAXED);
+			n = free;
+		}
+		prod_next = prod_head + n;
+
+		if (sp) {
+			__atomic_store_n(&br->br_prod_head, prod_next,
+					 __ATOMIC_RELAXED);
+			break;
 		}
-	} while (!ukarch_compare_exchange_sync((uint32_t *) &br->br_prod_head,
-			prod_head, prod_next));
+		/* On failure, prod_head is updated with the current head */
+	} while (!__atomic_compare_exchange_n(&br->br_prod_head, &prod_head,
+					      prod_next, 0, __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
 
+	for (i = 0; i < n; i++) {
 #ifdef DEBUG_BUFRING
-	if (br->br_ring[prod_head] != NULL)
-		UK_CRASH("dangling value in enqueue");
+		if (br->br_ring[(prod_head + i) & br->br_prod_mask] != NULL)
+			UK_CRASH("dangling value in enqueue");
 #endif
-	br->br_ring[prod_head] = buf;
+		br->br_ring[(prod_head + i) & br->br_prod_mask] = bufs[i];
+	}
 
 	/*
 	 * If there are other enqueues in progress
 	 * that preceded us, we need to wait for them
-	 * to complete 
+	 * to complete. Acquiring their tail makes our release
+	 * also publish their slots to the consumer.
 	 */
-	while (br->br_prod_tail != prod_head)
-		ukarch_spinwait();
-	ukarch_store_n(&br->br_prod_tail, prod_next);
+	if (!sp)
+		while (__atomic_load_n(&br->br_prod_tail,
+				       __ATOMIC_ACQUIRE) != prod_head)
+			ukarch_spinwait();
+	__atomic_store_n(&br->br_prod_tail, prod_next, __ATOMIC_RELEASE);
 	critical_exit();
-	return 0;
+	return n;
 }
 
-/*
- * multi-consumer safe dequeue 
- *
- */
-static __inline void *
-uk_ring_dequeue_mc(struct uk_ring *br)
+/* NOTE: Please do not use this function directly */
+static __inline unsigned int
+_uk_ring_dequeue(struct uk_ring *br, void **bufs, unsigned int n,
+		 int fixed, int sc)
 {
-	uint32_t cons_head, cons_next;
-	void *buf;
+	uint32_t cons_head, cons_next, prod_tail, avail;
+	unsigned int i;
 
+#ifdef DEBUG_BUFRING
+	if (sc && br->br_lock && !uk_mutex_is_locked(br->br_lock))
+		UK_CRASH("lock not held on single consumer dequeue: %d",
+			 br->br_lock->lock_count);
+#endif
 	critical_enter();
+	cons_head = __atomic_load_n(&br->br_cons_head, __ATOMIC_RELAXED);
 	do {
-		cons_head = br->br_cons_head;
-		cons_next = (cons_head + 1) & br->br_cons_mask;
+		/* Pairs with the release store of br_prod_tail: slots are not
+		 * read before the producer has written them
+		 */
+		prod_tail = __atomic_load_n(&br->br_prod_tail,
+					    __ATOMIC_ACQUIRE);
+		avail = prod_tail - cons_head;
+		if (n > avail) {
+			if (fixed || avail == 0) {
+				critical_exit();
+				return 0;
+			}
+			n = avail;
+		}
+		cons_next = cons_head + n;
 
-		if (cons_head == br->br_prod_tail) {
-			critical_exit();
-			return NULL;
+		if (sc) {
+			__atomic_store_n(&br->br_cons_head, cons_next,
+					 __ATOMIC_RELAXED);
+			break;
 		}
-	} while (!ukarch_compare_exchange_sync((uint32_t *) &br->br_cons_head,
-			cons_head, cons_next));
+		/* On failure, cons_head is updated with the current head */
+	} while (!__atomic_compare_exchange_n(&br->br_cons_head, &cons_head,
+					      cons_next, 0, __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
 
-	buf = br->br_ring[cons_head];
+	for (i = 0; i < n; i++) {
+		bufs[i] = br->br_ring[(cons_head + i) & br->br_cons_mask];
 #ifdef DEBUG_BUFRING
-	br->br_ring[cons_head] = NULL;
+		br->br_ring[(cons_head + i) & br->br_cons_mask] = NULL;
 #endif
+	}
+
 	/*
 	 * If there are other dequeues in progress
 	 * that preceded us, we need to wait for them
-	 * to complete
+	 * to complete. Acquiring their tail makes our release
+	 * also publish their reads to the producer.
 	 */
-	while (br->br_cons_tail != cons_head)
-		ukarch_spinwait();
-
-	ukarch_store_n(&br->br_cons_tail, cons_next);
+	if (!sc)
+		while (__atomic_load_n(&br->br_cons_tail,
+				       __ATOMIC_ACQUIRE) != cons_head)
+			ukarch_spinwait();
+	__atomic_store_n(&br->br_cons_tail, cons_next, __ATOMIC_RELEASE);
 	critical_exit();
+	return n;
+}
+
+/*
+ * multi-producer safe lock-free ring buffer enqueue
+ *
+ */
+static __inline int
+uk_ring_enqueue(struct uk_ring *br, void *buf)
+{
+	return _uk_ring_enqueue(br, &buf, 1, 1, 0) ? 0 : -ENOBUFS;
+}
+
+/*
+ * single-producer enqueue
+ * use where enqueue is protected by a lock or
+ * there is only one producer
+ */
+static __inline int
+uk_ring_enqueue_sp(struct uk_ring *br, void *buf)
+{
+	return _uk_ring_enqueue(br, &buf, 1, 1, 1) ? 0 : -ENOBUFS;
+}
+
+/*
+ * Enqueue either all n buffers or none of them.
+ * Returns the number of enqueued buffers.
+ */
+static __inline unsigned int
+uk_ring_enqueue_bulk(struct uk_ring *br, void *const *bufs, unsigned int n)
+{
+	return _uk_ring_enqueue(br, bufs, n, 1, 0);
+}
+
+static __inline unsigned int
+uk_ring_enqueue_bulk_sp(struct uk_ring *br, void *const *bufs, unsigned int n)
+{
+	return _uk_ring_enqueue(br, bufs, n, 1, 1);
+}
+
+/*
+ * Enqueue as many of the n buffers as fit.
+ * Returns the number of enqueued buffers.
+ */
+static __inline unsigned int
+uk_ring_enqueue_burst(struct uk_ring *br, void *const *bufs, unsigned int n)
+{
+	return _uk_ring_enqueue(br, bufs, n, 0, 0);
+}
+
+static __inline unsigned int
+uk_ring_enqueue_burst_sp(struct uk_ring *br, void *const *bufs,
+			 unsigned int n)
+{
+	return _uk_ring_enqueue(br, bufs, n, 0, 1);
+}
+
+/*
+ * multi-consumer safe dequeue
+ *
+ */
+static __inline void *
+uk_ring_dequeue_mc(struct uk_ring *br)
+{
+	void *buf;
 
-	return buf;
+	return _uk_ring_dequeue(br, &buf, 1, 1, 0) ? buf : NULL;
 }
 
 /*
- * single-consumer dequeue 
+ * single-consumer dequeue
  * use where dequeue is protected by a lock
  * e.g. a network driver's tx queue lock
  */
 static __inline void *
 uk_ring_dequeue_sc(struct uk_ring *br)
 {
-	uint32_t cons_head, cons_next;
-#ifdef PREFETCH_DEFINED
-	uint32_t cons_next_next;
-#endif
-	uint32_t prod_tail;
 	void *buf;
 
-	/*
-	 * This is a workaround to allow using uk_ring on ARM and ARM64.
-	 * ARM64TODO: Fix uk_ring in a generic way.
-	 * REMARKS: It is suspected that br_cons_head does not require
-	 *   load_acq operation, but this change was extensively tested
-	 *   and confirmed it's working. To be reviewed once again in
-	 *   FreeBSD-12.
-	 *
-	 * Preventing following situation:
-	 * Core(0) - uk_ring_enqueue()                                       Core(1) - uk_ring_dequeue_sc()
-	 * -----------------------------------------                                       ----------------------------------------------
-	 *
-	 *                                                                                cons_head = br->br_cons_head;
-	 * atomic_cmpset_acq_32(&br->br_prod_head, ...));
-	 *                                                                                buf = br->br_ring[cons_head];     <see <1>>
-	 * br->br_ring[prod_head] = buf;
-	 * atomic_store_rel_32(&br->br_prod_tail, ...);
-	 *                                                                                prod_tail = br->br_prod_tail;
-	 *                                                                                if (cons_head == prod_tail) 
-	 *                                                                                        return (NULL);
-	 *                                                                                <condition is false and code uses invalid(old) buf>`
-	 *
-	 * <1> Load (on core 1) from br->br_ring[cons_head] can be reordered (speculative readed) by CPU.
-	 */
-#if defined(CONFIG_ARCH_ARM_32) || defined(CONFIG_ARCH_ARM_64)
-	cons_head = ukarch_load_n(&br->br_cons_head);
-#else
-	cons_head = br->br_cons_head;
-#endif
-	prod_tail = ukarch_load_n(&br->br_prod_tail);
+	return _uk_ring_dequeue(br, &buf, 1, 1, 1) ? buf : NULL;
+}
 
-	cons_next = (cons_head + 1) & br->br_cons_mask;
-#ifdef PREFETCH_DEFINED
-	cons_next_next = (cons_head + 2) & br->br_cons_mask;
-#endif
+/*
+ * Dequeue either n buffers or none.
+ * Returns the number of dequeued buffers.
+ */
+static __inline unsigned int
+uk_ring_dequeue_bulk_mc(struct uk_ring *br, void **bufs, unsigned int n)
+{
+	return _uk_ring_dequeue(br, bufs, n, 1, 0);
+}
 
-	if (cons_head == prod_tail)
-		return NULL;
+static __inline unsigned int
+uk_ring_dequeue_bulk_sc(struct uk_ring *br, void **bufs, unsigned int n)
+{
+	return _uk_ring_dequeue(br, bufs, n, 1, 1);
+}
 
-#ifdef PREFETCH_DEFINED
-	if (cons_next != prod_tail) {
-		prefetch(br->br_ring[cons_next]);
-		if (cons_next_next != prod_tail)
-			prefetch(br->br_ring[cons_next_next]);
-	}
-#endif
-	br->br_cons_head = cons_next;
-	buf = br->br_ring[cons_head];
+/*
+ * Dequeue up to n buffers.
+ * Returns the number of dequeued buffers.
+ */
+static __inline unsigned int
+uk_ring_dequeue_burst_mc(struct uk_ring *br, void **bufs, unsigned int n)
+{
+	return _uk_ring_dequeue(br, bufs, n, 0, 0);
+}
 
-#ifdef DEBUG_BUFRING
-	br->br_ring[cons_head] = NULL;
-	if (!uk_mutex_is_locked(br->br_lock))
-		UK_CRASH("lock not held on single consumer dequeue: %d", br->br_lock->lock_count);
-	if (br->br_cons_tail != cons_head)
-		UK_CRASH("inconsistent list cons_tail=%d cons_head=%d",
-				br->br_cons_tail, cons_head);
-#endif
-	br->br_cons_tail = cons_next;
-	return buf;
+static __inline unsigned int
+uk_ring_dequeue_burst_sc(struct uk_ring *br, void **bufs, unsigned int n)
+{
+	return _uk_ring_dequeue(br, bufs, n, 0, 1);
 }
 
 /*
@@ -244,20 +339,18 @@ uk_ring_dequeue_sc(struct uk_ring *br)
 static __inline void
 uk_ring_advance_sc(struct uk_ring *br)
 {
-	uint32_t cons_head, cons_next;
-	uint32_t prod_tail;
+	uint32_t cons_head, prod_tail;
 
 	cons_head = br->br_cons_head;
-	prod_tail = br->br_prod_tail;
-
-	cons_next = (cons_head + 1) & br->br_cons_mask;
+	prod_tail = __atomic_load_n(&br->br_prod_tail, __ATOMIC_ACQUIRE);
 	if (cons_head == prod_tail)
 		return;
-	br->br_cons_head = cons_next;
+	br->br_cons_head = cons_head + 1;
 #ifdef DEBUG_BUFRING
-	br->br_ring[cons_head] = NULL;
+	br->br_ring[cons_head & br->br_cons_mask] = NULL;
 #endif
-	br->br_cons_tail = cons_next;
+	/* The slot was read by the preceding peek */
+	__atomic_store_n(&br->br_cons_tail, cons_head + 1, __ATOMIC_RELEASE);
 }
 
 /*
@@ -281,7 +374,7 @@ uk_ring_putback_sc(struct uk_ring *br, void *new)
 {
 	/* Buffer ring has none in putback */
 	UK_ASSERT(br->br_cons_head != br->br_prod_tail);
-	br->br_ring[br->br_cons_head] = new;
+	br->br_ring[br->br_cons_head & br->br_cons_mask] = new;
 }
 
 /*
@@ -292,25 +385,27 @@ uk_ring_putback_sc(struct uk_ring *br, void *new)
 static __inline void *
 uk_ring_peek(struct uk_ring *br)
 {
+	uint32_t cons_head;
+
 #ifdef DEBUG_BUFRING
 	if (!uk_mutex_is_locked(br->br_lock))
 		UK_CRASH("lock not held on single consumer dequeue");
 #endif
 	/*
-	 * I believe it is safe to not have a memory barrier
-	 * here because we control cons and tail is worst case
-	 * a lagging indicator so we worst case we might
-	 * return NULL immediately after a buffer has been enqueued
+	 * The acquire load orders the read of the slot after the check,
+	 * so we never return a slot that the producer has not written yet.
 	 */
-	if (br->br_cons_head == br->br_prod_tail)
+	cons_head = br->br_cons_head;
+	if (cons_head == __atomic_load_n(&br->br_prod_tail, __ATOMIC_ACQUIRE))
 		return NULL;
 
-	return br->br_ring[br->br_cons_head];
+	return br->br_ring[cons_head & br->br_cons_mask];
 }
 
 static __inline void *
 uk_ring_peek_clear_sc(struct uk_ring *br)
 {
+	uint32_t cons_head;
 #ifdef DEBUG_BUFRING
 	void *ret;
 
@@ -318,54 +413,44 @@ uk_ring_peek_clear_sc(struct uk_ring *br)
 		UK_CRASH("lock not held on single consumer dequeue");
 #endif
 
-	if (br->br_cons_head == br->br_prod_tail)
+	/* See uk_ring_peek() for the ordering */
+	cons_head = br->br_cons_head;
+	if (cons_head == __atomic_load_n(&br->br_prod_tail, __ATOMIC_ACQUIRE))
 		return NULL;
 
-#if defined(CONFIG_ARCH_ARM_32) || defined(CONFIG_ARCH_ARM_64)
-	/*
-	 * The barrier is required there on ARM and ARM64 to ensure, that
-	 * br->br_ring[br->br_cons_head] will not be fetched before the above
-	 * condition is checked.
-	 * Without the barrier, it is possible, that buffer will be fetched
-	 * before the enqueue will put mbuf into br, then, in the meantime, the
-	 * enqueue will update the array and the br_prod_tail, and the
-	 * conditional check will be true, so we will return previously fetched
-	 * (and invalid) buffer.
-	 */
-	#error "unsupported: atomic_thread_fence_acq()"
-	/* TODO atomic_thread_fence_acq(); */
-#endif
-
 #ifdef DEBUG_BUFRING
 	/*
 	 * Single consumer, i.e. cons_head will not move while we are
 	 * running, so atomic_swap_ptr() is not necessary here.
 	 */
-	ret = br->br_ring[br->br_cons_head];
-	br->br_ring[br->br_cons_head] = NULL;
+	ret = br->br_ring[cons_head & br->br_cons_mask];
+	br->br_ring[cons_head & br->br_cons_mask] = NULL;
 	return ret;
 #else
-	return br->br_ring[br->br_cons_head];
+	return br->br_ring[cons_head & br->br_cons_mask];
 #endif
 }
 
 static __inline int
 uk_ring_full(struct uk_ring *br)
 {
-	return ((br->br_prod_head + 1) & br->br_prod_mask) == br->br_cons_tail;
+	return (__atomic_load_n(&br->br_prod_head, __ATOMIC_RELAXED)
+		- __atomic_load_n(&br->br_cons_tail, __ATOMIC_RELAXED))
+		== (uint32_t) br->br_prod_size;
 }
 
 static __inline int
 uk_ring_empty(struct uk_ring *br)
 {
-	return br->br_cons_head == br->br_prod_tail;
+	return __atomic_load_n(&br->br_cons_head, __ATOMIC_RELAXED)
+		== __atomic_load_n(&br->br_prod_tail, __ATOMIC_RELAXED);
 }
 
 static __inline int
 uk_ring_count(struct uk_ring *br)
 {
-	return (br->br_prod_size + br->br_prod_tail - br->br_cons_tail)
-			& br->br_prod_mask;
+	return __atomic_load_n(&br->br_prod_tail, __ATOMIC_RELAXED)
+		- __atomic_load_n(&br->br_cons_tail, __ATOMIC_RELAXED);
 }
 
 struct uk_ring *uk_ring_alloc(int count, struct uk_alloc *a
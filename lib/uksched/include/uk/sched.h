@@ -98,6 +98,9 @@ struct uk_sched {
 	struct uk_thread_list exited_threads;
 	struct ukplat_ctx_callbacks plat_ctx_cbs;
 	struct uk_alloc *allocator;
+	/* stacks of destroyed threads, kept for reuse */
+	void *stack_pool;
+	unsigned int stack_pool_len;
 	struct uk_sched *next;
 	void *prv;
 };
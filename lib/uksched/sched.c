@@ -30,6 +30,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <uk/plat/config.h>
@@ -37,6 +38,10 @@
 #include <uk/alloc.h>
 #include <uk/sched.h>
 #include <uk/arch/tls.h>
+#include <uk/essentials.h>
+#if CONFIG_LIBUKSCHED_STACK_GUARD
+#include <uk/plat/paging.h>
+#endif
 #if CONFIG_LIBUKSCHEDCOOP
 #include <uk/schedcoop.h>
 #endif
@@ -133,6 +138,8 @@ struct uk_sched *uk_sched_create(struct uk_alloc *a, size_t prv_size)
 
 	sched->threads_started = false;
 	sched->allocator = a;
+	sched->stack_pool = NULL;
+	sched->stack_pool_len = 0;
 	UK_TAILQ_INIT(&sched->exited_threads);
 	sched->prv = (void *) sched + sizeof(struct uk_sched);
 
@@ -145,23 +152,100 @@ void uk_sched_start(struct uk_sched *sched)
 	ukplat_thread_ctx_start(&sched->plat_ctx_cbs, sched->idle.ctx);
 }
 
+/*
+ * Header written at the bottom of a recycled stack (where the pointer to the
+ * owning thread is kept while the stack is in use) to link it in the stack
+ * pool of the scheduler, together with the TLS area of its former thread.
+ */
+struct stack_pool_entry {
+	struct stack_pool_entry *next;
+	void *tls;
+};
+
+#if CONFIG_LIBUKSCHED_STACK_GUARD
+/*
+ * The stack is the upper half of a block of twice the stack size, which keeps
+ * the stack aligned to its size. The last page of the lower half is the
+ * write-protected guard page, the rest of the lower half can hold the TLS.
+ */
+#define STACK_BLOCK(stack)	((char *)(stack) - STACK_SIZE)
+#define STACK_GUARD(stack)	((char *)(stack) - __PAGE_SIZE)
+
+static int stack_guard_set(void *stack, unsigned long attr)
+{
+	return ukplat_page_set_attr(ukplat_pt_get_active(),
+				    (__vaddr_t)STACK_GUARD(stack), 1, attr, 0);
+}
+#endif /* CONFIG_LIBUKSCHED_STACK_GUARD */
+
 static void *create_stack(struct uk_alloc *allocator)
 {
 	void *stack;
+#if CONFIG_LIBUKSCHED_STACK_GUARD
+	int rc;
+
+	if (uk_posix_memalign(allocator, &stack,
+			      STACK_SIZE, 2 * STACK_SIZE) != 0) {
+		uk_pr_err("Failed to allocate thread stack: Not enough memory\n");
+		return NULL;
+	}
+	stack = (char *)stack + STACK_SIZE;
 
+	rc = stack_guard_set(stack, PAGE_ATTR_PROT_READ);
+	if (unlikely(rc))
+		uk_pr_warn("Failed to set up stack guard page at %p: %d\n",
+			   STACK_GUARD(stack), rc);
+#else /* !CONFIG_LIBUKSCHED_STACK_GUARD */
 	if (uk_posix_memalign(allocator, &stack,
 			      STACK_SIZE, STACK_SIZE) != 0) {
 		uk_pr_err("Failed to allocate thread stack: Not enough memory\n");
 		return NULL;
 	}
+#endif /* !CONFIG_LIBUKSCHED_STACK_GUARD */
 
 	return stack;
 }
 
-static void *uk_thread_tls_create(struct uk_alloc *allocator)
+static void destroy_stack(struct uk_alloc *allocator, void *stack)
+{
+#if CONFIG_LIBUKSCHED_STACK_GUARD
+	/* Hand the guard page back writable, it is regular heap memory */
+	stack_guard_set(stack, PAGE_ATTR_PROT_RW);
+	uk_free(allocator, STACK_BLOCK(stack));
+#else /* !CONFIG_LIBUKSCHED_STACK_GUARD */
+	uk_free(allocator, stack);
+#endif /* !CONFIG_LIBUKSCHED_STACK_GUARD */
+}
+
+/* Returns true if the TLS area was carved from the block of the stack */
+static inline bool tls_in_stack_block(void *stack __maybe_unused,
+				      void *tls __maybe_unused)
+{
+#if CONFIG_LIBUKSCHED_STACK_GUARD
+	return stack && (char *)tls >= STACK_BLOCK(stack) &&
+	       (char *)tls < STACK_GUARD(stack);
+#else /* !CONFIG_LIBUKSCHED_STACK_GUARD */
+	return false;
+#endif /* !CONFIG_LIBUKSCHED_STACK_GUARD */
+}
+
+static void *uk_thread_tls_create(struct uk_alloc *allocator,
+				  void *stack __maybe_unused)
 {
 	void *tls;
 
+#if CONFIG_LIBUKSCHED_STACK_GUARD
+	if (stack) {
+		tls = (void *)ALIGN_UP((__uptr)STACK_BLOCK(stack),
+				       ukarch_tls_area_align());
+		if ((char *)tls + ukarch_tls_area_size() <=
+		    STACK_GUARD(stack)) {
+			ukarch_tls_area_copy(tls);
+			return tls;
+		}
+	}
+#endif /* CONFIG_LIBUKSCHED_STACK_GUARD */
+
 	if (uk_posix_memalign(allocator, &tls, ukarch_tls_area_align(),
 			      ukarch_tls_area_size()) != 0) {
 		uk_pr_err("Failed to allocate thread TLS area\n");
@@ -171,6 +255,74 @@ static void *uk_thread_tls_create(struct uk_alloc *allocator)
 	return tls;
 }
 
+static void uk_thread_tls_destroy(struct uk_alloc *allocator, void *stack,
+				  void *tls)
+{
+	if (tls && !tls_in_stack_block(stack, tls))
+		uk_free(allocator, tls);
+}
+
+/*
+ * Provides a stack and, if needed, a TLS area for a new thread, preferably
+ * from the stack pool of the scheduler.
+ */
+static int thread_mem_alloc(struct uk_sched *sched, void **stack, void **tls)
+{
+	struct stack_pool_entry *entry = sched->stack_pool;
+
+	if (entry) {
+		sched->stack_pool = entry->next;
+		sched->stack_pool_len--;
+
+		*stack = entry;
+		*tls = entry->tls;
+		if (*tls)
+			ukarch_tls_area_copy(*tls);
+		return 0;
+	}
+
+	*stack = create_stack(sched->allocator);
+	if (*stack == NULL)
+		return -ENOMEM;
+
+	*tls = NULL;
+	if (have_tls_area() &&
+	    !(*tls = uk_thread_tls_create(sched->allocator, *stack))) {
+		destroy_stack(sched->allocator, *stack);
+		*stack = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void thread_mem_release(struct uk_sched *sched, void *stack, void *tls)
+{
+	uk_thread_tls_destroy(sched->allocator, stack, tls);
+	destroy_stack(sched->allocator, stack);
+}
+
+/*
+ * Returns the stack and TLS area of a destroyed thread to the stack pool of
+ * the scheduler, or to the allocator if the pool is full.
+ */
+static void thread_mem_free(struct uk_sched *sched, void *stack, void *tls)
+{
+#if CONFIG_LIBUKSCHED_STACK_POOL > 0
+	struct stack_pool_entry *entry = stack;
+
+	if (sched->stack_pool_len < CONFIG_LIBUKSCHED_STACK_POOL) {
+		entry->tls = tls;
+		entry->next = sched->stack_pool;
+		sched->stack_pool = entry;
+		sched->stack_pool_len++;
+		return;
+	}
+#endif /* CONFIG_LIBUKSCHED_STACK_POOL > 0 */
+
+	thread_mem_release(sched, stack, tls);
+}
+
 void uk_sched_idle_init(struct uk_sched *sched,
 		void *stack, void (*function)(void *))
 {
@@ -180,11 +332,13 @@ void uk_sched_idle_init(struct uk_sched *sched,
 
 	UK_ASSERT(sched != NULL);
 
-	if (stack == NULL)
-		stack = create_stack(sched->allocator);
-	UK_ASSERT(stack != NULL);
-	if (have_tls_area() && !(tls = uk_thread_tls_create(sched->allocator)))
+	if (stack == NULL) {
+		if (thread_mem_alloc(sched, &stack, &tls))
+			goto out_crash;
+	} else if (have_tls_area() &&
+		   !(tls = uk_thread_tls_create(sched->allocator, NULL))) {
 		goto out_crash;
+	}
 
 	idle = &sched->idle;
 
@@ -219,10 +373,7 @@ struct uk_thread *uk_sched_thread_create(struct uk_sched *sched,
 	/* We can't use lazy allocation here
 	 * since the trap handler runs on the stack
 	 */
-	stack = create_stack(sched->allocator);
-	if (stack == NULL)
-		goto err;
-	if (have_tls_area() && !(tls = uk_thread_tls_create(sched->allocator)))
+	if (thread_mem_alloc(sched, &stack, &tls))
 		goto err;
 
 	rc = uk_thread_init(thread,
@@ -240,10 +391,8 @@ struct uk_thread *uk_sched_thread_create(struct uk_sched *sched,
 err_add:
 	uk_thread_fini(thread, sched->allocator);
 err:
-	if (tls)
-		uk_free(sched->allocator, tls);
 	if (stack)
-		uk_free(sched->allocator, stack);
+		thread_mem_free(sched, stack, tls);
 	if (thread)
 		uk_free(sched->allocator, thread);
 
@@ -260,9 +409,7 @@ void uk_sched_thread_destroy(struct uk_sched *sched, struct uk_thread *thread)
 
 	UK_TAILQ_REMOVE(&sched->exited_threads, thread, thread_list);
 	uk_thread_fini(thread, sched->allocator);
-	uk_free(sched->allocator, thread->stack);
-	if (thread->tls)
-		uk_free(sched->allocator, thread->tls);
+	thread_mem_free(sched, thread->stack, thread->tls);
 	uk_free(sched->allocator, thread);
 }
 
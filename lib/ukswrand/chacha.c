@@ -34,24 +34,78 @@
 #include <uk/swrand.h>
 #include <uk/print.h>
 #include <uk/assert.h>
-#include <uk/ctors.h>
+#include <uk/config.h>
+#include <uk/essentials.h>
+
+/*
+ * ChaCha20 keystream generator with fast key erasure: every refill computes
+ * a batch of blocks under the current key. The last 32 bytes of the batch
+ * replace the key, the rest is handed out. Words are erased from the state
+ * as soon as they are handed out, so a later compromise of the state does
+ * not reveal earlier output.
+ *
+ * Blocks are computed CHACHA_LANES at a time with GCC vector extensions
+ * (SSE2: 4 lanes, AVX2: 8 lanes). Each vector holds the same state word of
+ * different blocks, so the rounds do not need any shuffles. Arm64 is built
+ * with -mgeneral-regs-only, so it computes one block at a time.
+ */
+#if defined(__AVX2__)
+#define CHACHA_LANES		8
+#elif defined(__SSE2__)
+#define CHACHA_LANES		4
+#else
+#define CHACHA_LANES		1
+#endif
+
+#define CHACHA_BLOCK_WORDS	16
+#define CHACHA_BLOCK_SIZE	(CHACHA_BLOCK_WORDS * sizeof(__u32))
+#define CHACHA_KEY_WORDS	8
+#define CHACHA_BATCH		8
+#define CHACHA_BATCH_WORDS	(CHACHA_BATCH * CHACHA_BLOCK_WORDS)
+#define CHACHA_OUT_WORDS	(CHACHA_BATCH_WORDS - CHACHA_KEY_WORDS)
+
+#if CONFIG_LIBUKSWRAND_CHACHA_RESEED
+#define CHACHA_RESEED_BATCHES						\
+	DIV_ROUND_UP(CONFIG_LIBUKSWRAND_CHACHA_RESEED * 1024UL,		\
+		     CHACHA_OUT_WORDS * sizeof(__u32))
+#endif
+
+#if CHACHA_LANES > 1
+typedef __u32 chacha_vec_t __attribute__((vector_size(CHACHA_LANES * 4)));
+#define CHACHA_LANE(v, l)	((v)[l])
+#else
+typedef __u32 chacha_vec_t;
+#define CHACHA_LANE(v, l)	(v)
+#endif
+
+UK_CTASSERT(CHACHA_BATCH % CHACHA_LANES == 0);
 
 struct uk_swrand {
-	int k;
-	__u32 input[16], output[16];
+	__u32 key[CHACHA_KEY_WORDS];
+	__u32 iv[2];
+	/* Number of unused words at the end of the output part of out. A zeroed
+	 * (not yet seeded) state thus starts with a refill.
+	 */
+	unsigned int avail;
+	/* Batches left until the key is reseeded */
+	unsigned long reseed;
+	__u32 out[CHACHA_BATCH_WORDS];
 };
 
-struct uk_swrand uk_swrand_def;
+static struct uk_swrand uk_swrand_lcpu_def[UK_SWRAND_MAX_LCPU];
 
-/* This value isn't important, as long as it's sufficiently asymmetric */
-static const char sigma[16] = "expand 32-byte k";
+/* "expand 32-byte k" */
+static const __u32 sigma[4] = {
+	0x61707865, 0x3320646e, 0x79622d32, 0x6b206574
+};
 
-static inline __u32 _uk_rotl32(__u32 v, int c)
+static inline chacha_vec_t _uk_rotl32(chacha_vec_t v, int c)
 {
 	return (v << c) | (v >> (32 - c));
 }
 
-static inline void _uk_quarterround(__u32 x[16], int a, int b, int c, int d)
+static inline void _uk_quarterround(chacha_vec_t x[16],
+				    int a, int b, int c, int d)
 {
 	x[a] = x[a] + x[b];
 	x[d] = _uk_rotl32(x[d] ^ x[a], 16);
@@ -66,46 +120,94 @@ static inline void _uk_quarterround(__u32 x[16], int a, int b, int c, int d)
 	x[b] = _uk_rotl32(x[b] ^ x[c], 7);
 }
 
-static inline void
-_uk_salsa20_wordtobyte(__u32 output[16], const __u32 input[16])
+static inline chacha_vec_t _uk_splat(__u32 v)
 {
-	__u32 i;
+	chacha_vec_t r;
+	int l;
+
+	for (l = 0; l < CHACHA_LANES; l++)
+		CHACHA_LANE(r, l) = v;
+	return r;
+}
+
+/*
+ * Computes the CHACHA_LANES blocks starting at block counter `ctr` into
+ * `out`, which does not need to be aligned
+ */
+static inline void _uk_chacha_blocks(const struct uk_swrand *r, __u32 ctr,
+				     char *out)
+{
+	chacha_vec_t input[16], x[16];
+	__u32 w;
+	int i, l;
+
+	for (i = 0; i < 4; i++)
+		input[i] = _uk_splat(sigma[i]);
+	for (i = 0; i < CHACHA_KEY_WORDS; i++)
+		input[i + 4] = _uk_splat(r->key[i]);
+	for (l = 0; l < CHACHA_LANES; l++)
+		CHACHA_LANE(input[12], l) = ctr + l;
+	input[13] = _uk_splat(0);
+	input[14] = _uk_splat(r->iv[0]);
+	input[15] = _uk_splat(r->iv[1]);
 
 	for (i = 0; i < 16; i++)
-		output[i] = input[i];
-
-	for (i = 8; i > 0; i -= 2) {
-		_uk_quarterround(output, 0, 4, 8, 12);
-		_uk_quarterround(output, 1, 5, 9, 13);
-		_uk_quarterround(output, 2, 6, 10, 14);
-		_uk_quarterround(output, 3, 7, 11, 15);
-		_uk_quarterround(output, 0, 5, 10, 15);
-		_uk_quarterround(output, 1, 6, 11, 12);
-		_uk_quarterround(output, 2, 7, 8, 13);
-		_uk_quarterround(output, 3, 4, 9, 14);
+		x[i] = input[i];
+
+	for (i = 20; i > 0; i -= 2) {
+		_uk_quarterround(x, 0, 4, 8, 12);
+		_uk_quarterround(x, 1, 5, 9, 13);
+		_uk_quarterround(x, 2, 6, 10, 14);
+		_uk_quarterround(x, 3, 7, 11, 15);
+		_uk_quarterround(x, 0, 5, 10, 15);
+		_uk_quarterround(x, 1, 6, 11, 12);
+		_uk_quarterround(x, 2, 7, 8, 13);
+		_uk_quarterround(x, 3, 4, 9, 14);
 	}
 
 	for (i = 0; i < 16; i++)
-		output[i] += input[i];
+		x[i] += input[i];
+
+	for (l = 0; l < CHACHA_LANES; l++)
+		for (i = 0; i < 16; i++) {
+			w = CHACHA_LANE(x[i], l);
+			memcpy(out, &w, sizeof(w));
+			out += sizeof(w);
+		}
 }
 
-static inline void _uk_key_setup(struct uk_swrand *r, __u32 k[8])
+/*
+ * Computes a batch of CHACHA_BATCH_WORDS words into `out` and rekeys the
+ * generator with the last CHACHA_KEY_WORDS of it. The caller has to make sure
+ * that these words are overwritten before `out` is handed out.
+ */
+static void _uk_chacha_batch(struct uk_swrand *r, char *out)
 {
+	__u32 ctr;
+#if CONFIG_LIBUKSWRAND_CHACHA_RESEED
 	int i;
+#endif
 
-	for (i = 0; i < 8; i++)
-		r->input[i + 4] = k[i];
+	for (ctr = 0; ctr < CHACHA_BATCH; ctr += CHACHA_LANES)
+		_uk_chacha_blocks(r, ctr, out + ctr * CHACHA_BLOCK_SIZE);
+	memcpy(r->key, out + CHACHA_OUT_WORDS * sizeof(__u32),
+	       sizeof(r->key));
 
-	for (i = 0; i < 4; i++)
-		r->input[i] = ((__u32 *)sigma)[i];
+#if CONFIG_LIBUKSWRAND_CHACHA_RESEED
+	if (--r->reseed == 0) {
+		for (i = 0; i < CHACHA_KEY_WORDS; i++)
+			r->key[i] ^= uk_swrandr_gen_seed32();
+		r->reseed = CHACHA_RESEED_BATCHES;
+	}
+#endif
 }
 
-static inline void _uk_iv_setup(struct uk_swrand *r, __u32 iv[2])
+static inline void _uk_chacha_refill(struct uk_swrand *r)
 {
-	r->input[12] = 0;
-	r->input[13] = 0;
-	r->input[14] = iv[0];
-	r->input[15] = iv[1];
+	_uk_chacha_batch(r, (char *) r->out);
+	memset(&r->out[CHACHA_OUT_WORDS], 0,
+	       CHACHA_KEY_WORDS * sizeof(__u32));
+	r->avail = CHACHA_OUT_WORDS;
 }
 
 static inline __u32 _infvec_val(unsigned int c, const __u32 v[],
@@ -116,43 +218,75 @@ static inline __u32 _infvec_val(unsigned int c, const __u32 v[],
 	return v[pos % c];
 }
 
+struct uk_swrand *uk_swrand_lcpu(__lcpuidx idx)
+{
+	UK_ASSERT(idx < UK_SWRAND_MAX_LCPU);
+
+	return &uk_swrand_lcpu_def[idx];
+}
+
 void uk_swrand_init_r(struct uk_swrand *r, unsigned int seedc,
 		const __u32 seedv[])
 {
 	__u32 i;
 
 	UK_ASSERT(r);
-	/* Initialize chacha */
-	__u32 k[8], iv[2];
-
-	for (i = 0; i < 8; i++)
-		k[i] = _infvec_val(10, seedv, i);
-
-	iv[0] = _infvec_val(seedc, seedv, i);
-	iv[1] = _infvec_val(seedc, seedv, i + 1);
 
-	_uk_key_setup(r, k);
-	_uk_iv_setup(r, iv);
+	for (i = 0; i < CHACHA_KEY_WORDS; i++)
+		r->key[i] = _infvec_val(seedc, seedv, i);
+	r->iv[0] = _infvec_val(seedc, seedv, i);
+	r->iv[1] = _infvec_val(seedc, seedv, i + 1);
 
-	r->k = 16;
+	memset(r->out, 0, sizeof(r->out));
+	r->avail = 0;
+#if CONFIG_LIBUKSWRAND_CHACHA_RESEED
+	r->reseed = CHACHA_RESEED_BATCHES;
+#endif
 }
 
 __u32 uk_swrand_randr_r(struct uk_swrand *r)
 {
+	__u32 *w;
 	__u32 res;
 
-	for (;;) {
-		_uk_salsa20_wordtobyte(r->output, r->input);
-		r->input[12] = r->input[12] + 1;
-		if (r->input[12] == 0)
-			r->input[13]++;
+	if (unlikely(r->avail == 0))
+		_uk_chacha_refill(r);
+
+	w = &r->out[CHACHA_OUT_WORDS - r->avail--];
+	res = *w;
+	*w = 0;
+	return res;
+}
+
+void uk_swrand_fill_r(struct uk_swrand *r, void *buf, size_t buflen)
+{
+	char *dst = buf;
+	__u32 *src;
+	size_t len;
+
+	UK_ASSERT(r);
 
-		if (r->k < 16) {
-			res = r->output[r->k];
-			r->k += 1;
-			return res;
+	while (buflen > 0) {
+		if (r->avail == 0) {
+			/* Compute large requests in place. The key words at
+			 * the end of the batch are overwritten by the
+			 * following output, as at least as many bytes remain.
+			 */
+			if (buflen >= CHACHA_BATCH_WORDS * sizeof(__u32)) {
+				_uk_chacha_batch(r, dst);
+				dst += CHACHA_OUT_WORDS * sizeof(__u32);
+				buflen -= CHACHA_OUT_WORDS * sizeof(__u32);
+				continue;
+			}
+			_uk_chacha_refill(r);
 		}
 
-		r->k = 0;
+		src = &r->out[CHACHA_OUT_WORDS - r->avail];
+		len = MIN(buflen, r->avail * sizeof(__u32));
+		memcpy(dst, src, len);
+		memset(src, 0, ALIGN_UP(len, sizeof(__u32)));
+		r->avail -= DIV_ROUND_UP(len, sizeof(__u32));
+		dst += len;
+		buflen -= len;
 	}
 }
@@ -45,25 +45,36 @@ extern "C" {
 
 #define UK_SWRAND_CTOR_PRIO	1
 
+#if CONFIG_HAVE_SMP
+#define UK_SWRAND_MAX_LCPU	CONFIG_UKPLAT_LCPU_MAXCOUNT
+#else
+#define UK_SWRAND_MAX_LCPU	1
+#endif
+
 struct uk_swrand;
 
-extern struct uk_swrand uk_swrand_def;
+/* Returns the pre-initialized default generator of a logical CPU */
+struct uk_swrand *uk_swrand_lcpu(__lcpuidx idx);
+
+/* Default generator of the boot CPU */
+#define uk_swrand_def (*uk_swrand_lcpu(0))
 
 void uk_swrand_init_r(struct uk_swrand *r, unsigned int seedc,
 			const __u32 seedv[]);
 __u32 uk_swrand_randr_r(struct uk_swrand *r);
+/* Fills `buflen` bytes of `buf`, which does not need to be aligned */
+void uk_swrand_fill_r(struct uk_swrand *r, void *buf, size_t buflen);
 
 __u32 uk_swrandr_gen_seed32(void);
-/* Uses the pre-initialized default generator  */
+/* Uses the pre-initialized default generator of the current CPU */
 /* TODO: Add assertion when we can test if we are in interrupt context */
-/* TODO: Revisit with multi-CPU support */
 static inline __u32 uk_swrand_randr(void)
 {
 	unsigned long iflags;
 	__u32 ret;
 
 	iflags = ukplat_lcpu_save_irqf();
-	ret = uk_swrand_randr_r(&uk_swrand_def);
+	ret = uk_swrand_randr_r(uk_swrand_lcpu(ukplat_lcpu_idx()));
 	ukplat_lcpu_restore_irqf(iflags);
 
 	return ret;
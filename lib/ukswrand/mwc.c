@@ -44,7 +44,14 @@ struct uk_swrand {
 	__u32 i;
 };
 
-struct uk_swrand uk_swrand_def;
+static struct uk_swrand uk_swrand_lcpu_def[UK_SWRAND_MAX_LCPU];
+
+struct uk_swrand *uk_swrand_lcpu(__lcpuidx idx)
+{
+	UK_ASSERT(idx < UK_SWRAND_MAX_LCPU);
+
+	return &uk_swrand_lcpu_def[idx];
+}
 
 void uk_swrand_init_r(struct uk_swrand *r, unsigned int seedc,
 		const __u32 seedv[])
@@ -88,3 +95,21 @@ __u32 uk_swrand_randr_r(struct uk_swrand *r)
 	r->c = c;
 	return (r->Q[i] = y - x);
 }
+
+void uk_swrand_fill_r(struct uk_swrand *r, void *buf, size_t buflen)
+{
+	char *dst = buf;
+	__u32 rd;
+
+	for (; buflen >= sizeof(rd); buflen -= sizeof(rd)) {
+		rd = uk_swrand_randr_r(r);
+		memcpy(dst, &rd, sizeof(rd));
+		dst += sizeof(rd);
+	}
+
+	/* fill the remaining bytes of the buffer */
+	if (buflen > 0) {
+		rd = uk_swrand_randr_r(r);
+		memcpy(dst, &rd, buflen);
+	}
+}
@@ -32,6 +32,60 @@
 #include <uk/config.h>
 #include <uk/print.h>
 #include <uk/init.h>
+#include <uk/plat/time.h>
+#include <uk/essentials.h>
+
+#if defined(CONFIG_LIBUKSWRAND_INITIALSEED_RDRAND) || \
+	defined(CONFIG_LIBUKSWRAND_INITIALSEED_RDSEED)
+/* rdrand only fails transiently, e.g., when it is shared heavily. Intel
+ * recommends to give up after 10 attempts: more failures indicate a broken
+ * CPU, and this may run with interrupts disabled.
+ */
+#define SWRAND_RDRAND_RETRIES 10
+
+static inline __u32 _uk_swrand_rdrand(void)
+{
+	__u32 val;
+	__u8 ok;
+	int i;
+
+	for (i = 0; i < SWRAND_RDRAND_RETRIES; i++) {
+		asm volatile ("rdrand %0; setc %1"
+			      : "=r" (val), "=qm" (ok));
+		if (likely(ok))
+			return val;
+	}
+
+	/* Better a weak seed than a hang. Reseeding mixes the value into the
+	 * existing key, so only the initial seed is weakened.
+	 */
+	uk_pr_warn_once("rdrand failed %d times, seeding from the clock\n",
+			SWRAND_RDRAND_RETRIES);
+	return (__u32)ukplat_monotonic_clock();
+}
+#endif
+
+#ifdef CONFIG_LIBUKSWRAND_INITIALSEED_RDSEED
+#define SWRAND_RDSEED_RETRIES 64
+
+static inline __u32 _uk_swrand_rdseed(void)
+{
+	__u32 val;
+	__u8 ok;
+	int i;
+
+	for (i = 0; i < SWRAND_RDSEED_RETRIES; i++) {
+		asm volatile ("rdseed %0; setc %1"
+			      : "=r" (val), "=qm" (ok));
+		if (likely(ok))
+			return val;
+		ukarch_spinwait();
+	}
+
+	/* The entropy source is exhausted, use its conditioned output */
+	return _uk_swrand_rdrand();
+}
+#endif
 
 __u32 uk_swrandr_gen_seed32(void)
 {
@@ -42,8 +96,11 @@ __u32 uk_swrandr_gen_seed32(void)
 #endif
 
 #ifdef CONFIG_LIBUKSWRAND_INITIALSEED_RDRAND
-	asm volatile ("rdrand %%eax;"
-		: "=a" (val));
+	val = _uk_swrand_rdrand();
+#endif
+
+#ifdef CONFIG_LIBUKSWRAND_INITIALSEED_RDSEED
+	val = _uk_swrand_rdseed();
 #endif
 
 #ifdef CONFIG_LIBUKSWRAND_INITIALSEED_USECONSTANT
@@ -53,21 +110,26 @@ __u32 uk_swrandr_gen_seed32(void)
 	return val;
 }
 
+/*
+ * Interrupts are disabled while the generator of the current CPU is used, so
+ * large requests are split to bound the interrupt latency.
+ */
+#define SWRAND_FILL_CHUNK 4096
+
 ssize_t uk_swrand_fill_buffer(void *buf, size_t buflen)
 {
-	size_t step, chunk_size, i;
-	__u32 rd;
+	unsigned long iflags;
+	size_t len, left;
+	char *dst = buf;
 
-	step = sizeof(__u32);
-	chunk_size = buflen % step;
+	for (left = buflen; left > 0; left -= len) {
+		len = MIN(left, SWRAND_FILL_CHUNK);
 
-	for (i = 0; i < buflen - chunk_size; i += step)
-		*(__u32 *)((char *) buf + i) = uk_swrand_randr();
+		iflags = ukplat_lcpu_save_irqf();
+		uk_swrand_fill_r(uk_swrand_lcpu(ukplat_lcpu_idx()), dst, len);
+		ukplat_lcpu_restore_irqf(iflags);
 
-	/* fill the remaining bytes of the buffer */
-	if (chunk_size > 0) {
-		rd = uk_swrand_randr();
-		memcpy(buf + i, &rd, chunk_size);
+		dst += len;
 	}
 
 	return buflen;
@@ -76,6 +138,7 @@ ssize_t uk_swrand_fill_buffer(void *buf, size_t buflen)
 static int _uk_swrand_init(void)
 {
 	unsigned int i;
+	__lcpuidx idx;
 #ifdef CONFIG_LIBUKSWRAND_CHACHA
 	unsigned int seedc = 10;
 	__u32 seedv[10];
@@ -85,10 +148,17 @@ static int _uk_swrand_init(void)
 #endif
 	uk_pr_info("Initialize random number generator...\n");
 
-	for (i = 0; i < seedc; i++)
-		seedv[i] = uk_swrandr_gen_seed32();
+	for (idx = 0; idx < UK_SWRAND_MAX_LCPU; idx++) {
+		for (i = 0; i < seedc; i++)
+			seedv[i] = uk_swrandr_gen_seed32();
+
+		/* Keep the streams of the CPUs apart even if the seed
+		 * source returns the same values
+		 */
+		seedv[seedc - 1] ^= idx;
 
-	uk_swrand_init_r(&uk_swrand_def, seedc, seedv);
+		uk_swrand_init_r(uk_swrand_lcpu(idx), seedc, seedv);
+	}
 
 	return seedc;
 }
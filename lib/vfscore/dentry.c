@@ -41,29 +41,213 @@
 #include <uk/mutex.h>
 #include "vfs.h"
 
-#define DENTRY_BUCKETS 32
+#define DENTRY_BUCKETS 256
 
+/*
+ * Dentries are hashed by their parent dentry and the name of their last
+ * path component. This allows namei() to resolve a path one component at a
+ * time without rehashing the whole path prefix for every step.
+ */
 static struct uk_hlist_head dentry_hash_table[DENTRY_BUCKETS];
-static UK_HLIST_HEAD(fake);
 static struct uk_mutex dentry_hash_lock = UK_MUTEX_INITIALIZER(dentry_hash_lock);
 
+#if CONFIG_LIBVFSCORE_DCACHE_SIZE > 0
+/*
+ * Unreferenced dentries are kept on an LRU list (oldest first) so that
+ * repeated lookups of the same path do not go down to the filesystem.
+ */
+static UK_LIST_HEAD(dentry_lru);
+static unsigned int dentry_lru_len;
+#endif /* CONFIG_LIBVFSCORE_DCACHE_SIZE > 0 */
+
+#if CONFIG_LIBVFSCORE_DCACHE_NEGATIVE
+#define DENTRY_NEG_SLOTS	64
+#define DENTRY_NEG_NAMELEN	32
+
+/*
+ * Direct-mapped cache of names that were not found in a directory. The
+ * parent dentry pointer is only compared, never dereferenced; entries are
+ * purged when their parent dentry is freed.
+ */
+struct dentry_neg {
+	struct dentry	*n_parent;	/* NULL if slot is unused */
+	unsigned int	n_hash;
+	size_t		n_len;
+	char		n_name[DENTRY_NEG_NAMELEN];
+};
+
+static struct dentry_neg dentry_neg_table[DENTRY_NEG_SLOTS];
+#endif /* CONFIG_LIBVFSCORE_DCACHE_NEGATIVE */
+
 /*
- * Get the hash value from the mount point and path name.
- * XXX: replace with a better hash for 64-bit pointers.
+ * Get the hash value of a single path component.
  */
-static unsigned int
-dentry_hash(struct mount *mp, const char *path)
+unsigned int
+dentry_name_hash(const char *name, size_t len)
 {
-	unsigned int val = 0;
+	unsigned int val = 5381;
 
-	if (path) {
-		while (*path) {
-			val = ((val << 5) + val) + *path++;
-		}
+	while (len--)
+		val = ((val << 5) + val) + (unsigned char) *name++;
+	return val;
+}
+
+static inline unsigned int
+dentry_bucket(struct dentry *parent_dp, unsigned int hash)
+{
+	unsigned long p = (unsigned long) parent_dp;
+
+	return (hash ^ (unsigned int) (p >> 4) ^ (unsigned int) (p >> 16))
+		& (DENTRY_BUCKETS - 1);
+}
+
+static void
+dentry_set_name(struct dentry *dp)
+{
+	char *name = strrchr(dp->d_path, '/');
+
+	dp->d_name = name ? name + 1 : dp->d_path;
+	dp->d_namelen = strlen(dp->d_name);
+	dp->d_hash = dentry_name_hash(dp->d_name, dp->d_namelen);
+}
+
+#if CONFIG_LIBVFSCORE_DCACHE_NEGATIVE
+static inline struct dentry_neg *
+dentry_neg_slot(struct dentry *parent_dp, unsigned int hash)
+{
+	return &dentry_neg_table[dentry_bucket(parent_dp, hash)
+				 & (DENTRY_NEG_SLOTS - 1)];
+}
+
+static inline int
+dentry_neg_match(struct dentry_neg *n, struct dentry *parent_dp,
+		 const char *name, size_t len, unsigned int hash)
+{
+	return n->n_parent == parent_dp && n->n_hash == hash &&
+	       n->n_len == len && !memcmp(n->n_name, name, len);
+}
+
+static void
+dentry_neg_forget_locked(struct dentry *parent_dp, const char *name,
+			 size_t len, unsigned int hash)
+{
+	struct dentry_neg *n = dentry_neg_slot(parent_dp, hash);
+
+	if (dentry_neg_match(n, parent_dp, name, len, hash))
+		n->n_parent = NULL;
+}
+
+static void
+dentry_neg_purge_locked(struct dentry *parent_dp)
+{
+	int i;
+
+	for (i = 0; i < DENTRY_NEG_SLOTS; i++) {
+		if (dentry_neg_table[i].n_parent == parent_dp)
+			dentry_neg_table[i].n_parent = NULL;
 	}
-	return (val ^ (unsigned long) mp) & (DENTRY_BUCKETS - 1);
 }
+#else /* !CONFIG_LIBVFSCORE_DCACHE_NEGATIVE */
+#define dentry_neg_forget_locked(parent_dp, name, len, hash) do {} while (0)
+#define dentry_neg_purge_locked(parent_dp) do {} while (0)
+#endif /* !CONFIG_LIBVFSCORE_DCACHE_NEGATIVE */
+
+int
+dentry_neg_lookup(struct dentry *parent_dp, const char *name, size_t len,
+		  unsigned int hash)
+{
+#if CONFIG_LIBVFSCORE_DCACHE_NEGATIVE
+	int found;
+
+	uk_mutex_lock(&dentry_hash_lock);
+	found = dentry_neg_match(dentry_neg_slot(parent_dp, hash),
+				 parent_dp, name, len, hash);
+	uk_mutex_unlock(&dentry_hash_lock);
+	return found;
+#else /* !CONFIG_LIBVFSCORE_DCACHE_NEGATIVE */
+	return 0;
+#endif /* !CONFIG_LIBVFSCORE_DCACHE_NEGATIVE */
+}
+
+void
+dentry_neg_add(struct dentry *parent_dp, const char *name, size_t len,
+	       unsigned int hash)
+{
+#if CONFIG_LIBVFSCORE_DCACHE_NEGATIVE
+	struct dentry_neg *n;
+
+	if (len >= DENTRY_NEG_NAMELEN)
+		return;
+
+	uk_mutex_lock(&dentry_hash_lock);
+	n = dentry_neg_slot(parent_dp, hash);
+	n->n_parent = parent_dp;
+	n->n_hash = hash;
+	n->n_len = len;
+	memcpy(n->n_name, name, len);
+	uk_mutex_unlock(&dentry_hash_lock);
+#endif /* CONFIG_LIBVFSCORE_DCACHE_NEGATIVE */
+}
+
+void
+dentry_neg_forget(struct dentry *parent_dp, const char *name)
+{
+#if CONFIG_LIBVFSCORE_DCACHE_NEGATIVE
+	size_t len = strlen(name);
+
+	uk_mutex_lock(&dentry_hash_lock);
+	dentry_neg_forget_locked(parent_dp, name, len,
+				 dentry_name_hash(name, len));
+	uk_mutex_unlock(&dentry_hash_lock);
+#endif /* CONFIG_LIBVFSCORE_DCACHE_NEGATIVE */
+}
+
+/*
+ * Take a reference to a hashed dentry. Must be called with the hash lock
+ * held.
+ */
+static inline void
+dget_locked(struct dentry *dp)
+{
+#if CONFIG_LIBVFSCORE_DCACHE_SIZE > 0
+	if (dp->d_refcnt == 0) {
+		/* Revive a dentry from the LRU */
+		uk_list_del_init(&dp->d_lru_link);
+		dentry_lru_len--;
+	}
+#endif /* CONFIG_LIBVFSCORE_DCACHE_SIZE > 0 */
+	dp->d_refcnt++;
+}
+
+/*
+ * Release all resources of a dentry whose reference count dropped to zero
+ * and that is not on the LRU.
+ */
+static void
+dentry_free(struct dentry *dp)
+{
+	UK_ASSERT(dp->d_refcnt == 0);
+
+	uk_mutex_lock(&dentry_hash_lock);
+	uk_hlist_del_init(&dp->d_link);
+	vn_del_name(dp->d_vnode, dp);
+	dentry_neg_purge_locked(dp);
+	uk_mutex_unlock(&dentry_hash_lock);
+
+	if (dp->d_parent) {
+		uk_mutex_lock(&dp->d_parent->d_lock);
+		// Remove dp from its parent's children list.
+		uk_list_del(&dp->d_child_link);
+		uk_mutex_unlock(&dp->d_parent->d_lock);
 
+		drele(dp->d_parent);
+	}
+
+	vrele(dp->d_vnode);
+
+	free(dp->d_path);
+	free(dp);
+}
 
 struct dentry *
 dentry_alloc(struct dentry *parent_dp, struct vnode *vp, const char *path)
@@ -80,6 +264,7 @@ dentry_alloc(struct dentry *parent_dp, struct vnode *vp, const char *path)
 		free(dp);
 		return NULL;
 	}
+	dentry_set_name(dp);
 
 	vref(vp);
 
@@ -87,6 +272,7 @@ dentry_alloc(struct dentry *parent_dp, struct vnode *vp, const char *path)
 	dp->d_vnode = vp;
 	dp->d_mount = mp;
 	UK_INIT_LIST_HEAD(&dp->d_child_list);
+	UK_INIT_LIST_HEAD(&dp->d_lru_link);
 
 	if (parent_dp) {
 		dref(parent_dp);
@@ -101,38 +287,117 @@ dentry_alloc(struct dentry *parent_dp, struct vnode *vp, const char *path)
 	vn_add_name(vp, dp);
 
 	uk_mutex_lock(&dentry_hash_lock);
+	if (parent_dp)
+		dentry_neg_forget_locked(parent_dp, dp->d_name, dp->d_namelen,
+					 dp->d_hash);
 	uk_hlist_add_head(&dp->d_link,
-			  &dentry_hash_table[dentry_hash(mp, path)]);
+			  &dentry_hash_table[dentry_bucket(parent_dp,
+							   dp->d_hash)]);
 	uk_mutex_unlock(&dentry_hash_lock);
 	return dp;
 };
 
+static struct dentry *
+dentry_lookup_child_locked(struct dentry *parent_dp, const char *name,
+			   size_t len, unsigned int hash)
+{
+	struct dentry *dp;
+
+	uk_hlist_for_each_entry(dp, &dentry_hash_table[dentry_bucket(parent_dp,
+								     hash)],
+				d_link) {
+		if (dp->d_parent == parent_dp && dp->d_hash == hash &&
+		    dp->d_namelen == len && !memcmp(dp->d_name, name, len))
+			return dp;
+	}
+	return NULL;
+}
+
 struct dentry *
-dentry_lookup(struct mount *mp, char *path)
+dentry_lookup_child(struct dentry *parent_dp, const char *name, size_t len,
+		    unsigned int hash)
 {
 	struct dentry *dp;
 
 	uk_mutex_lock(&dentry_hash_lock);
-	uk_hlist_for_each_entry(dp, &dentry_hash_table[dentry_hash(mp, path)], d_link) {
-		if (dp->d_mount == mp && !strncmp(dp->d_path, path, PATH_MAX)) {
-			dp->d_refcnt++;
-			uk_mutex_unlock(&dentry_hash_lock);
-			return dp;
+	dp = dentry_lookup_child_locked(parent_dp, name, len, hash);
+	if (dp)
+		dget_locked(dp);
+	uk_mutex_unlock(&dentry_hash_lock);
+	return dp;
+}
+
+struct dentry *
+dentry_lookup_path(struct dentry *root_dp, const char *path)
+{
+	struct dentry *dp = root_dp;
+	const char *name;
+	size_t len;
+	int want_dir = 0;
+
+	uk_mutex_lock(&dentry_hash_lock);
+	while (*path != '\0') {
+		while (*path == '/') {
+			want_dir = 1;
+			path++;
 		}
+		if (*path == '\0')
+			break;
+		want_dir = 0;
+
+		/* Only directories can have children */
+		if (dp->d_vnode->v_type != VDIR)
+			goto miss;
+
+		name = path;
+		while (*path != '\0' && *path != '/')
+			path++;
+		len = path - name;
+
+		dp = dentry_lookup_child_locked(dp, name, len,
+						dentry_name_hash(name, len));
+		/* Symbolic links are resolved by namei() */
+		if (!dp || dp->d_vnode->v_type == VLNK)
+			goto miss;
 	}
+	/* A trailing '/' requires a directory; namei() reports ENOTDIR */
+	if (want_dir && dp->d_vnode->v_type != VDIR)
+		goto miss;
+	dget_locked(dp);
 	uk_mutex_unlock(&dentry_hash_lock);
-	return NULL;                /* not found */
+	return dp;
+
+miss:
+	uk_mutex_unlock(&dentry_hash_lock);
+	return NULL;
 }
 
-static void dentry_children_remove(struct dentry *dp)
+struct dentry *
+dentry_lookup(struct mount *mp, char *path)
+{
+	return dentry_lookup_path(mp->m_root, path);
+}
+
+static void dentry_children_remove(struct dentry *dp,
+				   struct uk_list_head *unused)
 {
 	struct dentry *entry = NULL;
 
 	uk_mutex_lock(&dp->d_lock);
 	uk_list_for_each_entry(entry, &dp->d_child_list, d_child_link) {
 		UK_ASSERT(entry);
+		uk_hlist_del_init(&entry->d_link);
+#if CONFIG_LIBVFSCORE_DCACHE_SIZE > 0
+		if (entry->d_refcnt == 0) {
+			/* Cannot be found anymore, drop it from the LRU */
+			uk_list_del(&entry->d_lru_link);
+			uk_list_add(&entry->d_lru_link, unused);
+			dentry_lru_len--;
+		}
+#else /* !(CONFIG_LIBVFSCORE_DCACHE_SIZE > 0) */
 		UK_ASSERT(entry->d_refcnt > 0);
-		uk_hlist_del(&entry->d_link);
+		(void) unused;
+#endif /* !(CONFIG_LIBVFSCORE_DCACHE_SIZE > 0) */
 	}
 	uk_mutex_unlock(&dp->d_lock);
 
@@ -144,6 +409,8 @@ dentry_move(struct dentry *dp, struct dentry *parent_dp, char *path)
 	struct dentry *old_pdp = dp->d_parent;
 	char *old_path = dp->d_path;
 	char *new_path = strdup(path);
+	struct dentry *entry, *tmp;
+	UK_LIST_HEAD(unused);
 
 	if (!new_path) {
 		// Fail before changing anything to the VFS
@@ -168,18 +435,28 @@ dentry_move(struct dentry *dp, struct dentry *parent_dp, char *path)
 
 	uk_mutex_lock(&dentry_hash_lock);
 	// Remove all dp's child dentries from the hashtable.
-	dentry_children_remove(dp);
+	dentry_children_remove(dp, &unused);
 	// Remove dp with outdated hash info from the hashtable.
-	uk_hlist_del(&dp->d_link);
+	uk_hlist_del_init(&dp->d_link);
 	// Update dp.
 	dp->d_path = new_path;
+	dentry_set_name(dp);
 
 	dp->d_parent = parent_dp;
+	if (parent_dp)
+		dentry_neg_forget_locked(parent_dp, dp->d_name, dp->d_namelen,
+					 dp->d_hash);
 	// Insert dp updated hash info into the hashtable.
 	uk_hlist_add_head(&dp->d_link,
-			  &dentry_hash_table[dentry_hash(dp->d_mount, path)]);
+			  &dentry_hash_table[dentry_bucket(parent_dp,
+							   dp->d_hash)]);
 	uk_mutex_unlock(&dentry_hash_lock);
 
+	uk_list_for_each_entry_safe(entry, tmp, &unused, d_lru_link) {
+		uk_list_del_init(&entry->d_lru_link);
+		dentry_free(entry);
+	}
+
 	if (old_pdp) {
 		drele(old_pdp);
 	}
@@ -192,12 +469,44 @@ void
 dentry_remove(struct dentry *dp)
 {
 	uk_mutex_lock(&dentry_hash_lock);
-	uk_hlist_del(&dp->d_link);
-	/* put it on a fake list for drele() to work*/
-	uk_hlist_add_head(&dp->d_link, &fake);
+	/* Unhashed dentries are freed by drele() instead of being cached */
+	uk_hlist_del_init(&dp->d_link);
 	uk_mutex_unlock(&dentry_hash_lock);
 }
 
+void
+dentry_purge_mount(struct mount *mp)
+{
+#if CONFIG_LIBVFSCORE_DCACHE_SIZE > 0
+	struct dentry *dp;
+	int found;
+
+	/*
+	 * Freeing a dentry may put its parent on the LRU, so scan until no
+	 * unused dentry of this mount is left.
+	 */
+	do {
+		found = 0;
+
+		uk_mutex_lock(&dentry_hash_lock);
+		uk_list_for_each_entry(dp, &dentry_lru, d_lru_link) {
+			if (dp->d_mount == mp) {
+				uk_list_del_init(&dp->d_lru_link);
+				dentry_lru_len--;
+				found = 1;
+				break;
+			}
+		}
+		uk_mutex_unlock(&dentry_hash_lock);
+
+		if (found)
+			dentry_free(dp);
+	} while (found);
+#else /* !(CONFIG_LIBVFSCORE_DCACHE_SIZE > 0) */
+	(void) mp;
+#endif /* !(CONFIG_LIBVFSCORE_DCACHE_SIZE > 0) */
+}
+
 void
 dref(struct dentry *dp)
 {
@@ -212,6 +521,10 @@ dref(struct dentry *dp)
 void
 drele(struct dentry *dp)
 {
+#if CONFIG_LIBVFSCORE_DCACHE_SIZE > 0
+	struct dentry *victim = NULL;
+#endif /* CONFIG_LIBVFSCORE_DCACHE_SIZE > 0 */
+
 	UK_ASSERT(dp);
 	UK_ASSERT(dp->d_refcnt > 0);
 
@@ -220,24 +533,31 @@ drele(struct dentry *dp)
 		uk_mutex_unlock(&dentry_hash_lock);
 		return;
 	}
-	uk_hlist_del(&dp->d_link);
-	vn_del_name(dp->d_vnode, dp);
-
-	uk_mutex_unlock(&dentry_hash_lock);
 
-	if (dp->d_parent) {
-		uk_mutex_lock(&dp->d_parent->d_lock);
-		// Remove dp from its parent's children list.
-		uk_list_del(&dp->d_child_link);
-		uk_mutex_unlock(&dp->d_parent->d_lock);
+#if CONFIG_LIBVFSCORE_DCACHE_SIZE > 0
+	/*
+	 * Keep hashed dentries around for later lookups. Mount roots and
+	 * anonymous dentries (e.g., pipes) have no parent and are not cached.
+	 */
+	if (dp->d_parent && !uk_hlist_unhashed(&dp->d_link)) {
+		uk_list_add_tail(&dp->d_lru_link, &dentry_lru);
+		if (++dentry_lru_len > CONFIG_LIBVFSCORE_DCACHE_SIZE) {
+			victim = uk_list_first_entry(&dentry_lru,
+						     struct dentry,
+						     d_lru_link);
+			uk_list_del_init(&victim->d_lru_link);
+			dentry_lru_len--;
+		}
+		uk_mutex_unlock(&dentry_hash_lock);
 
-		drele(dp->d_parent);
+		if (victim)
+			dentry_free(victim);
+		return;
 	}
+#endif /* CONFIG_LIBVFSCORE_DCACHE_SIZE > 0 */
+	uk_mutex_unlock(&dentry_hash_lock);
 
-	vrele(dp->d_vnode);
-
-	free(dp->d_path);
-	free(dp);
+	dentry_free(dp);
 }
 
 void
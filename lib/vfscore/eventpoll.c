@@ -430,6 +430,35 @@ int eventpoll_wait(struct eventpoll *ep, struct epoll_event *events,
 	return n;
 }
 
+static void eventpoll_probe_unregister(struct eventpoll_cb *ecb __unused)
+{
+}
+
+unsigned int eventpoll_probe(struct vfscore_file *fp, unsigned int events)
+{
+	struct eventpoll_cb ecb;
+	struct vnode *vnode;
+	unsigned int revents = 0;
+	int ret;
+
+	UK_ASSERT(fp);
+	UK_ASSERT(fp->f_dentry);
+
+	vnode = fp->f_dentry->d_vnode;
+	UK_ASSERT(vnode->v_op->vop_poll);
+
+	/* Looks already registered to the driver, so it is not linked */
+	ecb.unregister = eventpoll_probe_unregister;
+	ecb.data = NULL;
+	UK_INIT_LIST_HEAD(&ecb.cb_link);
+
+	ret = VOP_POLL(vnode, &revents, &ecb);
+	if (unlikely(ret))
+		return EPOLLERR;
+
+	return revents & (events | EPERR_SET);
+}
+
 void eventpoll_signal(struct eventpoll_cb *ecb, unsigned int revents)
 {
 	struct eventpoll *ep;
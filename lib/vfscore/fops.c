@@ -100,6 +100,8 @@ int vfs_write(struct vfscore_file *fp, struct uio *uio, int flags)
 		ioflags |= IO_APPEND;
 	if (fp->f_flags & (O_DSYNC|O_SYNC))
 		ioflags |= IO_SYNC;
+	if (fp->f_flags & O_NONBLOCK)
+		ioflags |= IO_NDELAY;
 
 	if ((flags & FOF_OFFSET) == 0)
 		uio->uio_offset = fp->f_offset;
@@ -36,6 +36,7 @@
 
 #include <uk/mutex.h>
 #include <uk/list.h>
+#include <stddef.h>
 
 struct vnode;
 
@@ -43,6 +44,9 @@ struct dentry {
 	struct uk_hlist_node d_link;	/* link for hash list */
 	int		d_refcnt;	/* reference count */
 	char		*d_path;	/* pointer to path in fs */
+	const char	*d_name;	/* last component of d_path */
+	size_t		d_namelen;	/* length of d_name */
+	unsigned int	d_hash;		/* hash of d_name */
 	struct vnode	*d_vnode;
 	struct mount	*d_mount;
 	struct dentry   *d_parent; /* pointer to parent */
@@ -50,10 +54,21 @@ struct dentry {
 	struct uk_mutex	d_lock;
 	struct uk_list_head d_child_list;
 	struct uk_list_head d_child_link;
+	struct uk_list_head d_lru_link;	/* link for unused dentries */
 };
 
 struct dentry *dentry_alloc(struct dentry *parent_dp, struct vnode *vp, const char *path);
 struct dentry *dentry_lookup(struct mount *mp, char *path);
+unsigned int dentry_name_hash(const char *name, size_t len);
+struct dentry *dentry_lookup_child(struct dentry *parent_dp, const char *name,
+				   size_t len, unsigned int hash);
+struct dentry *dentry_lookup_path(struct dentry *root_dp, const char *path);
+int dentry_neg_lookup(struct dentry *parent_dp, const char *name, size_t len,
+		      unsigned int hash);
+void dentry_neg_add(struct dentry *parent_dp, const char *name, size_t len,
+		    unsigned int hash);
+void dentry_neg_forget(struct dentry *parent_dp, const char *name);
+void dentry_purge_mount(struct mount *mp);
 int dentry_move(struct dentry *dp, struct dentry *parent_dp, char *path);
 void dentry_remove(struct dentry *dp);
 void dref(struct dentry *dp);
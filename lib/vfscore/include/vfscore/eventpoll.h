@@ -66,8 +66,10 @@ struct eventpoll_cb {
 	 *
 	 * The driver must add the eventpoll file description, which this
 	 * context block belongs to, to its internal signal only on the first
-	 * call to VOP_POLL(). The driver can check the unregister callback
-	 * field for NULL or use the additional data field for this purpose.
+	 * call to VOP_POLL(). The driver must check the unregister callback
+	 * field for NULL for this purpose: eventpoll_probe() passes context
+	 * blocks with a dummy unregister callback to query the current events
+	 * without being added to the signal list.
 	 *
 	 * After a call to the unregister callback the driver must not access
 	 * this data structure anymore!
@@ -302,6 +304,18 @@ int eventpoll_wait(struct eventpoll *ep, struct epoll_event *events,
  */
 void eventpoll_signal(struct eventpoll_cb *ecb, unsigned int revents);
 
+/**
+ * Poll the current events of a file without registering for event signaling.
+ * This is cheaper than setting up an eventpoll if events are pending or the
+ * caller does not want to block.
+ *
+ * @param fp the VFS file object to poll
+ * @param events the events of interest. Error events are always reported
+ *
+ * @return the pending events of interest, EPOLLERR if the poll failed
+ */
+unsigned int eventpoll_probe(struct vfscore_file *fp, unsigned int events);
+
 /**
  * @internal Called by VFS to inform the eventpoll API that a file description
  * is closed and the respective file should be removed from all eventpolls
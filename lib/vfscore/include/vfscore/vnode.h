@@ -66,6 +66,9 @@ enum vtype {
 	VEPOLL,	    /* epoll */
 	VEVENT,	    /* eventfd */
 #endif /* CONFIG_LIBPOSIX_EVENT */
+#ifdef CONFIG_LIBPOSIX_IOURING
+	VURING,	    /* io_uring */
+#endif /* CONFIG_LIBPOSIX_IOURING */
 	VBAD
 };
 
@@ -144,6 +147,7 @@ struct vattr {
 
 #define IO_APPEND	0x0001
 #define IO_SYNC		0x0002
+#define IO_NDELAY	0x0004
 
 /*
  * ARC actions
@@ -62,15 +62,39 @@ read_link(struct vnode *vp, char *buf, size_t bufsz, ssize_t *sz)
 	return (0);
 }
 
+/*
+ * Build the in-filesystem path of a child dentry
+ *
+ * @ddp:  parent dentry.
+ * @name: NUL-terminated component name.
+ * @node: buffer of PATH_MAX bytes for the resulting path.
+ */
+static void
+namei_child_path(struct dentry *ddp, const char *name, char *node)
+{
+	strlcpy(node, ddp->d_path, PATH_MAX);
+	if (node[0] != '/' || node[1] != '\0')
+		strlcat(node, "/", PATH_MAX);
+	strlcat(node, name, PATH_MAX);
+}
+
+/*
+ * Replace a symbolic link in a path by its target
+ *
+ * @dp:   dentry of the symbolic link.
+ * @fp:   full path name that is rewritten in place.
+ * @name: start of the link component within @fp.
+ * @rest: remainder of @fp after the link component.
+ */
 int
-namei_follow_link(struct dentry *dp, char *node, char *name, char *fp, size_t mountpoint_len)
+namei_follow_link(struct dentry *dp, char *fp, char *name, char *rest)
 {
 	char link[PATH_MAX];
 	char t[PATH_MAX];
+	char dir[PATH_MAX];
 	int     error;
 	ssize_t sz;
-	char    *p;
-	int     c;
+	size_t  len;
 
 	error = read_link(dp->d_vnode, link, PATH_MAX, &sz);
 	if (error != 0) {
@@ -78,40 +102,49 @@ namei_follow_link(struct dentry *dp, char *node, char *name, char *fp, size_t mo
 	}
 	link[sz] = 0;
 
-	p = fp + mountpoint_len + strlen(node);
-	c = strlen(node) - strlen(name) - 1;
-	node[c] = 0;
-
 	if (link[0] == '/') {
-		strlcat(link, p, PATH_MAX);
+		strlcat(link, rest, PATH_MAX);
 		strlcpy(fp, link, PATH_MAX);
 	} else {
-		strlcpy(t, p, PATH_MAX);
-		strlcpy(node, fp, mountpoint_len + c + 1);
-		path_conv(node, link, fp);
+		strlcpy(t, rest, PATH_MAX);
+
+		/* Resolve relative to the directory containing the link */
+		*name = '\0';
+		strlcpy(dir, fp, PATH_MAX);
+		len = strlen(dir);
+		while (len > 1 && dir[len - 1] == '/')
+			dir[--len] = '\0';
+
+		path_conv(dir, link, fp);
 		strlcat(fp, t, PATH_MAX);
 	}
-	node[0] = 0;
-	name[0] = 0;
 	return (0);
 }
+
 /*
  * Convert a pathname into a pointer to a dentry
  *
+ * Paths are resolved component by component: each component is looked up
+ * in the dentry cache by its parent dentry and name, and only handed to the
+ * filesystem on a miss. If every component of a path is already cached,
+ * the whole path is resolved without taking any vnode lock.
+ *
  * @path: full path name.
  * @dpp:  dentry to be returned.
  */
 int
 namei(const char *path, struct dentry **dpp)
 {
-	char *p;
+	char *p, *comp;
 	char node[PATH_MAX];
 	char name[PATH_MAX];
 	char fp[PATH_MAX];
 	struct mount *mp;
 	struct dentry *dp, *ddp;
 	struct vnode *dvp, *vp;
-	int error, i;
+	unsigned int hash;
+	size_t len;
+	int error;
 	int links_followed;
 	int need_continue;
 
@@ -129,27 +162,25 @@ namei(const char *path, struct dentry **dpp)
 		if (vfs_findroot(fp, &mp, &p)) {
 			return ENOTDIR;
 		}
-		int mountpoint_len = p - fp - 1;
-		strlcpy(node, "/", sizeof(node));
-		strlcat(node, p, sizeof(node));
-		dp = dentry_lookup(mp, node);
+		ddp = mp->m_root;
+		if (!ddp) {
+			UK_CRASH("VFS: no root");
+		}
+
+		/* Fast path: all components are in the dentry cache */
+		dp = dentry_lookup_path(ddp, p);
 		if (dp) {
-			/* vnode is already active. */
 			*dpp = dp;
 			return 0;
 		}
+
 		/*
 		 * Find target vnode, started from root directory.
 		 * This is done to attach the fs specific data to
 		 * the target vnode.
 		 */
-		ddp = mp->m_root;
-		if (!ddp) {
-			UK_CRASH("VFS: no root");
-		}
 		dref(ddp);
-
-		node[0] = '\0';
+		dp = ddp;
 
 		while (*p != '\0') {
 			/*
@@ -163,46 +194,58 @@ namei(const char *path, struct dentry **dpp)
 				break;
 			}
 
-			for (i = 0; i < PATH_MAX; i++) {
-				if (*p == '\0' || *p == '/') {
-					break;
-				}
-				name[i] = *p++;
+			comp = p;
+			while (*p != '\0' && *p != '/') {
+				p++;
 			}
-			name[i] = '\0';
+			len = p - comp;
+			hash = dentry_name_hash(comp, len);
 
-			/*
-			 * Get a vnode for the target.
-			 */
-			strlcat(node, "/", sizeof(node));
-			strlcat(node, name, sizeof(node));
-			dvp = ddp->d_vnode;
-			vn_lock(dvp);
-			dp = dentry_lookup(mp, node);
+			dp = dentry_lookup_child(ddp, comp, len, hash);
 			if (dp == NULL) {
-				/* Find a vnode in this directory. */
-				error = VOP_LOOKUP(dvp, name, &vp);
-				if (error) {
-					vn_unlock(dvp);
-					drele(ddp);
-					return error;
-				}
-
-				dp = dentry_alloc(ddp, vp, node);
-				vput(vp);
-
-				if (!dp) {
-					vn_unlock(dvp);
-					drele(ddp);
-					return ENOMEM;
+				memcpy(name, comp, len);
+				name[len] = '\0';
+
+				dvp = ddp->d_vnode;
+				vn_lock(dvp);
+				/* Recheck, we may have raced with a lookup */
+				dp = dentry_lookup_child(ddp, comp, len, hash);
+				if (dp == NULL) {
+					/* Find a vnode in this directory. */
+					if (dentry_neg_lookup(ddp, comp, len,
+							      hash))
+						error = ENOENT;
+					else
+						error = VOP_LOOKUP(dvp, name,
+								   &vp);
+					if (error) {
+						if (error == ENOENT)
+							dentry_neg_add(ddp,
+								       comp,
+								       len,
+								       hash);
+						vn_unlock(dvp);
+						drele(ddp);
+						return error;
+					}
+
+					namei_child_path(ddp, name, node);
+					dp = dentry_alloc(ddp, vp, node);
+					vput(vp);
+
+					if (!dp) {
+						vn_unlock(dvp);
+						drele(ddp);
+						return ENOMEM;
+					}
 				}
+				vn_unlock(dvp);
 			}
-			vn_unlock(dvp);
 			drele(ddp);
 			ddp = dp;
 
 			if (dp->d_vnode->v_type == VLNK) {
-				error = namei_follow_link(dp, node, name, fp, mountpoint_len);
+				error = namei_follow_link(dp, fp, comp, p);
 				if (error) {
 					drele(dp);
 					return (error);
@@ -210,13 +253,10 @@ namei(const char *path, struct dentry **dpp)
 
 				drele(dp);
 
-				p       = fp;
 				dp      = NULL;
 				ddp     = NULL;
 				vp      = NULL;
 				dvp     = NULL;
-				name[0] = 0;
-				node[0] = 0;
 
 				if (++links_followed >= MAXSYMLINKS) {
 					return (ELOOP);
@@ -248,11 +288,11 @@ namei_last_nofollow(char *path, struct dentry *ddp, struct dentry **dpp)
 {
 	char          *name;
 	int           error;
-	struct mount  *mp;
-	char          *p;
 	struct dentry *dp;
 	struct vnode  *dvp;
 	struct vnode  *vp;
+	unsigned int  hash;
+	size_t        len;
 	char node[PATH_MAX];
 
 	dvp  = NULL;
@@ -267,30 +307,34 @@ namei_last_nofollow(char *path, struct dentry *ddp, struct dentry **dpp)
 	}
 	name++;
 
-	error = vfs_findroot(path, &mp, &p);
-	if (error != 0) {
-		return (ENOTDIR);
+	// We want to treat things like /tmp/ the same as /tmp. In that case
+	// the lookup already gave us the dentry we are looking for.
+	if (*name == '\0') {
+		dref(ddp);
+		*dpp = ddp;
+		return (0);
 	}
 
-	strlcpy(node, "/", PATH_MAX);
-	strlcat(node, p, PATH_MAX);
-
-	// We want to treat things like /tmp/ the same as /tmp. Best way to do that
-	// is to ignore the last character, except when we're stating the root.
-	int l = strlen(node) - 1;
-	if (l && node[l] == '/') {
-		node[l] = '\0';
-	}
+	len  = strlen(name);
+	hash = dentry_name_hash(name, len);
 
 	dvp = ddp->d_vnode;
 	vn_lock(dvp);
-	dp = dentry_lookup(mp, node);
+	dp = dentry_lookup_child(ddp, name, len, hash);
 	if (dp == NULL) {
+		if (dentry_neg_lookup(ddp, name, len, hash)) {
+			error = ENOENT;
+			goto out;
+		}
+
 		error = VOP_LOOKUP(dvp, name, &vp);
 		if (error != 0) {
+			if (error == ENOENT)
+				dentry_neg_add(ddp, name, len, hash);
 			goto out;
 		}
 
+		namei_child_path(ddp, name, node);
 		dp = dentry_alloc(ddp, vp, node);
 		vput(vp);
 
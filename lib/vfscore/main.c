@@ -1990,6 +1990,12 @@ UK_LLSYSCALL_R_DEFINE(int, fcntl, int, fd, unsigned int, cmd, int, arg)
 			goto out_errno;
 		fp->f_flags |= O_CLOEXEC;
 		break;
+	case F_SETPIPE_SZ:
+		error = pipe_set_size(fp, arg, &ret);
+		break;
+	case F_GETPIPE_SZ:
+		error = pipe_get_size(fp, &ret);
+		break;
 	case F_SETLK:
 		uk_pr_warn_once("fcntl(F_SETLK) stubbed\n");
 		break;
@@ -2026,7 +2032,8 @@ int fcntl(int fd, int cmd, ...)
 
 	va_start(ap, cmd);
 	if (cmd == F_SETFD ||
-	    cmd == F_SETFL) {
+	    cmd == F_SETFL ||
+	    cmd == F_SETPIPE_SZ) {
 		arg = va_arg(ap, int);
 	}
 	va_end(ap);
@@ -291,6 +291,9 @@ found:
 		goto out;
 	}
 
+	/* Drop unused cached dentries still referencing this mount */
+	dentry_purge_mount(mp);
+
 	if ((error = VFS_UNMOUNT(mp, flags)) != 0)
 		goto out;
 	uk_list_del_init(&mp->mnt_list);
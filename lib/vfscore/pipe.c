@@ -31,33 +31,64 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define _GNU_SOURCE
 #include <uk/config.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
 #include <vfscore/file.h>
 #include <vfscore/fs.h>
 #include <vfscore/mount.h>
 #include <vfscore/vnode.h>
 #include <vfscore/eventpoll.h>
+#include <vfscore/uio.h>
+#include <uk/alloc.h>
+#include <uk/arch/limits.h>
 #include <uk/wait.h>
 #include <uk/syscall.h>
 #include <sys/ioctl.h>
-#include <uk/syscall.h>
+#include "vfs.h"
 
 /* We use the default size in Linux kernel */
 #define PIPE_MAX_SIZE	(1 << CONFIG_LIBVFSCORE_PIPE_SIZE_ORDER)
 
+/* Upper bound for F_SETPIPE_SZ */
+#define PIPE_SIZE_LIMIT	(1 << 30)
+
+/* Number of pages moved per step by splice() */
+#define PIPE_SPLICE_IOV	16
+
+/*
+ * The pipe is a ring of slots that each describe up to one page of data.
+ * All pages are owned by the pipe and recycled once read. splice() moves
+ * them to and from files without copying them again.
+ */
+struct pipe_slot {
+	/* Start of the unread data */
+	char *base;
+	/* Number of unread bytes */
+	unsigned long len;
+	/* Backing page */
+	void *page;
+};
+
 struct pipe_buf {
-	/* The buffer */
-	char *data;
-	/* The buffer capacity, always a power of 2 */
-	unsigned long capacity;
-	/* Producer index */
+	/* The slot ring */
+	struct pipe_slot *slots;
+	/* Number of slots, always a power of 2 */
+	unsigned long nslots;
+	/* Producer slot index */
 	unsigned long prod;
-	/* Consumer index */
+	/* Consumer slot index */
 	unsigned long cons;
+	/* Number of unread bytes */
+	unsigned long bytes;
+	/* Cached page for the next write */
+	void *spare;
 
+	/* Ring lock, held at most for copying one page */
+	struct uk_mutex lock;
 	/* Read lock */
 	struct uk_mutex rdlock;
 	/* Write lock */
@@ -69,9 +100,7 @@ struct pipe_buf {
 	struct uk_waitq wrwq;
 };
 
-#define PIPE_BUF_IDX(buf, n)    ((n) & ((buf)->capacity - 1))
-#define PIPE_BUF_PROD_IDX(buf)  PIPE_BUF_IDX((buf), (buf)->prod)
-#define PIPE_BUF_CONS_IDX(buf)  PIPE_BUF_IDX((buf), (buf)->cons)
+#define PIPE_BUF_SLOT(buf, n)   (&(buf)->slots[(n) & ((buf)->nslots - 1)])
 
 struct pipe_file {
 	/* Pipe buffer */
@@ -89,26 +118,56 @@ struct pipe_file {
 	struct uk_list_head evp_list;
 };
 
+static unsigned long pipe_size_to_nslots(unsigned long size)
+{
+	unsigned long nslots = 1;
+
+	while (nslots * __PAGE_SIZE < size)
+		nslots <<= 1;
+
+	return nslots;
+}
+
+static void *pipe_page_get(struct pipe_buf *pipe_buf)
+{
+	void *page = pipe_buf->spare;
+
+	if (page) {
+		pipe_buf->spare = NULL;
+		return page;
+	}
+
+	return uk_palloc(uk_alloc_get_default(), 1);
+}
+
+static void pipe_page_put(struct pipe_buf *pipe_buf, void *page)
+{
+	if (!pipe_buf->spare)
+		pipe_buf->spare = page;
+	else
+		uk_pfree(uk_alloc_get_default(), page, 1);
+}
 
 static struct pipe_buf *pipe_buf_alloc(int capacity)
 {
 	struct pipe_buf *pipe_buf;
 
-	UK_ASSERT(POWER_OF_2(capacity));
-
 	pipe_buf = malloc(sizeof(*pipe_buf));
 	if (!pipe_buf)
 		return NULL;
 
-	pipe_buf->data = malloc(capacity);
-	if (!pipe_buf->data) {
+	pipe_buf->nslots = pipe_size_to_nslots(capacity);
+	pipe_buf->slots = calloc(pipe_buf->nslots, sizeof(*pipe_buf->slots));
+	if (!pipe_buf->slots) {
 		free(pipe_buf);
 		return NULL;
 	}
 
-	pipe_buf->capacity = capacity;
 	pipe_buf->cons = 0;
 	pipe_buf->prod = 0;
+	pipe_buf->bytes = 0;
+	pipe_buf->spare = NULL;
+	uk_mutex_init(&pipe_buf->lock);
 	uk_mutex_init(&pipe_buf->rdlock);
 	uk_mutex_init(&pipe_buf->wrlock);
 	uk_waitq_init(&pipe_buf->rdwq);
@@ -119,28 +178,53 @@ static struct pipe_buf *pipe_buf_alloc(int capacity)
 
 void pipe_buf_free(struct pipe_buf *pipe_buf)
 {
-	free(pipe_buf->data);
+	struct pipe_slot *slot;
+
+	for (; pipe_buf->cons != pipe_buf->prod; pipe_buf->cons++) {
+		slot = PIPE_BUF_SLOT(pipe_buf, pipe_buf->cons);
+		uk_pfree(uk_alloc_get_default(), slot->page, 1);
+	}
+	if (pipe_buf->spare)
+		uk_pfree(uk_alloc_get_default(), pipe_buf->spare, 1);
+
+	free(pipe_buf->slots);
 	free(pipe_buf);
 }
 
 static unsigned long pipe_buf_get_available(const struct pipe_buf *pipe_buf)
 {
-	return pipe_buf->prod - pipe_buf->cons;
+	return pipe_buf->bytes;
+}
+
+static unsigned long pipe_buf_get_free_slots(const struct pipe_buf *pipe_buf)
+{
+	return pipe_buf->nslots - (pipe_buf->prod - pipe_buf->cons);
 }
 
-static unsigned long pipe_buf_get_free_space(struct pipe_buf *pipe_buf)
+/* Returns the last slot if it has room for more data */
+static struct pipe_slot *pipe_buf_tail_slot(struct pipe_buf *pipe_buf)
 {
-	return pipe_buf->capacity - pipe_buf_get_available(pipe_buf);
+	struct pipe_slot *slot;
+
+	if (pipe_buf->prod == pipe_buf->cons)
+		return NULL;
+
+	slot = PIPE_BUF_SLOT(pipe_buf, pipe_buf->prod - 1);
+	if (slot->base + slot->len == (char *)slot->page + __PAGE_SIZE)
+		return NULL;
+
+	return slot;
 }
 
 static int pipe_buf_can_write(struct pipe_buf *pipe_buf)
 {
-	return pipe_buf_get_free_space(pipe_buf) > 0;
+	return pipe_buf_get_free_slots(pipe_buf) > 0 ||
+	       pipe_buf_tail_slot(pipe_buf);
 }
 
 static int pipe_buf_can_read(struct pipe_buf *pipe_buf)
 {
-	return pipe_buf_get_available(pipe_buf) > 0;
+	return pipe_buf->prod != pipe_buf->cons;
 }
 
 static int pipe_file_can_read(struct pipe_file *pipe_file)
@@ -148,82 +232,114 @@ static int pipe_file_can_read(struct pipe_file *pipe_file)
 	return pipe_buf_can_read(pipe_file->buf) || !(pipe_file->w_refcount);
 }
 
-static unsigned long pipe_buf_write(struct pipe_buf *pipe_buf,
-		struct iovec *iovec, size_t iovec_off)
+/*
+ * Writers only block on a full ring, so waiting for a free slot is enough.
+ * Unlike pipe_buf_can_write(), this is safe without the ring lock.
+ */
+static int pipe_file_can_write(struct pipe_file *pipe_file)
 {
-	unsigned long prod_idx, to_write;
-	void *iovec_data = iovec->iov_base + iovec_off;
-	size_t iov_len = iovec->iov_len - iovec_off;
+	return pipe_buf_get_free_slots(pipe_file->buf) > 0 ||
+	       !(pipe_file->r_refcount);
+}
 
-	prod_idx = PIPE_BUF_PROD_IDX(pipe_buf);
-	to_write = MIN(pipe_buf_get_free_space(pipe_buf), iov_len);
-	if (to_write == 0)
-		goto out;
+/*
+ * Copies into the last owned page, or into a new one. Returns the number of
+ * bytes written (at most one page), 0 if the pipe is full, or -ENOMEM.
+ * Must be called with the ring lock held.
+ */
+static long pipe_buf_write(struct pipe_buf *pipe_buf,
+		const char *data, unsigned long len)
+{
+	struct pipe_slot *slot;
+	unsigned long to_write;
+	void *page;
+
+	slot = pipe_buf_tail_slot(pipe_buf);
+	if (!slot) {
+		if (!pipe_buf_get_free_slots(pipe_buf))
+			return 0;
+
+		page = pipe_page_get(pipe_buf);
+		if (!page)
+			return -ENOMEM;
+
+		slot = PIPE_BUF_SLOT(pipe_buf, pipe_buf->prod);
+		slot->page = page;
+		slot->base = page;
+		slot->len = 0;
+		pipe_buf->prod++;
+	}
 
-	/* Copy in one piece */
-	if (prod_idx + to_write <= pipe_buf->capacity)
-		memcpy(pipe_buf->data + prod_idx, iovec_data, to_write);
+	to_write = (char *)slot->page + __PAGE_SIZE - (slot->base + slot->len);
+	to_write = MIN(to_write, len);
+	memcpy(slot->base + slot->len, data, to_write);
 
-	else {
-		int first_copy_bytes, second_copy_bytes;
+	slot->len += to_write;
+	pipe_buf->bytes += to_write;
 
-		/* Copy the first part */
-		first_copy_bytes = pipe_buf->capacity - prod_idx;
-		memcpy(pipe_buf->data + prod_idx,
-				iovec_data,
-				first_copy_bytes);
+	return to_write;
+}
 
-		/* Copy the second part */
-		second_copy_bytes = prod_idx + to_write - pipe_buf->capacity;
-		memcpy(pipe_buf->data,
-				iovec_data + first_copy_bytes,
-				second_copy_bytes);
-	}
+/* Queues a filled page owned by the pipe. The ring must have a free slot. */
+static void pipe_buf_push_page(struct pipe_buf *pipe_buf,
+		void *page, unsigned long len)
+{
+	struct pipe_slot *slot;
 
-	/* Update producer */
-	pipe_buf->prod += to_write;
+	UK_ASSERT(pipe_buf_get_free_slots(pipe_buf) > 0);
+	UK_ASSERT(len > 0 && len <= __PAGE_SIZE);
 
-out:
-	return to_write;
+	slot = PIPE_BUF_SLOT(pipe_buf, pipe_buf->prod);
+	slot->page = page;
+	slot->base = page;
+	slot->len = len;
+	pipe_buf->prod++;
+	pipe_buf->bytes += len;
 }
 
-static unsigned long pipe_buf_read(struct pipe_buf *pipe_buf,
-		struct iovec *iovec, size_t iovec_off)
+/* Drops len bytes from the head of the pipe and recycles drained pages */
+static void pipe_buf_consume(struct pipe_buf *pipe_buf, unsigned long len)
 {
-	unsigned long cons_idx, to_read;
-	void *iovec_data = iovec->iov_base + iovec_off;
-	size_t iov_len = iovec->iov_len - iovec_off;
-
-	cons_idx = PIPE_BUF_CONS_IDX(pipe_buf);
-	to_read = MIN(pipe_buf_get_available(pipe_buf), iov_len);
-	if (to_read == 0)
-		goto out;
+	struct pipe_slot *slot;
+	unsigned long n;
 
-	/* Copy in one piece */
-	if (cons_idx + to_read <= pipe_buf->capacity)
-		memcpy(iovec_data, pipe_buf->data + cons_idx, to_read);
+	UK_ASSERT(len <= pipe_buf->bytes);
 
-	else {
-		int first_copy_bytes;
-		int second_copy_bytes;
+	while (len > 0) {
+		slot = PIPE_BUF_SLOT(pipe_buf, pipe_buf->cons);
+		n = MIN(slot->len, len);
 
-		/* Copy the first part */
-		first_copy_bytes = pipe_buf->capacity - pipe_buf->cons;
-		memcpy(iovec_data,
-				pipe_buf->data + cons_idx,
-				first_copy_bytes);
+		slot->base += n;
+		slot->len -= n;
+		pipe_buf->bytes -= n;
+		len -= n;
 
-		/* Copy the second part */
-		second_copy_bytes = cons_idx + to_read - pipe_buf->capacity;
-		memcpy(iovec_data + first_copy_bytes,
-				pipe_buf->data,
-				second_copy_bytes);
+		if (slot->len == 0) {
+			pipe_page_put(pipe_buf, slot->page);
+			slot->page = NULL;
+			pipe_buf->cons++;
+		}
 	}
+}
 
-	/* Update consumer */
-	pipe_buf->cons += to_read;
+/*
+ * Copies out of the first slot. Returns the number of bytes read (at most
+ * one page). Must be called with the ring lock held.
+ */
+static unsigned long pipe_buf_read(struct pipe_buf *pipe_buf,
+		char *data, unsigned long len)
+{
+	struct pipe_slot *slot;
+	unsigned long to_read;
+
+	if (!pipe_buf_can_read(pipe_buf))
+		return 0;
+
+	slot = PIPE_BUF_SLOT(pipe_buf, pipe_buf->cons);
+	to_read = MIN(slot->len, len);
+	memcpy(data, slot->base, to_read);
+	pipe_buf_consume(pipe_buf, to_read);
 
-out:
 	return to_read;
 }
 
@@ -294,129 +410,156 @@ pipe_file_unregister_eventpoll(struct eventpoll_cb *ecb)
 	uk_mutex_unlock(&pipe_file->evp_lock);
 }
 
-static int pipe_write(struct vnode *vnode,
-		struct uio *buf, int ioflag __unused)
+static int pipe_do_write(struct pipe_file *pipe_file, struct uio *buf,
+		bool nonblocking)
 {
-	struct pipe_file *pipe_file = vnode->v_data;
 	struct pipe_buf *pipe_buf = pipe_file->buf;
-	bool nonblocking = false; /* TODO handle nonblocking */
-	bool data_available = true;
-	int uio_idx = 0;
+	ssize_t resid = buf->uio_resid;
+	bool wake = false;
+	int uio_idx;
+	int ret = 0;
 
 	if (!pipe_file->r_refcount) {
 		/* TODO before returning the error, send a SIGPIPE signal */
-		return -EPIPE;
+		return EPIPE;
 	}
 
 	uk_mutex_lock(&pipe_buf->wrlock);
-	while (data_available && uio_idx < buf->uio_iovcnt) {
+	for (uio_idx = 0; uio_idx < buf->uio_iovcnt; uio_idx++) {
 		struct iovec *iovec = &buf->uio_iov[uio_idx];
 		unsigned long off = 0;
 
 		while (off < iovec->iov_len) {
-			unsigned long written_bytes;
-
-			written_bytes = pipe_buf_write(pipe_buf, iovec, off);
-			if (written_bytes == 0) {
-				/* No data */
-				if (nonblocking) {
-					data_available = false;
-					break;
-
-				} else {
-					/* Wait until data available */
-					while (!pipe_buf_can_write(pipe_buf)) {
-						uk_mutex_unlock(&pipe_buf->wrlock);
-						uk_waitq_wait_event(&pipe_buf->wrwq,
-							pipe_buf_can_write(pipe_buf));
-						uk_mutex_lock(&pipe_buf->wrlock);
-					}
-				}
-
-			} else {
+			const char *data = (char *)iovec->iov_base + off;
+			long written_bytes;
+
+			uk_mutex_lock(&pipe_buf->lock);
+			written_bytes = pipe_buf_write(pipe_buf,
+					data, iovec->iov_len - off);
+			uk_mutex_unlock(&pipe_buf->lock);
+
+			if (written_bytes < 0) {
+				ret = -written_bytes;
+				goto out;
+			}
+
+			if (written_bytes > 0) {
 				/* Update bytes written_bytes. */
 				buf->uio_resid -= written_bytes;
-
 				off += written_bytes;
+				wake = true;
+				continue;
+			}
 
-				/* wake some readers */
+			/* No space */
+			if (nonblocking) {
+				ret = EAGAIN;
+				goto out;
+			}
+
+			/* Let readers drain the pipe before we sleep */
+			if (wake) {
 				uk_waitq_wake_up(&pipe_buf->rdwq);
 				pipe_file_event(pipe_file,
 						EPOLLIN | EPOLLRDNORM);
+				wake = false;
 			}
-		}
 
-		uio_idx++;
+			uk_mutex_unlock(&pipe_buf->wrlock);
+			uk_waitq_wait_event(&pipe_buf->wrwq,
+					    pipe_file_can_write(pipe_file));
+			uk_mutex_lock(&pipe_buf->wrlock);
+
+			if (!pipe_file->r_refcount) {
+				ret = EPIPE;
+				goto out;
+			}
+		}
 	}
+
+out:
 	uk_mutex_unlock(&pipe_buf->wrlock);
 
-	return 0;
+	if (wake) {
+		/* wake some readers */
+		uk_waitq_wake_up(&pipe_buf->rdwq);
+		pipe_file_event(pipe_file, EPOLLIN | EPOLLRDNORM);
+	}
+
+	/* Partial writes are reported as short counts */
+	return (buf->uio_resid != resid) ? 0 : ret;
 }
 
-static int pipe_read(struct vnode *vnode,
-		struct vfscore_file *vfscore_file,
-		struct uio *buf, int ioflag __unused)
+static int pipe_do_read(struct pipe_file *pipe_file, struct uio *buf,
+		bool nonblocking)
 {
-	struct pipe_file *pipe_file = vnode->v_data;
 	struct pipe_buf *pipe_buf = pipe_file->buf;
-	bool nonblocking = (vfscore_file->f_flags & O_NONBLOCK);
-	bool data_available = true;
-	int uio_idx = 0;
+	ssize_t resid = buf->uio_resid;
+	int uio_idx;
+	int ret = 0;
 
 	uk_mutex_lock(&pipe_buf->rdlock);
-	if (nonblocking && !pipe_buf_can_read(pipe_buf)) {
-		uk_mutex_unlock(&pipe_buf->rdlock);
-		return EAGAIN;
-	}
-
-	while (data_available && uio_idx < buf->uio_iovcnt) {
+	for (uio_idx = 0; uio_idx < buf->uio_iovcnt; uio_idx++) {
 		struct iovec *iovec = &buf->uio_iov[uio_idx];
 		unsigned long off = 0;
 
 		while (off < iovec->iov_len) {
 			unsigned long read_bytes;
 
-			read_bytes = pipe_buf_read(pipe_buf, iovec, off);
-			if (read_bytes == 0) {
-				/* No data */
-				if (nonblocking) {
-					data_available = false;
-					break;
-
-				} else {
-					/* Wait until data available */
-					while (!pipe_buf_can_read(pipe_buf)) {
-						uk_mutex_unlock(&pipe_buf->rdlock);
-						uk_waitq_wait_event(&pipe_buf->rdwq,
-							pipe_file_can_read(pipe_file));
+			uk_mutex_lock(&pipe_buf->lock);
+			read_bytes = pipe_buf_read(pipe_buf,
+					(char *)iovec->iov_base + off,
+					iovec->iov_len - off);
+			uk_mutex_unlock(&pipe_buf->lock);
 
-						if (!pipe_file->w_refcount)
-							return 0;
-
-						uk_mutex_lock(&pipe_buf->rdlock);
-					}
-				}
-
-			} else {
+			if (read_bytes > 0) {
 				/* Update bytes read */
 				buf->uio_resid -= read_bytes;
-
 				off += read_bytes;
+				continue;
+			}
 
-				/* wake some writers */
-				uk_waitq_wake_up(&pipe_buf->wrwq);
-				pipe_file_event(pipe_file,
-						EPOLLOUT | EPOLLWRNORM);
+			/* Return what we have, or EOF without writers */
+			if (buf->uio_resid != resid || !pipe_file->w_refcount)
+				goto out;
 
-				break;
+			if (nonblocking) {
+				ret = EAGAIN;
+				goto out;
 			}
-		}
 
-		uio_idx++;
+			/* Wait until data available */
+			uk_mutex_unlock(&pipe_buf->rdlock);
+			uk_waitq_wait_event(&pipe_buf->rdwq,
+					    pipe_file_can_read(pipe_file));
+			uk_mutex_lock(&pipe_buf->rdlock);
+		}
 	}
+
+out:
 	uk_mutex_unlock(&pipe_buf->rdlock);
 
-	return 0;
+	if (buf->uio_resid != resid) {
+		/* wake some writers */
+		uk_waitq_wake_up(&pipe_buf->wrwq);
+		pipe_file_event(pipe_file, EPOLLOUT | EPOLLWRNORM);
+	}
+
+	return ret;
+}
+
+static int pipe_write(struct vnode *vnode,
+		struct uio *buf, int ioflag)
+{
+	return pipe_do_write(vnode->v_data, buf, ioflag & IO_NDELAY);
+}
+
+static int pipe_read(struct vnode *vnode,
+		struct vfscore_file *vfscore_file,
+		struct uio *buf, int ioflag __unused)
+{
+	return pipe_do_read(vnode->v_data, buf,
+			    vfscore_file->f_flags & O_NONBLOCK);
 }
 
 static int pipe_close(struct vnode *vnode,
@@ -433,8 +576,14 @@ static int pipe_close(struct vnode *vnode,
 	if (vfscore_file->f_flags & UK_FWRITE)
 		pipe_file->w_refcount--;
 
-	if (!pipe_file->r_refcount && !pipe_file->w_refcount)
+	if (!pipe_file->r_refcount && !pipe_file->w_refcount) {
 		pipe_file_free(pipe_file);
+		return 0;
+	}
+
+	/* Blocked peers have to notice EOF or EPIPE */
+	uk_waitq_wake_up(&pipe_file->buf->rdwq);
+	uk_waitq_wake_up(&pipe_file->buf->wrwq);
 
 	return 0;
 }
@@ -456,9 +605,9 @@ static int pipe_ioctl(struct vnode *vnode,
 
 	switch (com) {
 	case FIONREAD:
-		uk_mutex_lock(&pipe_buf->rdlock);
+		uk_mutex_lock(&pipe_buf->lock);
 		*((int *) data) = pipe_buf_get_available(pipe_buf);
-		uk_mutex_unlock(&pipe_buf->rdlock);
+		uk_mutex_unlock(&pipe_buf->lock);
 		return 0;
 	default:
 		return -EINVAL;
@@ -473,15 +622,12 @@ get_pipe_file_events(struct pipe_file *pipe_file)
 
 	UK_ASSERT(pipe_file);
 
-	uk_mutex_lock(&pipe_buf->rdlock);
+	uk_mutex_lock(&pipe_buf->lock);
 	if (pipe_buf_can_read(pipe_buf))
 		events |= EPOLLIN | EPOLLRDNORM;
-	uk_mutex_unlock(&pipe_buf->rdlock);
-
-	uk_mutex_lock(&pipe_buf->wrlock);
 	if (pipe_buf_can_write(pipe_buf))
 		events |= EPOLLOUT | EPOLLWRNORM;
-	uk_mutex_unlock(&pipe_buf->wrlock);
+	uk_mutex_unlock(&pipe_buf->lock);
 
 	return events;
 }
@@ -707,6 +853,376 @@ UK_SYSCALL_R_DEFINE(int, pipe2, int*, pipefd, int, flags)
 	return 0;
 }
 
+/* Returns the pipe behind a file or NULL if the file is not a pipe */
+static struct pipe_file *pipe_file_get(struct vfscore_file *fp)
+{
+	struct vnode *vnode = fp->f_dentry->d_vnode;
+
+	if (vnode->v_op != &pipe_vnops)
+		return NULL;
+
+	return vnode->v_data;
+}
+
+int pipe_get_size(struct vfscore_file *fp, int *size)
+{
+	struct pipe_file *pipe_file = pipe_file_get(fp);
+
+	if (!pipe_file)
+		return EBADF;
+
+	*size = pipe_file->buf->nslots * __PAGE_SIZE;
+	return 0;
+}
+
+int pipe_set_size(struct vfscore_file *fp, int size, int *new_size)
+{
+	struct pipe_file *pipe_file = pipe_file_get(fp);
+	struct pipe_buf *pipe_buf;
+	struct pipe_slot *slots, *old_slots;
+	unsigned long nslots, idx;
+	int error = 0;
+
+	if (!pipe_file)
+		return EBADF;
+	if (size < 0 || size > PIPE_SIZE_LIMIT)
+		return EINVAL;
+
+	pipe_buf = pipe_file->buf;
+	nslots = pipe_size_to_nslots(size);
+	slots = calloc(nslots, sizeof(*slots));
+	if (!slots)
+		return ENOMEM;
+
+	uk_mutex_lock(&pipe_buf->rdlock);
+	uk_mutex_lock(&pipe_buf->wrlock);
+	uk_mutex_lock(&pipe_buf->lock);
+
+	/* Like Linux, refuse to drop queued data */
+	if (pipe_buf->prod - pipe_buf->cons > nslots) {
+		error = EBUSY;
+		old_slots = slots;
+	} else {
+		for (idx = pipe_buf->cons; idx != pipe_buf->prod; idx++)
+			slots[idx & (nslots - 1)] =
+				*PIPE_BUF_SLOT(pipe_buf, idx);
+
+		old_slots = pipe_buf->slots;
+		pipe_buf->slots = slots;
+		pipe_buf->nslots = nslots;
+	}
+
+	uk_mutex_unlock(&pipe_buf->lock);
+	uk_mutex_unlock(&pipe_buf->wrlock);
+	uk_mutex_unlock(&pipe_buf->rdlock);
+
+	free(old_slots);
+	if (error)
+		return error;
+
+	/* The pipe may have grown */
+	uk_waitq_wake_up(&pipe_buf->wrwq);
+	pipe_file_event(pipe_file, EPOLLOUT | EPOLLWRNORM);
+
+	*new_size = nslots * __PAGE_SIZE;
+	return 0;
+}
+
+#define SPLICE_F_ALL \
+	(SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE | SPLICE_F_GIFT)
+
+/*
+ * Writing to a pipe copies the user memory into pages of the pipe, like
+ * writev(). Referencing it in place would require the caller to keep it
+ * alive and unchanged until it is read, which nothing enforces. The pipe
+ * cannot tell whether gifted memory comes from the page allocator, so
+ * SPLICE_F_GIFT is accepted but ignored. Reading from a pipe behaves like
+ * readv().
+ */
+UK_SYSCALL_R_DEFINE(ssize_t, vmsplice, int, fd, const struct iovec *, iov,
+		    size_t, nr_segs, unsigned int, flags)
+{
+	struct vfscore_file *fp;
+	struct pipe_file *pipe_file;
+	struct uio uio;
+	ssize_t bytes = 0;
+	bool nonblocking;
+	size_t i;
+	int error;
+
+	if (unlikely(flags & ~SPLICE_F_ALL))
+		return -EINVAL;
+	if (unlikely(nr_segs > UIO_MAXIOV))
+		return -EINVAL;
+
+	for (i = 0; i < nr_segs; i++) {
+		if (unlikely(iov[i].iov_len > (size_t)(IOSIZE_MAX - bytes)))
+			return -EINVAL;
+		bytes += iov[i].iov_len;
+	}
+
+	fp = vfscore_get_file(fd);
+	if (unlikely(!fp))
+		return -EBADF;
+
+	pipe_file = pipe_file_get(fp);
+	if (unlikely(!pipe_file)) {
+		error = EBADF;
+		goto out;
+	}
+
+	uio.uio_iov = (struct iovec *)iov;
+	uio.uio_iovcnt = nr_segs;
+	uio.uio_offset = 0;
+	uio.uio_resid = bytes;
+
+	nonblocking = (flags & SPLICE_F_NONBLOCK) ||
+		      (fp->f_flags & O_NONBLOCK);
+	if (fp->f_flags & UK_FWRITE) {
+		uio.uio_rw = UIO_WRITE;
+		error = pipe_do_write(pipe_file, &uio, nonblocking);
+	} else {
+		uio.uio_rw = UIO_READ;
+		error = pipe_do_read(pipe_file, &uio, nonblocking);
+	}
+
+out:
+	vfscore_put_file(fp);
+	if (error)
+		return -error;
+
+	return bytes - uio.uio_resid;
+}
+
+/*
+ * Writes the queued pages directly to another file. Readers are serialized,
+ * so the pages cannot be recycled while the file is written; writers may
+ * only append meanwhile.
+ */
+static int pipe_splice_out(struct pipe_file *pipe_file,
+		struct vfscore_file *fp, off_t *off, size_t len,
+		bool nonblocking, size_t *count)
+{
+	struct pipe_buf *pipe_buf = pipe_file->buf;
+	struct iovec iov[PIPE_SPLICE_IOV];
+	struct pipe_slot *slot;
+	unsigned long idx;
+	size_t total = 0;
+	int niov;
+	int error = 0;
+
+	*count = 0;
+
+	uk_mutex_lock(&pipe_buf->rdlock);
+	while (!pipe_buf_can_read(pipe_buf)) {
+		if (!pipe_file->w_refcount)
+			goto out;
+
+		if (nonblocking) {
+			error = EAGAIN;
+			goto out;
+		}
+
+		uk_mutex_unlock(&pipe_buf->rdlock);
+		uk_waitq_wait_event(&pipe_buf->rdwq,
+				    pipe_file_can_read(pipe_file));
+		uk_mutex_lock(&pipe_buf->rdlock);
+	}
+
+	uk_mutex_lock(&pipe_buf->lock);
+	for (niov = 0, idx = pipe_buf->cons;
+	     niov < PIPE_SPLICE_IOV && idx != pipe_buf->prod && total < len;
+	     niov++, idx++) {
+		slot = PIPE_BUF_SLOT(pipe_buf, idx);
+		iov[niov].iov_base = slot->base;
+		iov[niov].iov_len = MIN(slot->len, len - total);
+		total += iov[niov].iov_len;
+	}
+	uk_mutex_unlock(&pipe_buf->lock);
+
+	error = sys_write(fp, iov, niov, off ? *off : -1, count);
+	if (*count) {
+		uk_mutex_lock(&pipe_buf->lock);
+		pipe_buf_consume(pipe_buf, *count);
+		uk_mutex_unlock(&pipe_buf->lock);
+	}
+
+out:
+	uk_mutex_unlock(&pipe_buf->rdlock);
+
+	if (*count) {
+		/* wake some writers */
+		uk_waitq_wake_up(&pipe_buf->wrwq);
+		pipe_file_event(pipe_file, EPOLLOUT | EPOLLWRNORM);
+	}
+
+	return error;
+}
+
+/*
+ * Reads another file directly into fresh pages and queues them. Writers are
+ * serialized, so the free slots cannot be taken while the file is read.
+ */
+static int pipe_splice_in(struct pipe_file *pipe_file,
+		struct vfscore_file *fp, off_t *off, size_t len,
+		bool nonblocking, size_t *count)
+{
+	struct pipe_buf *pipe_buf = pipe_file->buf;
+	struct iovec iov[PIPE_SPLICE_IOV];
+	unsigned long nfree;
+	size_t left;
+	int niov, i;
+	int error = 0;
+
+	*count = 0;
+
+	uk_mutex_lock(&pipe_buf->wrlock);
+	for (;;) {
+		if (!pipe_file->r_refcount) {
+			error = EPIPE;
+			goto out;
+		}
+
+		if (pipe_buf_get_free_slots(pipe_buf))
+			break;
+
+		if (nonblocking) {
+			error = EAGAIN;
+			goto out;
+		}
+
+		uk_mutex_unlock(&pipe_buf->wrlock);
+		uk_waitq_wait_event(&pipe_buf->wrwq,
+				    pipe_file_can_write(pipe_file));
+		uk_mutex_lock(&pipe_buf->wrlock);
+	}
+
+	uk_mutex_lock(&pipe_buf->lock);
+	nfree = MIN(pipe_buf_get_free_slots(pipe_buf),
+		    (unsigned long)PIPE_SPLICE_IOV);
+	for (niov = 0, left = len; niov < (int)nfree && left > 0; niov++) {
+		iov[niov].iov_base = pipe_page_get(pipe_buf);
+		if (!iov[niov].iov_base)
+			break;
+
+		iov[niov].iov_len = MIN(left, (size_t)__PAGE_SIZE);
+		left -= iov[niov].iov_len;
+	}
+	uk_mutex_unlock(&pipe_buf->lock);
+
+	if (!niov) {
+		error = ENOMEM;
+		goto out;
+	}
+
+	error = sys_read(fp, iov, niov, off ? *off : -1, count);
+
+	uk_mutex_lock(&pipe_buf->lock);
+	for (i = 0, left = *count; i < niov; i++) {
+		if (left) {
+			pipe_buf_push_page(pipe_buf, iov[i].iov_base,
+					   MIN(left, iov[i].iov_len));
+			left -= MIN(left, iov[i].iov_len);
+		} else {
+			pipe_page_put(pipe_buf, iov[i].iov_base);
+		}
+	}
+	uk_mutex_unlock(&pipe_buf->lock);
+
+out:
+	uk_mutex_unlock(&pipe_buf->wrlock);
+
+	if (*count) {
+		/* wake some readers */
+		uk_waitq_wake_up(&pipe_buf->rdwq);
+		pipe_file_event(pipe_file, EPOLLIN | EPOLLRDNORM);
+	}
+
+	return error;
+}
+
+/*
+ * Moves data between a pipe and another file (or pipe) through the pipe
+ * pages, without a bounce buffer in user space.
+ */
+UK_SYSCALL_R_DEFINE(ssize_t, splice, int, fd_in, off_t *, off_in,
+		    int, fd_out, off_t *, off_out, size_t, len,
+		    unsigned int, flags)
+{
+	struct vfscore_file *fp_in, *fp_out = NULL;
+	struct pipe_file *pipe_in, *pipe_out;
+	size_t count = 0;
+	bool nonblocking;
+	int error;
+
+	if (unlikely(flags & ~SPLICE_F_ALL))
+		return -EINVAL;
+
+	fp_in = vfscore_get_file(fd_in);
+	if (unlikely(!fp_in))
+		return -EBADF;
+
+	fp_out = vfscore_get_file(fd_out);
+	if (unlikely(!fp_out)) {
+		error = EBADF;
+		goto out;
+	}
+
+	if (unlikely(!(fp_in->f_flags & UK_FREAD) ||
+		     !(fp_out->f_flags & UK_FWRITE))) {
+		error = EBADF;
+		goto out;
+	}
+
+	pipe_in = pipe_file_get(fp_in);
+	pipe_out = pipe_file_get(fp_out);
+	if (unlikely((!pipe_in && !pipe_out) || pipe_in == pipe_out)) {
+		error = EINVAL;
+		goto out;
+	}
+
+	if (unlikely((off_in && (fp_in->f_vfs_flags & UK_VFSCORE_NOPOS)) ||
+		     (off_out && (fp_out->f_vfs_flags & UK_VFSCORE_NOPOS)))) {
+		error = ESPIPE;
+		goto out;
+	}
+
+	len = MIN(len, (size_t)IOSIZE_MAX);
+	if (len == 0) {
+		error = 0;
+		goto out;
+	}
+
+	nonblocking = flags & SPLICE_F_NONBLOCK;
+	if (pipe_in)
+		error = pipe_splice_out(pipe_in, fp_out, off_out, len,
+					nonblocking ||
+					(fp_in->f_flags & O_NONBLOCK),
+					&count);
+	else
+		error = pipe_splice_in(pipe_out, fp_in, off_in, len,
+				       nonblocking ||
+				       (fp_out->f_flags & O_NONBLOCK),
+				       &count);
+
+	if (count) {
+		if (pipe_in && off_out)
+			*off_out += count;
+		else if (!pipe_in && off_in)
+			*off_in += count;
+		error = 0;
+	}
+
+out:
+	if (fp_out)
+		vfscore_put_file(fp_out);
+	vfscore_put_file(fp_in);
+	if (error)
+		return -error;
+
+	return count;
+}
+
 #if UK_LIBC_SYSCALLS
 /* TODO maybe find a better place for this when it will be implemented */
 int mkfifo(const char *path __unused, mode_t mode __unused)
@@ -132,6 +132,8 @@ sys_open(char *path, int flags, mode_t mode, struct vfscore_file **fpp)
 			mode &= ~S_IFMT;
 			mode |= S_IFREG;
 			error = VOP_CREATE(ddp->d_vnode, filename, mode);
+			if (!error)
+				dentry_neg_forget(ddp, filename);
 			vn_unlock(ddp->d_vnode);
 			drele(ddp);
 
@@ -573,6 +575,8 @@ sys_mkdir(char *path, mode_t mode)
 	mode |= S_IFDIR;
 
 	error = VOP_MKDIR(ddp->d_vnode, name, mode);
+	if (!error)
+		dentry_neg_forget(ddp, name);
  out:
 	vn_unlock(ddp->d_vnode);
 	drele(ddp);
@@ -662,6 +666,8 @@ sys_mknod(char *path, mode_t mode)
 		error = VOP_MKDIR(ddp->d_vnode, name, mode);
 	else
 		error = VOP_CREATE(ddp->d_vnode, name, mode);
+	if (!error)
+		dentry_neg_forget(ddp, name);
  out:
 	vn_unlock(ddp->d_vnode);
 	drele(ddp);
@@ -905,6 +911,8 @@ sys_symlink(const char *oldpath, const char *newpath)
 		goto out;
 	}
 	error = VOP_SYMLINK(newdirdp->d_vnode, name, op);
+	if (!error)
+		dentry_neg_forget(newdirdp, name);
 
 out:
 	if (newdirdp != NULL) {
@@ -967,6 +975,8 @@ sys_link(char *oldpath, char *newpath)
 	}
 
 	error = VOP_LINK(newdirdp->d_vnode, vp, name);
+	if (error)
+		dentry_remove(newdp);
  out1:
 	vn_unlock(newdirdp->d_vnode);
 	drele(newdirdp);
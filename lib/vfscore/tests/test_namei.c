@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <uk/test.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define TEST_ROOT	"/namei_test"
+
+static int touch(const char *path)
+{
+	int fd;
+
+	fd = open(path, O_CREAT | O_WRONLY, 0644);
+	if (fd < 0)
+		return -1;
+	return close(fd);
+}
+
+UK_TESTCASE(vfscore_namei, negative_lookup_invalidated_by_create)
+{
+	struct stat st;
+
+	/* The second stat may be answered by the negative cache */
+	UK_TEST_EXPECT_SNUM_EQ(stat(TEST_ROOT "/file", &st), -1);
+	UK_TEST_EXPECT_SNUM_EQ(errno, ENOENT);
+	UK_TEST_EXPECT_SNUM_EQ(stat(TEST_ROOT "/file", &st), -1);
+	UK_TEST_EXPECT_SNUM_EQ(errno, ENOENT);
+
+	UK_TEST_EXPECT_ZERO(touch(TEST_ROOT "/file"));
+	UK_TEST_EXPECT_ZERO(stat(TEST_ROOT "/file", &st));
+
+	UK_TEST_EXPECT_SNUM_EQ(stat(TEST_ROOT "/dir", &st), -1);
+	UK_TEST_EXPECT_ZERO(mkdir(TEST_ROOT "/dir", 0755));
+	UK_TEST_EXPECT_ZERO(stat(TEST_ROOT "/dir", &st));
+	UK_TEST_EXPECT(S_ISDIR(st.st_mode));
+}
+
+UK_TESTCASE(vfscore_namei, cached_lookup_after_unlink)
+{
+	struct stat st;
+
+	UK_TEST_EXPECT_ZERO(touch(TEST_ROOT "/gone"));
+	UK_TEST_EXPECT_ZERO(stat(TEST_ROOT "/gone", &st));
+	UK_TEST_EXPECT_ZERO(unlink(TEST_ROOT "/gone"));
+	UK_TEST_EXPECT_SNUM_EQ(stat(TEST_ROOT "/gone", &st), -1);
+	UK_TEST_EXPECT_SNUM_EQ(errno, ENOENT);
+}
+
+UK_TESTCASE(vfscore_namei, cached_lookup_after_rename)
+{
+	struct stat st;
+
+	UK_TEST_EXPECT_ZERO(mkdir(TEST_ROOT "/old", 0755));
+	UK_TEST_EXPECT_ZERO(touch(TEST_ROOT "/old/file"));
+	UK_TEST_EXPECT_ZERO(stat(TEST_ROOT "/old/file", &st));
+	UK_TEST_EXPECT_SNUM_EQ(stat(TEST_ROOT "/new/file", &st), -1);
+
+	UK_TEST_EXPECT_ZERO(rename(TEST_ROOT "/old", TEST_ROOT "/new"));
+	UK_TEST_EXPECT_SNUM_EQ(stat(TEST_ROOT "/old/file", &st), -1);
+	UK_TEST_EXPECT_ZERO(stat(TEST_ROOT "/new/file", &st));
+}
+
+UK_TESTCASE(vfscore_namei, cached_lookup_through_symlink)
+{
+	struct stat st;
+
+	UK_TEST_EXPECT_ZERO(mkdir(TEST_ROOT "/target", 0755));
+	UK_TEST_EXPECT_ZERO(touch(TEST_ROOT "/target/file"));
+	UK_TEST_EXPECT_ZERO(symlink("target", TEST_ROOT "/link"));
+
+	/* Links are never resolved by the fast path */
+	UK_TEST_EXPECT_ZERO(stat(TEST_ROOT "/link/file", &st));
+	UK_TEST_EXPECT_ZERO(stat(TEST_ROOT "/link/file", &st));
+	UK_TEST_EXPECT(S_ISREG(st.st_mode));
+	UK_TEST_EXPECT_ZERO(lstat(TEST_ROOT "/link", &st));
+	UK_TEST_EXPECT(S_ISLNK(st.st_mode));
+}
+
+UK_TESTCASE(vfscore_namei, cached_lookup_trailing_slash)
+{
+	struct stat st;
+
+	UK_TEST_EXPECT_ZERO(mkdir(TEST_ROOT "/slashdir", 0755));
+	UK_TEST_EXPECT_ZERO(touch(TEST_ROOT "/slashfile"));
+
+	/* Look up both once, so that the second lookup hits the cache */
+	UK_TEST_EXPECT_ZERO(stat(TEST_ROOT "/slashdir", &st));
+	UK_TEST_EXPECT_ZERO(stat(TEST_ROOT "/slashfile", &st));
+
+	UK_TEST_EXPECT_ZERO(stat(TEST_ROOT "/slashdir/", &st));
+	UK_TEST_EXPECT(S_ISDIR(st.st_mode));
+	UK_TEST_EXPECT_SNUM_EQ(stat(TEST_ROOT "/slashfile/", &st), -1);
+	UK_TEST_EXPECT_SNUM_EQ(errno, ENOTDIR);
+}
+
+static int vfscore_namei_init(struct uk_testsuite *suite __unused)
+{
+	/* Tests need a writable root filesystem */
+	return mkdir(TEST_ROOT, 0755);
+}
+
+uk_testsuite_register(vfscore_namei, vfscore_namei_init);
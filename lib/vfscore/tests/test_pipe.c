@@ -0,0 +1,177 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _GNU_SOURCE
+
+#include <uk/test.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#define TEST_ROOT	"/pipe_test"
+#define PAGE		4096
+
+static char buf[4 * PAGE];
+
+UK_TESTCASE(vfscore_pipe, short_read)
+{
+	int fds[2];
+
+	UK_TEST_EXPECT_ZERO(pipe(fds));
+	UK_TEST_EXPECT_SNUM_EQ(write(fds[1], "hello", 5), 5);
+
+	/* A read returns what is available instead of waiting for more */
+	UK_TEST_EXPECT_SNUM_EQ(read(fds[0], buf, sizeof(buf)), 5);
+	UK_TEST_EXPECT_ZERO(memcmp(buf, "hello", 5));
+
+	/* End of file once all writers are gone */
+	close(fds[1]);
+	UK_TEST_EXPECT_ZERO(read(fds[0], buf, sizeof(buf)));
+	close(fds[0]);
+}
+
+UK_TESTCASE(vfscore_pipe, write_without_reader)
+{
+	int fds[2];
+
+	UK_TEST_EXPECT_ZERO(pipe(fds));
+	close(fds[0]);
+	UK_TEST_EXPECT_SNUM_EQ(write(fds[1], "x", 1), -1);
+	UK_TEST_EXPECT_SNUM_EQ(errno, EPIPE);
+	close(fds[1]);
+}
+
+UK_TESTCASE(vfscore_pipe, nonblocking_write)
+{
+	int fds[2];
+
+	UK_TEST_EXPECT_ZERO(pipe2(fds, O_NONBLOCK));
+	UK_TEST_EXPECT_SNUM_EQ(fcntl(fds[1], F_SETPIPE_SZ, PAGE), PAGE);
+
+	UK_TEST_EXPECT_SNUM_EQ(read(fds[0], buf, 1), -1);
+	UK_TEST_EXPECT_SNUM_EQ(errno, EAGAIN);
+
+	/* A full pipe takes a partial write, then nothing */
+	memset(buf, 'a', sizeof(buf));
+	UK_TEST_EXPECT_SNUM_EQ(write(fds[1], buf, 2 * PAGE), PAGE);
+	UK_TEST_EXPECT_SNUM_EQ(write(fds[1], buf, 1), -1);
+	UK_TEST_EXPECT_SNUM_EQ(errno, EAGAIN);
+
+	UK_TEST_EXPECT_SNUM_EQ(read(fds[0], buf, sizeof(buf)), PAGE);
+	UK_TEST_EXPECT_SNUM_EQ(write(fds[1], buf, 1), 1);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+UK_TESTCASE(vfscore_pipe, resize_keeps_data)
+{
+	int fds[2];
+
+	UK_TEST_EXPECT_ZERO(pipe(fds));
+	memset(buf, 'b', sizeof(buf));
+	UK_TEST_EXPECT_SNUM_EQ(write(fds[1], buf, 3 * PAGE), 3 * PAGE);
+
+	/* Shrinking below the queued data would drop it */
+	UK_TEST_EXPECT_SNUM_EQ(fcntl(fds[1], F_SETPIPE_SZ, PAGE), -1);
+	UK_TEST_EXPECT_SNUM_EQ(errno, EBUSY);
+	UK_TEST_EXPECT_SNUM_EQ(fcntl(fds[1], F_SETPIPE_SZ, 4 * PAGE),
+			       4 * PAGE);
+	UK_TEST_EXPECT_SNUM_EQ(fcntl(fds[0], F_GETPIPE_SZ), 4 * PAGE);
+
+	UK_TEST_EXPECT_SNUM_EQ(read(fds[0], buf, sizeof(buf)), 3 * PAGE);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+UK_TESTCASE(vfscore_pipe, vmsplice_copies)
+{
+	char data[] = "spliced";
+	struct iovec iov = { .iov_base = data, .iov_len = sizeof(data) };
+	int fds[2];
+
+	UK_TEST_EXPECT_ZERO(pipe(fds));
+	UK_TEST_EXPECT_SNUM_EQ(vmsplice(fds[1], &iov, 1, SPLICE_F_GIFT),
+			       sizeof(data));
+
+	/* The memory may be reused as soon as vmsplice() returns */
+	memset(data, 0, sizeof(data));
+	UK_TEST_EXPECT_SNUM_EQ(read(fds[0], buf, sizeof(buf)), sizeof(data));
+	UK_TEST_EXPECT_ZERO(strcmp(buf, "spliced"));
+	close(fds[0]);
+	close(fds[1]);
+}
+
+/* Not page-aligned, so that the pipe holds a partial page */
+#define LEN		(2 * PAGE + 100)
+
+UK_TESTCASE(vfscore_pipe, splice_in_and_out)
+{
+	int fds[2], in, out, i;
+
+	for (i = 0; i < (int) sizeof(buf); i++)
+		buf[i] = (char) i;
+
+	in = open(TEST_ROOT "/in", O_CREAT | O_RDWR, 0644);
+	UK_TEST_EXPECT(in >= 0);
+	UK_TEST_EXPECT_SNUM_EQ(write(in, buf, LEN), LEN);
+	UK_TEST_EXPECT_ZERO(lseek(in, 0, SEEK_SET));
+	out = open(TEST_ROOT "/out", O_CREAT | O_RDWR, 0644);
+	UK_TEST_EXPECT(out >= 0);
+	UK_TEST_EXPECT_ZERO(pipe(fds));
+
+	UK_TEST_EXPECT_SNUM_EQ(splice(in, NULL, fds[1], NULL, LEN, 0), LEN);
+	UK_TEST_EXPECT_SNUM_EQ(splice(fds[0], NULL, out, NULL, LEN, 0), LEN);
+
+	memset(buf, 0, sizeof(buf));
+	UK_TEST_EXPECT_ZERO(lseek(out, 0, SEEK_SET));
+	UK_TEST_EXPECT_SNUM_EQ(read(out, buf, sizeof(buf)), LEN);
+	for (i = 0; i < LEN; i++) {
+		if (buf[i] != (char) i)
+			break;
+	}
+	UK_TEST_EXPECT_SNUM_EQ(i, LEN);
+
+	close(fds[0]);
+	close(fds[1]);
+	close(in);
+	close(out);
+}
+
+static int vfscore_pipe_init(struct uk_testsuite *suite __unused)
+{
+	/* Tests need a writable root filesystem */
+	return mkdir(TEST_ROOT, 0755);
+}
+
+uk_testsuite_register(vfscore_pipe, vfscore_pipe_init);
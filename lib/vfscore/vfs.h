@@ -145,6 +145,9 @@ int vfs_stat(struct vfscore_file *fp, struct stat *st);
 int fget(int fd, struct vfscore_file **out_fp);
 int fdalloc(struct vfscore_file *fp, int *newfd);
 
+int pipe_get_size(struct vfscore_file *fp, int *size);
+int pipe_set_size(struct vfscore_file *fp, int size, int *new_size);
+
 #ifdef DEBUG_VFS
 void	 vnode_dump(void);
 void	 vfscore_mount_dump(void);
@@ -152,6 +152,11 @@ struct pci_device {
 
 	unsigned long base;
 	unsigned long irq;
+
+	/* MSI-X state, see pci_msix_enable() */
+	uint8_t  msix_cap;           /**< Config offset of the MSI-X capability */
+	uint16_t msix_count;         /**< Number of MSI-X table entries */
+	volatile uint32_t *msix_table; /**< Mapped MSI-X table */
 };
 
 
@@ -291,6 +296,158 @@ static struct pci_bus_handler ph __unused;
 #define PCI_MIN_GNT		0x3e	/* 8 bits */
 #define PCI_MAX_LAT		0x3f	/* 8 bits */
 
+/* Capabilities */
+#define PCI_STATUS_CAP_LIST	0x10	/* Support Capability List */
+#define PCI_CAP_LIST_ID		0	/* Capability ID */
+#define PCI_CAP_LIST_NEXT	1	/* Next capability in the list */
+#define PCI_CAP_ID_VNDR		0x09	/* Vendor-Specific */
+#define PCI_CAP_ID_MSIX		0x11	/* MSI-X */
+
+/* Base address registers */
+#define PCI_BASE_ADDRESS_SPACE_IO	0x01
+#define PCI_BASE_ADDRESS_MEM_TYPE_MASK	0x06
+#define PCI_BASE_ADDRESS_MEM_TYPE_64	0x04	/* 64 bit address */
+#define PCI_BASE_ADDRESS_MEM_MASK	(~0x0fUL)
+#define PCI_BASE_ADDRESS_IO_MASK	(~0x03UL)
+
+/* MSI-X capability */
+#define PCI_MSIX_FLAGS		2	/* Message Control (16 bits) */
+#define  PCI_MSIX_FLAGS_QSIZE	0x07ff	/* Table size - 1 */
+#define  PCI_MSIX_FLAGS_MASKALL	0x4000	/* Mask all vectors */
+#define  PCI_MSIX_FLAGS_ENABLE	0x8000	/* MSI-X enable */
+#define PCI_MSIX_TABLE		4	/* Table offset and BAR indicator */
+#define  PCI_MSIX_TABLE_BIR	0x00000007
+#define  PCI_MSIX_TABLE_OFFSET	0xfffffff8
+
+/* MSI-X table entry, in 32-bit words */
+#define PCI_MSIX_ENTRY_SIZE		4
+#define PCI_MSIX_ENTRY_LOWER_ADDR	0
+#define PCI_MSIX_ENTRY_UPPER_ADDR	1
+#define PCI_MSIX_ENTRY_DATA		2
+#define PCI_MSIX_ENTRY_VECTOR_CTRL	3
+#define  PCI_MSIX_ENTRY_CTRL_MASKBIT	0x1
+
 struct pci_driver *pci_find_driver(struct pci_device_id *id);
 
+/**
+ * Read from the configuration space of a PCI device.
+ *
+ * @param dev PCI device
+ * @param off offset into the configuration space, aligned to `len`
+ * @param len access width in bytes (1, 2, or 4)
+ * @return the value read
+ */
+uint32_t pci_conf_read(struct pci_device *dev, uint8_t off, uint8_t len);
+
+/**
+ * Write to the configuration space of a PCI device.
+ *
+ * @param dev PCI device
+ * @param off offset into the configuration space, aligned to `len`
+ * @param len access width in bytes (1, 2, or 4)
+ * @param val the value to write
+ */
+void pci_conf_write(struct pci_device *dev, uint8_t off, uint8_t len,
+		    uint32_t val);
+
+/**
+ * Walk the capability list of a PCI device.
+ *
+ * @param dev PCI device
+ * @param cap_id the capability ID to look for
+ * @param start config offset of the capability to continue the search
+ *   after, or 0 to start at the beginning of the list
+ * @return config offset of the capability, or 0 if there is none
+ */
+uint8_t pci_find_cap(struct pci_device *dev, uint8_t cap_id, uint8_t start);
+
+/**
+ * Decode a base address register. 64-bit memory BARs are supported.
+ *
+ * @param dev PCI device
+ * @param bar index of the BAR (0-5)
+ * @param[out] is_io set to 1 for I/O space BARs, 0 for memory BARs. May be
+ *   NULL
+ * @return the base address, or 0 if the BAR is not implemented
+ */
+uint64_t pci_bar_addr(struct pci_device *dev, unsigned int bar, int *is_io);
+
+/**
+ * Determine the size of a memory BAR by probing its address bits. Memory
+ * decoding of the device is disabled while probing.
+ *
+ * @param dev PCI device
+ * @param bar index of the BAR (0-5)
+ * @return the size of the BAR in bytes, or 0 for I/O space and
+ *   unimplemented BARs
+ */
+uint64_t pci_bar_size(struct pci_device *dev, unsigned int bar);
+
+/**
+ * Map a memory BAR for CPU access. The whole BAR is mapped uncached.
+ *
+ * @param dev PCI device
+ * @param bar index of the BAR (0-5)
+ * @param off offset into the BAR
+ * @return virtual address of `off` within the BAR, or NULL if the BAR is
+ *   not a memory BAR or cannot be accessed
+ */
+void *pci_bar_map(struct pci_device *dev, unsigned int bar, uint64_t off);
+
+/**
+ * Enable MSI-X for a device. All table entries are masked until they are
+ * configured with pci_msix_vector_alloc(). INTx is disabled as long as
+ * MSI-X is enabled.
+ *
+ * @param dev PCI device
+ * @param nvec number of table entries needed
+ * @return 0 on success, -ENOTSUP if the device or platform does not
+ *   support MSI-X, -ENOSPC if the table has less than `nvec` entries
+ */
+int pci_msix_enable(struct pci_device *dev, unsigned int nvec);
+
+/**
+ * Disable MSI-X for a device and mask all of its table entries.
+ *
+ * @param dev PCI device
+ */
+void pci_msix_disable(struct pci_device *dev);
+
+/**
+ * Allocate a platform IRQ for an MSI-X table entry and point the entry at
+ * it. The entry stays masked: register the IRQ handler with
+ * ukplat_irq_register() first, then unmask it with pci_msix_vector_mask().
+ *
+ * @param dev PCI device with MSI-X enabled
+ * @param entry index of the table entry
+ * @param lcpuidx logical CPU that receives the interrupt
+ * @return the IRQ number (>= 0), or a negative errno value
+ */
+int pci_msix_vector_alloc(struct pci_device *dev, unsigned int entry,
+			  unsigned int lcpuidx);
+
+/**
+ * Steer an MSI-X table entry to a different logical CPU. The mask state of
+ * the entry is kept.
+ *
+ * @param dev PCI device with MSI-X enabled
+ * @param entry index of the table entry
+ * @param irq IRQ number returned by pci_msix_vector_alloc()
+ * @param lcpuidx logical CPU that receives the interrupt
+ * @return 0 on success, a negative errno value otherwise
+ */
+int pci_msix_vector_affinity(struct pci_device *dev, unsigned int entry,
+			     unsigned long irq, unsigned int lcpuidx);
+
+/**
+ * Mask or unmask an MSI-X table entry. The IRQ stays allocated to the
+ * entry.
+ *
+ * @param dev PCI device with MSI-X enabled
+ * @param entry index of the table entry
+ * @param mask 1 to mask the entry, 0 to unmask it
+ */
+void pci_msix_vector_mask(struct pci_device *dev, unsigned int entry,
+			  int mask);
+
 #endif /* __UKPLAT_COMMON_PCI_BUS_H__ */
@@ -345,6 +345,17 @@ __lcpuid lcpu_arch_id(void);
  */
 int lcpu_arch_init(struct lcpu *this_lcpu);
 
+/**
+ * Initialize the per-CPU state of the platform clock (e.g., a paravirtual
+ * clock page) on a secondary CPU. On x86, the function is executed on the
+ * CPU represented by the LCPU as part of lcpu_arch_init(). The default
+ * implementation does nothing.
+ *
+ * @param this_lcpu pointer to the LCPU structure representing the CPU
+ *    executing this function
+ */
+void lcpu_time_init(struct lcpu *this_lcpu);
+
 /**
  * Switch to the specified stack and jump to the entry function
  *
@@ -87,6 +87,16 @@
 #define APIC_ESR_RECV_ILLEGAL_VECTOR	(1 << 6)
 #define APIC_ESR_ILLEGAL_REGISTER	(1 << 7)
 
+/* APIC local vector table (LVT) timer register */
+#define APIC_LVT_VECTOR_MASK		0x000000ff
+#define APIC_LVT_MASKED			(1 << 16)
+#define APIC_LVT_TIMER_ONESHOT		(0 << 17)
+#define APIC_LVT_TIMER_PERIODIC		(1 << 17)
+#define APIC_LVT_TIMER_TSC_DEADLINE	(2 << 17)
+
+/* APIC timer divide configuration register (DCR) */
+#define APIC_TIMER_DCR_DIV1		0xb
+
 /* APIC interrupt command register (ICR) */
 #define APIC_ICR_VECTOR_MASK		0x000000ff
 
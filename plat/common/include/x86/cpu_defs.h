@@ -79,6 +79,7 @@
 
 /* CPUID feature bits in ECX and EDX when EAX=1 */
 #define X86_CPUID1_ECX_x2APIC   (1 << 21)
+#define X86_CPUID1_ECX_TSC_DEADLINE (1 << 24)
 #define X86_CPUID1_ECX_XSAVE    (1 << 26)
 #define X86_CPUID1_ECX_OSXSAVE  (1 << 27)
 #define X86_CPUID1_ECX_AVX      (1 << 28)
@@ -116,6 +117,8 @@
 #define X86_MSR_CSTAR		0xc0000083
 /* EFLAGS mask for syscall */
 #define X86_MSR_SYSCALL_MASK	0xc0000084
+/* local APIC timer deadline in TSC-deadline mode */
+#define X86_MSR_TSC_DEADLINE	0x6e0
 
 /* MSR EFER bits */
 #define X86_EFER_SCE		(1 << 0)
@@ -90,6 +90,13 @@ static inline int irqs_disabled(void)
 #define local_irq_enable()       __sti()
 #define local_irq_enable_halt()  __sti_hlt()
 
-#define __MAX_IRQ	16
+/*
+ * IRQs 0-15 are the legacy PIC lines. The IRQs that follow are not routed
+ * through the PIC but are raised by message signaled interrupts (MSI/MSI-X)
+ * that are delivered directly to the local APIC.
+ */
+#define __MSI_IRQ_BASE	16
+#define __MSI_IRQ_COUNT	32
+#define __MAX_IRQ	(__MSI_IRQ_BASE + __MSI_IRQ_COUNT)
 
 #endif /* __PLAT_CMN_X86_IRQ_H__ */
@@ -98,6 +98,9 @@ pgarch_pte_create(__paddr_t paddr, unsigned long attr, unsigned int level,
 	if (!(attr & PAGE_ATTR_PROT_EXEC))
 		pte |= X86_PTE_NX;
 
+	if (attr & PAGE_ATTR_NOCACHE)
+		pte |= X86_PTE_PCD | X86_PTE_PWT;
+
 	/* Take all other bits from template */
 	pte |= template & (X86_PTE_US |
 			   X86_PTE_PWT |
@@ -117,7 +120,7 @@ static inline __pte_t
 pgarch_pte_change_attr(__pte_t pte, unsigned long new_attr,
 		       unsigned int level __unused)
 {
-	pte &= ~(X86_PTE_RW | X86_PTE_NX);
+	pte &= ~(X86_PTE_RW | X86_PTE_NX | X86_PTE_PCD | X86_PTE_PWT);
 
 	if (new_attr & PAGE_ATTR_PROT_WRITE)
 		pte |= X86_PTE_RW;
@@ -125,6 +128,9 @@ pgarch_pte_change_attr(__pte_t pte, unsigned long new_attr,
 	if (!(new_attr & PAGE_ATTR_PROT_EXEC))
 		pte |= X86_PTE_NX;
 
+	if (new_attr & PAGE_ATTR_NOCACHE)
+		pte |= X86_PTE_PCD | X86_PTE_PWT;
+
 	return pte;
 }
 
@@ -139,6 +145,9 @@ pgarch_attr_from_pte(__pte_t pte, unsigned int level __unused)
 	if (!(pte & X86_PTE_NX))
 		attr |= PAGE_ATTR_PROT_EXEC;
 
+	if (pte & X86_PTE_PCD)
+		attr |= PAGE_ATTR_NOCACHE;
+
 	return attr;
 }
 
@@ -52,12 +52,52 @@
  */
 
 #include <string.h>
+#include <errno.h>
 #include <uk/print.h>
+#include <uk/essentials.h>
 #include <uk/plat/common/cpu.h>
 #include <pci/pci_bus.h>
 
 extern int arch_pci_probe(struct uk_alloc *pha);
 
+/*
+ * Architecture hooks for configuration space access and message signaled
+ * interrupts. The defaults make every device look like it has no
+ * capabilities, so drivers fall back to what the bus probe provides.
+ */
+__weak uint32_t arch_pci_conf_read(struct pci_address *addr __unused,
+				   uint8_t off __unused, uint8_t len __unused)
+{
+	return 0;
+}
+
+__weak void arch_pci_conf_write(struct pci_address *addr __unused,
+				uint8_t off __unused, uint8_t len __unused,
+				uint32_t val __unused)
+{
+}
+
+__weak void *arch_pci_mmio_map(uint64_t paddr __unused, uint64_t len __unused)
+{
+	return NULL;
+}
+
+__weak int arch_pci_msi_irq_alloc(void)
+{
+	return -ENOTSUP;
+}
+
+__weak void arch_pci_msi_irq_free(unsigned long irq __unused)
+{
+}
+
+__weak int arch_pci_msi_compose(unsigned long irq __unused,
+				unsigned int lcpuidx __unused,
+				uint64_t *addr __unused, uint32_t *data __unused)
+{
+	return -ENOTSUP;
+}
+
 static inline int pci_device_id_match(const struct pci_device_id *id0,
 					const struct pci_device_id *id1)
 {
@@ -117,6 +157,267 @@ struct pci_driver *pci_find_driver(struct pci_device_id *id)
 	return NULL; /* no driver found */
 }
 
+uint32_t pci_conf_read(struct pci_device *dev, uint8_t off, uint8_t len)
+{
+	UK_ASSERT(dev);
+	UK_ASSERT(len == 1 || len == 2 || len == 4);
+	UK_ASSERT((off & (len - 1)) == 0);
+
+	return arch_pci_conf_read(&dev->addr, off, len);
+}
+
+void pci_conf_write(struct pci_device *dev, uint8_t off, uint8_t len,
+		    uint32_t val)
+{
+	UK_ASSERT(dev);
+	UK_ASSERT(len == 1 || len == 2 || len == 4);
+	UK_ASSERT((off & (len - 1)) == 0);
+
+	arch_pci_conf_write(&dev->addr, off, len, val);
+}
+
+uint8_t pci_find_cap(struct pci_device *dev, uint8_t cap_id, uint8_t start)
+{
+	uint8_t pos;
+	int ttl = 48; /* Protects against malformed (looping) lists */
+
+	if (start) {
+		pos = pci_conf_read(dev, start + PCI_CAP_LIST_NEXT, 1);
+	} else {
+		if (!(pci_conf_read(dev, PCI_STATUS_OFFSET, 2)
+		      & PCI_STATUS_CAP_LIST))
+			return 0;
+		pos = pci_conf_read(dev, PCI_CAPABILITIES_PTR, 1);
+	}
+
+	while (pos >= 0x40 && ttl--) {
+		pos &= ~0x3;
+		if (pci_conf_read(dev, pos + PCI_CAP_LIST_ID, 1) == cap_id)
+			return pos;
+		pos = pci_conf_read(dev, pos + PCI_CAP_LIST_NEXT, 1);
+	}
+	return 0;
+}
+
+uint64_t pci_bar_addr(struct pci_device *dev, unsigned int bar, int *is_io)
+{
+	uint8_t off = PCI_BASE_ADDRESS_0 + bar * 4;
+	uint64_t addr;
+	uint32_t lo;
+
+	UK_ASSERT(bar < 6);
+
+	lo = pci_conf_read(dev, off, 4);
+	if (is_io)
+		*is_io = !!(lo & PCI_BASE_ADDRESS_SPACE_IO);
+	if (lo & PCI_BASE_ADDRESS_SPACE_IO)
+		return lo & PCI_BASE_ADDRESS_IO_MASK;
+
+	addr = lo & PCI_BASE_ADDRESS_MEM_MASK;
+	if ((lo & PCI_BASE_ADDRESS_MEM_TYPE_MASK)
+	    == PCI_BASE_ADDRESS_MEM_TYPE_64) {
+		if (unlikely(bar == 5))
+			return 0;
+		addr |= (uint64_t) pci_conf_read(dev, off + 4, 4) << 32;
+	}
+	return addr;
+}
+
+uint64_t pci_bar_size(struct pci_device *dev, unsigned int bar)
+{
+	uint8_t off = PCI_BASE_ADDRESS_0 + bar * 4;
+	uint32_t lo, hi, cmd;
+	uint64_t mask;
+
+	UK_ASSERT(bar < 6);
+
+	lo = pci_conf_read(dev, off, 4);
+	if (lo & PCI_BASE_ADDRESS_SPACE_IO)
+		return 0;
+
+	/* The device must not decode the all-ones address while probing */
+	cmd = pci_conf_read(dev, PCI_COMMAND, 2);
+	pci_conf_write(dev, PCI_COMMAND, 2, cmd & ~PCI_COMMAND_MEMORY);
+
+	pci_conf_write(dev, off, 4, 0xffffffff);
+	mask = pci_conf_read(dev, off, 4) & PCI_BASE_ADDRESS_MEM_MASK;
+	pci_conf_write(dev, off, 4, lo);
+
+	if ((lo & PCI_BASE_ADDRESS_MEM_TYPE_MASK)
+	    == PCI_BASE_ADDRESS_MEM_TYPE_64 && bar < 5) {
+		hi = pci_conf_read(dev, off + 4, 4);
+		pci_conf_write(dev, off + 4, 4, 0xffffffff);
+		mask |= (uint64_t) pci_conf_read(dev, off + 4, 4) << 32;
+		pci_conf_write(dev, off + 4, 4, hi);
+	} else {
+		mask |= 0xffffffff00000000ULL;
+	}
+
+	pci_conf_write(dev, PCI_COMMAND, 2, cmd);
+
+	mask &= PCI_BASE_ADDRESS_MEM_MASK;
+	return mask ? ~mask + 1 : 0;
+}
+
+void *pci_bar_map(struct pci_device *dev, unsigned int bar, uint64_t off)
+{
+	uint64_t addr, size;
+	void *base;
+	int is_io;
+
+	addr = pci_bar_addr(dev, bar, &is_io);
+	if (!addr || is_io)
+		return NULL;
+
+	size = pci_bar_size(dev, bar);
+	if (off >= size)
+		return NULL;
+
+	/* Map the whole BAR, so that it is checked against the limits of the
+	 * platform as a whole. Mapping it again for another offset is fine.
+	 */
+	base = arch_pci_mmio_map(addr, size);
+	if (!base)
+		return NULL;
+
+	return (char *) base + off;
+}
+
+static inline volatile uint32_t *pci_msix_entry(struct pci_device *dev,
+						unsigned int entry)
+{
+	UK_ASSERT(dev->msix_table);
+	UK_ASSERT(entry < dev->msix_count);
+
+	return dev->msix_table + entry * PCI_MSIX_ENTRY_SIZE;
+}
+
+int pci_msix_enable(struct pci_device *dev, unsigned int nvec)
+{
+	uint32_t table;
+	uint16_t ctrl;
+	unsigned int i;
+
+	UK_ASSERT(dev);
+
+	if (!dev->msix_cap) {
+		dev->msix_cap = pci_find_cap(dev, PCI_CAP_ID_MSIX, 0);
+		if (!dev->msix_cap)
+			return -ENOTSUP;
+	}
+
+	ctrl = pci_conf_read(dev, dev->msix_cap + PCI_MSIX_FLAGS, 2);
+	dev->msix_count = (ctrl & PCI_MSIX_FLAGS_QSIZE) + 1;
+	if (dev->msix_count < nvec)
+		return -ENOSPC;
+
+	table = pci_conf_read(dev, dev->msix_cap + PCI_MSIX_TABLE, 4);
+	dev->msix_table = pci_bar_map(dev, table & PCI_MSIX_TABLE_BIR,
+				      table & PCI_MSIX_TABLE_OFFSET);
+	if (!dev->msix_table) {
+		uk_pr_warn("PCI %02x:%02x.%02x: Cannot map MSI-X table\n",
+			   (int) dev->addr.bus, (int) dev->addr.devid,
+			   (int) dev->addr.function);
+		return -ENOTSUP;
+	}
+
+	/* Enable MSI-X with all vectors masked while we set up the table */
+	pci_conf_write(dev, dev->msix_cap + PCI_MSIX_FLAGS, 2,
+		       ctrl | PCI_MSIX_FLAGS_ENABLE | PCI_MSIX_FLAGS_MASKALL);
+	for (i = 0; i < dev->msix_count; i++)
+		pci_msix_vector_mask(dev, i, 1);
+	pci_conf_write(dev, dev->msix_cap + PCI_MSIX_FLAGS, 2,
+		       (ctrl | PCI_MSIX_FLAGS_ENABLE)
+		       & ~PCI_MSIX_FLAGS_MASKALL);
+
+	/* The device must be able to write the messages */
+	pci_conf_write(dev, PCI_COMMAND, 2,
+		       pci_conf_read(dev, PCI_COMMAND, 2)
+		       | PCI_COMMAND_MASTER | PCI_COMMAND_INTX_DISABLE);
+	return 0;
+}
+
+void pci_msix_disable(struct pci_device *dev)
+{
+	uint16_t ctrl;
+	unsigned int i;
+
+	UK_ASSERT(dev);
+
+	if (!dev->msix_table)
+		return;
+
+	for (i = 0; i < dev->msix_count; i++)
+		pci_msix_vector_mask(dev, i, 1);
+
+	ctrl = pci_conf_read(dev, dev->msix_cap + PCI_MSIX_FLAGS, 2);
+	pci_conf_write(dev, dev->msix_cap + PCI_MSIX_FLAGS, 2,
+		       ctrl & ~PCI_MSIX_FLAGS_ENABLE);
+	pci_conf_write(dev, PCI_COMMAND, 2,
+		       pci_conf_read(dev, PCI_COMMAND, 2)
+		       & ~PCI_COMMAND_INTX_DISABLE);
+	dev->msix_table = NULL;
+}
+
+void pci_msix_vector_mask(struct pci_device *dev, unsigned int entry,
+			  int mask)
+{
+	volatile uint32_t *e = pci_msix_entry(dev, entry);
+	uint32_t ctrl;
+
+	ctrl = e[PCI_MSIX_ENTRY_VECTOR_CTRL];
+	if (mask)
+		ctrl |= PCI_MSIX_ENTRY_CTRL_MASKBIT;
+	else
+		ctrl &= ~PCI_MSIX_ENTRY_CTRL_MASKBIT;
+	e[PCI_MSIX_ENTRY_VECTOR_CTRL] = ctrl;
+
+	/* Flush the posted write */
+	(void) e[PCI_MSIX_ENTRY_VECTOR_CTRL];
+}
+
+int pci_msix_vector_affinity(struct pci_device *dev, unsigned int entry,
+			     unsigned long irq, unsigned int lcpuidx)
+{
+	volatile uint32_t *e = pci_msix_entry(dev, entry);
+	uint64_t addr;
+	uint32_t data;
+	int masked;
+	int rc;
+
+	rc = arch_pci_msi_compose(irq, lcpuidx, &addr, &data);
+	if (unlikely(rc))
+		return rc;
+
+	/* The entry must be masked while the message is updated */
+	masked = e[PCI_MSIX_ENTRY_VECTOR_CTRL] & PCI_MSIX_ENTRY_CTRL_MASKBIT;
+	if (!masked)
+		pci_msix_vector_mask(dev, entry, 1);
+	e[PCI_MSIX_ENTRY_LOWER_ADDR] = (uint32_t) addr;
+	e[PCI_MSIX_ENTRY_UPPER_ADDR] = (uint32_t) (addr >> 32);
+	e[PCI_MSIX_ENTRY_DATA]       = data;
+	if (!masked)
+		pci_msix_vector_mask(dev, entry, 0);
+	return 0;
+}
+
+int pci_msix_vector_alloc(struct pci_device *dev, unsigned int entry,
+			  unsigned int lcpuidx)
+{
+	int irq, rc;
+
+	irq = arch_pci_msi_irq_alloc();
+	if (unlikely(irq < 0))
+		return irq;
+
+	rc = pci_msix_vector_affinity(dev, entry, irq, lcpuidx);
+	if (unlikely(rc)) {
+		arch_pci_msi_irq_free(irq);
+		return rc;
+	}
+	return irq;
+}
+
 static int pci_probe(void)
 {
 	return arch_pci_probe(ph.a);
@@ -58,6 +58,10 @@ __lcpuid lcpu_arch_id(void)
 	return (ebx >> 24);
 }
 
+void __weak lcpu_time_init(struct lcpu *this_lcpu __unused)
+{
+}
+
 int lcpu_arch_init(struct lcpu *this_lcpu)
 {
 #ifdef CONFIG_HAVE_SMP
@@ -70,6 +74,10 @@ int lcpu_arch_init(struct lcpu *this_lcpu)
 
 	traps_lcpu_init(this_lcpu);
 
+	/* The boot CPU sets up its clock during ukplat_time_init() */
+	if (!lcpu_is_bsp(this_lcpu))
+		lcpu_time_init(this_lcpu);
+
 	return 0;
 }
 
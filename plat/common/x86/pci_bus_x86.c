@@ -52,9 +52,17 @@
  */
 
 #include <string.h>
+#include <errno.h>
 #include <uk/print.h>
+#include <uk/plat/lcpu.h>
 #include <uk/plat/common/cpu.h>
+#include <uk/plat/common/lcpu.h>
+#include <x86/irq.h>
+#include <x86/apic.h>
 #include <pci/pci_bus.h>
+#if CONFIG_PAGING
+#include <uk/plat/paging.h>
+#endif /* CONFIG_PAGING */
 
 #define PCI_CONF_READ(type, ret, a, s)					\
 	do {								\
@@ -65,6 +73,171 @@
 		*(ret) = (type) _conf_data;				\
 	} while (0)
 
+/* MSI message address for fixed delivery to a physical APIC ID */
+#define MSI_ADDR_BASE		0xfee00000UL
+#define MSI_ADDR_DEST_SHIFT	12
+#define MSI_ADDR_DEST_MAX	0xff
+
+/* The boot page tables identity-map the first 4 GiB. With paging enabled,
+ * BARs are mapped 1:1 on demand, but must stay below the directly mapped
+ * heap area.
+ */
+#define PCI_MMIO_LIMIT		0x100000000ULL
+
+static inline uint32_t pci_conf_addr(struct pci_address *addr, uint8_t off)
+{
+	return (PCI_ENABLE_BIT)
+		| (addr->bus << PCI_BUS_SHIFT)
+		| (addr->devid << PCI_DEVICE_SHIFT)
+		| (addr->function << PCI_FUNCTION_SHIFT)
+		| (off & ~0x3);
+}
+
+uint32_t arch_pci_conf_read(struct pci_address *addr, uint8_t off,
+			    uint8_t len)
+{
+	unsigned long flags;
+	uint32_t val;
+
+	/* Selecting the register and accessing it must not be interleaved */
+	flags = ukplat_lcpu_save_irqf();
+	outl(PCI_CONFIG_ADDR, pci_conf_addr(addr, off));
+	switch (len) {
+	case 1:
+		val = inb(PCI_CONFIG_DATA + (off & 0x3));
+		break;
+	case 2:
+		val = inw(PCI_CONFIG_DATA + (off & 0x2));
+		break;
+	default:
+		val = inl(PCI_CONFIG_DATA);
+		break;
+	}
+	ukplat_lcpu_restore_irqf(flags);
+
+	return val;
+}
+
+void arch_pci_conf_write(struct pci_address *addr, uint8_t off, uint8_t len,
+			 uint32_t val)
+{
+	unsigned long flags;
+
+	flags = ukplat_lcpu_save_irqf();
+	outl(PCI_CONFIG_ADDR, pci_conf_addr(addr, off));
+	switch (len) {
+	case 1:
+		outb(PCI_CONFIG_DATA + (off & 0x3), (uint8_t) val);
+		break;
+	case 2:
+		outw(PCI_CONFIG_DATA + (off & 0x2), (uint16_t) val);
+		break;
+	default:
+		outl(PCI_CONFIG_DATA, val);
+		break;
+	}
+	ukplat_lcpu_restore_irqf(flags);
+}
+
+void *arch_pci_mmio_map(uint64_t paddr, uint64_t len)
+{
+#if CONFIG_PAGING
+	struct uk_pagetable *pt = ukplat_pt_get_active();
+	const unsigned long attr = PAGE_ATTR_PROT_RW | PAGE_ATTR_NOCACHE;
+	__vaddr_t vaddr, end;
+	int rc;
+#endif /* CONFIG_PAGING */
+
+	if (!len || paddr + len > PCI_MMIO_LIMIT || paddr + len < paddr)
+		return NULL;
+
+#if CONFIG_PAGING
+	/* _init_paging() leaves nothing but the reserved ranges mapped, and
+	 * those read-only. Map the region page by page, as parts of it may
+	 * already be mapped, either as reserved memory or by an earlier call
+	 * for another capability in the same BAR.
+	 */
+	end = PAGE_ALIGN_UP(paddr + len);
+	for (vaddr = PAGE_ALIGN_DOWN(paddr); vaddr < end; vaddr += PAGE_SIZE) {
+		rc = ukplat_page_map(pt, vaddr, vaddr, 1, attr, 0);
+		if (rc == -EEXIST)
+			rc = ukplat_page_set_attr(pt, vaddr, 1, attr, 0);
+		if (unlikely(rc)) {
+			uk_pr_err("Failed to map PCI MMIO at 0x%"__PRIvaddr
+				  ": %d\n", vaddr, rc);
+			return NULL;
+		}
+	}
+#endif /* CONFIG_PAGING */
+
+	return (void *) paddr;
+}
+
+static unsigned long msi_irq_used;
+UK_CTASSERT(__MSI_IRQ_COUNT <= sizeof(msi_irq_used) * 8);
+
+int arch_pci_msi_irq_alloc(void)
+{
+	static int apic_ready;
+	unsigned long flags;
+	int i, rc;
+
+	/* MSIs are delivered to the local APIC, which must accept them and
+	 * is acknowledged through the x2APIC EOI register.
+	 */
+	if (!apic_ready) {
+		rc = apic_enable();
+		if (unlikely(rc))
+			return rc;
+		apic_ready = 1;
+	}
+
+	flags = ukplat_lcpu_save_irqf();
+	for (i = 0; i < __MSI_IRQ_COUNT; i++) {
+		if (!(msi_irq_used & (1UL << i))) {
+			msi_irq_used |= (1UL << i);
+			break;
+		}
+	}
+	ukplat_lcpu_restore_irqf(flags);
+
+	if (unlikely(i == __MSI_IRQ_COUNT))
+		return -ENOSPC;
+	return __MSI_IRQ_BASE + i;
+}
+
+void arch_pci_msi_irq_free(unsigned long irq)
+{
+	unsigned long flags;
+
+	UK_ASSERT(irq >= __MSI_IRQ_BASE && irq < __MAX_IRQ);
+
+	flags = ukplat_lcpu_save_irqf();
+	msi_irq_used &= ~(1UL << (irq - __MSI_IRQ_BASE));
+	ukplat_lcpu_restore_irqf(flags);
+}
+
+int arch_pci_msi_compose(unsigned long irq, unsigned int lcpuidx,
+			 uint64_t *addr, uint32_t *data)
+{
+	__lcpuid id;
+
+	UK_ASSERT(irq >= __MSI_IRQ_BASE && irq < __MAX_IRQ);
+
+	if (unlikely(lcpuidx >= ukplat_lcpu_count()))
+		return -EINVAL;
+
+	/* Without interrupt remapping, only 8-bit APIC IDs are reachable */
+	id = lcpu_get(lcpuidx)->id;
+	if (unlikely(id > MSI_ADDR_DEST_MAX))
+		return -ENOTSUP;
+
+	/* Fixed delivery, edge triggered, same vector layout as the PIC */
+	*addr = MSI_ADDR_BASE | (id << MSI_ADDR_DEST_SHIFT);
+	*data = 32 + irq;
+	return 0;
+}
+
 static inline int pci_driver_add_device(struct pci_driver *drv,
 					struct pci_address *addr,
 					struct pci_device_id *devid)
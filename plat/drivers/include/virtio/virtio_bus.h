@@ -114,6 +114,9 @@ struct virtio_config_ops {
 				      struct uk_alloc *a);
 	void (*vq_release)(struct virtio_dev *vdev, struct virtqueue *vq,
 				struct uk_alloc *a);
+	/** Steer the interrupts of a virtqueue to a logical CPU (optional) */
+	int (*vq_set_affinity)(struct virtio_dev *vdev, struct virtqueue *vq,
+			       unsigned int lcpuidx);
 };
 
 /**
@@ -345,6 +348,31 @@ static inline void virtio_vqueue_release(struct virtio_dev *vdev,
 		vdev->cops->vq_release(vdev, vq, a);
 }
 
+/**
+ * A helper function to steer the interrupts of an individual virtqueue to
+ * a logical CPU. This requires a transport with per-queue interrupts.
+ * @param vdev
+ *	Reference to the virtio device.
+ * @param vq
+ *	Reference to the virtqueue.
+ * @param lcpuidx
+ *	Index of the logical CPU that should handle the interrupts.
+ * @return int
+ *	0 on success,
+ *	-ENOTSUP if the transport does not support interrupt steering.
+ */
+static inline int virtio_vqueue_set_affinity(struct virtio_dev *vdev,
+					     struct virtqueue *vq,
+					     unsigned int lcpuidx)
+{
+	UK_ASSERT(vdev);
+	UK_ASSERT(vq);
+
+	if (!vdev->cops->vq_set_affinity)
+		return -ENOTSUP;
+	return vdev->cops->vq_set_affinity(vdev, vq, lcpuidx);
+}
+
 static inline void virtio_dev_drv_up(struct virtio_dev *vdev)
 {
 	virtio_dev_status_update(vdev, VIRTIO_CONFIG_STATUS_DRIVER_OK);
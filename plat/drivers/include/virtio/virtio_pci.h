@@ -30,12 +30,14 @@
 #ifndef __PLAT_DRV_VIRTIO_PCI_H__
 #define __PLAT_DRV_VIRTIO_PCI_H__
 
+#include <uk/arch/types.h>
+#include <uk/essentials.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus __ */
 
-/* virtio config space layout */
-/* TODO we currently support only the legacy interface */
+/* virtio config space layout of the legacy interface */
 #define VIRTIO_PCI_HOST_FEATURES        0    /* 32-bit r/o */
 #define VIRTIO_PCI_GUEST_FEATURES       4    /* 32-bit r/w */
 #define VIRTIO_PCI_QUEUE_PFN            8    /* 32-bit r/w */
@@ -67,6 +69,51 @@ extern "C" {
 #define VIRTIO_PCI_CONFIG_OFF           20
 #define VIRTIO_PCI_VRING_ALIGN          4096
 
+/*
+ * Modern (virtio 1.0) interface: The device registers are located in memory
+ * BARs that are described by vendor-specific PCI capabilities.
+ */
+#define VIRTIO_PCI_CAP_COMMON_CFG       1    /* Common configuration */
+#define VIRTIO_PCI_CAP_NOTIFY_CFG       2    /* Notifications */
+#define VIRTIO_PCI_CAP_ISR_CFG          3    /* ISR Status */
+#define VIRTIO_PCI_CAP_DEVICE_CFG       4    /* Device specific config */
+#define VIRTIO_PCI_CAP_PCI_CFG          5    /* PCI configuration access */
+
+/* Offsets into struct virtio_pci_cap within the PCI config space */
+#define VIRTIO_PCI_CAP_CFG_TYPE         3    /* 8-bit */
+#define VIRTIO_PCI_CAP_BAR              4    /* 8-bit */
+#define VIRTIO_PCI_CAP_OFFSET           8    /* 32-bit */
+#define VIRTIO_PCI_CAP_LENGTH           12   /* 32-bit */
+#define VIRTIO_PCI_NOTIFY_CAP_MULT      16   /* 32-bit */
+
+struct virtio_pci_common_cfg {
+	/* About the whole device */
+	__u32 device_feature_select;   /* read-write */
+	__u32 device_feature;          /* read-only */
+	__u32 guest_feature_select;    /* read-write */
+	__u32 guest_feature;           /* read-write */
+	__u16 msix_config;             /* read-write */
+	__u16 num_queues;              /* read-only */
+	__u8 device_status;            /* read-write */
+	__u8 config_generation;        /* read-only */
+
+	/* About a specific virtqueue */
+	__u16 queue_select;            /* read-write */
+	__u16 queue_size;              /* read-write, power of 2 */
+	__u16 queue_msix_vector;       /* read-write */
+	__u16 queue_enable;            /* read-write */
+	__u16 queue_notify_off;        /* read-only */
+	__u32 queue_desc_lo;           /* read-write */
+	__u32 queue_desc_hi;           /* read-write */
+	__u32 queue_avail_lo;          /* read-write */
+	__u32 queue_avail_hi;          /* read-write */
+	__u32 queue_used_lo;           /* read-write */
+	__u32 queue_used_hi;           /* read-write */
+} __packed;
+
+/* Vector value used to disable MSI-X for a queue or config changes */
+#define VIRTIO_MSI_NO_VECTOR            0xffff
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus __ */
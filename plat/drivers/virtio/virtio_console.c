@@ -0,0 +1,250 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <uk/alloc.h>
+#include <uk/essentials.h>
+#include <uk/print.h>
+#include <uk/sglist.h>
+#include <virtio/virtio_bus.h>
+#include <virtio/virtio_console.h>
+#include <kvm/console.h>
+
+#define DRIVER_NAME		"virtio-console"
+#define VTCONS_TXBUF_SIZE	__PAGE_SIZE
+#define VTCONS_TXBUF_COUNT	8 /* The number of in-flight transmissions */
+
+UK_CTASSERT(VTCONS_TXBUF_COUNT <= 32);
+
+static struct uk_alloc *a;
+
+struct virtio_console_device {
+	/* Virtio device. */
+	struct virtio_dev *vdev;
+	/* Transmit virtqueue of port 0. */
+	struct virtqueue *txq;
+	/* Whether we asked for a transmit completion interrupt. */
+	int txintr;
+	/* Transmit buffers and the mask of those owned by the driver. */
+	char *txbufs;
+	__u32 txfree;
+	/* Scatter-gather list. */
+	struct uk_sglist sg;
+	struct uk_sglist_seg sgsegs[1];
+	/* Console output sink. */
+	struct kvm_console_sink sink;
+};
+
+/* Only the first console device takes over the console output */
+static struct virtio_console_device *vtcons;
+
+static void virtio_console_tx_reclaim(struct virtio_console_device *d)
+{
+	void *cookie;
+	__u32 len;
+
+	while (virtqueue_buffer_dequeue(d->txq, &cookie, &len) >= 0)
+		d->txfree |= 1U << (((char *) cookie - d->txbufs)
+				    / VTCONS_TXBUF_SIZE);
+}
+
+/*
+ * Called by the console ring consumer only, so there is no concurrent
+ * access to the transmit queue.
+ */
+static unsigned int virtio_console_write(struct kvm_console_sink *sink,
+					 const char *buf, unsigned int len)
+{
+	struct virtio_console_device *d;
+	char *txbuf;
+	int idx, rc;
+
+	d = __containerof(sink, struct virtio_console_device, sink);
+
+	virtio_console_tx_reclaim(d);
+	if (unlikely(!d->txfree)) {
+		/* Have the device tell us when a buffer comes back. A buffer
+		 * might have completed before the interrupt got enabled.
+		 */
+		d->txintr = 1;
+		if (!virtqueue_intr_enable(d->txq))
+			return 0;
+		virtio_console_tx_reclaim(d);
+		if (!d->txfree)
+			return 0;
+	}
+	if (d->txintr) {
+		virtqueue_intr_disable(d->txq);
+		d->txintr = 0;
+	}
+
+	idx = __builtin_ffs(d->txfree) - 1;
+	txbuf = d->txbufs + idx * VTCONS_TXBUF_SIZE;
+	len = MIN(len, VTCONS_TXBUF_SIZE);
+	memcpy(txbuf, buf, len);
+
+	uk_sglist_reset(&d->sg);
+	rc = uk_sglist_append(&d->sg, txbuf, len);
+	if (unlikely(rc != 0))
+		return 0;
+
+	rc = virtqueue_buffer_enqueue(d->txq, txbuf, &d->sg, 1, 0);
+	if (unlikely(rc < 0))
+		return 0;
+	d->txfree &= ~(1U << idx);
+
+	virtqueue_host_notify(d->txq);
+	return len;
+}
+
+static int virtio_console_tx_done(struct virtqueue *vq __unused,
+				  void *priv __unused)
+{
+	/* Buffers are reclaimed by the next write */
+	_libkvmplat_console_flush();
+	return 1;
+}
+
+static int virtio_console_vq_alloc(struct virtio_console_device *d)
+{
+	__u16 qdesc_size[2];
+	int vq_avail;
+
+	vq_avail = virtio_find_vqs(d->vdev, 2, qdesc_size);
+	if (unlikely(vq_avail != 2)) {
+		uk_pr_err(DRIVER_NAME": Expected: %d queues, found %d\n",
+			  2, vq_avail);
+		return -ENOMEM;
+	}
+
+	/* Input stays with the serial port, so the receive queue of port 0
+	 * is not set up
+	 */
+	d->txq = virtio_vqueue_setup(d->vdev, VIRTIO_CONSOLE_TX_QUEUE,
+				     qdesc_size[VIRTIO_CONSOLE_TX_QUEUE],
+				     virtio_console_tx_done, a);
+	if (unlikely(PTRISERR(d->txq))) {
+		uk_pr_err(DRIVER_NAME": Failed to set up virtqueue %d\n",
+			  VIRTIO_CONSOLE_TX_QUEUE);
+		return PTR2ERR(d->txq);
+	}
+	d->txq->priv = d;
+	virtqueue_intr_disable(d->txq);
+
+	return 0;
+}
+
+static int virtio_console_configure(struct virtio_console_device *d)
+{
+	int rc;
+
+	/* We need none of the optional features */
+	d->vdev->features = 0;
+	virtio_feature_set(d->vdev, d->vdev->features);
+
+	d->txbufs = uk_memalign(a, __PAGE_SIZE,
+				VTCONS_TXBUF_COUNT * VTCONS_TXBUF_SIZE);
+	if (unlikely(!d->txbufs)) {
+		rc = -ENOMEM;
+		goto out_status_fail;
+	}
+	d->txfree = (1ULL << VTCONS_TXBUF_COUNT) - 1;
+	uk_sglist_init(&d->sg, ARRAY_SIZE(d->sgsegs), &d->sgsegs[0]);
+
+	rc = virtio_console_vq_alloc(d);
+	if (unlikely(rc)) {
+		uk_pr_err(DRIVER_NAME": Could not allocate virtqueue\n");
+		goto out_free_bufs;
+	}
+	return 0;
+
+out_free_bufs:
+	uk_free(a, d->txbufs);
+out_status_fail:
+	virtio_dev_status_update(d->vdev, VIRTIO_CONFIG_STATUS_FAIL);
+	return rc;
+}
+
+static int virtio_console_add_dev(struct virtio_dev *vdev)
+{
+	struct virtio_console_device *d;
+	int rc;
+
+	UK_ASSERT(vdev != NULL);
+
+	if (vtcons) {
+		uk_pr_info(DRIVER_NAME": Ignoring additional device %p\n",
+			   vdev);
+		return 0;
+	}
+
+	d = uk_calloc(a, 1, sizeof(*d));
+	if (!d)
+		return -ENOMEM;
+	d->vdev = vdev;
+
+	rc = virtio_console_configure(d);
+	if (rc)
+		goto out_free;
+
+	virtio_dev_drv_up(d->vdev);
+
+	d->sink.write = virtio_console_write;
+	vtcons = d;
+	_libkvmplat_console_sink_register(&d->sink);
+	uk_pr_info(DRIVER_NAME": Console output moved to %p\n", vdev);
+	return 0;
+
+out_free:
+	uk_free(a, d);
+	return rc;
+}
+
+static int virtio_console_drv_init(struct uk_alloc *drv_allocator)
+{
+	if (!drv_allocator)
+		return -EINVAL;
+
+	a = drv_allocator;
+	return 0;
+}
+
+static const struct virtio_dev_id vcons_dev_id[] = {
+	{VIRTIO_ID_CONSOLE},
+	{VIRTIO_ID_INVALID} /* List Terminator */
+};
+
+static struct virtio_driver vcons_drv = {
+	.dev_ids = vcons_dev_id,
+	.init    = virtio_console_drv_init,
+	.add_dev = virtio_console_add_dev
+};
+VIRTIO_BUS_REGISTER_DRIVER(&vcons_drv);
@@ -158,6 +158,8 @@ struct virtio_net_device {
 	__u8 state;
 	/* RX promiscuous mode. */
 	__u8 promisc : 1;
+	/* Length of the virtio-net header exchanged with the device */
+	__u16 hdr_len;
 };
 
 /**
@@ -331,7 +333,7 @@ static int virtio_netdev_xmit(struct uk_netdev *dev,
 			      struct uk_netdev_tx_queue *queue,
 			      struct uk_netbuf *pkt)
 {
-	struct virtio_net_device *vndev __unused;
+	struct virtio_net_device *vndev;
 	struct virtio_net_hdr *vhdr;
 	struct virtio_net_hdr_padded *padded_hdr;
 	int16_t header_sz = sizeof(*padded_hdr);
@@ -378,7 +380,7 @@ static int virtio_netdev_xmit(struct uk_netdev *dev,
 	 *       to `uk_sglist_append_netbuf()`. However, a netbuf
 	 *       chain can only once have set the PARTIAL_CSUM flag.
 	 */
-	memset(vhdr, 0, sizeof(*vhdr));
+	memset(vhdr, 0, vndev->hdr_len);
 	if (pkt->flags & UK_NETBUF_F_PARTIAL_CSUM) {
 		vhdr->flags       |= VIRTIO_NET_HDR_F_NEEDS_CSUM;
 		/* `csum_start` is without header size */
@@ -400,7 +402,7 @@ static int virtio_netdev_xmit(struct uk_netdev *dev,
 	 * 1 for the virtio header and the other for the actual network packet.
 	 */
 	/* Appending the data to the list. */
-	rc = uk_sglist_append(&queue->sg, vhdr, sizeof(*vhdr));
+	rc = uk_sglist_append(&queue->sg, vhdr, vndev->hdr_len);
 	if (unlikely(rc != 0)) {
 		uk_pr_err("Failed to append to the sg list\n");
 		goto err_remove_vhdr;
@@ -497,7 +499,7 @@ static int virtio_netdev_rxq_enqueue(struct uk_netdev_rx_queue *rxq,
 	uk_sglist_reset(sg);
 
 	/* Appending the header buffer to the sglist */
-	uk_sglist_append(sg, rxhdr, sizeof(struct virtio_net_hdr));
+	uk_sglist_append(sg, rxhdr, to_virtionetdev(rxq->ndev)->hdr_len);
 
 	/* Appending the data buffer to the sglist */
 	uk_sglist_append(sg, buf_start, buf_len);
@@ -551,7 +553,8 @@ static int virtio_netdev_rxq_dequeue(struct uk_netdev_rx_queue *rxq,
 	 * alignment of the packet data. We compensate for this, by adding the
 	 *  padding to the length on dequeue.
 	 */
-	buf->len = len + VTNET_RX_HEADER_PAD;
+	buf->len = len + sizeof(struct virtio_net_hdr_padded)
+		   - to_virtionetdev(rxq->ndev)->hdr_len;
 	rc = uk_netbuf_header(buf,
 			      -((int16_t)sizeof(struct virtio_net_hdr_padded)));
 	UK_ASSERT(rc == 1);
@@ -930,6 +933,15 @@ static int virtio_netdev_feature_negotiate(struct uk_netdev *n)
 	vndev->vdev->features = drv_features;
 	virtio_feature_set(vndev->vdev, vndev->vdev->features);
 
+	/**
+	 * Virtio 1.0 devices always use the header layout that includes the
+	 * `num_buffers` field. It still fits into the padded header space.
+	 */
+	if (VIRTIO_FEATURE_HAS(vndev->vdev->features, VIRTIO_F_VERSION_1))
+		vndev->hdr_len = sizeof(struct virtio_net_hdr_mrg_rxbuf);
+	else
+		vndev->hdr_len = sizeof(struct virtio_net_hdr);
+
 	/**
 	 * According to Virtio specification, section 2.3.1. Config fields
 	 * greater than 32-bits cannot be atomically read. We may need to
@@ -48,6 +48,22 @@
 
 static struct uk_alloc *a;
 
+#if CONFIG_VIRTIO_PCI_MODERN
+/**
+ * Per-virtqueue state of the modern transport.
+ */
+struct virtio_pci_vq_info {
+	/* The virtqueue, NULL if it is not set up */
+	struct virtqueue *vq;
+	/* Notification address of the queue */
+	volatile __u16 *notify;
+	/* MSI-X IRQ of the queue, negative if the queue has no vector */
+	int irq;
+	/* Logical CPU that receives the interrupts of the queue */
+	unsigned int lcpuidx;
+};
+#endif /* CONFIG_VIRTIO_PCI_MODERN */
+
 /**
  * The structure declares a pci device.
  */
@@ -60,6 +76,24 @@ struct virtio_pci_dev {
 	__u64 pci_isr_addr;
 	/* Pci device information */
 	struct pci_device *pdev;
+#if CONFIG_VIRTIO_PCI_MODERN
+	/* Common configuration structure (modern only) */
+	volatile struct virtio_pci_common_cfg *common;
+	/* ISR status register (modern only) */
+	volatile __u8 *isr;
+	/* Device-specific configuration (modern only) */
+	volatile __u8 *device;
+	/* Base of the notification area and the queue offset multiplier */
+	volatile __u8 *notify_base;
+	__u32 notify_mult;
+	/* Per-virtqueue state, allocated on virtqueue discovery */
+	struct virtio_pci_vq_info *vqi;
+	__u16 vqi_count;
+	/* Set if every virtqueue got its own MSI-X vector */
+	int msix;
+	/* Set if the INTx handler is registered */
+	int intx;
+#endif /* CONFIG_VIRTIO_PCI_MODERN */
 };
 
 /**
@@ -96,6 +130,10 @@ static int virtio_pci_handle(void *arg);
 static int vpci_legacy_notify(struct virtio_dev *vdev, __u16 queue_id);
 static int virtio_pci_legacy_add_dev(struct pci_device *pci_dev,
 				     struct virtio_pci_dev *vpci_dev);
+#if CONFIG_VIRTIO_PCI_MODERN
+static int virtio_pci_modern_add_dev(struct pci_device *pci_dev,
+				     struct virtio_pci_dev *vpci_dev);
+#endif /* CONFIG_VIRTIO_PCI_MODERN */
 
 /**
  * Configuration operations legacy PCI device.
@@ -387,6 +425,516 @@ static int virtio_pci_legacy_add_dev(struct pci_device *pci_dev,
 }
 
 
+#if CONFIG_VIRTIO_PCI_MODERN
+/**
+ * Modern (virtio 1.0) PCI transport. The device registers are accessed
+ * through memory BARs: Each virtqueue has its own notification address and,
+ * if MSI-X is available, its own interrupt vector.
+ */
+static int vpci_modern_notify(struct virtio_dev *vdev, __u16 queue_id)
+{
+	struct virtio_pci_dev *vpdev;
+
+	UK_ASSERT(vdev);
+	vpdev = to_virtiopcidev(vdev);
+	UK_ASSERT(queue_id < vpdev->vqi_count);
+	UK_ASSERT(vpdev->vqi[queue_id].notify);
+
+	/* A single write, no queue selection required */
+	*vpdev->vqi[queue_id].notify = queue_id;
+
+	return 0;
+}
+
+static int vpci_modern_vq_handle(void *arg)
+{
+	struct virtio_pci_vq_info *vqi = (struct virtio_pci_vq_info *) arg;
+	struct virtqueue *vq;
+
+	UK_ASSERT(arg);
+
+	/* The vector belongs to this queue only, there is no ISR to read */
+	vq = UK_READ_ONCE(vqi->vq);
+	if (likely(vq))
+		virtqueue_ring_interrupt(vq);
+
+	return 1;
+}
+
+static int vpci_modern_intx_handle(void *arg)
+{
+	struct virtio_pci_dev *d = (struct virtio_pci_dev *) arg;
+	struct virtqueue *vq;
+	__u8 isr_status;
+	int rc = 0;
+
+	UK_ASSERT(arg);
+
+	/* Reading the isr status is used to acknowledge the interrupt */
+	isr_status = *d->isr;
+	if (isr_status & VIRTIO_PCI_ISR_CONFIG) {
+		uk_pr_warn("Unsupported config change interrupt received on virtio-pci device %p\n",
+			   d);
+	}
+
+	if (isr_status & VIRTIO_PCI_ISR_HAS_INTR) {
+		UK_TAILQ_FOREACH(vq, &d->vdev.vqs, next) {
+			rc |= virtqueue_ring_interrupt(vq);
+		}
+	}
+	return rc;
+}
+
+static __u8 vpci_modern_pci_status_get(struct virtio_dev *vdev)
+{
+	struct virtio_pci_dev *vpdev;
+
+	UK_ASSERT(vdev);
+	vpdev = to_virtiopcidev(vdev);
+	return vpdev->common->device_status;
+}
+
+static void vpci_modern_pci_status_set(struct virtio_dev *vdev, __u8 status)
+{
+	struct virtio_pci_dev *vpdev;
+
+	/* Reset should be performed using the reset interface */
+	UK_ASSERT(vdev && status != VIRTIO_CONFIG_STATUS_RESET);
+
+	vpdev = to_virtiopcidev(vdev);
+	vpdev->common->device_status = vpdev->common->device_status | status;
+}
+
+static void vpci_modern_pci_dev_reset(struct virtio_dev *vdev)
+{
+	struct virtio_pci_dev *vpdev;
+
+	UK_ASSERT(vdev);
+	vpdev = to_virtiopcidev(vdev);
+
+	vpdev->common->device_status = VIRTIO_CONFIG_STATUS_RESET;
+
+	/* The reset is complete once the device reads back 0 (4.1.4.3.2) */
+	while (vpdev->common->device_status != VIRTIO_CONFIG_STATUS_RESET)
+		ukarch_spinwait();
+}
+
+static __u64 vpci_modern_pci_features_get(struct virtio_dev *vdev)
+{
+	struct virtio_pci_dev *vpdev;
+	__u64 features;
+
+	UK_ASSERT(vdev);
+	vpdev = to_virtiopcidev(vdev);
+
+	vpdev->common->device_feature_select = 1;
+	features = vpdev->common->device_feature;
+	features <<= 32;
+
+	vpdev->common->device_feature_select = 0;
+	features |= vpdev->common->device_feature;
+
+	return features;
+}
+
+static void vpci_modern_pci_features_set(struct virtio_dev *vdev,
+					 __u64 features __unused)
+{
+	struct virtio_pci_dev *vpdev;
+
+	UK_ASSERT(vdev);
+	vpdev = to_virtiopcidev(vdev);
+
+	/* virtio_feature_set() passes only the lower 32 bits, so we take
+	 * the full set from the device. VIRTIO_F_VERSION_1 is mandatory for
+	 * the modern interface.
+	 */
+	vdev->features = virtqueue_feature_negotiate(vdev->features);
+	VIRTIO_FEATURE_SET(vdev->features, VIRTIO_F_VERSION_1);
+
+	vpdev->common->guest_feature_select = 1;
+	vpdev->common->guest_feature = (__u32) (vdev->features >> 32);
+	vpdev->common->guest_feature_select = 0;
+	vpdev->common->guest_feature = (__u32) vdev->features;
+
+	vpci_modern_pci_status_set(vdev, VIRTIO_CONFIG_STATUS_FEATURES_OK);
+	if (!(vpci_modern_pci_status_get(vdev)
+	      & VIRTIO_CONFIG_STATUS_FEATURES_OK))
+		uk_pr_err("Virtio-pci device %p rejected features 0x%"__PRIx64"\n",
+			  vpdev, vdev->features);
+}
+
+static int vpci_modern_pci_config_get(struct virtio_dev *vdev, __u16 offset,
+				      void *buf, __u32 len, __u8 type_len)
+{
+	struct virtio_pci_dev *vpdev;
+	volatile __u8 *src;
+	__u8 gen;
+	__u32 i;
+
+	UK_ASSERT(vdev);
+	vpdev = to_virtiopcidev(vdev);
+	if (unlikely(!vpdev->device))
+		return -ENOTSUP;
+
+	src = vpdev->device + offset;
+
+	/* Retry until we got a consistent snapshot of the config space */
+	do {
+		gen = vpdev->common->config_generation;
+		if (type_len == len && (len == 1 || len == 2 || len == 4)) {
+			switch (len) {
+			case 1:
+				*(__u8 *) buf = *src;
+				break;
+			case 2:
+				*(__u16 *) buf = *(volatile __u16 *) src;
+				break;
+			default:
+				*(__u32 *) buf = *(volatile __u32 *) src;
+				break;
+			}
+		} else {
+			for (i = 0; i < len; i++)
+				((__u8 *) buf)[i] = src[i];
+		}
+	} while (gen != vpdev->common->config_generation);
+
+	return 0;
+}
+
+static int vpci_modern_pci_config_set(struct virtio_dev *vdev, __u16 offset,
+				      const void *buf, __u32 len)
+{
+	struct virtio_pci_dev *vpdev;
+	__u32 i;
+
+	UK_ASSERT(vdev);
+	vpdev = to_virtiopcidev(vdev);
+	if (unlikely(!vpdev->device))
+		return -ENOTSUP;
+
+	for (i = 0; i < len; i++)
+		vpdev->device[offset + i] = ((const __u8 *) buf)[i];
+
+	return 0;
+}
+
+static int vpci_modern_pci_vq_find(struct virtio_dev *vdev, __u16 num_vqs,
+				   __u16 *qdesc_size)
+{
+	struct virtio_pci_dev *vpdev;
+	int vq_cnt = 0, i, rc;
+
+	UK_ASSERT(vdev);
+	vpdev = to_virtiopcidev(vdev);
+
+	/* The per-queue state covers every queue of the device, so
+	 * interrupt handlers can keep referencing it.
+	 */
+	if (!vpdev->vqi) {
+		vpdev->vqi_count = vpdev->common->num_queues;
+		vpdev->vqi = uk_calloc(a, vpdev->vqi_count, sizeof(*vpdev->vqi));
+		if (unlikely(!vpdev->vqi)) {
+			vpdev->vqi_count = 0;
+			return -ENOMEM;
+		}
+		for (i = 0; i < vpdev->vqi_count; i++)
+			vpdev->vqi[i].irq = -1;
+	}
+
+	/* Configuration change interrupts are not supported */
+	vpdev->common->msix_config = VIRTIO_MSI_NO_VECTOR;
+
+	/* Use one MSI-X vector per queue if possible, INTx otherwise */
+	if (!vpdev->msix && !vpdev->intx) {
+		rc = pci_msix_enable(vpdev->pdev, MIN(num_vqs, vpdev->vqi_count));
+		if (rc == 0) {
+			vpdev->msix = 1;
+		} else {
+			uk_pr_info("Virtio-pci device %p: MSI-X not available (%d), using INTx\n",
+				   vpdev, rc);
+			rc = ukplat_irq_register(vpdev->pdev->irq,
+						 vpci_modern_intx_handle,
+						 vpdev);
+			if (rc != 0) {
+				uk_pr_err("Failed to register the interrupt\n");
+				return rc;
+			}
+			vpdev->intx = 1;
+		}
+	}
+
+	for (i = 0; i < num_vqs; i++) {
+		qdesc_size[i] = 0;
+		if (i < vpdev->vqi_count) {
+			vpdev->common->queue_select = i;
+			qdesc_size[i] = vpdev->common->queue_size;
+		}
+		if (unlikely(!qdesc_size[i])) {
+			uk_pr_err("Virtqueue %d not available\n", i);
+			continue;
+		}
+		vq_cnt++;
+	}
+	return vq_cnt;
+}
+
+/* Expects the queue to be selected */
+static int vpci_modern_vq_vector(struct virtio_pci_dev *vpdev, __u16 queue_id)
+{
+	struct virtio_pci_vq_info *vqi = &vpdev->vqi[queue_id];
+	int rc;
+
+	if (vqi->irq < 0) {
+		if (queue_id >= vpdev->pdev->msix_count)
+			return -ENOSPC;
+
+		rc = pci_msix_vector_alloc(vpdev->pdev, queue_id,
+					   vqi->lcpuidx);
+		if (unlikely(rc < 0))
+			return rc;
+		vqi->irq = rc;
+
+		rc = ukplat_irq_register(vqi->irq, vpci_modern_vq_handle, vqi);
+		if (unlikely(rc))
+			return rc;
+	}
+
+	/* The device reads back VIRTIO_MSI_NO_VECTOR if it failed to
+	 * allocate resources for the vector
+	 */
+	vpdev->common->queue_msix_vector = queue_id;
+	if (unlikely(vpdev->common->queue_msix_vector != queue_id))
+		return -ENOSPC;
+
+	pci_msix_vector_mask(vpdev->pdev, queue_id, 0);
+	return 0;
+}
+
+static struct virtqueue *vpci_modern_vq_setup(struct virtio_dev *vdev,
+					      __u16 queue_id,
+					      __u16 num_desc,
+					      virtqueue_callback_t callback,
+					      struct uk_alloc *a)
+{
+	struct virtio_pci_dev *vpdev;
+	struct virtio_pci_vq_info *vqi;
+	struct virtqueue *vq;
+	__paddr_t addr;
+	long flags;
+	int rc;
+
+	UK_ASSERT(vdev != NULL);
+
+	vpdev = to_virtiopcidev(vdev);
+	if (unlikely(queue_id >= vpdev->vqi_count)) {
+		uk_pr_err("Virtqueue %"__PRIu16" not available\n", queue_id);
+		return ERR2PTR(-EINVAL);
+	}
+	vqi = &vpdev->vqi[queue_id];
+
+	vq = virtqueue_create(queue_id, num_desc, VIRTIO_PCI_VRING_ALIGN,
+			      callback, vpci_modern_notify, vdev, a);
+	if (PTRISERR(vq)) {
+		uk_pr_err("Failed to create the virtqueue: %d\n",
+			  PTR2ERR(vq));
+		return vq;
+	}
+
+	/* Select the queue of interest */
+	vpdev->common->queue_select = queue_id;
+	vpdev->common->queue_size = num_desc;
+
+	/* Physical addresses of the rings (64-bit) */
+	addr = virtqueue_physaddr(vq);
+	vpdev->common->queue_desc_lo = (__u32) addr;
+	vpdev->common->queue_desc_hi = (__u32) ((__u64) addr >> 32);
+	addr = virtqueue_get_avail_addr(vq);
+	vpdev->common->queue_avail_lo = (__u32) addr;
+	vpdev->common->queue_avail_hi = (__u32) ((__u64) addr >> 32);
+	addr = virtqueue_get_used_addr(vq);
+	vpdev->common->queue_used_lo = (__u32) addr;
+	vpdev->common->queue_used_hi = (__u32) ((__u64) addr >> 32);
+
+	/* Cache the notification address so notify is a single write */
+	vqi->notify = (volatile __u16 *) (vpdev->notify_base
+		+ (__u32) vpdev->common->queue_notify_off * vpdev->notify_mult);
+
+	UK_WRITE_ONCE(vqi->vq, vq);
+	if (vpdev->msix) {
+		rc = vpci_modern_vq_vector(vpdev, queue_id);
+		if (unlikely(rc)) {
+			uk_pr_err("Failed to assign an MSI-X vector to virtqueue %"__PRIu16": %d\n",
+				  queue_id, rc);
+			UK_WRITE_ONCE(vqi->vq, NULL);
+			virtqueue_destroy(vq, a);
+			return ERR2PTR(rc);
+		}
+	}
+
+	vpdev->common->queue_enable = 1;
+
+	flags = ukplat_lcpu_save_irqf();
+	UK_TAILQ_INSERT_TAIL(&vpdev->vdev.vqs, vq, next);
+	ukplat_lcpu_restore_irqf(flags);
+
+	return vq;
+}
+
+static void vpci_modern_vq_release(struct virtio_dev *vdev,
+				   struct virtqueue *vq, struct uk_alloc *a)
+{
+	struct virtio_pci_dev *vpdev;
+	struct virtio_pci_vq_info *vqi;
+	long flags;
+
+	UK_ASSERT(vq != NULL);
+	UK_ASSERT(a != NULL);
+	vpdev = to_virtiopcidev(vdev);
+	UK_ASSERT(vq->queue_id < vpdev->vqi_count);
+	vqi = &vpdev->vqi[vq->queue_id];
+
+	/* A virtio 1.0 queue can only be disabled by a device reset. Detach
+	 * the queue from its vector; the IRQ stays reserved for the queue.
+	 */
+	vpdev->common->queue_select = vq->queue_id;
+	vpdev->common->queue_msix_vector = VIRTIO_MSI_NO_VECTOR;
+	if (vpdev->msix && vqi->irq >= 0)
+		pci_msix_vector_mask(vpdev->pdev, vq->queue_id, 1);
+	UK_WRITE_ONCE(vqi->vq, NULL);
+
+	flags = ukplat_lcpu_save_irqf();
+	UK_TAILQ_REMOVE(&vpdev->vdev.vqs, vq, next);
+	ukplat_lcpu_restore_irqf(flags);
+
+	virtqueue_destroy(vq, a);
+}
+
+static int vpci_modern_vq_set_affinity(struct virtio_dev *vdev,
+				       struct virtqueue *vq,
+				       unsigned int lcpuidx)
+{
+	struct virtio_pci_dev *vpdev;
+	struct virtio_pci_vq_info *vqi;
+	int rc;
+
+	UK_ASSERT(vq != NULL);
+	vpdev = to_virtiopcidev(vdev);
+	if (!vpdev->msix)
+		return -ENOTSUP;
+
+	UK_ASSERT(vq->queue_id < vpdev->vqi_count);
+	vqi = &vpdev->vqi[vq->queue_id];
+	UK_ASSERT(vqi->irq >= 0);
+
+	rc = pci_msix_vector_affinity(vpdev->pdev, vq->queue_id, vqi->irq,
+				      lcpuidx);
+	if (unlikely(rc))
+		return rc;
+
+	vqi->lcpuidx = lcpuidx;
+	return 0;
+}
+
+/**
+ * Configuration operations modern PCI device.
+ */
+static struct virtio_config_ops vpci_modern_ops = {
+	.device_reset    = vpci_modern_pci_dev_reset,
+	.config_get      = vpci_modern_pci_config_get,
+	.config_set      = vpci_modern_pci_config_set,
+	.features_get    = vpci_modern_pci_features_get,
+	.features_set    = vpci_modern_pci_features_set,
+	.status_get      = vpci_modern_pci_status_get,
+	.status_set      = vpci_modern_pci_status_set,
+	.vqs_find        = vpci_modern_pci_vq_find,
+	.vq_setup        = vpci_modern_vq_setup,
+	.vq_release      = vpci_modern_vq_release,
+	.vq_set_affinity = vpci_modern_vq_set_affinity,
+};
+
+static int virtio_pci_modern_add_dev(struct pci_device *pci_dev,
+				     struct virtio_pci_dev *vpci_dev)
+{
+	__u8 pos, type, bar;
+	__u32 offset;
+	volatile void *ptr;
+
+	/* Locate the register blocks. The first capability of a type wins */
+	for (pos = pci_find_cap(pci_dev, PCI_CAP_ID_VNDR, 0); pos;
+	     pos = pci_find_cap(pci_dev, PCI_CAP_ID_VNDR, pos)) {
+		type = pci_conf_read(pci_dev, pos + VIRTIO_PCI_CAP_CFG_TYPE, 1);
+		bar = pci_conf_read(pci_dev, pos + VIRTIO_PCI_CAP_BAR, 1);
+		offset = pci_conf_read(pci_dev, pos + VIRTIO_PCI_CAP_OFFSET, 4);
+		if (bar > 5)
+			continue;
+
+		ptr = NULL;
+		switch (type) {
+		case VIRTIO_PCI_CAP_COMMON_CFG:
+			if (!vpci_dev->common)
+				ptr = vpci_dev->common = pci_bar_map(pci_dev, bar,
+								     offset);
+			break;
+		case VIRTIO_PCI_CAP_NOTIFY_CFG:
+			if (!vpci_dev->notify_base) {
+				ptr = vpci_dev->notify_base =
+					pci_bar_map(pci_dev, bar, offset);
+				vpci_dev->notify_mult = pci_conf_read(pci_dev,
+					pos + VIRTIO_PCI_NOTIFY_CAP_MULT, 4);
+			}
+			break;
+		case VIRTIO_PCI_CAP_ISR_CFG:
+			if (!vpci_dev->isr)
+				ptr = vpci_dev->isr = pci_bar_map(pci_dev, bar,
+								  offset);
+			break;
+		case VIRTIO_PCI_CAP_DEVICE_CFG:
+			if (!vpci_dev->device)
+				ptr = vpci_dev->device = pci_bar_map(pci_dev,
+								     bar,
+								     offset);
+			break;
+		default:
+			continue;
+		}
+		if (ptr)
+			uk_pr_debug("Virtio-pci cap %"__PRIu8": bar %"__PRIu8" offset 0x%"__PRIx32" mapped at %p\n",
+				    type, bar, offset, (void *) ptr);
+	}
+
+	/* The device configuration is optional for some device types */
+	if (!vpci_dev->common || !vpci_dev->notify_base || !vpci_dev->isr) {
+		vpci_dev->common = NULL;
+		vpci_dev->notify_base = NULL;
+		vpci_dev->isr = NULL;
+		vpci_dev->device = NULL;
+		return -ENOTSUP;
+	}
+
+	/* Enable the memory BARs and DMA */
+	pci_conf_write(pci_dev, PCI_COMMAND, 2,
+		       pci_conf_read(pci_dev, PCI_COMMAND, 2)
+		       | PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER);
+
+	/* Setting the configuration operation */
+	vpci_dev->vdev.cops = &vpci_modern_ops;
+
+	uk_pr_info("Added virtio-pci device %04x (modern)\n",
+		   pci_dev->id.device_id);
+
+	/* Mapping the virtio device identifier */
+	if (pci_dev->id.device_id >= VIRTIO_PCI_MODERN_DEVICEID_START)
+		vpci_dev->vdev.id.virtio_device_id = pci_dev->id.device_id
+			- VIRTIO_PCI_MODERN_DEVICEID_START;
+	else
+		vpci_dev->vdev.id.virtio_device_id =
+			pci_dev->id.subsystem_device_id;
+	return 0;
+}
+#endif /* CONFIG_VIRTIO_PCI_MODERN */
+
 static int virtio_pci_add_dev(struct pci_device *pci_dev)
 {
 	struct virtio_pci_dev *vpci_dev = NULL;
@@ -394,7 +942,7 @@ static int virtio_pci_add_dev(struct pci_device *pci_dev)
 
 	UK_ASSERT(pci_dev != NULL);
 
-	vpci_dev = uk_malloc(a, sizeof(*vpci_dev));
+	vpci_dev = uk_calloc(a, 1, sizeof(*vpci_dev));
 	if (!vpci_dev) {
 		uk_pr_err("Failed to allocate virtio-pci device\n");
 		return -ENOMEM;
@@ -404,14 +952,20 @@ static int virtio_pci_add_dev(struct pci_device *pci_dev)
 	vpci_dev->pdev = pci_dev;
 	vpci_dev->pci_base_addr = pci_dev->base;
 
+#if CONFIG_VIRTIO_PCI_MODERN
 	/**
-	 * Probing for the legacy virtio device. We separate the legacy probing
-	 * with the possibility of supporting the modern PCI device in the
-	 * future.
+	 * Prefer the modern interface. Transitional devices offer both, in
+	 * which case we fall back to the legacy interface if the modern one
+	 * cannot be used.
 	 */
+	rc = virtio_pci_modern_add_dev(pci_dev, vpci_dev);
+	if (rc == -ENOTSUP)
+		rc = virtio_pci_legacy_add_dev(pci_dev, vpci_dev);
+#else /* !CONFIG_VIRTIO_PCI_MODERN */
 	rc = virtio_pci_legacy_add_dev(pci_dev, vpci_dev);
+#endif /* !CONFIG_VIRTIO_PCI_MODERN */
 	if (rc != 0) {
-		uk_pr_err("Failed to probe (legacy) pci device: %d\n", rc);
+		uk_pr_err("Failed to probe pci device: %d\n", rc);
 		goto free_pci_dev;
 	}
 
@@ -24,6 +24,7 @@
 
 void _libkvmplat_init_serial_console(void);
 void _libkvmplat_serial_putc(char a);
+unsigned int _libkvmplat_serial_write(const char *buf, unsigned int len);
 int  _libkvmplat_serial_getc(void);
 
 #endif /* __KVM_SERIAL_CONSOLE__ */
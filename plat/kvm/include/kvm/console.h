@@ -22,6 +22,52 @@
 #ifndef __KVM_CONSOLE_H__
 #define __KVM_CONSOLE_H__
 
+#include <uk/config.h>
+
 void _libkvmplat_init_console(void);
 
+#if CONFIG_KVM_CONSOLE_RING
+/**
+ * An output device that takes over the buffered console output from the
+ * serial port, e.g., a virtio console.
+ */
+struct kvm_console_sink {
+	/**
+	 * Writes up to `len` bytes from `buf` to the device. Called from the
+	 * single console consumer only and must not block. Returns the number
+	 * of bytes taken, 0 if the device is busy. Each call must reclaim
+	 * completed transmissions, since the console polls the sink when
+	 * it cannot wait for interrupts. The device calls
+	 * _libkvmplat_console_flush() once it can take more output.
+	 */
+	unsigned int (*write)(struct kvm_console_sink *sink,
+			      const char *buf, unsigned int len);
+};
+
+/**
+ * Sends the buffered console output to `sink` instead of the serial port.
+ */
+void _libkvmplat_console_sink_register(struct kvm_console_sink *sink);
+
+/**
+ * Drains the console ring without blocking. Called from idle and device
+ * completion contexts.
+ */
+void _libkvmplat_console_flush(void);
+
+/**
+ * Called when the CPU goes idle. Enables buffering on first use, since
+ * from now on there is a context that drains the ring, and flushes it.
+ */
+void _libkvmplat_console_idle(void);
+
+/**
+ * Synchronously writes out the console ring and disables buffering. The
+ * output goes to the registered sink, if any, otherwise to the serial
+ * port. Later output is written out right away. Used on shutdown and crash
+ * paths.
+ */
+void _libkvmplat_console_sync(void);
+#endif /* CONFIG_KVM_CONSOLE_RING */
+
 #endif /* __KVM_CONSOLE_H__ */
@@ -37,4 +37,31 @@ int tscclock_init(void);
 __u64 tscclock_monotonic(void);
 __u64 tscclock_epochoffset(void);
 
+#if CONFIG_KVM_LAPIC_TIMER
+#include <x86/apic.h>
+
+enum tscclock_lapic_timer_mode {
+	LAPIC_TIMER_NONE = 0,
+	LAPIC_TIMER_ONESHOT,
+	LAPIC_TIMER_DEADLINE,
+};
+
+extern enum tscclock_lapic_timer_mode tscclock_lapic_timer_mode;
+#endif /* CONFIG_KVM_LAPIC_TIMER */
+
+/*
+ * Acknowledge a timer interrupt. Called from the IRQ 0 handler, so this must
+ * stay inline: the handler is built with the ISR flags, but tscclock.c is not.
+ */
+static inline void tscclock_ack_irq(void)
+{
+#if CONFIG_KVM_LAPIC_TIMER
+	if (tscclock_lapic_timer_mode != LAPIC_TIMER_NONE)
+		apic_ack_interrupt();
+#endif /* CONFIG_KVM_LAPIC_TIMER */
+}
+#if CONFIG_UKPLAT_VDSO
+__u64 tscclock_vdso_monotonic(void);
+#endif /* CONFIG_UKPLAT_VDSO */
+
 #endif /* __KVM_TSCCLOCK_H__ */
@@ -26,6 +26,7 @@
 #include <uk/plat/common/irq.h>
 #include <uk/print.h>
 #include <uk/plat/bootstrap.h>
+#include <kvm/console.h>
 
 static void cpu_halt(void) __noreturn;
 
@@ -33,6 +34,9 @@ static void cpu_halt(void) __noreturn;
 void ukplat_terminate(enum ukplat_gstate request __unused)
 {
 	uk_pr_info("Unikraft halted\n");
+#if CONFIG_KVM_CONSOLE_RING
+	_libkvmplat_console_sync();
+#endif
 
 	/* Try to make system off */
 	system_off();
@@ -34,6 +34,206 @@
 #if (CONFIG_KVM_DEBUG_SERIAL_CONSOLE || CONFIG_KVM_KERNEL_SERIAL_CONSOLE)
 #include <kvm-x86/serial_console.h>
 #endif
+#if CONFIG_KVM_CONSOLE_RING
+#include <string.h>
+#include <uk/arch/atomic.h>
+#include <uk/arch/lcpu.h>
+#include <uk/plat/lcpu.h>
+#include <kvm/console.h>
+
+/*
+ * Serial console output is staged in a ring buffer and written out in
+ * batches when the CPU is idle, so that printing does not cost the caller
+ * two VM exits per character. Producers reserve space with a CAS on `head`
+ * and publish in reservation order through `tail`. There is a single
+ * consumer at a time, guarded by `flushing`.
+ */
+#define CONSOLE_RING_SIZE CONFIG_KVM_CONSOLE_RING_SIZE
+#define CONSOLE_RING_MASK (CONSOLE_RING_SIZE - 1)
+
+UK_CTASSERT(POWER_OF_2(CONSOLE_RING_SIZE));
+
+static struct {
+	char buf[CONSOLE_RING_SIZE];
+	__u32 head;	/* Next byte to reserve */
+	__u32 tail;	/* End of the bytes visible to the consumer */
+	__u32 cons;	/* Next byte to consume */
+	int flushing;	/* A consumer is active */
+	int async;	/* Output is buffered */
+	struct kvm_console_sink *sink;
+} cring;
+
+static unsigned int console_ring_reserve(const char *buf, unsigned int len)
+{
+	unsigned long flags;
+	__u32 head, next, off, n;
+
+	/* An interrupt handler printing between our reservation and commit
+	 * would wait for our commit forever
+	 */
+	flags = ukplat_lcpu_save_irqf();
+
+	head = __atomic_load_n(&cring.head, __ATOMIC_RELAXED);
+	do {
+		len = MIN(len, CONSOLE_RING_SIZE - (head -
+			  __atomic_load_n(&cring.cons, __ATOMIC_ACQUIRE)));
+		if (!len)
+			goto out;
+		next = head + len;
+	} while (!__atomic_compare_exchange_n(&cring.head, &head, next, 1,
+					      __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+
+	off = head & CONSOLE_RING_MASK;
+	n = MIN(len, CONSOLE_RING_SIZE - off);
+	memcpy(&cring.buf[off], buf, n);
+	memcpy(&cring.buf[0], buf + n, len - n);
+
+	/* Publish after all earlier reservations */
+	while (__atomic_load_n(&cring.tail, __ATOMIC_RELAXED) != head)
+		ukarch_spinwait();
+	__atomic_store_n(&cring.tail, next, __ATOMIC_RELEASE);
+
+out:
+	ukplat_lcpu_restore_irqf(flags);
+	return len;
+}
+
+/* Returns the number of bytes written out, 0 if another context is
+ * draining the ring or the sink is busy. With `sync` set, the output goes
+ * to the serial port even if a sink is registered.
+ */
+static unsigned int console_ring_drain(int sync)
+{
+	struct kvm_console_sink *sink;
+	__u32 cons, tail, off, n;
+	unsigned int total = 0;
+	unsigned long flags = 0;
+
+	if (__atomic_exchange_n(&cring.flushing, 1, __ATOMIC_ACQUIRE))
+		return 0;
+
+	/* Writers wait for the sink when the ring is full. An interrupt
+	 * handler waiting on this CPU would never let us finish.
+	 */
+	sink = sync ? NULL : UK_READ_ONCE(cring.sink);
+	if (sink)
+		flags = ukplat_lcpu_save_irqf();
+
+	cons = __atomic_load_n(&cring.cons, __ATOMIC_RELAXED);
+	for (;;) {
+		tail = __atomic_load_n(&cring.tail, __ATOMIC_ACQUIRE);
+		if (cons == tail)
+			break;
+
+		off = cons & CONSOLE_RING_MASK;
+		n = MIN(tail - cons, CONSOLE_RING_SIZE - off);
+		if (sink)
+			n = sink->write(sink, &cring.buf[off], n);
+		else
+			n = _libkvmplat_serial_write(&cring.buf[off], n);
+		if (!n)
+			break;
+
+		cons += n;
+		total += n;
+		__atomic_store_n(&cring.cons, cons, __ATOMIC_RELEASE);
+	}
+
+	if (sink)
+		ukplat_lcpu_restore_irqf(flags);
+	__atomic_store_n(&cring.flushing, 0, __ATOMIC_RELEASE);
+	return total;
+}
+
+/* Writes out the whole ring through the sink. The sink reclaims completed
+ * transmissions on every write, so this polls until the device catches up.
+ */
+static void console_ring_drain_wait(void)
+{
+	while (__atomic_load_n(&cring.cons, __ATOMIC_RELAXED) !=
+	       __atomic_load_n(&cring.tail, __ATOMIC_ACQUIRE)) {
+		if (!console_ring_drain(0))
+			ukarch_spinwait();
+	}
+}
+
+static void console_ring_put(const char *buf, unsigned int len)
+{
+	struct kvm_console_sink *sink = UK_READ_ONCE(cring.sink);
+	int async = UK_READ_ONCE(cring.async);
+	unsigned int n;
+
+	if (!async && !sink) {
+		_libkvmplat_serial_write(buf, len);
+		return;
+	}
+
+	while (len) {
+		n = console_ring_reserve(buf, len);
+		if (n) {
+			buf += n;
+			len -= n;
+			continue;
+		}
+
+		/* The ring is full. Output must not be split between the
+		 * sink and the serial port, so wait for the sink.
+		 */
+		if (sink) {
+			if (!console_ring_drain(0))
+				ukarch_spinwait();
+			continue;
+		}
+
+		/* Drain it ourselves and, if someone else is already doing
+		 * so, bypass the ring rather than wait.
+		 */
+		if (!console_ring_drain(0) && !console_ring_drain(1)) {
+			_libkvmplat_serial_write(buf, len);
+			return;
+		}
+	}
+
+	/* Unbuffered output through a sink is written out right away */
+	if (!async)
+		console_ring_drain_wait();
+}
+
+void _libkvmplat_console_sink_register(struct kvm_console_sink *sink)
+{
+	UK_WRITE_ONCE(cring.sink, sink);
+}
+
+void _libkvmplat_console_flush(void)
+{
+	console_ring_drain(0);
+}
+
+void _libkvmplat_console_idle(void)
+{
+	if (unlikely(!UK_READ_ONCE(cring.async)))
+		UK_WRITE_ONCE(cring.async, 1);
+
+	console_ring_drain(0);
+}
+
+void _libkvmplat_console_sync(void)
+{
+	UK_WRITE_ONCE(cring.async, 0);
+
+	/* Whoever drained the ring is not going to finish */
+	__atomic_store_n(&cring.flushing, 0, __ATOMIC_RELEASE);
+	if (UK_READ_ONCE(cring.sink))
+		console_ring_drain_wait();
+	else
+		console_ring_drain(1);
+}
+
+#define serial_cout(buf, len) console_ring_put(buf, len)
+#else /* !CONFIG_KVM_CONSOLE_RING */
+#define serial_cout(buf, len) _libkvmplat_serial_write(buf, len)
+#endif /* !CONFIG_KVM_CONSOLE_RING */
 
 void _libkvmplat_init_console(void)
 {
@@ -48,28 +248,26 @@ void _libkvmplat_init_console(void)
 
 int ukplat_coutd(const char *buf __maybe_unused, unsigned int len)
 {
-	for (unsigned int i = 0; i < len; i++) {
 #if CONFIG_KVM_DEBUG_SERIAL_CONSOLE
-		_libkvmplat_serial_putc(buf[i]);
+	serial_cout(buf, len);
 #endif
 #if CONFIG_KVM_DEBUG_VGA_CONSOLE
+	for (unsigned int i = 0; i < len; i++)
 		_libkvmplat_vga_putc(buf[i]);
 #endif
-	}
 	return len;
 }
 
 
 int ukplat_coutk(const char *buf __maybe_unused, unsigned int len)
 {
-	for (unsigned int i = 0; i < len; i++) {
 #if CONFIG_KVM_KERNEL_SERIAL_CONSOLE
-		_libkvmplat_serial_putc(buf[i]);
+	serial_cout(buf, len);
 #endif
 #if CONFIG_KVM_KERNEL_VGA_CONSOLE
+	for (unsigned int i = 0; i < len; i++)
 		_libkvmplat_vga_putc(buf[i]);
 #endif
-	}
 	return len;
 }
 
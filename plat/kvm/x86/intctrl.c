@@ -24,6 +24,8 @@
 
 #include <stdint.h>
 #include <x86/cpu.h>
+#include <x86/irq.h>
+#include <x86/apic.h>
 #include <kvm/intctrl.h>
 
 #define PIC1             0x20    /* IO base address for master PIC */
@@ -35,6 +37,7 @@
 #define IRQ_ON_MASTER(n) ((n) < 8)
 #define IRQ_PORT(n)      (IRQ_ON_MASTER(n) ? PIC1_DATA : PIC2_DATA)
 #define IRQ_OFFSET(n)    (IRQ_ON_MASTER(n) ? (n) : ((n) - 8))
+#define IRQ_IS_MSI(n)    ((n) >= __MSI_IRQ_BASE)
 
 #define PIC_EOI          0x20 /* End-of-interrupt command code */
 #define ICW1_ICW4        0x01 /* ICW4 (not) needed */
@@ -88,6 +91,12 @@ void intctrl_init(void)
 
 void intctrl_ack_irq(unsigned int irq)
 {
+	/* Message signaled interrupts are acknowledged at the local APIC */
+	if (IRQ_IS_MSI(irq)) {
+		apic_ack_interrupt();
+		return;
+	}
+
 	if (!IRQ_ON_MASTER(irq))
 		outb(PIC2_COMMAND, PIC_EOI);
 
@@ -98,6 +107,10 @@ void intctrl_mask_irq(unsigned int irq)
 {
 	__u16 port;
 
+	/* MSIs are masked at the device */
+	if (IRQ_IS_MSI(irq))
+		return;
+
 	port = IRQ_PORT(irq);
 	outb(port, inb(port) | (1 << IRQ_OFFSET(irq)));
 }
@@ -106,6 +119,9 @@ void intctrl_clear_irq(unsigned int irq)
 {
 	__u16 port;
 
+	if (IRQ_IS_MSI(irq))
+		return;
+
 	port = IRQ_PORT(irq);
 	outb(port, inb(port) & ~(1 << IRQ_OFFSET(irq)));
 }
@@ -33,6 +33,7 @@
 
 #define COM1_DATA (COM1 + 0)
 #define COM1_INTR (COM1 + 1)
+#define COM1_FIFO (COM1 + 2)
 #define COM1_CTRL (COM1 + 3)
 #define COM1_STATUS (COM1 + 5)
 
@@ -55,6 +56,10 @@
 
 #define DLAB 0x80
 #define PROT 0x03 /* 8N1 (8 bits, no parity, one stop bit) */
+#define FIFO 0x07 /* Enable and clear FIFOs */
+
+/* Bytes that fit into the transmit FIFO once it reported empty */
+#define COM1_TX_FIFO_SIZE 16
 
 void _libkvmplat_init_serial_console(void)
 {
@@ -63,6 +68,7 @@ void _libkvmplat_init_serial_console(void)
 	outb(COM1_DIV_LO, COM1_BAUDDIV_LO);/* Div (lo byte) */
 	outb(COM1_DIV_HI, COM1_BAUDDIV_HI);/*     (hi byte) */
 	outb(COM1_CTRL, PROT);  /* Set 8N1, clear DLAB */
+	outb(COM1_FIFO, FIFO);  /* Enable FIFOs */
 }
 
 static int serial_tx_empty(void)
@@ -85,6 +91,33 @@ void _libkvmplat_serial_putc(char a)
 	serial_write(a);
 }
 
+unsigned int _libkvmplat_serial_write(const char *buf, unsigned int len)
+{
+	unsigned int i, room = 0;
+	int cr = 0;
+
+	/* Poll the status only once per FIFO fill instead of once per
+	 * character, each poll is a VM exit
+	 */
+	for (i = 0; i < len; ) {
+		if (!room) {
+			while (!serial_tx_empty())
+				;
+			room = COM1_TX_FIFO_SIZE;
+		}
+
+		if (buf[i] == '\n' && !cr) {
+			outb(COM1_DATA, '\r');
+			cr = 1;
+		} else {
+			outb(COM1_DATA, buf[i++]);
+			cr = 0;
+		}
+		room--;
+	}
+	return len;
+}
+
 static int serial_rx_ready(void)
 {
 	return inb(COM1_STATUS) & 0x01;
@@ -56,12 +56,14 @@ __nsec ukplat_wall_clock(void)
 	return tscclock_monotonic() + tscclock_epochoffset();
 }
 
-/* NB: If this ever does more than an immediate return, it will need to be
- * compiled with NO_X86_EXTREGS_FLAGS to prevent potential clobbering of
- * registers that are not saved on interrupt handling.
+/* NB: This file is built with the ISR flags because the handler runs in
+ * interrupt context, where extended registers are not saved. It must only
+ * call inline functions or code that is built the same way.
  */
 static int timer_handler(void *arg __unused)
 {
+	tscclock_ack_irq();
+
 	/* Yes, we handled the irq. */
 	return 1;
 }
@@ -59,6 +59,14 @@
 #include <uk/print.h>
 #include <uk/assert.h>
 #include <uk/bitops.h>
+#include <uk/essentials.h>
+#include <uk/plat/io.h>
+#include <uk/plat/common/lcpu.h>
+#include <kvm/tscclock.h>
+#include <kvm/console.h>
+#if CONFIG_KVM_LAPIC_TIMER
+#include <x86/apic.h>
+#endif /* CONFIG_KVM_LAPIC_TIMER */
 
 #define TIMER_CNTR           0x40
 #define TIMER_MODE           0x43
@@ -82,6 +90,15 @@
 #define	RTC_STATUS_A         0x0a
 #define	RTC_UIP              (1<<7)
 
+#define KVM_CPUID_SIGNATURE                0x40000000
+#define KVM_CPUID_FEATURES                 0x40000001
+#define KVM_FEATURE_CLOCKSOURCE2           (1<<3)
+#define KVM_FEATURE_CLOCKSOURCE_STABLE_BIT (1<<24)
+#define MSR_KVM_WALL_CLOCK_NEW             0x4b564d00
+#define MSR_KVM_SYSTEM_TIME_NEW            0x4b564d01
+#define PVCLOCK_SYSTEM_TIME_ENABLE         (1<<0)
+#define PVCLOCK_TSC_STABLE_BIT             (1<<0)
+
 /*
  * Compile-time check to make sure we don't tick faster than the PIT can go.
  * This is really only a basic sanity check. We'll run into serious issues WAY
@@ -98,8 +115,11 @@ static __u64 rtc_epochoffset;
  * TSC clock specific.
  */
 
-/* Base time values at the last call to tscclock_monotonic(). */
-static __u64 time_base;
+/*
+ * TSC value at monotonic time 0. It is never updated afterwards, so that
+ * readers on any CPU (and the vDSO) compute the same time without
+ * synchronization.
+ */
 static __u64 tsc_base;
 
 /* Multiplier for converting TSC ticks to nsecs. (0.32) fixed point. */
@@ -116,6 +136,340 @@ static __u32 tsc_mult;
 static const __u32 pit_mult =
 	(1ULL << 63) / ((UKARCH_NSEC_PER_SEC << 31) / TIMER_HZ);
 
+#if CONFIG_KVM_PVCLOCK
+/*
+ * KVM paravirtual clock (kvmclock) specific.
+ */
+
+/*
+ * Time information published by the hypervisor for a single vCPU. The host
+ * updates it whenever the TSC of the vCPU changes frequency or gets
+ * rebased, e.g., after a migration. An odd `version` means an update is in
+ * progress. Each instance gets its own cache line, which also keeps it
+ * from crossing a page boundary.
+ */
+struct pvclock_vcpu_time_info {
+	__u32 version;
+	__u32 pad0;
+	__u64 tsc_timestamp;
+	__u64 system_time;
+	__u32 tsc_to_system_mul;
+	__s8  tsc_shift;
+	__u8  flags;
+	__u8  pad[2];
+} __packed __align(64);
+
+/* Host wall time at the point where `system_time` was 0 */
+struct pvclock_wall_clock {
+	__u32 version;
+	__u32 sec;
+	__u32 nsec;
+} __packed __align(4);
+
+static struct pvclock_vcpu_time_info pvclock_ti[CONFIG_UKPLAT_LCPU_MAXCOUNT];
+static struct pvclock_wall_clock pvclock_wc;
+
+/* Set once kvmclock is registered on the boot CPU */
+static int pvclock_enabled;
+/* The time info of all vCPUs is in sync and the boot CPU's can be used */
+static int pvclock_stable;
+/* kvmclock system time when the clock was initialized */
+static __u64 pvclock_base;
+/* Last returned value, to stay monotonic across unsynchronized vCPUs */
+static __u64 pvclock_last;
+
+static __u64 pvclock_read(const volatile struct pvclock_vcpu_time_info *ti)
+{
+	__u32 version;
+	__u64 delta, ns;
+
+	do {
+		version = ti->version;
+		rmb();
+		delta = rdtsc() - ti->tsc_timestamp;
+		if (ti->tsc_shift >= 0)
+			delta <<= ti->tsc_shift;
+		else
+			delta >>= -ti->tsc_shift;
+		ns = ti->system_time + mul64_32(delta, ti->tsc_to_system_mul);
+		rmb();
+	} while ((version & 1) || version != ti->version);
+
+	return ns;
+}
+
+static __u64 pvclock_monotonic(void)
+{
+	__u64 now, last;
+
+	if (pvclock_stable)
+		return pvclock_read(&pvclock_ti[0]) - pvclock_base;
+
+	/*
+	 * Without the stable bit the per-vCPU clocks can drift apart. Never
+	 * return a value smaller than one already returned on another vCPU.
+	 */
+	now = pvclock_read(&pvclock_ti[ukplat_lcpu_idx()]) - pvclock_base;
+	last = __atomic_load_n(&pvclock_last, __ATOMIC_RELAXED);
+	do {
+		if (now <= last)
+			return last;
+	} while (!__atomic_compare_exchange_n(&pvclock_last, &last, now, 0,
+					      __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+
+	return now;
+}
+
+static void pvclock_register(__lcpuidx idx)
+{
+	wrmsrl(MSR_KVM_SYSTEM_TIME_NEW,
+	       ukplat_virt_to_phys(&pvclock_ti[idx]) |
+	       PVCLOCK_SYSTEM_TIME_ENABLE);
+}
+
+/*
+ * Register kvmclock on the boot CPU and compute the epoch offset from the
+ * host wall clock. Returns the TSC frequency, or 0 if kvmclock is not
+ * available.
+ */
+static __u64 pvclock_init(void)
+{
+	__u32 eax, ebx, ecx, edx;
+	__u32 version;
+	__u64 wall_boot, tsc_freq;
+	__s8 shift;
+
+	cpuid(KVM_CPUID_SIGNATURE, 0, &eax, &ebx, &ecx, &edx);
+	/* "KVMKVMKVM\0\0\0" */
+	if (ebx != 0x4b4d564b || ecx != 0x564b4d56 || edx != 0x0000004d)
+		return 0;
+	if (eax < KVM_CPUID_FEATURES)
+		return 0;
+
+	cpuid(KVM_CPUID_FEATURES, 0, &eax, &ebx, &ecx, &edx);
+	if (!(eax & KVM_FEATURE_CLOCKSOURCE2))
+		return 0;
+
+	pvclock_register(0);
+
+	pvclock_stable = (eax & KVM_FEATURE_CLOCKSOURCE_STABLE_BIT) &&
+			 (UK_READ_ONCE(pvclock_ti[0].flags) &
+			  PVCLOCK_TSC_STABLE_BIT);
+
+	wrmsrl(MSR_KVM_WALL_CLOCK_NEW, ukplat_virt_to_phys(&pvclock_wc));
+	do {
+		version = UK_READ_ONCE(pvclock_wc.version);
+		rmb();
+		wall_boot = pvclock_wc.sec * UKARCH_NSEC_PER_SEC +
+			    pvclock_wc.nsec;
+		rmb();
+	} while ((version & 1) || version != UK_READ_ONCE(pvclock_wc.version));
+
+	pvclock_base = pvclock_read(&pvclock_ti[0]);
+	rtc_epochoffset = wall_boot + pvclock_base;
+	pvclock_enabled = 1;
+
+	/*
+	 * Derive the TSC frequency from the scaling parameters:
+	 * ns = ((ticks << shift) * mul) >> 32.
+	 */
+	tsc_freq = (UKARCH_NSEC_PER_SEC << 32) /
+		   UK_READ_ONCE(pvclock_ti[0].tsc_to_system_mul);
+	shift = UK_READ_ONCE(pvclock_ti[0].tsc_shift);
+	if (shift >= 0)
+		tsc_freq >>= shift;
+	else
+		tsc_freq <<= -shift;
+
+	return tsc_freq;
+}
+#endif /* CONFIG_KVM_PVCLOCK */
+
+#if CONFIG_KVM_LAPIC_TIMER
+/*
+ * Local APIC timer specific.
+ */
+
+/* The local APIC timer raises the vector of the PIT interrupt (IRQ 0) */
+#define LAPIC_TIMER_VECTOR	32
+
+/*
+ * Upper bound for a single sleep. Longer sleeps are split, but the limit is
+ * high enough that an idle VM practically never wakes up without reason.
+ */
+#define LAPIC_MAX_DELTA_NS	(3600 * UKARCH_NSEC_PER_SEC)
+
+enum tscclock_lapic_timer_mode tscclock_lapic_timer_mode;
+
+/*
+ * Timer ticks per nsec: integral part and (0.32) fixed point fraction. The
+ * timer counts TSC ticks in TSC-deadline mode and APIC bus clock ticks in
+ * one-shot mode.
+ */
+static __u64 lapic_ticks_int;
+static __u32 lapic_ticks_frac;
+
+static void lapic_timer_set_freq(__u64 freq)
+{
+	lapic_ticks_int = freq / UKARCH_NSEC_PER_SEC;
+	lapic_ticks_frac = ((freq % UKARCH_NSEC_PER_SEC) << 32) /
+			   UKARCH_NSEC_PER_SEC;
+}
+
+static inline __u64 lapic_ns_to_ticks(__u64 ns)
+{
+	return ns * lapic_ticks_int + mul64_32(ns, lapic_ticks_frac);
+}
+
+/*
+ * Program the timer LVT of the executing CPU. Each CPU has its own timer.
+ */
+static void lapic_timer_lcpu_init(void)
+{
+	if (tscclock_lapic_timer_mode == LAPIC_TIMER_DEADLINE) {
+		wrmsr(APIC_MSR_LVT_TIMER,
+		      LAPIC_TIMER_VECTOR | APIC_LVT_TIMER_TSC_DEADLINE, 0);
+	} else {
+		wrmsr(APIC_MSR_TIMER_DCR, APIC_TIMER_DCR_DIV1, 0);
+		wrmsr(APIC_MSR_LVT_TIMER,
+		      LAPIC_TIMER_VECTOR | APIC_LVT_TIMER_ONESHOT, 0);
+	}
+}
+
+/*
+ * Measure the APIC timer frequency against the already calibrated TSC.
+ * This takes 1ms.
+ */
+static __u64 lapic_timer_calibrate(__u64 tsc_freq)
+{
+	__u64 tsc_start;
+	__u32 eax, edx;
+
+	wrmsr(APIC_MSR_TIMER_DCR, APIC_TIMER_DCR_DIV1, 0);
+	wrmsr(APIC_MSR_LVT_TIMER, APIC_LVT_MASKED | APIC_LVT_TIMER_ONESHOT, 0);
+	wrmsr(APIC_MSR_TIMER_IC, 0xffffffff, 0);
+
+	tsc_start = rdtsc();
+	while (rdtsc() - tsc_start < tsc_freq / 1000)
+		ukarch_spinwait();
+
+	rdmsr(APIC_MSR_TIMER_CC, &eax, &edx);
+	wrmsr(APIC_MSR_TIMER_IC, 0, 0);
+
+	return (__u64)(0xffffffff - eax) * 1000;
+}
+
+static int lapic_timer_init(__u64 tsc_freq)
+{
+	__u32 eax, ebx, ecx, edx;
+	__u64 apic_freq = 0;
+	int rc;
+
+	cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+	rc = apic_enable();
+	if (unlikely(rc))
+		return rc;
+
+	if (ecx & X86_CPUID1_ECX_TSC_DEADLINE) {
+		tscclock_lapic_timer_mode = LAPIC_TIMER_DEADLINE;
+		lapic_timer_set_freq(tsc_freq);
+		uk_pr_info("Timer: local APIC, TSC-deadline mode\n");
+	} else {
+		/*
+		 * The hypervisor generic timing leaf reports the APIC bus
+		 * frequency in kHz in EBX.
+		 */
+		cpuid(0x40000000, 0, &eax, &ebx, &ecx, &edx);
+		if (eax >= 0x40000010) {
+			cpuid(0x40000010, 0, &eax, &ebx, &ecx, &edx);
+			apic_freq = (__u64)ebx * 1000;
+		}
+		if (!apic_freq)
+			apic_freq = lapic_timer_calibrate(tsc_freq);
+		if (unlikely(!apic_freq))
+			return -ENOTSUP;
+
+		tscclock_lapic_timer_mode = LAPIC_TIMER_ONESHOT;
+		lapic_timer_set_freq(apic_freq);
+		uk_pr_info("Timer: local APIC, one-shot mode at %llu Hz\n",
+			   (unsigned long long) apic_freq);
+	}
+
+	lapic_timer_lcpu_init();
+	return 0;
+}
+
+/*
+ * Arm the local APIC timer of this CPU and halt. See tscclock_cpu_block().
+ */
+static void lapic_cpu_block(__u64 until)
+{
+	__u64 now, delta_ns, ticks;
+
+	now = ukplat_monotonic_clock();
+	if (until <= now)
+		return;
+
+	delta_ns = MIN(until - now, LAPIC_MAX_DELTA_NS);
+	ticks = lapic_ns_to_ticks(delta_ns);
+
+	/*
+	 * Unlike the PIT, there is no minimum delta: a deadline or count that
+	 * has already expired raises the interrupt right after `sti`.
+	 */
+	if (tscclock_lapic_timer_mode == LAPIC_TIMER_DEADLINE) {
+		wrmsrl(X86_MSR_TSC_DEADLINE, rdtsc() + ticks);
+	} else {
+		/* A zero initial count stops the timer */
+		ticks = MAX(MIN(ticks, 0xffffffffULL), 1ULL);
+		wrmsr(APIC_MSR_TIMER_IC, (__u32) ticks, 0);
+	}
+
+	ukplat_lcpu_halt_irq();
+}
+#endif /* CONFIG_KVM_LAPIC_TIMER */
+
+/*
+ * Set up the per-CPU clock and timer state of a secondary CPU.
+ */
+void lcpu_time_init(struct lcpu *this_lcpu __maybe_unused)
+{
+#if CONFIG_KVM_PVCLOCK
+	/*
+	 * Secondary CPUs register their own time info so that the hypervisor
+	 * keeps it up-to-date with their TSC.
+	 */
+	if (pvclock_enabled)
+		pvclock_register(this_lcpu->idx);
+#endif /* CONFIG_KVM_PVCLOCK */
+#if CONFIG_KVM_LAPIC_TIMER
+	if (tscclock_lapic_timer_mode != LAPIC_TIMER_NONE)
+		lapic_timer_lcpu_init();
+#endif /* CONFIG_KVM_LAPIC_TIMER */
+}
+
+/*
+ * Set up the one-shot timer used by tscclock_cpu_block(). The local APIC
+ * timer is preferred as it can be armed with a single MSR write, while
+ * reprogramming the PIT takes two port writes (i.e., two VM exits) and
+ * limits a sleep to 65535 PIT ticks.
+ */
+static void tscclock_timer_init(__u64 tsc_freq __maybe_unused)
+{
+	/*
+	 * Initialise i8254 timer channel 0 to mode 4 (one shot). This also
+	 * stops the rate generator used for calibration until the PIT is
+	 * programmed with a count.
+	 */
+	outb(TIMER_MODE, TIMER_SEL0 | TIMER_ONESHOT | TIMER_16BIT);
+
+#if CONFIG_KVM_LAPIC_TIMER
+	if (lapic_timer_init(tsc_freq) < 0)
+		uk_pr_info("Timer: i8254 PIT\n");
+#endif /* CONFIG_KVM_LAPIC_TIMER */
+}
+
 
 /*
  * Read the current i8254 channel 0 tick count.
@@ -198,18 +552,34 @@ static __u64 rtc_gettimeofday(void)
  */
 __u64 tscclock_monotonic(void)
 {
-	__u64 tsc_now, tsc_delta;
+#if CONFIG_KVM_PVCLOCK
+	if (pvclock_enabled)
+		return pvclock_monotonic();
+#endif /* CONFIG_KVM_PVCLOCK */
 
-	/*
-	 * Update time_base (monotonic time) and tsc_base (TSC time).
-	 */
-	tsc_now = rdtsc();
-	tsc_delta = tsc_now - tsc_base;
-	time_base += mul64_32(tsc_delta, tsc_mult);
-	tsc_base = tsc_now;
+	return mul64_32(rdtsc() - tsc_base, tsc_mult);
+}
+
+#if CONFIG_UKPLAT_VDSO
+/*
+ * Return monotonic time like tscclock_monotonic() but without depending on
+ * the current CPU or writing shared state, so that it can be called from
+ * application context (vDSO). Returns 0 if the clock cannot be read this
+ * way and a system call is needed.
+ */
+__u64 tscclock_vdso_monotonic(void)
+{
+#if CONFIG_KVM_PVCLOCK
+	if (pvclock_enabled) {
+		if (!pvclock_stable)
+			return 0;
+		return pvclock_read(&pvclock_ti[0]) - pvclock_base;
+	}
+#endif /* CONFIG_KVM_PVCLOCK */
 
-	return time_base;
+	return mul64_32(rdtsc() - tsc_base, tsc_mult);
 }
+#endif /* CONFIG_UKPLAT_VDSO */
 
 /*
  * Calibrate TSC and initialise TSC clock.
@@ -219,6 +589,24 @@ int tscclock_init(void)
 	__u64 tsc_freq = 0, rtc_boot;
 	__u32 eax, ebx, ecx, edx;
 
+#if CONFIG_KVM_PVCLOCK
+	/*
+	 * Prefer the paravirtual clock: it needs neither calibration nor
+	 * RTC reads, and the hypervisor keeps it accurate across frequency
+	 * changes and migration.
+	 */
+	tsc_freq = pvclock_init();
+	if (tsc_freq) {
+		tsc_mult = (UKARCH_NSEC_PER_SEC << 32) / tsc_freq;
+		uk_pr_info("Clock source: kvmclock%s, TSC frequency is %llu Hz\n",
+			   pvclock_stable ? " (stable TSC)" : "",
+			   (unsigned long long) tsc_freq);
+
+		tscclock_timer_init(tsc_freq);
+		return 0;
+	}
+#endif /* CONFIG_KVM_PVCLOCK */
+
 	/* Initialise i8254 timer channel 0 to mode 2 at CONFIG_HZ frequency */
 	outb(TIMER_MODE, TIMER_SEL0 | TIMER_RATEGEN | TIMER_16BIT);
 	outb(TIMER_CNTR, (TIMER_HZ / CONFIG_HZ) & 0xff);
@@ -261,11 +649,6 @@ int tscclock_init(void)
 	 *
 	 * (0.32) tsc_mult = UKARCH_NSEC_PER_SEC (32.32) / tsc_freq (32.0)
 	 *
-	 * Warning, do not print anything between TSC calibration and the
-	 * setting of tsc_mult: if CONFIG_LIBUKDEBUG_PRINT_TIME is enabled
-	 * this will trigger a reset of tsc_base via tscclock_monotonic
-	 * and delay the clock starting point.
-	 *
 	 * FIXME: this will overflow with small TSC frequencies. We should
 	 * probably calculate the TSC shift dynamically like solo5/hvt does.
 	 */
@@ -276,20 +659,12 @@ int tscclock_init(void)
 
 	/*
 	 * Monotonic time begins at tsc_base (first read of TSC before
-	 * calibration).
-	 */
-	tscclock_monotonic();
-
-	/*
-	 * Compute RTC epoch offset by subtracting monotonic time_base from RTC
-	 * time at boot.
+	 * calibration). Compute RTC epoch offset by subtracting the current
+	 * monotonic time from RTC time at boot.
 	 */
-	rtc_epochoffset = rtc_boot - time_base;
+	rtc_epochoffset = rtc_boot - tscclock_monotonic();
 
-	/*
-	 * Initialise i8254 timer channel 0 to mode 4 (one shot).
-	 */
-	outb(TIMER_MODE, TIMER_SEL0 | TIMER_ONESHOT | TIMER_16BIT);
+	tscclock_timer_init(tsc_freq);
 
 	return 0;
 }
@@ -327,6 +702,13 @@ static void tscclock_cpu_block(__u64 until)
 
 	UK_ASSERT(ukplat_lcpu_irqs_disabled());
 
+#if CONFIG_KVM_LAPIC_TIMER
+	if (tscclock_lapic_timer_mode != LAPIC_TIMER_NONE) {
+		lapic_cpu_block(until);
+		return;
+	}
+#endif /* CONFIG_KVM_LAPIC_TIMER */
+
 	now = ukplat_monotonic_clock();
 
 	/*
@@ -382,6 +764,11 @@ unsigned long sched_have_pending_events;
 
 void time_block_until(__snsec until)
 {
+#if CONFIG_KVM_CONSOLE_RING
+	/* Write out buffered console output while there is nothing to do */
+	_libkvmplat_console_idle();
+#endif
+
 	while ((__snsec) ukplat_monotonic_clock() < until) {
 		tscclock_cpu_block(until);
 
@@ -0,0 +1,345 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*
+ * Copyright (c) 2022, The Unikraft Authors. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Virtual dynamic shared object (vDSO) for binary-compatible applications.
+ *
+ * Applications in binary-compatibility mode share the address space with
+ * the kernel, so the vDSO does not need a separate mapping: it is a
+ * read-only ELF image in the kernel that describes functions of the kernel
+ * with their absolute addresses. These functions read the TSC-based clock
+ * directly and only fall back to a system call if the clock source cannot
+ * be read from application context. The image is made available to the
+ * application C library through the `AT_SYSINFO_EHDR` auxiliary vector entry.
+ */
+
+#include <uk/config.h>
+#include <uk/essentials.h>
+#include <uk/arch/lcpu.h>
+#include <uk/arch/limits.h>
+#include <uk/arch/time.h>
+#include <uk/plat/time.h>
+#include <kvm/tscclock.h>
+
+/* Linux x86_64 ABI */
+#define VDSO_NR_gettimeofday		96
+#define VDSO_NR_time			201
+#define VDSO_NR_clock_gettime		228
+#define VDSO_NR_clock_getres		229
+
+#define VDSO_CLOCK_REALTIME		0
+#define VDSO_CLOCK_MONOTONIC		1
+#define VDSO_CLOCK_MONOTONIC_COARSE	6
+
+struct vdso_timespec {
+	long tv_sec;
+	long tv_nsec;
+};
+
+struct vdso_timeval {
+	long tv_sec;
+	long tv_usec;
+};
+
+static inline long vdso_syscall(long nr, long arg1, long arg2)
+{
+	long ret;
+
+	__asm__ __volatile__ (
+		"syscall"
+		: "=a" (ret)
+		: "a" (nr), "D" (arg1), "S" (arg2)
+		: "rcx", "r11", "memory"
+	);
+
+	return ret;
+}
+
+/* Returns the time of a clock, or 0 if a system call is needed */
+static inline __nsec vdso_clock_read(int clk)
+{
+	__nsec now;
+
+	switch (clk) {
+	case VDSO_CLOCK_MONOTONIC:
+	case VDSO_CLOCK_MONOTONIC_COARSE:
+		return tscclock_vdso_monotonic();
+	case VDSO_CLOCK_REALTIME:
+		now = tscclock_vdso_monotonic();
+		if (unlikely(!now))
+			return 0;
+		return now + tscclock_epochoffset();
+	default:
+		return 0;
+	}
+}
+
+static long vdso_clock_gettime(int clk, struct vdso_timespec *tp)
+{
+	__nsec now;
+
+	if (unlikely(!tp))
+		goto syscall;
+
+	now = vdso_clock_read(clk);
+	if (unlikely(!now))
+		goto syscall;
+
+	tp->tv_sec = ukarch_time_nsec_to_sec(now);
+	tp->tv_nsec = ukarch_time_subsec(now);
+	return 0;
+
+syscall:
+	return vdso_syscall(VDSO_NR_clock_gettime, clk, (long) tp);
+}
+
+static long vdso_gettimeofday(struct vdso_timeval *tv, void *tz)
+{
+	__nsec now;
+
+	if (unlikely(!tv))
+		goto syscall;
+
+	now = vdso_clock_read(VDSO_CLOCK_REALTIME);
+	if (unlikely(!now))
+		goto syscall;
+
+	tv->tv_sec = ukarch_time_nsec_to_sec(now);
+	tv->tv_usec = ukarch_time_nsec_to_usec(ukarch_time_subsec(now));
+	return 0;
+
+syscall:
+	return vdso_syscall(VDSO_NR_gettimeofday, (long) tv, (long) tz);
+}
+
+static long vdso_time(long *tloc)
+{
+	__nsec now;
+	long secs;
+
+	now = vdso_clock_read(VDSO_CLOCK_REALTIME);
+	if (unlikely(!now))
+		return vdso_syscall(VDSO_NR_time, (long) tloc, 0);
+
+	secs = ukarch_time_nsec_to_sec(now);
+	if (tloc)
+		*tloc = secs;
+	return secs;
+}
+
+static long vdso_clock_getres(int clk, struct vdso_timespec *tp)
+{
+	switch (clk) {
+	case VDSO_CLOCK_REALTIME:
+	case VDSO_CLOCK_MONOTONIC:
+	case VDSO_CLOCK_MONOTONIC_COARSE:
+		if (unlikely(!tp))
+			break;
+		tp->tv_sec = 0;
+		tp->tv_nsec = UKPLAT_TIME_TICK_NSEC;
+		return 0;
+	default:
+		break;
+	}
+
+	return vdso_syscall(VDSO_NR_clock_getres, clk, (long) tp);
+}
+
+/*
+ * ELF image
+ */
+#define VDSO_ELFCLASS64		2
+#define VDSO_ELFDATA2LSB	1
+#define VDSO_EV_CURRENT		1
+#define VDSO_ET_DYN		3
+#define VDSO_EM_X86_64		62
+#define VDSO_PT_LOAD		1
+#define VDSO_PT_DYNAMIC		2
+#define VDSO_PF_X		0x1
+#define VDSO_PF_R		0x4
+#define VDSO_DT_NULL		0
+#define VDSO_DT_HASH		4
+#define VDSO_DT_STRTAB		5
+#define VDSO_DT_SYMTAB		6
+#define VDSO_DT_STRSZ		10
+#define VDSO_DT_SYMENT		11
+#define VDSO_DT_SONAME		14
+#define VDSO_SHN_ABS		0xfff1
+#define VDSO_STB_GLOBAL		1
+#define VDSO_STT_FUNC		2
+
+struct vdso_elf64_ehdr {
+	__u8  e_ident[16];
+	__u16 e_type;
+	__u16 e_machine;
+	__u32 e_version;
+	__u64 e_entry;
+	__u64 e_phoff;
+	__u64 e_shoff;
+	__u32 e_flags;
+	__u16 e_ehsize;
+	__u16 e_phentsize;
+	__u16 e_phnum;
+	__u16 e_shentsize;
+	__u16 e_shnum;
+	__u16 e_shstrndx;
+};
+
+struct vdso_elf64_phdr {
+	__u32 p_type;
+	__u32 p_flags;
+	__u64 p_offset;
+	__u64 p_vaddr;
+	__u64 p_paddr;
+	__u64 p_filesz;
+	__u64 p_memsz;
+	__u64 p_align;
+};
+
+struct vdso_elf64_dyn {
+	__s64 d_tag;
+	__u64 d_val;
+};
+
+struct vdso_elf64_sym {
+	__u32 st_name;
+	__u8  st_info;
+	__u8  st_other;
+	__u16 st_shndx;
+	__u64 st_value;
+	__u64 st_size;
+};
+
+struct vdso_strtab {
+	char null[1];
+	char soname[sizeof("linux-vdso.so.1")];
+	char clock_gettime[sizeof("__vdso_clock_gettime")];
+	char gettimeofday[sizeof("__vdso_gettimeofday")];
+	char time[sizeof("__vdso_time")];
+	char clock_getres[sizeof("__vdso_clock_getres")];
+};
+
+#define VDSO_NSYMS 5 /* including the null symbol */
+
+struct vdso_image {
+	struct vdso_elf64_ehdr ehdr;
+	struct vdso_elf64_phdr phdr[2];
+	struct vdso_elf64_dyn dyn[7];
+	/* nbucket, nchain, bucket[1], chain[VDSO_NSYMS] */
+	__u32 hash[2 + 1 + VDSO_NSYMS];
+	struct vdso_elf64_sym sym[VDSO_NSYMS];
+	struct vdso_strtab str;
+};
+
+static const struct vdso_image vdso_image;
+
+/*
+ * Symbols and dynamic section entries use absolute addresses: the load bias
+ * (image address minus `p_vaddr` of the loadable segment) is zero.
+ */
+#define VDSO_ADDR(member)						\
+	((__u64) &vdso_image + __offsetof(struct vdso_image, member))
+
+#define VDSO_STR(member)						\
+	__offsetof(struct vdso_strtab, member)
+
+#define VDSO_SYM(name, fn)						\
+	{								\
+		.st_name  = VDSO_STR(name),				\
+		.st_info  = (VDSO_STB_GLOBAL << 4) | VDSO_STT_FUNC,	\
+		.st_shndx = VDSO_SHN_ABS,				\
+		.st_value = (__u64) &(fn),				\
+	}
+
+static const struct vdso_image vdso_image __align(__PAGE_SIZE) = {
+	.ehdr = {
+		.e_ident     = { 0x7f, 'E', 'L', 'F', VDSO_ELFCLASS64,
+				 VDSO_ELFDATA2LSB, VDSO_EV_CURRENT },
+		.e_type      = VDSO_ET_DYN,
+		.e_machine   = VDSO_EM_X86_64,
+		.e_version   = VDSO_EV_CURRENT,
+		.e_phoff     = __offsetof(struct vdso_image, phdr),
+		.e_ehsize    = sizeof(struct vdso_elf64_ehdr),
+		.e_phentsize = sizeof(struct vdso_elf64_phdr),
+		.e_phnum     = ARRAY_SIZE(vdso_image.phdr),
+	},
+	.phdr = {
+		{
+			.p_type   = VDSO_PT_LOAD,
+			.p_flags  = VDSO_PF_R | VDSO_PF_X,
+			.p_offset = 0,
+			.p_vaddr  = VDSO_ADDR(ehdr),
+			.p_paddr  = VDSO_ADDR(ehdr),
+			.p_filesz = sizeof(struct vdso_image),
+			.p_memsz  = sizeof(struct vdso_image),
+			.p_align  = __PAGE_SIZE,
+		},
+		{
+			.p_type   = VDSO_PT_DYNAMIC,
+			.p_flags  = VDSO_PF_R,
+			.p_offset = __offsetof(struct vdso_image, dyn),
+			.p_vaddr  = VDSO_ADDR(dyn),
+			.p_paddr  = VDSO_ADDR(dyn),
+			.p_filesz = sizeof(vdso_image.dyn),
+			.p_memsz  = sizeof(vdso_image.dyn),
+			.p_align  = 8,
+		},
+	},
+	.dyn = {
+		{ VDSO_DT_HASH,   VDSO_ADDR(hash) },
+		{ VDSO_DT_STRTAB, VDSO_ADDR(str) },
+		{ VDSO_DT_SYMTAB, VDSO_ADDR(sym) },
+		{ VDSO_DT_STRSZ,  sizeof(struct vdso_strtab) },
+		{ VDSO_DT_SYMENT, sizeof(struct vdso_elf64_sym) },
+		{ VDSO_DT_SONAME, VDSO_STR(soname) },
+		{ VDSO_DT_NULL,   0 },
+	},
+	/* A single bucket that chains all symbols */
+	.hash = { 1, VDSO_NSYMS, 1, 0, 2, 3, 4, 0 },
+	.sym = {
+		{ 0 },
+		VDSO_SYM(clock_gettime, vdso_clock_gettime),
+		VDSO_SYM(gettimeofday, vdso_gettimeofday),
+		VDSO_SYM(time, vdso_time),
+		VDSO_SYM(clock_getres, vdso_clock_getres),
+	},
+	.str = {
+		.soname        = "linux-vdso.so.1",
+		.clock_gettime = "__vdso_clock_gettime",
+		.gettimeofday  = "__vdso_gettimeofday",
+		.time          = "__vdso_time",
+		.clock_getres  = "__vdso_clock_getres",
+	},
+};
+
+const void *ukplat_vdso_image(void)
+{
+	return &vdso_image.ehdr;
+}